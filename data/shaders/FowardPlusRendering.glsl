@@ -1,44 +1,52 @@
-// #version 330 core
-
-// #ifndef BLOCK_SIZE
-// #pragma message("BLOCK_SIZE not defined, defaulting to 16")
-// #define BLOCK_SIZE 16
-// #endif
-
-// struct ComputeShaderInput {
-//   uint3 groupID : SV_GroupID;
-//   uint3 groupThreadID : SV_GroupThreadID;
-//   uint3 dispatchThreadID : SV_DispatchThreadID;
-//   uint groupIndex : SV_GroupIndex;
-// };
-
 #version 430 core
-layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
-
-uniform ivec2 uScreenSize;  // Screen dimensions in pixels
+// Clustered Forward+: builds one view-space AABB per cluster.
+// Dispatched with one work group per cluster (uGridSize.x, uGridSize.y, uGridSize.z); only rerun
+// when the projection changes. CPU reference: computeClusterBounds() in clustered_lighting.h
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+struct ClusterAABB {
+    vec4 minPoint;
+    vec4 maxPoint;
+};
 
-struct Plane {
-    vec3 normal;
-    float distance;
+layout(std430, binding = 1) writeonly buffer ClusterBounds {
+    ClusterAABB clusters[];
 };
 
-Plane ComputePlane(vec3 pointA, vec3 pointB, vec3 pointC) {
-  Plane plane;
-  vec3 edge1 = pointB - pointA;
-  vec3 edge2 = pointC - pointA;
-  plane.normal = normalize(cross(edge1, edge2));
-  plane.distance = -dot(plane.normal, pointA);
-  return plane;
+uniform uvec3 uGridSize;
+uniform float uZNear;
+uniform float uZFar;
+uniform mat4 uInvProjection;
+
+vec3 ndcToView(vec2 ndc) {
+    vec4 v = uInvProjection * vec4(ndc, -1.0, 1.0);
+    return v.xyz / v.w;
 }
 
-struct Frustum {
-    Plane planes[6]; // 0: Near, 1: Far, 2: Left, 3: Right, 4: Top, 5: Bottom
-};
+// point where the eye ray through dir crosses the plane z = zDistance
+vec3 rayToZPlane(vec3 dir, float zDistance) {
+    return dir * (zDistance / dir.z);
+}
 
 void main() {
-  // Accessing compute shader built-in variables
-  uvec3 groupID = gl_WorkGroupID;             // SV_GroupID
-  uvec3 localID = gl_LocalInvocationID;       // SV_GroupThreadID
-  uvec3 globalID = gl_GlobalInvocationID;     // SV_DispatchThreadID
-  uint localIndex = gl_LocalInvocationIndex;  // Flattened index within the workgroup
-}
\ No newline at end of file
+    uvec3 cluster = gl_WorkGroupID;
+    uint index = cluster.x + cluster.y * uGridSize.x + cluster.z * uGridSize.x * uGridSize.y;
+
+    vec2 ndcMin = vec2(cluster.xy) / vec2(uGridSize.xy) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(cluster.xy + 1u) / vec2(uGridSize.xy) * 2.0 - 1.0;
+    vec3 minNear = ndcToView(ndcMin);
+    vec3 maxNear = ndcToView(ndcMax);
+
+    // exponential slicing keeps clusters roughly cubic in view space
+    float ratio = uZFar / uZNear;
+    float sliceNear = -uZNear * pow(ratio, float(cluster.z) / float(uGridSize.z));
+    float sliceFar = -uZNear * pow(ratio, float(cluster.z + 1u) / float(uGridSize.z));
+
+    vec3 a = rayToZPlane(minNear, sliceNear);
+    vec3 b = rayToZPlane(minNear, sliceFar);
+    vec3 c = rayToZPlane(maxNear, sliceNear);
+    vec3 d = rayToZPlane(maxNear, sliceFar);
+
+    clusters[index].minPoint = vec4(min(min(a, b), min(c, d)), 0.0);
+    clusters[index].maxPoint = vec4(max(max(a, b), max(c, d)), 0.0);
+}
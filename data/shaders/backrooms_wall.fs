@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 out vec4 FragColor;
 
 struct Material {
@@ -24,9 +24,12 @@ struct SpotLight {
 
 #define NR_POINT_LIGHTS 4
 
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
+in VS_OUT {
+  vec3 FragPos;
+  vec3 Normal;
+  vec2 Tex;
+  flat int MaterialID;
+};
 
 uniform vec3 viewPos;
 uniform SpotLight spotLight;
@@ -75,9 +78,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
   float epsilon = light.cutOff - light.outerCutOff;
   float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-  vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-  vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-  vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+  vec3 ambient = light.ambient * vec3(texture(material.diffuse, Tex));
+  vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, Tex));
+  vec3 specular = light.specular * spec * vec3(texture(material.specular, Tex));
   // ambient *= attenuation * intensity;
   diffuse *= attenuation * intensity;
   specular *= attenuation * intensity;
@@ -1,25 +1,42 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in uint aWallData;
+// packed wall, divisor 1; location 8 because 3..7 belong to the mesh semantics and the
+// GPU-driven instance index (see vertex_layout.h, maze_streaming.h)
+layout (location = 8) in uint aWallData;
 
 #define PI 3.14159265359
 #define gridSize 1.0
 
-out vec3 FragPos;
-out vec3 Normal;
-out vec2 TexCoords;
+uniform vec2 uChunkOrigin; // world x/z of the chunk's cell (0, 0)
+uniform int uMaterialID;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    mat4 viewProjection;         // unjittered, for motion vectors
+    mat4 previousViewProjection;
+} camera;
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 Tex;
+    flat int MaterialID;
+    vec4 CurrentClip;  // unjittered, this frame and last; deferred.fs writes the difference
+    vec4 PreviousClip;
+} vs_out;
 
 void main() {
   uint rotation = (aWallData >> 14) & 0x03u;  // Extract 2 rotation bits
   uint xPos = (aWallData >> 7) & 0x7Fu;       // Extract 7 x bits
   uint zPos = aWallData & 0x7Fu;              // Extract 7 z bits
 
-  vec3 worldPos = vec3(float(xPos) * gridSize, 0.0, float(zPos) * gridSize);
+  vec3 worldPos = vec3(uChunkOrigin.x + float(xPos) * gridSize, 0.0, uChunkOrigin.y + float(zPos) * gridSize);
 
   // Apply rotation based on wall data
   float angle = float(rotation) * (PI / 2.0);
@@ -39,11 +56,16 @@ void main() {
   );
 
   mat4 instanceModel = translationMatrix * rotationMatrix;
-  
+
   vec4 worldPosition = instanceModel * vec4(aPos, 1.0);
-  FragPos = worldPosition.xyz;
-  Normal = mat3(transpose(inverse(instanceModel))) * aNormal;
-  TexCoords = aTexCoords;
+  vs_out.FragPos = worldPosition.xyz;
+  // a rotation about Y: its own normal matrix
+  vs_out.Normal = mat3(rotationMatrix) * aNormal;
+  vs_out.Tex = aTexCoords;
+  vs_out.MaterialID = uMaterialID;
 
-  gl_Position = projection * view * worldPosition;
+  // walls are static: only the camera adds motion
+  vs_out.CurrentClip = camera.viewProjection * worldPosition;
+  vs_out.PreviousClip = camera.previousViewProjection * worldPosition;
+  gl_Position = camera.projection * camera.view * worldPosition;
 }
@@ -0,0 +1,94 @@
+#version 430 core
+// Clustered Forward+: assigns point lights to clusters.
+// One invocation per cluster; lights are staged through shared memory in batches of the group size.
+// CPU reference: cullLightsCPU() in clustered_lighting.h
+#define GROUP_SIZE 128
+#define MAX_LIGHTS_PER_CLUSTER 128
+layout(local_size_x = GROUP_SIZE) in;
+
+struct PointLight {
+    vec4 positionRadius; // xyz = position, w = radius
+    vec4 color;
+};
+
+struct ClusterAABB {
+    vec4 minPoint;
+    vec4 maxPoint;
+};
+
+struct LightGridEntry {
+    uint offset;
+    uint count;
+};
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+} camera;
+
+layout(std430, binding = 0) readonly buffer PointLights {
+    PointLight uPointLights[];
+};
+layout(std430, binding = 1) readonly buffer ClusterBounds {
+    ClusterAABB clusters[];
+};
+layout(std430, binding = 2) writeonly buffer LightGrid {
+    LightGridEntry lightGrid[];
+};
+layout(std430, binding = 3) writeonly buffer LightIndices {
+    uint lightIndices[];
+};
+layout(std430, binding = 4) buffer LightIndexCounter {
+    uint lightIndexCount;
+};
+
+uniform int uPointLightCount;
+uniform uint uClusterCount;
+
+shared vec4 sharedLights[GROUP_SIZE]; // view-space center, w = radius
+
+bool sphereIntersectsAABB(vec3 center, float radius, ClusterAABB box) {
+    vec3 d = max(max(box.minPoint.xyz - center, vec3(0.0)), center - box.maxPoint.xyz);
+    return dot(d, d) <= radius * radius;
+}
+
+void main() {
+    uint clusterIndex = gl_GlobalInvocationID.x;
+    bool active = clusterIndex < uClusterCount;
+
+    ClusterAABB box;
+    if (active)
+        box = clusters[clusterIndex];
+
+    uint visible[MAX_LIGHTS_PER_CLUSTER];
+    uint visibleCount = 0u;
+
+    uint lightCount = uint(uPointLightCount);
+    for (uint base = 0u; base < lightCount; base += GROUP_SIZE) {
+        uint lightIndex = base + gl_LocalInvocationIndex;
+        if (lightIndex < lightCount) {
+            vec4 light = uPointLights[lightIndex].positionRadius;
+            sharedLights[gl_LocalInvocationIndex] = vec4((camera.view * vec4(light.xyz, 1.0)).xyz, light.w);
+        }
+        barrier();
+
+        uint batch = min(uint(GROUP_SIZE), lightCount - base);
+        for (uint i = 0u; active && i < batch && visibleCount < MAX_LIGHTS_PER_CLUSTER; i++) {
+            if (sphereIntersectsAABB(sharedLights[i].xyz, sharedLights[i].w, box)) {
+                visible[visibleCount] = base + i;
+                visibleCount++;
+            }
+        }
+        barrier();
+    }
+
+    if (!active)
+        return;
+
+    uint offset = atomicAdd(lightIndexCount, visibleCount);
+    for (uint i = 0u; i < visibleCount; i++)
+        lightIndices[offset + i] = visible[i];
+    lightGrid[clusterIndex].offset = offset;
+    lightGrid[clusterIndex].count = visibleCount;
+}
@@ -1,47 +1,64 @@
-#version 330 core
-layout(location=0) out vec4 gPosition;      // xyz position, w = linear depth
-layout(location=1) out vec4 gNormal;        // xyz normal, w = roughness
-layout(location=2) out vec4 gAlbedoMetal;   // rgb albedo, a = metallic
-layout(location=3) out vec4 gRoughAoEmiss;  // r=AO, g=emissive strength, b=unused, a=specular (optional)
+#version 430 core
+// layout in GBuffer (buffers.h); position is rebuilt from depth by the passes that need it
+layout(location=0) out vec2 gNormal;        // octahedral normal, see gbuffer_encoding.glsl
+layout(location=1) out vec4 gAlbedoMetal;   // rgb albedo, a = metallic
+layout(location=2) out vec4 gRoughAoEmiss;  // r = roughness, g = AO, b = emissive strength, a = specular
+layout(location=3) out vec2 gMotion;        // UV now minus UV last frame
 
-in VS_OUT { vec3 FragPos; vec3 Normal; vec2 Tex; } fs_in;
+#include "gbuffer_encoding.glsl"
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_specular1;
-uniform sampler2D texture_metallic1;
-uniform sampler2D texture_roughness1;
-uniform sampler2D texture_ao1;
-uniform sampler2D texture_emissive1;
+in VS_OUT { vec3 FragPos; vec3 Normal; vec2 Tex; flat int MaterialID; vec4 CurrentClip; vec4 PreviousClip; } fs_in;
 
-uniform float uTime;
-uniform bool hasEmissive; // only animate when a real emissive map exists
+// Material data, see material.h. layers[] packs (array << 16 | layer) per slot, -1 = no map.
+#define MAX_MATERIAL_ARRAYS 12
+#define SLOT_ALBEDO 0
+#define SLOT_SPECULAR 1
+#define SLOT_METALLIC 2
+#define SLOT_ROUGHNESS 3
+#define SLOT_AO 4
+#define SLOT_EMISSIVE 5
 
-float linearDepth(vec3 fragPos) {
-    // assuming camera at view transform (pass near/far if needed)
-    return length(fragPos);
-}
+struct GpuMaterial {
+    ivec4 layers[2];
+    vec4 baseColor;
+    vec4 factors; // metallic, roughness, ao, emissive
+    vec4 extra;   // specular, has emissive map
+};
+layout(std430, binding = 5) readonly buffer Materials {
+    GpuMaterial materials[];
+};
+
+uniform sampler2DArray uMaterialArrays[MAX_MATERIAL_ARRAYS];
 
-// Octahedral encoding for normals (saves 1 channel)
-vec2 encodeNormal(vec3 n) {
-    n /= (abs(n.x) + abs(n.y) + abs(n.z));
-    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign(n.xy);
+uniform float uTime;
+
+// map value for a slot, or 1.0 when the material has no map there (its factor then is the value)
+vec4 sampleSlot(GpuMaterial m, int slot) {
+    int packed = m.layers[slot / 4][slot % 4];
+    if (packed < 0)
+        return vec4(1.0);
+    // the material is constant per draw, and GPU-driven buckets only group draws whose slots use
+    // the same arrays, so the array index stays dynamically uniform
+    return texture(uMaterialArrays[packed >> 16], vec3(fs_in.Tex, float(packed & 0xFFFF)));
 }
 
 void main() {
-    vec3 albedo = texture(texture_diffuse1, fs_in.Tex).rgb;
-    float metallic = texture(texture_metallic1, fs_in.Tex).r;
-    float roughness = texture(texture_roughness1, fs_in.Tex).r;
-    float ao = texture(texture_ao1, fs_in.Tex).r;
-    vec3 emissive = texture(texture_emissive1, fs_in.Tex).rgb;
+    GpuMaterial m = materials[fs_in.MaterialID];
+    vec3 albedo = sampleSlot(m, SLOT_ALBEDO).rgb * m.baseColor.rgb;
+    float metallic = sampleSlot(m, SLOT_METALLIC).r * m.factors.x;
+    float roughness = sampleSlot(m, SLOT_ROUGHNESS).r * m.factors.y;
+    float ao = sampleSlot(m, SLOT_AO).r * m.factors.z;
+    vec3 emissive = sampleSlot(m, SLOT_EMISSIVE).rgb * m.factors.w;
+    float specular = sampleSlot(m, SLOT_SPECULAR).r * m.extra.x;
+    bool hasEmissive = m.extra.y > 0.5; // only animate when a real emissive map exists
 
     // Only animate emissive if present; otherwise keep at 0
     float baseEmiss = (emissive.r + emissive.g + emissive.b) / 3.0;
     float flicker = 0.85 + 0.15 * sin(uTime * 10.0); // subtler
     float emissiveStrength = hasEmissive ? baseEmiss * flicker : 0.0;
 
-    gPosition = vec4(fs_in.FragPos, linearDepth(fs_in.FragPos));
-    gNormal   = vec4(encodeNormal(normalize(fs_in.Normal)), clamp(roughness, 0.04, 1.0), metallic);
+    gNormal = encodeNormal(normalize(fs_in.Normal));
     gAlbedoMetal = vec4(albedo, metallic);
-    // pack: r=AO, g=emissive strength, b=unused, a=specular scalar
-    gRoughAoEmiss = vec4(ao, emissiveStrength, 0.0, texture(texture_specular1, fs_in.Tex).r);
-}
\ No newline at end of file
+    gRoughAoEmiss = vec4(clamp(roughness, 0.04, 1.0), ao, emissiveStrength, specular);
+    gMotion = (fs_in.CurrentClip.xy / fs_in.CurrentClip.w - fs_in.PreviousClip.xy / fs_in.PreviousClip.w) * 0.5;
+}
@@ -1,23 +1,40 @@
-#version 330 core
+#version 430 core
 
 layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNormal;
 layout(location=2) in vec2 aTex;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix; // inverse transpose of model, from the CPU
+uniform mat4 previousModel; // last frame's model, for motion vectors
+uniform int uMaterialID;
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    mat4 viewProjection;         // unjittered, for motion vectors
+    mat4 previousViewProjection;
+} camera;
 
 out VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 Tex;
+    flat int MaterialID;
+    vec4 CurrentClip;  // unjittered, this frame and last; deferred.fs writes the difference
+    vec4 PreviousClip;
 } vs_out;
 
 void main() {
     vec4 world = model * vec4(aPos,1.0);
     vs_out.FragPos = world.xyz;
-    vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
+    vs_out.Normal = normalMatrix * aNormal;
     vs_out.Tex = aTex;
-    gl_Position = projection * view * world;
+    vs_out.MaterialID = uMaterialID;
+    vs_out.CurrentClip = camera.viewProjection * world;
+    vs_out.PreviousClip = camera.previousViewProjection * (previousModel * vec4(aPos, 1.0));
+    gl_Position = camera.projection * camera.view * world;
 }
\ No newline at end of file
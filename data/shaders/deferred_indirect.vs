@@ -0,0 +1,53 @@
+#version 430 core
+// deferred.vs for the GPU-driven path: the transform and material come from the instance the
+// cull pass emitted, found through the per-instance index attribute (see gpu_driven.h).
+
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aNormal;
+layout(location=2) in vec2 aTex;
+layout(location=7) in uint aDrawInstance; // divisor 1, offset by the command's baseInstance
+
+struct DrawInstance {
+    mat4 model;
+    mat3 normalMatrix; // columns padded to vec4, as in GpuDrawInstance
+    vec4 boundsCenter;
+    vec4 boundsExtents;
+    uvec4 draw;   // LOD 0 indexCount, firstIndex, baseVertex, materialID
+    uvec4 bucket;
+    uvec4 meshlets;
+};
+layout(std430, binding = 6) readonly buffer DrawInstances {
+    DrawInstance instances[];
+};
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    mat4 viewProjection;         // unjittered, for motion vectors
+    mat4 previousViewProjection;
+} camera;
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 Tex;
+    flat int MaterialID;
+    vec4 CurrentClip;  // unjittered, this frame and last; deferred.fs writes the difference
+    vec4 PreviousClip;
+} vs_out;
+
+void main() {
+    DrawInstance instance = instances[aDrawInstance];
+    vec4 world = instance.model * vec4(aPos, 1.0);
+    vs_out.FragPos = world.xyz;
+    vs_out.Normal = instance.normalMatrix * aNormal;
+    vs_out.Tex = aTex;
+    vs_out.MaterialID = int(instance.draw.w);
+    // GPU-driven instances do not move between frames: only the camera adds motion
+    vs_out.CurrentClip = camera.viewProjection * world;
+    vs_out.PreviousClip = camera.previousViewProjection * world;
+    gl_Position = camera.projection * camera.view * world;
+}
@@ -0,0 +1,53 @@
+#version 430 core
+// deferred.vs for ModelInstanceSet: the transform and normal matrix come from the instance
+// buffer, indexed through the visible list of the current (mesh, LOD) run (see model_instances.h).
+
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aNormal;
+layout(location=2) in vec2 aTex;
+
+struct ModelInstance {
+    mat4 model;
+    mat3 normalMatrix; // columns padded to vec4, as in GpuModelInstance
+};
+layout(std430, binding = 12) readonly buffer ModelInstances {
+    ModelInstance instances[];
+};
+layout(std430, binding = 13) readonly buffer ModelInstanceIndices {
+    uint visibleInstances[];
+};
+
+uniform uint uInstanceOffset; // first entry of this draw's run in visibleInstances
+uniform int uMaterialID;
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    mat4 viewProjection;         // unjittered, for motion vectors
+    mat4 previousViewProjection;
+} camera;
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 Tex;
+    flat int MaterialID;
+    vec4 CurrentClip;  // unjittered, this frame and last; deferred.fs writes the difference
+    vec4 PreviousClip;
+} vs_out;
+
+void main() {
+    ModelInstance instance = instances[visibleInstances[uInstanceOffset + uint(gl_InstanceID)]];
+    vec4 world = instance.model * vec4(aPos, 1.0);
+    vs_out.FragPos = world.xyz;
+    vs_out.Normal = instance.normalMatrix * aNormal;
+    vs_out.Tex = aTex;
+    vs_out.MaterialID = uMaterialID;
+    // instance transforms only change when the set is rebuilt: only the camera adds motion
+    vs_out.CurrentClip = camera.viewProjection * world;
+    vs_out.PreviousClip = camera.previousViewProjection * world;
+    gl_Position = camera.projection * camera.view * world;
+}
@@ -1,23 +1,51 @@
-#version 330 core
+#version 430 core
 out vec4 FragColor;
 in vec2 Tex;
 
 struct PointLight {
-    vec3 position;
-    vec3 color;
-    float radius;
+    vec4 positionRadius; // xyz = position, w = radius
+    vec4 color;
 };
 
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+} camera;
+
+// packed light array, uploaded with one buffer write per frame (no fixed cap)
+layout(std430, binding = 0) readonly buffer PointLights {
+    PointLight uPointLights[];
+};
 uniform int uPointLightCount;
-uniform PointLight uPointLights[32];
-uniform vec3 viewPos;
 
-uniform sampler2D gPosition;
+// clustered culling output (cluster_light_culling.glsl)
+struct LightGridEntry {
+    uint offset;
+    uint count;
+};
+layout(std430, binding = 2) readonly buffer LightGrid {
+    LightGridEntry lightGrid[];
+};
+layout(std430, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+uniform bool uUseClusters; // false = brute force over every light, for comparison
+uniform uvec3 uGridSize;
+uniform float uZNear;
+uniform float uZFar;
+uniform vec2 uScreenSize;
+
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoMetal;
 uniform sampler2D gRoughAoEmiss;
 uniform sampler2D ssaoTex;
 
+#include "gbuffer_encoding.glsl"
+
 const float PI = 3.14159265359;
 
 vec3 fresnelSchlick(float cosTheta, vec3 F0){
@@ -45,27 +73,44 @@ float GeometrySmith(vec3 N, vec3 V, vec3 L, float rough){
     return ggx1*ggx2;
 }
 
+uint clusterIndex(float viewZ){
+    float slice = log(-viewZ / uZNear) / log(uZFar / uZNear) * float(uGridSize.z);
+    uint zSlice = min(uint(max(slice, 0.0)), uGridSize.z - 1u);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / uScreenSize * vec2(uGridSize.xy)), uGridSize.xy - 1u);
+    return tile.x + tile.y * uGridSize.x + zSlice * uGridSize.x * uGridSize.y;
+}
+
 void main(){
-    vec3 pos = texture(gPosition, Tex).xyz;
-    vec3 N = normalize(texture(gNormal, Tex).xyz);
+    vec3 pos = reconstructPosition(Tex, texture(gDepth, Tex).r, camera.inverseViewProjection);
+    vec3 N = decodeNormal(texture(gNormal, Tex).rg);
     vec4 albedoMetal = texture(gAlbedoMetal, Tex);
     vec4 pack = texture(gRoughAoEmiss, Tex);
     vec3 albedo = pow(albedoMetal.rgb, vec3(2.2)); // gamma to linear
     float metallic = albedoMetal.a;
-    float roughness = texture(gNormal, Tex).w;
-    float ao = pack.r * texture(ssaoTex, Tex).r;
-    float emiss = pack.g;
+    float roughness = pack.r;
+    float ao = pack.g * texture(ssaoTex, Tex).r;
+    float emiss = pack.b;
     float specScalar = pack.a;
-    vec3 V = normalize(viewPos - pos);
+    vec3 V = normalize(camera.viewPos.xyz - pos);
     vec3 F0 = mix(vec3(0.04*specScalar), albedo, metallic);
 
+    uint lightOffset = 0u;
+    uint lightCount = uint(uPointLightCount);
+    if(uUseClusters){
+        LightGridEntry cell = lightGrid[clusterIndex((camera.view * vec4(pos, 1.0)).z)];
+        lightOffset = cell.offset;
+        lightCount = cell.count;
+    }
+
     vec3 Lo = vec3(0.0);
-    for(int i=0;i<uPointLightCount;i++){
-        PointLight Lgt = uPointLights[i];
-        vec3 L = normalize(Lgt.position - pos);
+    for(uint i=0u;i<lightCount;i++){
+        PointLight Lgt = uPointLights[uUseClusters ? lightIndices[lightOffset + i] : i];
+        vec3 lightPos = Lgt.positionRadius.xyz;
+        float lightRadius = Lgt.positionRadius.w;
+        vec3 L = normalize(lightPos - pos);
         vec3 H = normalize(V + L);
-        float dist = length(Lgt.position - pos);
-        float attenuation = 1.0 / (1.0 + dist*dist / (Lgt.radius*Lgt.radius));
+        float dist = length(lightPos - pos);
+        float attenuation = 1.0 / (1.0 + dist*dist / (lightRadius*lightRadius));
         float NdotL = max(dot(N,L),0.0);
 
         float D = DistributionGGX(N,H,roughness);
@@ -79,7 +124,7 @@ void main(){
         vec3 kS = F;
         vec3 kD = (vec3(1.0)-kS)*(1.0 - metallic);
 
-        vec3 irradiance = Lgt.color * attenuation * NdotL;
+        vec3 irradiance = Lgt.color.rgb * attenuation * NdotL;
         Lo += (kD*albedo/PI + specular) * irradiance;
     }
     vec3 ambient = albedo * ao * 0.01; // slightly darker baseline
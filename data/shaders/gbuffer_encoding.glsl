@@ -0,0 +1,40 @@
+#ifndef GBUFFER_ENCODING_GLSL
+#define GBUFFER_ENCODING_GLSL
+// G-buffer packing shared by deferred.fs, deferred_lighting.fs and ssao.fs (pulled in with
+// #include, see Shader::expandIncludes). include/gbuffer_encoding.h is the CPU mirror; change both.
+
+// +-1 per component, with +1 for zero so the two hemispheres fold consistently
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// octahedral map of a unit vector onto [-1, 1]^2
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
+
+vec3 octDecode(vec2 p) {
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+// the RG16 unorm normal target
+vec2 encodeNormal(vec3 n) {
+    return octEncode(n) * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 encoded) {
+    return octDecode(encoded * 2.0 - 1.0);
+}
+
+// position from a depth-buffer value at `uv`; inverse(projection) gives view space,
+// inverse(projection * view) world space
+vec3 reconstructPosition(vec2 uv, float depth, mat4 inverseMatrix) {
+    vec4 position = inverseMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+#endif
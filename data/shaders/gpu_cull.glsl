@@ -0,0 +1,264 @@
+#version 430 core
+// GPU-driven rendering: frustum-culls every draw instance and writes the survivors as
+// DrawElementsIndirectCommands, compacted per bucket, plus a draw count per bucket.
+// With occlusion culling the pass runs twice a frame:
+//   phase 1 emits what was visible last frame; those draws fill the depth buffer and the Hi-Z
+//   pyramid is built from it;
+//   phase 2 tests every instance in the frustum against the pyramid, records the result for the
+//   next frame, and emits the visible ones phase 1 did not draw.
+// Each emitted draw uses the instance's LOD picked from projected screen-space error (mesh_lod.h).
+// At LOD 0 a clustered mesh is meshlet-culled against the frustum and its normal cones in mesh
+// space (meshlet.h), emitting one command per run of adjacent surviving meshlets.
+// One invocation per instance. CPU side: gpu_driven.h
+#define GROUP_SIZE 64
+layout(local_size_x = GROUP_SIZE) in;
+
+// must match GpuCullPhase in gpu_driven.h
+#define PHASE_FRUSTUM 0
+#define PHASE_PREVIOUS_VISIBLE 1
+#define PHASE_OCCLUSION 2
+
+// drawCounts[0..8] are statistics, the per-bucket counts follow: one set per command slot
+#define STAT_VISIBLE 0
+#define STAT_OCCLUDED 1
+#define STAT_DRAWN_EARLY 2
+#define STAT_DRAWN_LATE 3
+#define STAT_MESHLETS 4
+#define STAT_MESHLETS_VISIBLE 5
+#define STAT_MESHLET_TRIANGLES 6
+#define STAT_FRUSTUM_CULLED_TRIANGLES 7
+#define STAT_CONE_CULLED_TRIANGLES 8
+#define STAT_COUNT 9
+
+// uMeshletCulling bits
+#define MESHLET_FRUSTUM 1
+#define MESHLET_CONE 2
+
+struct DrawInstance {
+    mat4 model;
+    mat3 normalMatrix;  // columns padded to vec4, as in GpuDrawInstance
+    vec4 boundsCenter;  // local-space AABB center, w unused
+    vec4 boundsExtents; // local-space half extents, w unused
+    uvec4 draw;         // LOD 0 indexCount, firstIndex, baseVertex (as int), materialID
+    uvec4 bucket;       // bucket index, first command slot of the bucket, first LOD entry, LOD count
+    uvec4 meshlets;     // first meshlet entry, meshlet count, unused, unused
+};
+
+struct MeshletBounds {
+    vec4 sphere; // mesh-space center, radius
+    vec4 cone;   // axis, cutoff
+    uvec4 range; // indexCount, firstIndex, unused, unused
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+} camera;
+
+layout(std430, binding = 6) readonly buffer DrawInstances {
+    DrawInstance instances[];
+};
+layout(std430, binding = 7) writeonly buffer DrawCommands {
+    DrawCommand commands[]; // two slots of uCommandCapacity commands: early draws, then late draws
+};
+layout(std430, binding = 8) buffer DrawCounts {
+    uint drawCounts[];
+};
+layout(std430, binding = 9) buffer DrawVisibility {
+    uint visibility[]; // 1 if the instance passed the last occlusion test
+};
+
+layout(std430, binding = 10) readonly buffer MeshLods {
+    uvec4 lods[]; // indexCount, firstIndex, error (float bits), unused
+};
+
+layout(std430, binding = 11) readonly buffer Meshlets {
+    MeshletBounds meshlets[];
+};
+
+layout(binding = 12) uniform sampler2D uHiZ;
+
+uniform vec4 uFrustumPlanes[6]; // xyz = inward normal, w = distance
+uniform uint uInstanceCount;
+uniform uint uCommandCapacity; // command slots per phase, at least one per instance
+uniform uint uBucketCount;
+uniform int uPhase;
+uniform float uLodPixelsPerUnit; // screen height / (2 tan(fov / 2))
+uniform float uLodMaxPixelError;
+uniform int uLodForced;          // -1 picks by error, otherwise a fixed level
+uniform int uMeshletCulling;     // MESHLET_ bits; 0 draws LOD 0 whole
+
+// the coarsest LOD whose error, projected at the box's nearest distance, stays within the pixel budget
+uint selectLod(DrawInstance instance, vec3 center, vec3 extents) {
+    uint count = instance.bucket.w;
+    uint lod = 0u;
+    if (uLodForced >= 0) {
+        lod = min(uint(uLodForced), count - 1u);
+    } else {
+        vec3 m0 = instance.model[0].xyz, m1 = instance.model[1].xyz, m2 = instance.model[2].xyz;
+        float scale = sqrt(max(max(dot(m0, m0), dot(m1, m1)), dot(m2, m2)));
+        float distance = max(length(center - camera.viewPos.xyz) - length(extents), 1e-4);
+        float pixelsPerError = scale * uLodPixelsPerUnit / distance;
+        while (lod + 1u < count && uintBitsToFloat(lods[instance.bucket.z + lod + 1u].z) * pixelsPerError <= uLodMaxPixelError)
+            lod++;
+    }
+    return lod;
+}
+
+// True when the whole box lies behind the farthest depth under its screen rectangle.
+bool occludedByHiZ(vec3 center, vec3 extents) {
+    mat4 viewProjection = camera.projection * camera.view;
+    vec3 ndcMin = vec3(1e30), ndcMax = vec3(-1e30);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extents * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false; // crosses the camera plane: no usable screen rectangle
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    if (ndcMin.z < -1.0)
+        return false;
+    float nearestDepth = ndcMin.z * 0.5 + 0.5;
+
+    // rectangle in level-0 texels; shifting by the level keeps odd-size remainders in the last texel
+    ivec2 size0 = textureSize(uHiZ, 0);
+    ivec2 pixelMin = clamp(ivec2((ndcMin.xy * 0.5 + 0.5) * vec2(size0)), ivec2(0), size0 - 1);
+    ivec2 pixelMax = clamp(ivec2((ndcMax.xy * 0.5 + 0.5) * vec2(size0)), ivec2(0), size0 - 1);
+    // the level at which the rectangle spans at most 2x2 texels
+    int span = max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y);
+    int level = 0;
+    while ((1 << level) < span)
+        level++;
+    level = min(level, textureQueryLevels(uHiZ) - 1);
+
+    ivec2 levelSize = textureSize(uHiZ, level);
+    ivec2 lo = min(pixelMin >> level, levelSize - 1);
+    ivec2 hi = min(pixelMax >> level, levelSize - 1);
+    float farthest = 0.0;
+    for (int y = lo.y; y <= hi.y; y++)
+        for (int x = lo.x; x <= hi.x; x++)
+            farthest = max(farthest, texelFetch(uHiZ, ivec2(x, y), level).r);
+    return nearestDepth > farthest;
+}
+
+void emit(uint index, DrawInstance instance, uint commandSlot, uvec2 range) {
+    uint bucketCount = atomicAdd(drawCounts[STAT_COUNT + commandSlot * uBucketCount + instance.bucket.x], 1u);
+    uint slot = commandSlot * uCommandCapacity + instance.bucket.y + bucketCount;
+    commands[slot].count = range.x;
+    commands[slot].instanceCount = 1u;
+    commands[slot].firstIndex = range.y;
+    commands[slot].baseVertex = int(instance.draw.z);
+    // baseInstance offsets the per-instance attribute, so the vertex shader sees this instance's index
+    commands[slot].baseInstance = index;
+}
+
+// Emits the instance at `lod`; at LOD 0 only the meshlets that pass the enabled tests, with the
+// frustum and the eye moved into mesh space (exact for affine transforms, the cone test is
+// skipped for mirroring ones)
+void drawInstance(uint index, DrawInstance instance, uint commandSlot, uint lod) {
+    atomicAdd(drawCounts[commandSlot == 0u ? STAT_DRAWN_EARLY : STAT_DRAWN_LATE], 1u);
+    if (lod != 0u || instance.meshlets.y == 0u || uMeshletCulling == 0) {
+        emit(index, instance, commandSlot, lods[instance.bucket.z + lod].xy);
+        return;
+    }
+
+    vec4 planes[6];
+    for (int p = 0; p < 6; p++) {
+        vec4 world = uFrustumPlanes[p];
+        vec4 local = vec4(dot(world, instance.model[0]), dot(world, instance.model[1]), dot(world, instance.model[2]), dot(world, instance.model[3]));
+        planes[p] = local / max(length(local.xyz), 1e-20);
+    }
+    vec3 eye = (inverse(instance.model) * vec4(camera.viewPos.xyz, 1.0)).xyz;
+    bool testFrustum = (uMeshletCulling & MESHLET_FRUSTUM) != 0;
+    bool testCone = (uMeshletCulling & MESHLET_CONE) != 0 && determinant(mat3(instance.model)) > 0.0;
+
+    uint visibleCount = 0u, triangles = 0u, frustumCulled = 0u, coneCulled = 0u;
+    uvec2 run = uvec2(0u); // indexCount, firstIndex of the pending run of survivors
+    for (uint m = 0u; m < instance.meshlets.y; m++) {
+        MeshletBounds meshlet = meshlets[instance.meshlets.x + m];
+        uint meshletTriangles = meshlet.range.x / 3u;
+        triangles += meshletTriangles;
+        bool outside = false;
+        for (int p = 0; p < 6 && testFrustum && !outside; p++)
+            outside = dot(planes[p].xyz, meshlet.sphere.xyz) + planes[p].w < -meshlet.sphere.w;
+        if (outside) {
+            frustumCulled += meshletTriangles;
+            continue;
+        }
+        vec3 toCenter = meshlet.sphere.xyz - eye;
+        if (testCone && dot(toCenter, meshlet.cone.xyz) >= meshlet.cone.w * length(toCenter) + meshlet.sphere.w) {
+            coneCulled += meshletTriangles;
+            continue;
+        }
+        visibleCount++;
+        if (run.x != 0u && run.y + run.x == meshlet.range.y) {
+            run.x += meshlet.range.x;
+        } else {
+            if (run.x != 0u)
+                emit(index, instance, commandSlot, run);
+            run = meshlet.range.xy;
+        }
+    }
+    if (run.x != 0u)
+        emit(index, instance, commandSlot, run);
+
+    atomicAdd(drawCounts[STAT_MESHLETS], instance.meshlets.y);
+    atomicAdd(drawCounts[STAT_MESHLETS_VISIBLE], visibleCount);
+    atomicAdd(drawCounts[STAT_MESHLET_TRIANGLES], triangles);
+    atomicAdd(drawCounts[STAT_FRUSTUM_CULLED_TRIANGLES], frustumCulled);
+    atomicAdd(drawCounts[STAT_CONE_CULLED_TRIANGLES], coneCulled);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uInstanceCount)
+        return;
+    DrawInstance instance = instances[index];
+
+    // world-space box: transformed center, extents through |M| (same as transformAABB in bounds.h)
+    vec3 center = (instance.model * vec4(instance.boundsCenter.xyz, 1.0)).xyz;
+    mat3 absolute = mat3(abs(instance.model[0].xyz), abs(instance.model[1].xyz), abs(instance.model[2].xyz));
+    vec3 extents = absolute * instance.boundsExtents.xyz;
+
+    for (int p = 0; p < 6; p++) {
+        vec4 plane = uFrustumPlanes[p];
+        if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extents) < 0.0) {
+            if (uPhase != PHASE_PREVIOUS_VISIBLE)
+                visibility[index] = 0u;
+            return;
+        }
+    }
+
+    uint lod = selectLod(instance, center, extents);
+    if (uPhase == PHASE_FRUSTUM) {
+        // keeps the visible set current so switching occlusion on starts from it
+        visibility[index] = 1u;
+        atomicAdd(drawCounts[STAT_VISIBLE], 1u);
+        drawInstance(index, instance, 0u, lod);
+    } else if (uPhase == PHASE_PREVIOUS_VISIBLE) {
+        if (visibility[index] != 0u)
+            drawInstance(index, instance, 0u, lod);
+    } else {
+        atomicAdd(drawCounts[STAT_VISIBLE], 1u);
+        bool wasVisible = visibility[index] != 0u;
+        if (occludedByHiZ(center, extents)) {
+            visibility[index] = 0u;
+            atomicAdd(drawCounts[STAT_OCCLUDED], 1u);
+            return;
+        }
+        visibility[index] = 1u;
+        if (!wasVisible)
+            drawInstance(index, instance, 1u, lod);
+    }
+}
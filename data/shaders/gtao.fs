@@ -0,0 +1,104 @@
+#version 430 core
+out float FragAO;
+in vec2 Tex;
+uniform sampler2D uLinearDepth; // from ssao_prepare.fs, at the AO resolution
+uniform sampler2D uViewNormal;
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+} camera;
+uniform int uSliceCount; // directions per pixel per frame
+uniform int uStepCount;  // horizon samples each side of a slice
+uniform float radius;    // view-space search radius
+uniform int uFrameIndex; // rotates the noise so accumulated frames see different directions
+
+#include "gbuffer_encoding.glsl"
+
+const float PI = 3.14159265;
+const float HALF_PI = 1.57079633;
+
+vec3 viewPosition(vec2 uv, float viewDistance) {
+    vec3 ray = reconstructPosition(uv, 1.0, camera.inverseProjection);
+    return ray * (viewDistance / -ray.z);
+}
+
+// interleaved gradient noise; offsetting the pixel by a per-frame amount gives a new pattern each frame
+float noise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+// Ground-truth AO (Jimenez et al. 2016): per slice direction, find the highest horizon on each side
+// in screen space and integrate the cosine-weighted visible arc around the projected normal
+void main(){
+    float viewDistance = texture(uLinearDepth, Tex).r;
+    if (viewDistance <= 0.0) {
+        FragAO = 1.0; // background
+        return;
+    }
+    vec2 size = vec2(textureSize(uLinearDepth, 0));
+    vec3 P = viewPosition(Tex, viewDistance);
+    vec3 V = normalize(-P);
+    vec3 N = decodeNormal(texture(uViewNormal, Tex).rg);
+
+    // the search radius in pixels shrinks with distance; below a pixel there is nothing to find
+    float radiusPixels = radius * camera.projection[1][1] * 0.5 * size.y / viewDistance;
+    if (radiusPixels < 1.0) {
+        FragAO = 1.0;
+        return;
+    }
+
+    vec2 pixel = gl_FragCoord.xy + 5.588238 * float(uFrameIndex & 63);
+    float sliceNoise = noise(pixel);
+    float stepNoise = noise(pixel.yx + 17.0);
+    int sliceCount = max(uSliceCount, 1);
+    int stepCount = max(uStepCount, 1);
+    float falloffStart = 0.6 * radius; // horizons fade back to the tangent plane over the last 40%
+
+    float visibility = 0.0;
+    for (int slice = 0; slice < sliceCount; slice++) {
+        float phi = (float(slice) + sliceNoise) * PI / float(sliceCount);
+        vec2 omega = vec2(cos(phi), sin(phi));
+        vec3 direction = vec3(omega, 0.0);
+        vec3 orthoDirection = direction - dot(direction, V) * V;
+        vec3 axis = normalize(cross(orthoDirection, V));
+        vec3 projectedNormal = N - axis * dot(N, axis);
+        float projectedLength = length(projectedNormal);
+        if (projectedLength < 1.0e-4)
+            continue;
+        float cosN = clamp(dot(projectedNormal, V) / projectedLength, -1.0, 1.0);
+        float n = sign(dot(orthoDirection, projectedNormal)) * acos(cosN);
+
+        // cosines of the lowest allowed horizons: the hemisphere around the projected normal
+        float horizonCos0 = cos(n - HALF_PI);
+        float horizonCos1 = cos(n + HALF_PI);
+        float lowCos0 = horizonCos0, lowCos1 = horizonCos1;
+        for (int s = 0; s < stepCount; s++) {
+            float t = (float(s) + stepNoise) / float(stepCount);
+            vec2 offset = omega * max(t * radiusPixels, 1.0) / size;
+            for (int side = 0; side < 2; side++) {
+                vec2 sampleUv = side == 0 ? Tex - offset : Tex + offset;
+                float sampleDistance = texture(uLinearDepth, sampleUv).r;
+                if (sampleDistance <= 0.0 || any(lessThan(sampleUv, vec2(0.0))) || any(greaterThan(sampleUv, vec2(1.0))))
+                    continue;
+                vec3 delta = viewPosition(sampleUv, sampleDistance) - P;
+                float len = length(delta);
+                float weight = clamp((radius - len) / (radius - falloffStart), 0.0, 1.0);
+                float horizonCos = dot(delta / len, V);
+                if (side == 0)
+                    horizonCos0 = max(horizonCos0, mix(lowCos0, horizonCos, weight));
+                else
+                    horizonCos1 = max(horizonCos1, mix(lowCos1, horizonCos, weight));
+            }
+        }
+
+        float h0 = n + max(-acos(horizonCos0) - n, -HALF_PI);
+        float h1 = n + min(acos(horizonCos1) - n, HALF_PI);
+        float sinN = sin(n);
+        float arc0 = cosN + 2.0 * h0 * sinN - cos(2.0 * h0 - n);
+        float arc1 = cosN + 2.0 * h1 * sinN - cos(2.0 * h1 - n);
+        visibility += projectedLength * 0.25 * (arc0 + arc1);
+    }
+    FragAO = clamp(visibility / float(sliceCount), 0.0, 1.0);
+}
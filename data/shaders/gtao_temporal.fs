@@ -0,0 +1,52 @@
+#version 430 core
+layout(location = 0) out vec4 History; // r = accumulated AO, g = view distance, b = frames accumulated
+in vec2 Tex;
+uniform sampler2D ssaoInput;     // this frame's GTAO
+uniform sampler2D uLinearDepth;  // view distance, 0 for background
+uniform sampler2D uHistory;      // last frame's History
+uniform sampler2D gMotion;       // UV now minus UV last frame (buffers.h)
+uniform float uMaxFrames;        // cap on the running average, so the history still follows changes
+uniform float uRejectThreshold;  // relative view-distance change that counts as a disocclusion
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    mat4 viewProjection;
+    mat4 previousViewProjection; // unjittered
+} camera;
+
+#include "gbuffer_encoding.glsl"
+
+// Reprojects the pixel into last frame's AO with the motion vectors and blends this frame in as a
+// running average. History whose stored distance does not match where the surface was last frame
+// was occluded then (or is off screen) and is dropped. That distance comes from the camera alone, so
+// for a moving object it is off by how far the object moved along the view ray; uRejectThreshold
+// absorbs that at ordinary speeds.
+void main(){
+    float current = texture(ssaoInput, Tex).r;
+    float viewDistance = texture(uLinearDepth, Tex).r;
+    if (viewDistance <= 0.0) {
+        History = vec4(1.0, 0.0, 0.0, 0.0);
+        return;
+    }
+    vec3 ray = reconstructPosition(Tex, 1.0, camera.inverseProjection);
+    vec3 position = ray * (viewDistance / -ray.z);
+
+    // the view matrix is rigid, so its inverse rotation is the transpose
+    vec3 world = camera.viewPos.xyz + transpose(mat3(camera.view)) * position;
+    vec4 previousClip = camera.previousViewProjection * vec4(world, 1.0);
+    vec2 previousUv = Tex - texture(gMotion, Tex).rg;
+    float frames = 0.0;
+    float history = current;
+    if (previousClip.w > 0.0 && all(greaterThanEqual(previousUv, vec2(0.0))) && all(lessThanEqual(previousUv, vec2(1.0)))) {
+        vec4 previous = texture(uHistory, previousUv);
+        // w of a perspective clip position is the view distance in that frame
+        if (previous.b > 0.0 && abs(previous.g - previousClip.w) <= uRejectThreshold * previousClip.w) {
+            frames = min(previous.b, uMaxFrames);
+            history = previous.r;
+        }
+    }
+    History = vec4(mix(history, current, 1.0 / (frames + 1.0)), viewDistance, frames + 1.0, 0.0);
+}
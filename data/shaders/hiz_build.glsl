@@ -0,0 +1,38 @@
+#version 430 core
+// Builds one level of the Hi-Z pyramid: level 0 copies the depth buffer, every further level
+// keeps the max (farthest) depth of the 2x2 texels below it. On odd-sized sources the last
+// column/row of the destination also covers the leftover texel, so nothing is skipped.
+// CPU side: hiz.h
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 12) uniform sampler2D uSource; // depth texture for level 0, else the pyramid itself
+layout(r32f, binding = 0) uniform writeonly image2D uDest;
+
+uniform int uSourceLevel;
+uniform bool uDownsample;
+
+void main() {
+    ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 dstSize = imageSize(uDest);
+    if (any(greaterThanEqual(dst, dstSize)))
+        return;
+
+    if (!uDownsample) {
+        imageStore(uDest, dst, vec4(texelFetch(uSource, dst, 0).r));
+        return;
+    }
+
+    ivec2 srcSize = textureSize(uSource, uSourceLevel);
+    ivec2 src = dst * 2;
+    ivec2 reach = ivec2(1);
+    if (dst.x == dstSize.x - 1 && (srcSize.x & 1) != 0)
+        reach.x = 2;
+    if (dst.y == dstSize.y - 1 && (srcSize.y & 1) != 0)
+        reach.y = 2;
+
+    float depth = 0.0;
+    for (int y = 0; y <= reach.y; y++)
+        for (int x = 0; x <= reach.x; x++)
+            depth = max(depth, texelFetch(uSource, min(src + ivec2(x, y), srcSize - 1), uSourceLevel).r);
+    imageStore(uDest, dst, vec4(depth));
+}
@@ -0,0 +1,38 @@
+#version 430 core
+// model.vs for ModelInstanceSet (see deferred_instanced.vs)
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+struct ModelInstance {
+    mat4 model;
+    mat3 normalMatrix;
+};
+layout(std430, binding = 12) readonly buffer ModelInstances {
+    ModelInstance instances[];
+};
+layout(std430, binding = 13) readonly buffer ModelInstanceIndices {
+    uint visibleInstances[];
+};
+
+uniform uint uInstanceOffset;
+
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+} camera;
+
+void main()
+{
+    ModelInstance instance = instances[visibleInstances[uInstanceOffset + uint(gl_InstanceID)]];
+    FragPos = vec3(instance.model * vec4(aPos, 1.0));
+    Normal = instance.normalMatrix * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = camera.projection * camera.view * vec4(FragPos, 1.0);
+}
@@ -1,34 +1,63 @@
-#version 330 core
+#version 430 core
 out float FragAO;
 in vec2 Tex;
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
+uniform sampler2D uLinearDepth; // from ssao_prepare.fs, at the AO resolution
+uniform sampler2D uViewNormal;
 uniform sampler2D noiseTex;
-uniform vec3 samples[64];
-uniform mat4 projection;
+// must match SSAO_MAX_KERNEL_SIZE and UBO_BINDING_SSAO_KERNEL in ssao.h
+#define SSAO_MAX_KERNEL_SIZE 64
+layout(std140, binding = 1) uniform SSAOKernelBlock {
+    vec4 samples[SSAO_MAX_KERNEL_SIZE];
+} ssaoKernel;
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+} camera;
+uniform int uSampleCount;
 uniform float radius;
 uniform float bias;
+
+#include "gbuffer_encoding.glsl"
+
+// view-space point at `viewDistance` along the ray through `uv`
+vec3 viewPosition(vec2 uv, float viewDistance) {
+    vec3 ray = reconstructPosition(uv, 1.0, camera.inverseProjection);
+    return ray * (viewDistance / -ray.z);
+}
+
+// hemisphere sampling in view space against the low-res linear depth
 void main(){
-    vec3 pos = texture(gPosition, Tex).xyz;
-    vec3 normal = normalize(texture(gNormal, Tex).xyz);
-    vec3 randomVec = normalize(texture(noiseTex, Tex * 4.0).xyz);
+    float viewDistance = texture(uLinearDepth, Tex).r;
+    if (viewDistance <= 0.0) {
+        FragAO = 1.0; // background
+        return;
+    }
+    vec3 pos = viewPosition(Tex, viewDistance);
+    vec3 normal = decodeNormal(texture(uViewNormal, Tex).rg);
+    vec2 noiseScale = vec2(textureSize(uLinearDepth, 0)) / 4.0; // tile the 4x4 rotations per pixel
+    vec3 randomVec = normalize(texture(noiseTex, Tex * noiseScale).xyz);
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
     vec3 bitangent = cross(normal, tangent);
     mat3 TBN = mat3(tangent, bitangent, normal);
 
+    int count = clamp(uSampleCount, 1, SSAO_MAX_KERNEL_SIZE);
     float occlusion = 0.0;
-    for(int i=0;i<64;i++){
-        vec3 samplePos = TBN * samples[i];
+    for(int i=0;i<count;i++){
+        vec3 samplePos = TBN * ssaoKernel.samples[i].xyz;
         samplePos = pos + samplePos * radius;
 
-        vec4 offset = projection * vec4(samplePos,1.0);
+        vec4 offset = camera.projection * vec4(samplePos,1.0);
         offset.xyz /= offset.w;
         offset.xyz = offset.xyz * 0.5 + 0.5;
 
-        float sampleDepth = texture(gPosition, offset.xy).w;
-        float rangeCheck = smoothstep(0.0,1.0,radius / abs(pos.z - samplePos.z));
+        float sampleDistance = texture(uLinearDepth, offset.xy).r;
+        if (sampleDistance <= 0.0)
+            continue; // background never occludes
+        float sampleDepth = -sampleDistance;
+        float rangeCheck = smoothstep(0.0,1.0,radius / abs(pos.z - sampleDepth));
         occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
     }
-    occlusion = 1.0 - (occlusion / 64.0);
-    FragAO = occlusion;
-}
\ No newline at end of file
+    FragAO = 1.0 - (occlusion / float(count));
+}
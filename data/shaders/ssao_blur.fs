@@ -1,15 +1,34 @@
-#version 330 core
+#version 430 core
 out float FragAO;
 in vec2 Tex;
 uniform sampler2D ssaoInput;
+uniform sampler2D uLinearDepth; // view distance, 0 for background
+uniform vec2 uDirection;        // one texel along the blur axis
+uniform int uBlurRadius;        // taps each side
+uniform float uSharpness;
+
+// one axis of a separable Gaussian; taps are weighted down by their depth difference relative to
+// the centre, so occlusion does not bleed across silhouettes
 void main(){
-    float result = 0.0;
-    float w[9] = float[](1,2,3,2,6,2,3,2,1);
-    ivec2 size = textureSize(ssaoInput,0);
-    for(int x=-1;x<=1;x++)
-    for(int y=-1;y<=1;y++){
-        vec2 uv = Tex + vec2(x,y)/vec2(size);
-        result += texture(ssaoInput, uv).r * w[(x+1)*3 + (y+1)];
+    float center = texture(ssaoInput, Tex).r;
+    float centerDepth = texture(uLinearDepth, Tex).r;
+    if (centerDepth <= 0.0) {
+        FragAO = center;
+        return;
     }
-    FragAO = result / 22.0;
-}
\ No newline at end of file
+    float sigma = 0.5 * float(uBlurRadius) + 0.5;
+    float result = center;
+    float weightSum = 1.0;
+    for (int i = -uBlurRadius; i <= uBlurRadius; i++) {
+        if (i == 0)
+            continue;
+        vec2 uv = Tex + uDirection * float(i);
+        float d = texture(uLinearDepth, uv).r;
+        if (d <= 0.0)
+            continue;
+        float w = exp(-float(i * i) / (2.0 * sigma * sigma)) * exp(-abs(d - centerDepth) / centerDepth * uSharpness);
+        result += texture(ssaoInput, uv).r * w;
+        weightSum += w;
+    }
+    FragAO = result / weightSum;
+}
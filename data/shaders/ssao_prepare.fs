@@ -0,0 +1,41 @@
+#version 430 core
+layout(location = 0) out float LinearDepth; // view distance, 0 for background
+layout(location = 1) out vec2 ViewNormal;   // octahedral, view space
+in vec2 Tex;
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform int uScale; // full-res pixels per low-res pixel along each axis
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+} camera;
+
+#include "gbuffer_encoding.glsl"
+
+// downsample for the SSAO passes: the nearest depth of the block, so thin foreground edges survive,
+// together with that texel's normal
+void main(){
+    ivec2 last = textureSize(gDepth, 0) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * uScale;
+    ivec2 nearest = min(base, last);
+    float depth = 1.0;
+    for (int y = 0; y < uScale; y++)
+        for (int x = 0; x < uScale; x++) {
+            ivec2 texel = min(base + ivec2(x, y), last);
+            float d = texelFetch(gDepth, texel, 0).r;
+            if (d < depth) {
+                depth = d;
+                nearest = texel;
+            }
+        }
+    if (depth >= 1.0) {
+        LinearDepth = 0.0;
+        ViewNormal = encodeNormal(vec3(0.0, 0.0, 1.0));
+        return;
+    }
+    vec2 uv = (vec2(nearest) + 0.5) / vec2(last + 1);
+    LinearDepth = -reconstructPosition(uv, depth, camera.inverseProjection).z;
+    ViewNormal = encodeNormal(normalize(mat3(camera.view) * decodeNormal(texelFetch(gNormal, nearest, 0).rg)));
+}
@@ -0,0 +1,53 @@
+#version 430 core
+out float FragAO;
+in vec2 Tex;
+uniform sampler2D gDepth;       // full-res depth buffer
+uniform sampler2D ssaoInput;    // blurred, at the AO resolution
+uniform sampler2D uLinearDepth; // view distance at the AO resolution, 0 for background
+uniform float uSharpness;
+layout(std140, binding = 0) uniform CameraBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    mat4 inverseProjection;
+} camera;
+
+#include "gbuffer_encoding.glsl"
+
+// joint bilateral upsampling: the four low-res texels around the pixel, bilinear weights times the
+// similarity of their depth to this pixel's; falls back to the closest depth when none matches
+void main(){
+    float depth = texture(gDepth, Tex).r;
+    if (depth >= 1.0) {
+        FragAO = 1.0;
+        return;
+    }
+    float viewDistance = -reconstructPosition(Tex, depth, camera.inverseProjection).z;
+    ivec2 lowSize = textureSize(uLinearDepth, 0);
+    vec2 p = Tex * vec2(lowSize) - 0.5;
+    ivec2 base = ivec2(floor(p));
+    vec2 f = p - floor(p);
+
+    float result = 0.0;
+    float weightSum = 0.0;
+    float closest = 1.0e30;
+    float fallback = 1.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 corner = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + corner, ivec2(0), lowSize - 1);
+        float d = texelFetch(uLinearDepth, texel, 0).r;
+        float ao = texelFetch(ssaoInput, texel, 0).r;
+        if (d <= 0.0)
+            continue;
+        float difference = abs(d - viewDistance);
+        vec2 bilinear = mix(1.0 - f, f, vec2(corner));
+        float w = bilinear.x * bilinear.y * exp(-difference / viewDistance * uSharpness);
+        result += ao * w;
+        weightSum += w;
+        if (difference < closest) {
+            closest = difference;
+            fallback = ao;
+        }
+    }
+    FragAO = weightSum > 1.0e-4 ? result / weightSum : fallback;
+}
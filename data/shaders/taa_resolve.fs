@@ -0,0 +1,61 @@
+#version 430 core
+out vec4 FragColor;
+in vec2 Tex;
+uniform sampler2D uCurrent; // this frame's lit scene, rendered with jitter
+uniform sampler2D uHistory; // last resolve, bilinear
+uniform sampler2D gMotion;  // UV now minus UV last frame (buffers.h)
+uniform sampler2D gDepth;
+uniform float uFeedback;    // history weight for still pixels
+uniform bool uHistoryValid;
+
+vec3 toYCoCg(vec3 c) {
+    return vec3(dot(c, vec3(0.25, 0.5, 0.25)), dot(c, vec3(0.5, 0.0, -0.5)), dot(c, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 fromYCoCg(vec3 c) {
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+// reproject the history with the motion of the nearest surface in the 3x3 neighbourhood, clamp it
+// to the neighbourhood's colour box (min/max tightened by the variance) and blend
+void main(){
+    vec2 texel = 1.0 / vec2(textureSize(uCurrent, 0));
+    vec3 current = toYCoCg(texture(uCurrent, Tex).rgb);
+
+    vec3 boxMin = current, boxMax = current;
+    vec3 moment1 = vec3(0.0), moment2 = vec3(0.0);
+    float closestDepth = 1.0;
+    vec2 closestUv = Tex;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++) {
+            vec2 uv = Tex + vec2(x, y) * texel;
+            vec3 c = toYCoCg(texture(uCurrent, uv).rgb);
+            boxMin = min(boxMin, c);
+            boxMax = max(boxMax, c);
+            moment1 += c;
+            moment2 += c * c;
+            float d = texture(gDepth, uv).r;
+            if (d < closestDepth) {
+                closestDepth = d;
+                closestUv = uv;
+            }
+        }
+    vec3 mean = moment1 / 9.0;
+    vec3 sigma = sqrt(max(moment2 / 9.0 - mean * mean, vec3(0.0)));
+    boxMin = max(boxMin, mean - 1.25 * sigma);
+    boxMax = min(boxMax, mean + 1.25 * sigma);
+
+    vec2 motion = texture(gMotion, closestUv).rg;
+    vec2 previousUv = Tex - motion;
+    if (!uHistoryValid || any(lessThan(previousUv, vec2(0.0))) || any(greaterThan(previousUv, vec2(1.0)))) {
+        FragColor = vec4(fromYCoCg(current), 1.0);
+        return;
+    }
+    vec3 history = clamp(toYCoCg(texture(uHistory, previousUv).rgb), boxMin, boxMax);
+
+    // bilinear resampling blurs the history a little every frame it moves; lean on the current
+    // frame as the motion grows
+    float pixelsMoved = length(motion / texel);
+    float feedback = uFeedback * mix(1.0, 0.7, clamp(pixelsMoved / 8.0, 0.0, 1.0));
+    FragColor = vec4(fromYCoCg(mix(current, history, feedback)), 1.0);
+}
@@ -0,0 +1,116 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Bounding volumes for meshes: an AABB for culling and a sphere for cheap distance/LOD tests.
+// Both are in the mesh's local space; transformAABB moves a box into world space.
+// Plain CPU math with no GL dependency, shared by the culling kernels and the scene BVH.
+
+struct AABB
+{
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+  // the SAH cost measure; half the true surface area, which is all a comparison needs
+  float surfaceArea() const
+  {
+    glm::vec3 d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  bool contains(const AABB &other) const
+  {
+    return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+  }
+
+  bool overlaps(const AABB &other) const
+  {
+    return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+  }
+};
+
+inline AABB mergeAABB(const AABB &a, const AABB &b)
+{
+  return AABB{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+struct BoundingSphere
+{
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+};
+
+struct MeshBounds
+{
+  AABB box;
+  BoundingSphere sphere;
+};
+
+// box from the vertex positions; sphere centred on the box, radius to the farthest vertex.
+// Any vertex type with a glm::vec3 `position` works (Vertex from vertex_layout.h in practice).
+template <typename VertexT>
+MeshBounds computeMeshBounds(const std::vector<VertexT> &vertices)
+{
+  MeshBounds bounds;
+  if (vertices.empty())
+    return bounds;
+
+  bounds.box.min = bounds.box.max = vertices[0].position;
+  for (const VertexT &v : vertices)
+  {
+    bounds.box.min = glm::min(bounds.box.min, v.position);
+    bounds.box.max = glm::max(bounds.box.max, v.position);
+  }
+
+  bounds.sphere.center = bounds.box.center();
+  float radius2 = 0.0f;
+  for (const VertexT &v : vertices)
+  {
+    glm::vec3 d = v.position - bounds.sphere.center;
+    radius2 = std::max(radius2, glm::dot(d, d));
+  }
+  bounds.sphere.radius = std::sqrt(radius2);
+  return bounds;
+}
+
+// world-space box enclosing `box` under `transform` (Arvo: |M| applied to the extents)
+inline AABB transformAABB(const AABB &box, const glm::mat4 &transform)
+{
+  glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+  glm::vec3 extents = box.extents();
+  glm::mat3 m(transform);
+  glm::vec3 worldExtents(
+      std::fabs(m[0][0]) * extents.x + std::fabs(m[1][0]) * extents.y + std::fabs(m[2][0]) * extents.z,
+      std::fabs(m[0][1]) * extents.x + std::fabs(m[1][1]) * extents.y + std::fabs(m[2][1]) * extents.z,
+      std::fabs(m[0][2]) * extents.x + std::fabs(m[1][2]) * extents.y + std::fabs(m[2][2]) * extents.z);
+  return AABB{center - worldExtents, center + worldExtents};
+}
+
+// largest scale the transform applies along any local axis
+inline float maxAxisScale(const glm::mat4 &transform)
+{
+  glm::mat3 m(transform);
+  return std::sqrt(std::max({glm::dot(m[0], m[0]), glm::dot(m[1], m[1]), glm::dot(m[2], m[2])}));
+}
+
+// transforms normals: inverse transpose of the upper 3x3, computed once per transform on the CPU
+// instead of per vertex
+inline glm::mat3 normalMatrix(const glm::mat4 &transform)
+{
+  return glm::transpose(glm::inverse(glm::mat3(transform)));
+}
+
+inline BoundingSphere transformSphere(const BoundingSphere &sphere, const glm::mat4 &transform)
+{
+  return BoundingSphere{glm::vec3(transform * glm::vec4(sphere.center, 1.0f)), sphere.radius * maxAxisScale(transform)};
+}
+
+#endif // BOUNDS_H
@@ -1,74 +1,165 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <vector>
+
+// Fixed binding points shared between C++ and the `layout(binding = N)` qualifiers in data/shaders
+enum UniformBlockBinding
+{
+  UBO_BINDING_CAMERA = 0,
+};
+
+enum StorageBlockBinding
+{
+  SSBO_BINDING_POINT_LIGHTS = 0,
+};
+
+// Mirrors `layout(std140, binding = 0) uniform CameraBlock` in the shaders.
+// Every member is vec4-aligned so std140 and the C++ layout agree without padding fields.
+// Shaders may declare only a prefix; the inverses are for rebuilding positions from depth.
+// `projection` and the inverses carry the TAA jitter; the two view-projections do not, so motion
+// vectors computed from them only hold real movement.
+struct CameraBlock
+{
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::vec4 viewPos; // xyz = camera position, w unused
+  glm::mat4 inverseProjection;
+  glm::mat4 inverseViewProjection;
+  glm::mat4 viewProjection;         // unjittered
+  glm::mat4 previousViewProjection; // last frame's, unjittered
+  glm::vec4 jitter;                 // xy = this frame's jitter in NDC, zw = last frame's
+};
+
+// Mirrors `struct PointLight` in the std430 light buffer of deferred_lighting.fs.
+struct GpuPointLight
+{
+  glm::vec4 positionRadius; // xyz = world position, w = radius
+  glm::vec4 color;          // rgb = color, a unused
+};
+
+// A UBO bound once to a fixed binding point; updated with a single glBufferSubData per frame.
+class UniformBuffer
+{
+public:
+  unsigned int id = 0;
+  GLsizeiptr size = 0;
+
+  void init(GLsizeiptr byteSize, GLuint binding)
+  {
+    size = byteSize;
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+
+  void update(const void *data, GLsizeiptr byteSize, GLintptr offset = 0)
+  {
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, byteSize, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+
+  template <typename T>
+  void update(const T &block)
+  {
+    update(&block, sizeof(T));
+  }
+};
+
+// A growable SSBO holding a tightly packed std430 array. Capacity doubles when exceeded
+// (orphaning the old store); otherwise an upload is one glBufferSubData of the used range.
+class StorageBuffer
+{
+public:
+  unsigned int id = 0;
+  GLuint binding = 0;
+  GLsizeiptr capacity = 0;
+
+  void init(GLsizeiptr initialCapacity, GLuint bindingPoint)
+  {
+    binding = bindingPoint;
+    glGenBuffers(1, &id);
+    reserve(initialCapacity);
+  }
+
+  void reserve(GLsizeiptr byteSize)
+  {
+    if (byteSize <= capacity)
+      return;
+    GLsizeiptr newCapacity = capacity > 0 ? capacity : 256;
+    while (newCapacity < byteSize)
+      newCapacity *= 2;
+    capacity = newCapacity;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  void upload(const void *data, GLsizeiptr byteSize)
+  {
+    reserve(byteSize);
+    if (byteSize == 0)
+      return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, byteSize, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  template <typename T>
+  void upload(const std::vector<T> &elements)
+  {
+    upload(elements.data(), (GLsizeiptr)(elements.size() * sizeof(T)));
+  }
+
+  // rewrites [offset, offset + byteSize) in place; the range must be within capacity
+  void uploadRange(const void *data, GLintptr offset, GLsizeiptr byteSize)
+  {
+    if (byteSize == 0)
+      return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, byteSize, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+};
+
+// Deferred geometry targets, 20 bytes a pixel with depth (layouts compared in gbuffer_encoding.h):
+//   0: RG16  octahedral normal (gbuffer_encoding.glsl)
+//   1: RGBA8 albedo, metallic
+//   2: RGBA8 roughness, AO, emissive strength, specular
+//   3: RG16F motion: this frame's UV minus last frame's for the surface (camera and object movement,
+//      no jitter), cleared to zero; for TAA and any other pass that reprojects
+// There is no position target: passes rebuild it from depth with the inverse matrices in
+// CameraBlock. Depth is a texture rather than a renderbuffer so those passes and the Hi-Z pyramid
+// can sample it.
+// The targets are frame graph transients declared by the geometry pass (frame_graph.h), so they
+// follow the window size; a GBuffer holds their formats and the textures a frame's targets got.
 class GBuffer
 {
 public:
   enum GBUFFER_TEXTURE_TYPE
   {
-    GBUFFER_TEXTURE_TYPE_POSITION,
     GBUFFER_TEXTURE_TYPE_NORMAL,
     GBUFFER_TEXTURE_TYPE_ALBEDO_METAL,
     GBUFFER_TEXTURE_TYPE_ROUGH_AO_EMISS,
-    GBUFFER_TEXTURE_TYPE_TEXCOORD,
+    GBUFFER_TEXTURE_TYPE_MOTION,
     GBUFFER_NUM_TEXTURES
   };
-};
 
-// struct GBuffer
-// {
-//   unsigned int fbo = 0;
-//   unsigned int texPosition = 0;
-//   unsigned int texNormal = 0;
-//   unsigned int texAlbedoMetal = 0;
-//   unsigned int texRoughAoEmiss = 0;
-//   unsigned int rboDepth = 0;
-//   bool init(int width, int height)
-//   {
-//     glGenFramebuffers(1, &fbo);
-//     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-//     glGenTextures(1, &texPosition);
-//     glBindTexture(GL_TEXTURE_2D, texPosition);
-//     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, nullptr); // RGB instead of RGBA
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-//     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texPosition, 0);
-
-//     glGenTextures(1, &texNormal);
-//     glBindTexture(GL_TEXTURE_2D, texNormal);
-//     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-//     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, texNormal, 0);
-
-//     glGenTextures(1, &texAlbedoMetal);
-//     glBindTexture(GL_TEXTURE_2D, texAlbedoMetal);
-//     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-//     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, texAlbedoMetal, 0);
-
-//     glGenTextures(1, &texRoughAoEmiss);
-//     glBindTexture(GL_TEXTURE_2D, texRoughAoEmiss);
-//     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-//     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-//     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, texRoughAoEmiss, 0);
-
-//     unsigned int attachments[4] = {
-//         GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
-//         GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3};
-//     glDrawBuffers(4, attachments);
-
-//     glGenRenderbuffers(1, &rboDepth);
-//     glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-//     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
-//     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-//     bool ok = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-//     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-//     return ok;
-//   }
-// };
\ No newline at end of file
+  // colour attachment i holds FORMATS[i]
+  static constexpr GLenum FORMATS[GBUFFER_NUM_TEXTURES] = {GL_RG16, GL_RGBA8, GL_RGBA8, GL_RG16F};
+  static constexpr GLenum DEPTH_FORMAT = GL_DEPTH_COMPONENT32F;
+
+  unsigned int texNormal = 0;
+  unsigned int texAlbedoMetal = 0;
+  unsigned int texRoughAoEmiss = 0;
+  unsigned int texMotion = 0;
+  unsigned int texDepth = 0;
+  int width = 0;
+  int height = 0;
+};
@@ -0,0 +1,699 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frustum_culling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Dynamic AABB tree (bounding volume hierarchy) over arbitrary objects.
+//
+// Every object is a leaf ("proxy") holding its box enlarged by fatMargin, so objects that move a
+// little do not touch the tree at all. Insertion picks the sibling with the cheapest surface-area
+// cost and keeps the tree balanced with AVL-style rotations; removal splices the leaf out.
+// For scenes where everything moves every frame, setLeafBox() + refit() updates boxes bottom-up
+// in O(n) without restructuring, and rebuild() re-derives the whole tree with a binned SAH
+// build when its quality has drifted.
+//
+// Queries (box, sphere, frustum, ray) call back with proxy ids; tests are against the fat boxes,
+// so callers refine with their exact bounds. CPU-only: no GL state is touched here, and
+// tools/bvh_report.cpp (BVHReport) checks validate() and every query against brute force.
+
+#define BVH_NULL_NODE (-1)
+
+struct BVHNode
+{
+  AABB box;
+  int parent = BVH_NULL_NODE; // next free node while on the free list
+  int child1 = BVH_NULL_NODE;
+  int child2 = BVH_NULL_NODE;
+  int height = -1; // 0 for leaves, -1 for free nodes
+  uint32_t userData = 0;
+
+  bool isLeaf() const { return child1 == BVH_NULL_NODE; }
+};
+
+class DynamicAABBTree
+{
+public:
+  // leaves are stored this much larger on every side
+  float fatMargin = 0.1f;
+
+  int insert(const AABB &box, uint32_t userData)
+  {
+    int leaf = allocateNode();
+    nodes[leaf].box = fatten(box);
+    nodes[leaf].userData = userData;
+    nodes[leaf].height = 0;
+    insertLeaf(leaf);
+    leaves++;
+    return leaf;
+  }
+
+  void remove(int proxy)
+  {
+    assert(validProxy(proxy));
+    removeLeaf(proxy);
+    freeNode(proxy);
+    leaves--;
+  }
+
+  // Updates a proxy for the object's new box. Returns true when the leaf had to be reinserted,
+  // false when the box still fits inside the fat one.
+  bool move(int proxy, const AABB &box)
+  {
+    assert(validProxy(proxy));
+    if (nodes[proxy].box.contains(box))
+      return false;
+    removeLeaf(proxy);
+    nodes[proxy].box = fatten(box);
+    insertLeaf(proxy);
+    return true;
+  }
+
+  // Sets a leaf's box with no tree update; the ancestors are stale until refit() or rebuild().
+  void setLeafBox(int proxy, const AABB &box)
+  {
+    assert(validProxy(proxy));
+    nodes[proxy].box = fatten(box);
+  }
+
+  // Recomputes every internal box from its children, bottom-up. Topology is left alone, so this is
+  // cheap but the tree degrades as objects drift away from their original neighbours.
+  void refit()
+  {
+    postOrder(scratchOrder);
+    for (auto it = scratchOrder.rbegin(); it != scratchOrder.rend(); ++it)
+    {
+      BVHNode &node = nodes[*it];
+      if (!node.isLeaf())
+        node.box = mergeAABB(nodes[node.child1].box, nodes[node.child2].box);
+    }
+  }
+
+  // Throws away the internal nodes and builds them again top-down with a binned SAH split.
+  void rebuild()
+  {
+    std::vector<int> leafNodes;
+    leafNodes.reserve(leaves);
+    for (int i = 0; i < (int)nodes.size(); i++)
+    {
+      if (nodes[i].height < 0)
+        continue;
+      if (nodes[i].isLeaf())
+        leafNodes.push_back(i);
+      else
+        freeNode(i);
+    }
+    root = BVH_NULL_NODE;
+    if (leafNodes.empty())
+      return;
+
+    std::vector<glm::vec3> centroids(nodes.size());
+    for (int leaf : leafNodes)
+      centroids[leaf] = nodes[leaf].box.center();
+
+    struct BuildTask
+    {
+      int parent;
+      bool firstChild;
+      size_t begin, end;
+    };
+    std::vector<BuildTask> tasks;
+    tasks.push_back({BVH_NULL_NODE, true, 0, leafNodes.size()});
+    while (!tasks.empty())
+    {
+      BuildTask task = tasks.back();
+      tasks.pop_back();
+
+      int node;
+      size_t mid = 0;
+      if (task.end - task.begin == 1)
+        node = leafNodes[task.begin];
+      else
+      {
+        mid = sahSplit(leafNodes, centroids, task.begin, task.end);
+        node = allocateNode();
+        nodes[node].height = 1; // real heights are filled in below
+      }
+
+      nodes[node].parent = task.parent;
+      if (task.parent == BVH_NULL_NODE)
+        root = node;
+      else if (task.firstChild)
+        nodes[task.parent].child1 = node;
+      else
+        nodes[task.parent].child2 = node;
+
+      if (task.end - task.begin > 1)
+      {
+        tasks.push_back({node, true, task.begin, mid});
+        tasks.push_back({node, false, mid, task.end});
+      }
+    }
+
+    postOrder(scratchOrder);
+    for (auto it = scratchOrder.rbegin(); it != scratchOrder.rend(); ++it)
+    {
+      BVHNode &node = nodes[*it];
+      if (node.isLeaf())
+        continue;
+      node.box = mergeAABB(nodes[node.child1].box, nodes[node.child2].box);
+      node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+    }
+  }
+
+  void clear()
+  {
+    nodes.clear();
+    root = BVH_NULL_NODE;
+    freeList = BVH_NULL_NODE;
+    leaves = 0;
+  }
+
+  uint32_t userData(int proxy) const { return nodes[proxy].userData; }
+  const AABB &fatBox(int proxy) const { return nodes[proxy].box; }
+  size_t leafCount() const { return leaves; }
+  size_t nodeCount() const { return leaves ? 2 * leaves - 1 : 0; }
+  int height() const { return root == BVH_NULL_NODE ? 0 : nodes[root].height; }
+
+  // sum of internal node areas relative to the root: the expected traversal cost under SAH
+  float sahCost() const
+  {
+    if (root == BVH_NULL_NODE)
+      return 0.0f;
+    float rootArea = nodes[root].box.surfaceArea();
+    if (rootArea <= 0.0f)
+      return 0.0f;
+    float total = 0.0f;
+    for (const BVHNode &node : nodes)
+      if (node.height > 0)
+        total += node.box.surfaceArea();
+    return total / rootArea;
+  }
+
+  // callback(int proxy) for every leaf whose fat box overlaps `box`
+  template <typename Callback>
+  void query(const AABB &box, Callback &&callback) const
+  {
+    traverse([&](const AABB &nodeBox)
+             { return nodeBox.overlaps(box); },
+             callback);
+  }
+
+  // callback(int proxy) for every leaf whose fat box touches the sphere
+  template <typename Callback>
+  void querySphere(const glm::vec3 &center, float radius, Callback &&callback) const
+  {
+    float radius2 = radius * radius;
+    traverse([&](const AABB &nodeBox)
+             {
+               glm::vec3 closest = glm::clamp(center, nodeBox.min, nodeBox.max);
+               glm::vec3 d = closest - center;
+               return glm::dot(d, d) <= radius2; },
+             callback);
+  }
+
+  // callback(int proxy) for every leaf whose fat box is at least partly inside the frustum.
+  // Planes a node lies fully inside of are not tested again below it, and subtrees entirely
+  // inside are reported without further tests.
+  template <typename Callback>
+  void queryFrustum(const Frustum &frustum, Callback &&callback) const
+  {
+    if (root == BVH_NULL_NODE)
+      return;
+    std::vector<std::pair<int, unsigned int>> stack;
+    stack.reserve(64);
+    stack.push_back({root, (1u << FRUSTUM_PLANE_COUNT) - 1});
+    while (!stack.empty())
+    {
+      auto [index, planeMask] = stack.back();
+      stack.pop_back();
+      const BVHNode &node = nodes[index];
+
+      if (planeMask)
+      {
+        glm::vec3 center = node.box.center();
+        glm::vec3 extents = node.box.extents();
+        bool outside = false;
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT && !outside; p++)
+        {
+          if (!(planeMask & (1u << p)))
+            continue;
+          const glm::vec4 &plane = frustum.planes[p];
+          float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+          float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+          if (distance + radius < 0.0f)
+            outside = true;
+          else if (distance - radius >= 0.0f)
+            planeMask &= ~(1u << p);
+        }
+        if (outside)
+          continue;
+      }
+
+      if (node.isLeaf())
+        callback(index);
+      else
+      {
+        stack.push_back({node.child1, planeMask});
+        stack.push_back({node.child2, planeMask});
+      }
+    }
+  }
+
+  // Walks leaves hit by origin + t * direction for t in [0, maxDistance], nearer subtrees first.
+  // callback(int proxy, float entryDistance) returns the new maxDistance: return the exact hit
+  // distance to clip the ray, or the current maximum to keep going.
+  template <typename Callback>
+  void raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, Callback &&callback) const
+  {
+    if (root == BVH_NULL_NODE)
+      return;
+    glm::vec3 inverse = 1.0f / direction;
+    float entry;
+    if (!rayHitsBox(origin, inverse, nodes[root].box, maxDistance, entry))
+      return;
+
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+    stack.push_back({root, entry});
+    while (!stack.empty())
+    {
+      auto [index, nodeEntry] = stack.back();
+      stack.pop_back();
+      if (nodeEntry > maxDistance)
+        continue;
+      const BVHNode &node = nodes[index];
+      if (node.isLeaf())
+      {
+        maxDistance = callback(index, nodeEntry);
+        continue;
+      }
+
+      float entry1, entry2;
+      bool hit1 = rayHitsBox(origin, inverse, nodes[node.child1].box, maxDistance, entry1);
+      bool hit2 = rayHitsBox(origin, inverse, nodes[node.child2].box, maxDistance, entry2);
+      // push the farther child first so the nearer one is visited next
+      if (hit1 && hit2 && entry1 < entry2)
+      {
+        stack.push_back({node.child2, entry2});
+        stack.push_back({node.child1, entry1});
+        continue;
+      }
+      if (hit1)
+        stack.push_back({node.child1, entry1});
+      if (hit2)
+        stack.push_back({node.child2, entry2});
+    }
+  }
+
+  // Walks the tree and returns the first broken invariant, or nullptr when there is none: links
+  // agree both ways, every parent box encloses its children, heights are 1 + the taller child, and
+  // the leaf count matches. `maxBalance` bounds the height difference of sibling subtrees: insert
+  // and remove rotate once per level, which keeps it within 2; rebuild() splits by SAH with no
+  // height bound, so pass -1 after it to skip the check.
+  const char *validate(int maxBalance = 2) const
+  {
+    if (root == BVH_NULL_NODE)
+      return leaves == 0 ? nullptr : "empty tree with a non-zero leaf count";
+    if (nodes[root].parent != BVH_NULL_NODE)
+      return "root has a parent";
+    std::vector<int> order;
+    postOrder(order);
+    size_t leafNodes = 0;
+    for (int index : order)
+    {
+      const BVHNode &node = nodes[index];
+      if (node.height < 0)
+        return "free node reachable from the root";
+      if (node.isLeaf())
+      {
+        if (node.height != 0 || node.child2 != BVH_NULL_NODE)
+          return "leaf with a height or a second child";
+        leafNodes++;
+        continue;
+      }
+      const BVHNode &a = nodes[node.child1];
+      const BVHNode &b = nodes[node.child2];
+      if (a.parent != index || b.parent != index)
+        return "child does not point back at its parent";
+      if (!node.box.contains(a.box) || !node.box.contains(b.box))
+        return "parent box does not enclose a child";
+      if (node.height != 1 + std::max(a.height, b.height))
+        return "height is not 1 + the taller child";
+      if (maxBalance >= 0 && std::abs(a.height - b.height) > maxBalance)
+        return "sibling heights differ by more than the balance bound";
+    }
+    if (leafNodes != leaves || order.size() != nodeCount())
+      return "reachable node count does not match the leaf count";
+    return nullptr;
+  }
+
+  // slab test; `entry` is where the ray enters the box (0 if it starts inside)
+  static bool rayHitsBox(const glm::vec3 &origin, const glm::vec3 &inverseDirection, const AABB &box, float maxDistance, float &entry)
+  {
+    glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return entry <= exit;
+  }
+
+private:
+  std::vector<BVHNode> nodes;
+  int root = BVH_NULL_NODE;
+  int freeList = BVH_NULL_NODE;
+  size_t leaves = 0;
+  std::vector<int> scratchOrder;
+
+  static constexpr int SAH_BINS = 12;
+
+  AABB fatten(const AABB &box) const
+  {
+    glm::vec3 margin(fatMargin);
+    return AABB{box.min - margin, box.max + margin};
+  }
+
+  bool validProxy(int proxy) const
+  {
+    return proxy >= 0 && proxy < (int)nodes.size() && nodes[proxy].height == 0;
+  }
+
+  int allocateNode()
+  {
+    int index;
+    if (freeList != BVH_NULL_NODE)
+    {
+      index = freeList;
+      freeList = nodes[index].parent;
+    }
+    else
+    {
+      index = (int)nodes.size();
+      nodes.emplace_back();
+    }
+    nodes[index] = BVHNode();
+    return index;
+  }
+
+  void freeNode(int index)
+  {
+    nodes[index].parent = freeList;
+    nodes[index].child1 = nodes[index].child2 = BVH_NULL_NODE;
+    nodes[index].height = -1;
+    freeList = index;
+  }
+
+  // nodes reachable from the root, parents before children
+  void postOrder(std::vector<int> &order) const
+  {
+    order.clear();
+    if (root == BVH_NULL_NODE)
+      return;
+    order.push_back(root);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      const BVHNode &node = nodes[order[i]];
+      if (!node.isLeaf())
+      {
+        order.push_back(node.child1);
+        order.push_back(node.child2);
+      }
+    }
+  }
+
+  template <typename Test, typename Callback>
+  void traverse(Test &&test, Callback &callback) const
+  {
+    if (root == BVH_NULL_NODE)
+      return;
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+      int index = stack.back();
+      stack.pop_back();
+      const BVHNode &node = nodes[index];
+      if (!test(node.box))
+        continue;
+      if (node.isLeaf())
+        callback(index);
+      else
+      {
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+      }
+    }
+  }
+
+  void insertLeaf(int leaf)
+  {
+    if (root == BVH_NULL_NODE)
+    {
+      root = leaf;
+      nodes[leaf].parent = BVH_NULL_NODE;
+      return;
+    }
+
+    // descend towards the sibling that adds the least surface area
+    AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf())
+    {
+      const BVHNode &node = nodes[index];
+      float area = node.box.surfaceArea();
+      float combinedArea = mergeAABB(node.box, leafBox).surfaceArea();
+      float cost = 2.0f * combinedArea;                      // new parent here
+      float inheritance = 2.0f * (combinedArea - area);      // growth pushed onto the ancestors
+      float cost1 = descendCost(node.child1, leafBox) + inheritance;
+      float cost2 = descendCost(node.child2, leafBox) + inheritance;
+      if (cost < cost1 && cost < cost2)
+        break;
+      index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = mergeAABB(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == BVH_NULL_NODE)
+      root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+      nodes[oldParent].child1 = newParent;
+    else
+      nodes[oldParent].child2 = newParent;
+
+    fixUpwards(nodes[leaf].parent);
+  }
+
+  float descendCost(int child, const AABB &leafBox) const
+  {
+    const BVHNode &node = nodes[child];
+    float combinedArea = mergeAABB(leafBox, node.box).surfaceArea();
+    return node.isLeaf() ? combinedArea : combinedArea - node.box.surfaceArea();
+  }
+
+  void removeLeaf(int leaf)
+  {
+    if (leaf == root)
+    {
+      root = BVH_NULL_NODE;
+      return;
+    }
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == BVH_NULL_NODE)
+    {
+      root = sibling;
+      nodes[sibling].parent = BVH_NULL_NODE;
+      freeNode(parent);
+      return;
+    }
+    if (nodes[grandParent].child1 == parent)
+      nodes[grandParent].child1 = sibling;
+    else
+      nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    fixUpwards(grandParent);
+  }
+
+  // rebalances and refreshes boxes/heights from `index` to the root
+  void fixUpwards(int index)
+  {
+    while (index != BVH_NULL_NODE)
+    {
+      index = balance(index);
+      BVHNode &node = nodes[index];
+      node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+      node.box = mergeAABB(nodes[node.child1].box, nodes[node.child2].box);
+      index = node.parent;
+    }
+  }
+
+  void replaceChild(int parent, int oldChild, int newChild)
+  {
+    if (parent == BVH_NULL_NODE)
+      root = newChild;
+    else if (nodes[parent].child1 == oldChild)
+      nodes[parent].child1 = newChild;
+    else
+      nodes[parent].child2 = newChild;
+  }
+
+  // Rotates the taller child of `a` up when the children's heights differ by more than one.
+  // Returns the node now at a's position.
+  int balance(int a)
+  {
+    BVHNode &A = nodes[a];
+    if (A.isLeaf() || A.height < 2)
+      return a;
+
+    int b = A.child1, c = A.child2;
+    BVHNode &B = nodes[b];
+    BVHNode &C = nodes[c];
+    int heightDelta = C.height - B.height;
+
+    if (heightDelta > 1)
+    {
+      // C becomes the parent; its taller child stays with it, the shorter one moves to A
+      int f = C.child1, g = C.child2;
+      C.child1 = a;
+      C.parent = A.parent;
+      A.parent = c;
+      replaceChild(C.parent, a, c);
+
+      int keep = nodes[f].height > nodes[g].height ? f : g;
+      int give = keep == f ? g : f;
+      C.child2 = keep;
+      A.child2 = give;
+      nodes[give].parent = a;
+      A.box = mergeAABB(B.box, nodes[give].box);
+      C.box = mergeAABB(A.box, nodes[keep].box);
+      A.height = 1 + std::max(B.height, nodes[give].height);
+      C.height = 1 + std::max(A.height, nodes[keep].height);
+      return c;
+    }
+    if (heightDelta < -1)
+    {
+      int d = B.child1, e = B.child2;
+      B.child1 = a;
+      B.parent = A.parent;
+      A.parent = b;
+      replaceChild(B.parent, a, b);
+
+      int keep = nodes[d].height > nodes[e].height ? d : e;
+      int give = keep == d ? e : d;
+      B.child2 = keep;
+      A.child1 = give;
+      nodes[give].parent = a;
+      A.box = mergeAABB(C.box, nodes[give].box);
+      B.box = mergeAABB(A.box, nodes[keep].box);
+      A.height = 1 + std::max(C.height, nodes[give].height);
+      B.height = 1 + std::max(A.height, nodes[keep].height);
+      return b;
+    }
+    return a;
+  }
+
+  // Partitions leafNodes[begin, end) for a binned SAH split and returns the split point. Falls
+  // back to a median split when the centroids coincide or SAH puts everything on one side.
+  size_t sahSplit(std::vector<int> &leafNodes, const std::vector<glm::vec3> &centroids, size_t begin, size_t end) const
+  {
+    AABB centroidBounds{centroids[leafNodes[begin]], centroids[leafNodes[begin]]};
+    for (size_t i = begin; i < end; i++)
+    {
+      centroidBounds.min = glm::min(centroidBounds.min, centroids[leafNodes[i]]);
+      centroidBounds.max = glm::max(centroidBounds.max, centroids[leafNodes[i]]);
+    }
+    glm::vec3 size = centroidBounds.max - centroidBounds.min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+    size_t mid = (begin + end) / 2;
+
+    if (size[axis] > 1e-6f)
+    {
+      struct Bin
+      {
+        AABB box;
+        size_t count = 0;
+      } bins[SAH_BINS];
+      float scale = SAH_BINS / size[axis];
+      auto binOf = [&](int leaf)
+      {
+        int bin = (int)((centroids[leaf][axis] - centroidBounds.min[axis]) * scale);
+        return std::min(bin, SAH_BINS - 1);
+      };
+      for (size_t i = begin; i < end; i++)
+      {
+        Bin &bin = bins[binOf(leafNodes[i])];
+        bin.box = bin.count ? mergeAABB(bin.box, nodes[leafNodes[i]].box) : nodes[leafNodes[i]].box;
+        bin.count++;
+      }
+
+      // sweep from the right to get suffix areas, then from the left to evaluate each split
+      float rightArea[SAH_BINS];
+      size_t rightCount[SAH_BINS];
+      AABB accumulated;
+      size_t count = 0;
+      for (int i = SAH_BINS - 1; i > 0; i--)
+      {
+        if (bins[i].count)
+          accumulated = count ? mergeAABB(accumulated, bins[i].box) : bins[i].box;
+        count += bins[i].count;
+        rightArea[i] = count ? accumulated.surfaceArea() : 0.0f;
+        rightCount[i] = count;
+      }
+      float bestCost = std::numeric_limits<float>::max();
+      int bestSplit = -1;
+      count = 0;
+      for (int i = 0; i < SAH_BINS - 1; i++)
+      {
+        if (bins[i].count)
+          accumulated = count ? mergeAABB(accumulated, bins[i].box) : bins[i].box;
+        count += bins[i].count;
+        if (!count || !rightCount[i + 1])
+          continue;
+        float cost = count * accumulated.surfaceArea() + rightCount[i + 1] * rightArea[i + 1];
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestSplit = i;
+        }
+      }
+      if (bestSplit >= 0)
+      {
+        auto split = std::partition(leafNodes.begin() + begin, leafNodes.begin() + end, [&](int leaf)
+                                    { return binOf(leaf) <= bestSplit; });
+        size_t splitIndex = (size_t)(split - leafNodes.begin());
+        if (splitIndex > begin && splitIndex < end)
+          return splitIndex;
+      }
+    }
+
+    std::nth_element(leafNodes.begin() + begin, leafNodes.begin() + mid, leafNodes.begin() + end, [&](int a, int b)
+                     { return centroids[a][axis] < centroids[b][axis]; });
+    return mid;
+  }
+};
+
+#endif // BVH_H
@@ -66,6 +66,17 @@ public:
     return glm::lookAt(Position, Position + Front, Up);
   }
 
+  // perspective projection from Zoom; `jitter` is a sub-pixel offset in NDC units (2 / viewport size
+  // per pixel) added to the projected x/y, as used by temporal anti-aliasing
+  glm::mat4 GetProjectionMatrix(float aspect, float zNear, float zFar, glm::vec2 jitter = glm::vec2(0.0f))
+  {
+    glm::mat4 projection = glm::perspective(glm::radians(Zoom), aspect, zNear, zFar);
+    // w_clip = -z_view, so subtracting jitter * z_view adds jitter * w_clip: x_ndc moves by exactly `jitter`
+    projection[2][0] -= jitter.x;
+    projection[2][1] -= jitter.y;
+    return projection;
+  }
+
   // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
   void ProcessKeyboard(Camera_Movement direction, float deltaTime)
   {
@@ -116,6 +127,14 @@ public:
       Zoom = 179.0f;
   }
 
+  // world-space direction of the ray through a point in normalized device coordinates, for picking.
+  // `aspect` must be the one the perspective projection (built from Zoom) uses.
+  glm::vec3 GetRayDirection(float ndcX, float ndcY, float aspect)
+  {
+    float tanHalfFov = tan(glm::radians(Zoom) * 0.5f);
+    return glm::normalize(Front + Right * (ndcX * tanHalfFov * aspect) + Up * (ndcY * tanHalfFov));
+  }
+
 private:
   // calculates the front vector from the Camera's (updated) Euler Angles
   void updateCameraVectors()
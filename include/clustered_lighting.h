@@ -0,0 +1,237 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "buffers.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Clustered Forward+ light culling.
+// The view frustum is split into dims.x * dims.y screen tiles and dims.z exponential depth slices.
+// Each cluster gets a view-space AABB; every point light sphere is tested against every AABB and the
+// surviving light indices are written to one flat list, with a per-cluster (offset, count) entry.
+// The lighting pass then only loops over the lights of the cluster its pixel falls in.
+//
+// The CPU functions below are the reference for FowardPlusRendering.glsl (bounds) and
+// cluster_light_culling.glsl (culling); they use the same math and touch no GL state.
+// tools/cluster_cull_report.cpp (ClusterCullReport) checks them against a brute-force sphere/AABB pass.
+
+// must match MAX_LIGHTS_PER_CLUSTER in cluster_light_culling.glsl
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+enum ClusterStorageBinding
+{
+  SSBO_BINDING_CLUSTER_BOUNDS = 1,
+  SSBO_BINDING_LIGHT_GRID = 2,
+  SSBO_BINDING_LIGHT_INDICES = 3,
+  SSBO_BINDING_LIGHT_INDEX_COUNTER = 4,
+};
+
+struct ClusterGrid
+{
+  glm::uvec3 dims = glm::uvec3(16, 9, 24);
+  float zNear = 0.1f;
+  float zFar = 100.0f;
+
+  unsigned int clusterCount() const { return dims.x * dims.y * dims.z; }
+};
+
+// std430 layouts, mirrored in the compute shaders
+struct ClusterAABB
+{
+  glm::vec4 minPoint; // view space, w unused
+  glm::vec4 maxPoint;
+};
+
+struct LightGridEntry
+{
+  uint32_t offset;
+  uint32_t count;
+};
+
+// flat cluster index for a tile/slice coordinate
+inline unsigned int clusterLinearIndex(const ClusterGrid &grid, glm::uvec3 cluster)
+{
+  return cluster.x + cluster.y * grid.dims.x + cluster.z * grid.dims.x * grid.dims.y;
+}
+
+// exponential depth slice for a (negative, view-space) z
+inline unsigned int clusterDepthSlice(const ClusterGrid &grid, float viewZ)
+{
+  float slice = std::log(-viewZ / grid.zNear) / std::log(grid.zFar / grid.zNear) * (float)grid.dims.z;
+  return std::min((unsigned int)std::max(slice, 0.0f), grid.dims.z - 1);
+}
+
+// cluster containing a fragment, same as clusterIndex() in deferred_lighting.fs
+inline unsigned int clusterIndexForFragment(const ClusterGrid &grid, glm::vec2 fragCoord, glm::vec2 screenSize, float viewZ)
+{
+  glm::uvec2 tile = glm::uvec2(fragCoord / screenSize * glm::vec2(grid.dims.x, grid.dims.y));
+  tile = glm::min(tile, glm::uvec2(grid.dims.x - 1, grid.dims.y - 1));
+  return clusterLinearIndex(grid, glm::uvec3(tile, clusterDepthSlice(grid, viewZ)));
+}
+
+inline ClusterAABB computeClusterBounds(const ClusterGrid &grid, const glm::mat4 &invProjection, glm::uvec3 cluster)
+{
+  auto ndcToView = [&](glm::vec2 ndc)
+  {
+    glm::vec4 v = invProjection * glm::vec4(ndc, -1.0f, 1.0f);
+    return glm::vec3(v) / v.w;
+  };
+  // point where the eye ray through `dir` crosses the plane z = zDistance
+  auto rayToZPlane = [](glm::vec3 dir, float zDistance)
+  {
+    return dir * (zDistance / dir.z);
+  };
+
+  glm::vec2 dimsXY(grid.dims.x, grid.dims.y);
+  glm::vec2 ndcMin = glm::vec2(cluster.x, cluster.y) / dimsXY * 2.0f - 1.0f;
+  glm::vec2 ndcMax = glm::vec2(cluster.x + 1, cluster.y + 1) / dimsXY * 2.0f - 1.0f;
+  glm::vec3 minNear = ndcToView(ndcMin);
+  glm::vec3 maxNear = ndcToView(ndcMax);
+
+  float ratio = grid.zFar / grid.zNear;
+  float sliceNear = -grid.zNear * std::pow(ratio, (float)cluster.z / (float)grid.dims.z);
+  float sliceFar = -grid.zNear * std::pow(ratio, (float)(cluster.z + 1) / (float)grid.dims.z);
+
+  glm::vec3 a = rayToZPlane(minNear, sliceNear);
+  glm::vec3 b = rayToZPlane(minNear, sliceFar);
+  glm::vec3 c = rayToZPlane(maxNear, sliceNear);
+  glm::vec3 d = rayToZPlane(maxNear, sliceFar);
+
+  ClusterAABB box;
+  box.minPoint = glm::vec4(glm::min(glm::min(a, b), glm::min(c, d)), 0.0f);
+  box.maxPoint = glm::vec4(glm::max(glm::max(a, b), glm::max(c, d)), 0.0f);
+  return box;
+}
+
+inline std::vector<ClusterAABB> buildClusterBoundsCPU(const ClusterGrid &grid, const glm::mat4 &projection)
+{
+  glm::mat4 invProjection = glm::inverse(projection);
+  std::vector<ClusterAABB> clusters(grid.clusterCount());
+  for (unsigned int z = 0; z < grid.dims.z; z++)
+    for (unsigned int y = 0; y < grid.dims.y; y++)
+      for (unsigned int x = 0; x < grid.dims.x; x++)
+        clusters[clusterLinearIndex(grid, glm::uvec3(x, y, z))] = computeClusterBounds(grid, invProjection, glm::uvec3(x, y, z));
+  return clusters;
+}
+
+inline bool sphereIntersectsAABB(glm::vec3 center, float radius, const ClusterAABB &box)
+{
+  glm::vec3 d = glm::max(glm::max(glm::vec3(box.minPoint) - center, glm::vec3(0.0f)), center - glm::vec3(box.maxPoint));
+  return glm::dot(d, d) <= radius * radius;
+}
+
+// Reference culling. Light order inside a cluster matches the GPU; cluster offsets do not, since
+// the GPU allocates list space with an atomic counter. Compare per-cluster light sets, not offsets.
+inline void cullLightsCPU(const std::vector<ClusterAABB> &clusters, const glm::mat4 &view,
+                          const std::vector<GpuPointLight> &lights,
+                          std::vector<LightGridEntry> &lightGrid, std::vector<uint32_t> &lightIndices)
+{
+  std::vector<glm::vec4> viewLights(lights.size());
+  for (size_t i = 0; i < lights.size(); i++)
+    viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(glm::vec3(lights[i].positionRadius), 1.0f)), lights[i].positionRadius.w);
+
+  lightGrid.assign(clusters.size(), LightGridEntry{0, 0});
+  lightIndices.clear();
+  for (size_t c = 0; c < clusters.size(); c++)
+  {
+    lightGrid[c].offset = (uint32_t)lightIndices.size();
+    for (size_t i = 0; i < viewLights.size() && lightGrid[c].count < MAX_LIGHTS_PER_CLUSTER; i++)
+    {
+      if (sphereIntersectsAABB(glm::vec3(viewLights[i]), viewLights[i].w, clusters[c]))
+      {
+        lightIndices.push_back((uint32_t)i);
+        lightGrid[c].count++;
+      }
+    }
+  }
+}
+
+// GPU side: owns the cluster buffers and the two compute programs.
+class ClusteredLighting
+{
+public:
+  ClusterGrid grid;
+
+  void init(const std::string &shaderDir, ClusterGrid clusterGrid = ClusterGrid())
+  {
+    grid = clusterGrid;
+    buildShader = std::make_unique<ComputeShader>((shaderDir + "/FowardPlusRendering.glsl").c_str(), "clusterBuildShader");
+    cullShader = std::make_unique<ComputeShader>((shaderDir + "/cluster_light_culling.glsl").c_str(), "clusterCullShader");
+
+    GLsizeiptr clusterCount = grid.clusterCount();
+    clusterBounds.init(clusterCount * (GLsizeiptr)sizeof(ClusterAABB), SSBO_BINDING_CLUSTER_BOUNDS);
+    lightGrid.init(clusterCount * (GLsizeiptr)sizeof(LightGridEntry), SSBO_BINDING_LIGHT_GRID);
+    lightIndices.init(clusterCount * MAX_LIGHTS_PER_CLUSTER * (GLsizeiptr)sizeof(uint32_t), SSBO_BINDING_LIGHT_INDICES);
+    indexCounter.init((GLsizeiptr)sizeof(uint32_t), SSBO_BINDING_LIGHT_INDEX_COUNTER);
+  }
+
+  // rebuilds cluster bounds only when the projection changed (zoom, resize), then culls all lights.
+  // Expects the camera UBO and point light SSBO to be up to date for this frame.
+  void update(const glm::mat4 &projection, int lightCount)
+  {
+    static constexpr UniformHandle uGridSize("uGridSize");
+    static constexpr UniformHandle uZNear("uZNear");
+    static constexpr UniformHandle uZFar("uZFar");
+    static constexpr UniformHandle uInvProjection("uInvProjection");
+    static constexpr UniformHandle uPointLightCount("uPointLightCount");
+    static constexpr UniformHandle uClusterCount("uClusterCount");
+
+    if (projection != builtProjection)
+    {
+      builtProjection = projection;
+      buildShader->use();
+      glUniform3ui(buildShader->getUniformLocation(uGridSize), grid.dims.x, grid.dims.y, grid.dims.z);
+      buildShader->setFloat(uZNear, grid.zNear);
+      buildShader->setFloat(uZFar, grid.zFar);
+      buildShader->setMat4(uInvProjection, glm::inverse(projection));
+      buildShader->dispatch(grid.dims.x, grid.dims.y, grid.dims.z);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    uint32_t zero = 0;
+    indexCounter.upload(&zero, sizeof(zero));
+
+    cullShader->use();
+    cullShader->setInt(uPointLightCount, lightCount);
+    glUniform1ui(cullShader->getUniformLocation(uClusterCount), grid.clusterCount());
+    cullShader->dispatch((grid.clusterCount() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+  }
+
+  // uniforms deferred_lighting.fs needs to locate its cluster
+  void setLightingUniforms(const Shader &shader, glm::vec2 screenSize) const
+  {
+    static constexpr UniformHandle uGridSize("uGridSize");
+    static constexpr UniformHandle uZNear("uZNear");
+    static constexpr UniformHandle uZFar("uZFar");
+    static constexpr UniformHandle uScreenSize("uScreenSize");
+
+    glUniform3ui(shader.getUniformLocation(uGridSize), grid.dims.x, grid.dims.y, grid.dims.z);
+    shader.setFloat(uZNear, grid.zNear);
+    shader.setFloat(uZFar, grid.zFar);
+    shader.setVec2(uScreenSize, screenSize);
+  }
+
+private:
+  // must match local_size_x in cluster_light_culling.glsl
+  static constexpr unsigned int CULL_GROUP_SIZE = 128;
+
+  std::unique_ptr<ComputeShader> buildShader;
+  std::unique_ptr<ComputeShader> cullShader;
+  StorageBuffer clusterBounds;
+  StorageBuffer lightGrid;
+  StorageBuffer lightIndices;
+  StorageBuffer indexCounter;
+  glm::mat4 builtProjection = glm::mat4(0.0f);
+};
+
+#endif // CLUSTERED_LIGHTING_H
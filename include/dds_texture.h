@@ -0,0 +1,231 @@
+#ifndef DDS_TEXTURE_H
+#define DDS_TEXTURE_H
+
+#include "file_stamp.h"
+#include "texture_compress.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// DDS container for block-compressed textures, always written with the DX10 extension header so
+// other tools can open the files. Cooked textures live next to their source as "<image>.dds"; the
+// source size and write time are stored in the header's reserved words (tagged "OGTX") and the
+// streamer ignores the cooked file once they stop matching.
+
+#define COOKED_TEXTURE_EXTENSION ".dds"
+#define COOKED_TEXTURE_TAG 0x5854474Fu // "OGTX"
+
+struct DDSPixelFormat
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11]; // [0] tag, [1..2] source size, [3..4] source write time
+  DDSPixelFormat pixelFormat;
+  uint32_t caps, caps2, caps3, caps4;
+  uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header layout");
+
+namespace dds
+{
+  constexpr uint32_t MAGIC = 0x20534444u; // "DDS "
+  constexpr uint32_t FOURCC_DX10 = 0x30315844u;
+  constexpr uint32_t FOURCC_DXT1 = 0x31545844u;
+  constexpr uint32_t FOURCC_DXT5 = 0x35545844u;
+  constexpr uint32_t FOURCC_ATI1 = 0x31495441u;
+  constexpr uint32_t FOURCC_ATI2 = 0x32495441u;
+
+  // DXGI_FORMAT_*_UNORM
+  inline uint32_t dxgiFormat(TextureBlockFormat format)
+  {
+    switch (format)
+    {
+    case BLOCK_BC1:
+      return 71;
+    case BLOCK_BC3:
+      return 77;
+    case BLOCK_BC4:
+      return 80;
+    case BLOCK_BC5:
+      return 83;
+    case BLOCK_BC7:
+      return 98;
+    }
+    return 0;
+  }
+
+  inline bool blockFormatFromDXGI(uint32_t dxgi, TextureBlockFormat &format)
+  {
+    switch (dxgi)
+    {
+    case 71:
+    case 72: // _SRGB variants decode the same blocks
+      format = BLOCK_BC1;
+      return true;
+    case 77:
+    case 78:
+      format = BLOCK_BC3;
+      return true;
+    case 80:
+      format = BLOCK_BC4;
+      return true;
+    case 83:
+      format = BLOCK_BC5;
+      return true;
+    case 98:
+    case 99:
+      format = BLOCK_BC7;
+      return true;
+    }
+    return false;
+  }
+
+  inline bool blockFormatFromFourCC(uint32_t fourCC, TextureBlockFormat &format)
+  {
+    switch (fourCC)
+    {
+    case FOURCC_DXT1:
+      format = BLOCK_BC1;
+      return true;
+    case FOURCC_DXT5:
+      format = BLOCK_BC3;
+      return true;
+    case FOURCC_ATI1:
+      format = BLOCK_BC4;
+      return true;
+    case FOURCC_ATI2:
+      format = BLOCK_BC5;
+      return true;
+    }
+    return false;
+  }
+} // namespace dds
+
+// Writes `texture` to `path`, stamped with the source image it was cooked from when one is given.
+inline bool writeDDSTexture(const std::string &path, const CompressedTexture &texture, const std::string &sourcePath)
+{
+  DDSHeader header{};
+  header.size = sizeof(DDSHeader);
+  header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixelformat, mipmapcount, linearsize
+  header.height = texture.height;
+  header.width = texture.width;
+  header.pitchOrLinearSize = (uint32_t)texture.mips[0].size;
+  header.mipMapCount = (uint32_t)texture.mips.size();
+  header.pixelFormat.size = sizeof(DDSPixelFormat);
+  header.pixelFormat.flags = 0x4; // fourcc
+  header.pixelFormat.fourCC = dds::FOURCC_DX10;
+  header.caps = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+
+  uint64_t sourceSize = 0;
+  int64_t sourceWriteTime = 0;
+  if (!sourcePath.empty() && readSourceStamp(sourcePath, sourceSize, sourceWriteTime))
+  {
+    header.reserved1[0] = COOKED_TEXTURE_TAG;
+    header.reserved1[1] = (uint32_t)sourceSize;
+    header.reserved1[2] = (uint32_t)(sourceSize >> 32);
+    header.reserved1[3] = (uint32_t)((uint64_t)sourceWriteTime);
+    header.reserved1[4] = (uint32_t)((uint64_t)sourceWriteTime >> 32);
+  }
+
+  DDSHeaderDX10 dx10{};
+  dx10.dxgiFormat = dds::dxgiFormat(texture.format);
+  dx10.resourceDimension = 3; // texture2d
+  dx10.arraySize = 1;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "ERROR::DDS:: cannot write " << path << std::endl;
+    return false;
+  }
+  out.write((const char *)&dds::MAGIC, sizeof(dds::MAGIC));
+  out.write((const char *)&header, sizeof(header));
+  out.write((const char *)&dx10, sizeof(dx10));
+  out.write((const char *)texture.data.data(), (std::streamsize)texture.data.size());
+  return (bool)out;
+}
+
+// Reads a DDS file holding a BC1/3/4/5/7 2D texture. With a non-empty `sourcePath` the file must
+// carry a matching source stamp, so stale cooked textures are rejected.
+inline bool readDDSTexture(const std::string &path, CompressedTexture &texture, const std::string &sourcePath = "")
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+
+  uint32_t magic = 0;
+  DDSHeader header{};
+  in.read((char *)&magic, sizeof(magic));
+  in.read((char *)&header, sizeof(header));
+  if (!in || magic != dds::MAGIC || header.size != sizeof(DDSHeader))
+    return false;
+
+  if (!sourcePath.empty())
+  {
+    uint64_t sourceSize = 0;
+    int64_t sourceWriteTime = 0;
+    if (header.reserved1[0] != COOKED_TEXTURE_TAG || !readSourceStamp(sourcePath, sourceSize, sourceWriteTime) ||
+        header.reserved1[1] != (uint32_t)sourceSize || header.reserved1[2] != (uint32_t)(sourceSize >> 32) ||
+        header.reserved1[3] != (uint32_t)((uint64_t)sourceWriteTime) || header.reserved1[4] != (uint32_t)((uint64_t)sourceWriteTime >> 32))
+      return false;
+  }
+
+  if (header.pixelFormat.fourCC == dds::FOURCC_DX10)
+  {
+    DDSHeaderDX10 dx10{};
+    in.read((char *)&dx10, sizeof(dx10));
+    if (!in || dx10.resourceDimension != 3 || dx10.arraySize > 1 || !dds::blockFormatFromDXGI(dx10.dxgiFormat, texture.format))
+      return false;
+  }
+  else if (!dds::blockFormatFromFourCC(header.pixelFormat.fourCC, texture.format))
+    return false;
+
+  texture.width = header.width;
+  texture.height = header.height;
+  uint32_t levels = std::max(1u, header.mipMapCount);
+  texture.mips.clear();
+  size_t total = 0;
+  uint32_t w = texture.width, h = texture.height;
+  for (uint32_t i = 0; i < levels; i++)
+  {
+    size_t size = compressedLevelSize(texture.format, w, h);
+    texture.mips.push_back({w, h, total, size});
+    total += size;
+    w = std::max(1u, w / 2);
+    h = std::max(1u, h / 2);
+  }
+
+  texture.data.resize(total);
+  in.read((char *)texture.data.data(), (std::streamsize)total);
+  return (bool)in;
+}
+
+#endif // DDS_TEXTURE_H
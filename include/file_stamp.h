@@ -0,0 +1,20 @@
+#ifndef FILE_STAMP_H
+#define FILE_STAMP_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Size + last write time of a source asset. Cooked files (mesh caches, compressed textures) store it
+// and are ignored once the source no longer matches.
+inline bool readSourceStamp(const std::string &sourcePath, uint64_t &size, int64_t &writeTime)
+{
+  std::error_code ec;
+  size = (uint64_t)std::filesystem::file_size(sourcePath, ec);
+  if (ec)
+    return false;
+  writeTime = (int64_t)std::filesystem::last_write_time(sourcePath, ec).time_since_epoch().count();
+  return !ec;
+}
+
+#endif // FILE_STAMP_H
@@ -0,0 +1,728 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Frame graph: the render passes of a frame and the textures they use, declared again every frame.
+//
+// A pass states what it reads and writes through a FrameGraphBuilder and supplies a callback that
+// issues its GL work. compile() then
+//   - culls passes nothing downstream reads (passes that write an imported texture or the
+//     backbuffer, or ask for it, are always kept),
+//   - orders the rest by their dependencies, with declaration order breaking ties,
+//   - finds the first and last pass that touches each transient texture.
+// execute() runs the passes in that order. Transient textures come from a pool that outlives the
+// frame, keyed by format, size and filter. A texture goes back to the pool after its last pass, so
+// a later texture with the same key can reuse (alias) it within the frame. Before each pass the
+// graph binds a cached framebuffer for its attachments and sets the viewport to their size. Pool
+// textures unused for FRAMEGRAPH_POOL_FRAMES frames are freed, so old sizes go away after a resize.
+//
+// Each write makes a new version of a resource. Writing a version that already has contents (blending
+// onto it, depth testing against it) also reads that version. Passes that replace a target start
+// from a fresh createTexture(). An aliased texture starts with whatever its last user left behind,
+// so the first writer clears it or covers every pixel.
+
+#define FRAMEGRAPH_POOL_FRAMES 3
+#define FRAMEGRAPH_MAX_COLOR_ATTACHMENTS 8
+
+struct FrameGraphTextureDesc
+{
+  int width = 0;
+  int height = 0;
+  GLenum format = GL_RGBA8; // sized internal format
+  GLenum filter = GL_NEAREST;
+
+  bool operator==(const FrameGraphTextureDesc &o) const
+  {
+    return width == o.width && height == o.height && format == o.format && filter == o.filter;
+  }
+};
+
+inline unsigned int frameGraphBytesPerPixel(GLenum format)
+{
+  switch (format)
+  {
+  case GL_R8:
+    return 1;
+  case GL_RG8:
+  case GL_R16F:
+    return 2;
+  case GL_RGBA16F:
+  case GL_RG32F:
+    return 8;
+  case GL_RGBA32F:
+    return 16;
+  default: // RGBA8, RG16, RG16F, R32F, DEPTH32F, DEPTH24_STENCIL8
+    return 4;
+  }
+}
+
+inline const char *frameGraphFormatName(GLenum format)
+{
+  switch (format)
+  {
+  case GL_R8:
+    return "R8";
+  case GL_RG8:
+    return "RG8";
+  case GL_RGBA8:
+    return "RGBA8";
+  case GL_RG16:
+    return "RG16";
+  case GL_R16F:
+    return "R16F";
+  case GL_RG16F:
+    return "RG16F";
+  case GL_RGBA16F:
+    return "RGBA16F";
+  case GL_R32F:
+    return "R32F";
+  case GL_RG32F:
+    return "RG32F";
+  case GL_RGBA32F:
+    return "RGBA32F";
+  case GL_DEPTH_COMPONENT32F:
+    return "DEPTH32F";
+  case GL_DEPTH24_STENCIL8:
+    return "DEPTH24S8";
+  default:
+    return "?";
+  }
+}
+
+// a version of a resource; a default-constructed handle is "none"
+struct FrameGraphResource
+{
+  uint32_t node = UINT32_MAX;
+
+  bool valid() const { return node != UINT32_MAX; }
+};
+
+struct FrameGraphStats
+{
+  unsigned int passes = 0; // declared
+  unsigned int culledPasses = 0;
+  unsigned int transientTextures = 0; // transient resources used by the surviving passes
+  unsigned int pooledTextures = 0;    // GL textures those resources were given
+  unsigned int createdTextures = 0;   // by this frame's execute(), after a resize or a settings change
+  size_t transientBytes = 0;          // one texture per transient resource
+  size_t allocatedBytes = 0;          // the pool textures this frame used
+  size_t poolBytes = 0;               // everything the pool holds, including textures kept for reuse
+
+  size_t savedBytes() const { return transientBytes > allocatedBytes ? transientBytes - allocatedBytes : 0; }
+};
+
+class FrameGraph;
+
+// handed to a pass's callback; the pass's framebuffer is bound and the viewport set
+struct FrameGraphPassContext
+{
+  FrameGraph *graph = nullptr;
+  GLuint framebuffer = 0; // the one bound for the attachments (0 for the backbuffer or without attachments)
+  int width = 0;          // of the attachments, 0 without any
+  int height = 0;
+
+  // the GL texture behind a resource the pass declared
+  GLuint texture(FrameGraphResource resource) const;
+  // a cached framebuffer over resources the pass declared, e.g. the read side of a blit; binds it
+  GLuint framebufferFor(std::initializer_list<FrameGraphResource> colors, FrameGraphResource depth = FrameGraphResource()) const;
+};
+
+typedef std::function<void(const FrameGraphPassContext &)> FrameGraphCallback;
+
+class FrameGraphBuilder
+{
+public:
+  FrameGraphResource read(FrameGraphResource resource);
+  // returns the new version
+  FrameGraphResource write(FrameGraphResource resource);
+  // a write bound as the next colour attachment (location = call order)
+  FrameGraphResource colorAttachment(FrameGraphResource resource);
+  // without depth writes the pass only tests against it: a read, no new version
+  FrameGraphResource depthAttachment(FrameGraphResource resource, bool depthWrites = true);
+  // keeps the pass even when nothing reads what it writes
+  void sideEffect();
+  void execute(FrameGraphCallback callback);
+
+private:
+  friend class FrameGraph;
+  FrameGraphBuilder(FrameGraph &frameGraph, uint32_t passIndex) : graph(frameGraph), pass(passIndex) {}
+
+  FrameGraph &graph;
+  uint32_t pass;
+};
+
+class FrameGraph
+{
+public:
+  FrameGraph() = default;
+  FrameGraph(const FrameGraph &) = delete;
+  FrameGraph &operator=(const FrameGraph &) = delete;
+
+  // drops last frame's passes and resources; the pool and the framebuffers stay
+  void reset()
+  {
+    passes.clear();
+    resources.clear();
+    nodes.clear();
+    order.clear();
+    compiled = false;
+  }
+
+  FrameGraphResource createTexture(const std::string &name, const FrameGraphTextureDesc &desc)
+  {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    return addResource(resource);
+  }
+
+  // a texture owned elsewhere (history buffers, the Hi-Z pyramid); never pooled or attached
+  FrameGraphResource importTexture(const std::string &name, GLuint texture, const FrameGraphTextureDesc &desc)
+  {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.texture = texture;
+    return addResource(resource);
+  }
+
+  // the default framebuffer, colour and depth; attached alone
+  FrameGraphResource importBackbuffer(int width, int height)
+  {
+    Resource resource;
+    resource.name = "Backbuffer";
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.imported = true;
+    resource.backbuffer = true;
+    return addResource(resource);
+  }
+
+  FrameGraphBuilder addPass(const std::string &name)
+  {
+    Pass pass;
+    pass.name = name;
+    passes.push_back(pass);
+    compiled = false;
+    return FrameGraphBuilder(*this, (uint32_t)(passes.size() - 1));
+  }
+
+  const FrameGraphTextureDesc &desc(FrameGraphResource resource) const { return resources[nodes[resource.node].resource].desc; }
+
+  // valid while execute() runs the pass that declared it
+  GLuint texture(FrameGraphResource resource) const { return resources[nodes[resource.node].resource].texture; }
+
+  void compile()
+  {
+    problems.clear();
+
+    // reference counts: readers per version, versions produced per pass
+    for (Node &node : nodes)
+      node.readers = 0;
+    for (Pass &pass : passes)
+    {
+      pass.culled = false;
+      pass.producing = (uint32_t)pass.writes.size();
+      for (uint32_t w : pass.writes)
+        if (resources[nodes[w].resource].imported)
+          pass.sideEffect = true;
+      for (uint32_t r : pass.reads)
+        nodes[r].readers++;
+    }
+
+    // cull backwards from versions nobody reads
+    std::vector<uint32_t> unread;
+    auto cull = [&](Pass &pass)
+    {
+      pass.culled = true;
+      for (uint32_t r : pass.reads)
+        if (--nodes[r].readers == 0 && nodes[r].producer >= 0)
+          unread.push_back(r);
+    };
+    for (Pass &pass : passes)
+      if (pass.producing == 0 && !pass.sideEffect)
+        cull(pass);
+    for (uint32_t n = 0; n < nodes.size(); n++)
+      if (nodes[n].readers == 0 && nodes[n].producer >= 0)
+        unread.push_back(n);
+    while (!unread.empty())
+    {
+      Pass &producer = passes[nodes[unread.back()].producer];
+      unread.pop_back();
+      if (producer.sideEffect || producer.culled || --producer.producing > 0)
+        continue;
+      cull(producer);
+    }
+
+    // order: producers before readers, readers of a version before the pass that overwrites it
+    std::vector<std::vector<uint32_t>> successors(passes.size());
+    std::vector<uint32_t> predecessors(passes.size(), 0);
+    auto addEdge = [&](int from, int to)
+    {
+      if (from < 0 || to < 0 || from == to || passes[from].culled || passes[to].culled)
+        return;
+      successors[from].push_back((uint32_t)to);
+      predecessors[to]++;
+    };
+    for (uint32_t p = 0; p < passes.size(); p++)
+      for (uint32_t r : passes[p].reads)
+      {
+        addEdge(nodes[r].producer, (int)p);
+        addEdge((int)p, nodes[r].overwrittenBy);
+      }
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    size_t alive = 0;
+    for (uint32_t p = 0; p < passes.size(); p++)
+      if (!passes[p].culled)
+      {
+        alive++;
+        if (predecessors[p] == 0)
+          ready.push(p);
+      }
+    order.clear();
+    while (!ready.empty())
+    {
+      uint32_t p = ready.top();
+      ready.pop();
+      order.push_back(p);
+      for (uint32_t s : successors[p])
+        if (--predecessors[s] == 0)
+          ready.push(s);
+    }
+    if (order.size() != alive)
+    {
+      problems += "dependency cycle; running the passes in declaration order\n";
+      order.clear();
+      for (uint32_t p = 0; p < passes.size(); p++)
+        if (!passes[p].culled)
+          order.push_back(p);
+    }
+
+    // lifetimes in execution order, and declarations that cannot work
+    for (Resource &resource : resources)
+      resource.firstUse = resource.lastUse = -1;
+    for (int o = 0; o < (int)order.size(); o++)
+    {
+      const Pass &pass = passes[order[o]];
+      auto touch = [&](uint32_t n)
+      {
+        Resource &resource = resources[nodes[n].resource];
+        if (resource.firstUse < 0)
+          resource.firstUse = o;
+        resource.lastUse = o;
+      };
+      for (uint32_t r : pass.reads)
+      {
+        touch(r);
+        if (nodes[r].producer < 0 && !resources[nodes[r].resource].imported)
+          problems += pass.name + " reads " + resources[nodes[r].resource].name + " before anything writes it\n";
+      }
+      for (uint32_t w : pass.writes)
+        touch(w);
+      checkAttachments(pass);
+    }
+    if (!problems.empty() && problems != reportedProblems)
+      std::cout << "ERROR::FRAMEGRAPH::" << problems << std::flush;
+    reportedProblems = problems;
+    compiled = true;
+  }
+
+  // compiles if needed, then runs the surviving passes; leaves the last pass's framebuffer bound
+  void execute()
+  {
+    if (!compiled)
+      compile();
+    frameIndex++;
+    frameStats = FrameGraphStats();
+    frameStats.passes = (unsigned int)passes.size();
+    frameStats.culledPasses = (unsigned int)(passes.size() - order.size());
+
+    std::vector<std::vector<uint32_t>> acquireAt(order.size()), releaseAt(order.size());
+    for (uint32_t r = 0; r < resources.size(); r++)
+      if (!resources[r].imported && resources[r].firstUse >= 0)
+      {
+        acquireAt[resources[r].firstUse].push_back(r);
+        releaseAt[resources[r].lastUse].push_back(r);
+        frameStats.transientTextures++;
+        frameStats.transientBytes += textureBytes(resources[r].desc);
+      }
+
+    for (size_t o = 0; o < order.size(); o++)
+    {
+      for (uint32_t r : acquireAt[o])
+        acquire(resources[r]);
+
+      const Pass &pass = passes[order[o]];
+      FrameGraphPassContext context;
+      context.graph = this;
+      bindAttachments(pass, context);
+      if (pass.callback)
+        pass.callback(context);
+
+      for (uint32_t r : releaseAt[o])
+        pool[resources[r].pooled].inUse = false;
+    }
+
+    for (const PooledTexture &entry : pool)
+      if (entry.lastFrame == frameIndex)
+      {
+        frameStats.pooledTextures++;
+        frameStats.allocatedBytes += textureBytes(entry.desc);
+      }
+    buildDump();
+    evict();
+    for (const PooledTexture &entry : pool)
+      frameStats.poolBytes += textureBytes(entry.desc);
+  }
+
+  // cached framebuffer with these colour attachments (in order) and depth; binds it
+  GLuint framebuffer(const GLuint *colors, int count, GLuint depth)
+  {
+    std::vector<GLuint> key(colors, colors + count);
+    key.push_back(depth);
+    auto it = framebuffers.find(key);
+    if (it != framebuffers.end())
+    {
+      glBindFramebuffer(GL_FRAMEBUFFER, it->second);
+      return it->second;
+    }
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    GLenum drawBuffers[FRAMEGRAPH_MAX_COLOR_ATTACHMENTS];
+    for (int i = 0; i < count; i++)
+    {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i], 0);
+      drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    if (depth)
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    if (count > 0)
+      glDrawBuffers(count, drawBuffers);
+    else
+    {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      std::cout << "ERROR::FRAMEGRAPH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    framebuffers[key] = fbo;
+    return fbo;
+  }
+
+  // of the last execute()
+  const FrameGraphStats &stats() const { return frameStats; }
+  // passes in execution order with their reads and writes, then every resource's lifetime and texture
+  const std::string &dump() const { return dumpText; }
+
+  // GL thread, before the context goes away
+  void clear()
+  {
+    reset();
+    for (auto &entry : framebuffers)
+      glDeleteFramebuffers(1, &entry.second);
+    framebuffers.clear();
+    for (PooledTexture &entry : pool)
+      glDeleteTextures(1, &entry.texture);
+    pool.clear();
+  }
+
+private:
+  friend class FrameGraphBuilder;
+
+  struct Resource
+  {
+    std::string name;
+    FrameGraphTextureDesc desc;
+    bool imported = false;
+    bool backbuffer = false;
+    GLuint texture = 0; // imported, or the pool's during execute()
+    int pooled = -1;    // pool index while transient and alive
+    int firstUse = -1;  // position in `order`
+    int lastUse = -1;
+  };
+
+  struct Node
+  {
+    uint32_t resource = 0;
+    uint32_t version = 0;
+    int producer = -1;      // pass that wrote this version
+    int overwrittenBy = -1; // pass that wrote the next one
+    uint32_t readers = 0;
+  };
+
+  struct Pass
+  {
+    std::string name;
+    std::vector<uint32_t> reads;  // nodes
+    std::vector<uint32_t> writes; // nodes it produced
+    std::vector<uint32_t> colorAttachments; // resources
+    int depthAttachment = -1;
+    bool sideEffect = false;
+    FrameGraphCallback callback;
+    uint32_t producing = 0;
+    bool culled = false;
+  };
+
+  struct PooledTexture
+  {
+    FrameGraphTextureDesc desc;
+    GLuint texture = 0;
+    bool inUse = false;
+    uint64_t lastFrame = 0;
+  };
+
+  std::vector<Pass> passes;
+  std::vector<Resource> resources;
+  std::vector<Node> nodes;
+  std::vector<uint32_t> order; // surviving passes
+  bool compiled = false;
+  std::string problems, reportedProblems;
+
+  std::vector<PooledTexture> pool;
+  std::map<std::vector<GLuint>, GLuint> framebuffers; // colour textures + depth -> FBO
+  uint64_t frameIndex = 0;
+  FrameGraphStats frameStats;
+  std::string dumpText;
+
+  static size_t textureBytes(const FrameGraphTextureDesc &desc)
+  {
+    return (size_t)desc.width * (size_t)desc.height * frameGraphBytesPerPixel(desc.format);
+  }
+
+  FrameGraphResource addResource(const Resource &resource)
+  {
+    resources.push_back(resource);
+    Node node;
+    node.resource = (uint32_t)(resources.size() - 1);
+    nodes.push_back(node);
+    return FrameGraphResource{(uint32_t)(nodes.size() - 1)};
+  }
+
+  bool hasContents(uint32_t n) const { return nodes[n].producer >= 0 || resources[nodes[n].resource].imported; }
+
+  FrameGraphResource newVersion(uint32_t n, uint32_t pass)
+  {
+    Node node;
+    node.resource = nodes[n].resource;
+    node.version = nodes[n].version + 1;
+    node.producer = (int)pass;
+    nodes[n].overwrittenBy = (int)pass;
+    nodes.push_back(node);
+    passes[pass].writes.push_back((uint32_t)(nodes.size() - 1));
+    compiled = false;
+    return FrameGraphResource{(uint32_t)(nodes.size() - 1)};
+  }
+
+  void checkAttachments(const Pass &pass)
+  {
+    std::vector<uint32_t> attached = pass.colorAttachments;
+    if (pass.depthAttachment >= 0)
+      attached.push_back((uint32_t)pass.depthAttachment);
+    for (uint32_t r : attached)
+    {
+      const Resource &resource = resources[r];
+      if (resource.backbuffer && attached.size() > 1)
+        problems += pass.name + " attaches the backbuffer together with other targets\n";
+      else if (resource.imported && !resource.backbuffer)
+        problems += pass.name + " attaches imported " + resource.name + "\n";
+      if (!(resource.desc.width == resources[attached[0]].desc.width && resource.desc.height == resources[attached[0]].desc.height))
+        problems += pass.name + " attaches targets of different sizes\n";
+    }
+    if (pass.colorAttachments.size() > FRAMEGRAPH_MAX_COLOR_ATTACHMENTS)
+      problems += pass.name + " has too many colour attachments\n";
+  }
+
+  void acquire(Resource &resource)
+  {
+    int found = -1;
+    for (size_t i = 0; i < pool.size() && found < 0; i++)
+      if (!pool[i].inUse && pool[i].desc == resource.desc)
+        found = (int)i;
+    if (found < 0)
+    {
+      PooledTexture entry;
+      entry.desc = resource.desc;
+      glGenTextures(1, &entry.texture);
+      glBindTexture(GL_TEXTURE_2D, entry.texture);
+      glTexStorage2D(GL_TEXTURE_2D, 1, resource.desc.format, std::max(resource.desc.width, 1), std::max(resource.desc.height, 1));
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, resource.desc.filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, resource.desc.filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glBindTexture(GL_TEXTURE_2D, 0);
+      pool.push_back(entry);
+      found = (int)pool.size() - 1;
+      frameStats.createdTextures++;
+    }
+    pool[found].inUse = true;
+    pool[found].lastFrame = frameIndex;
+    resource.pooled = found;
+    resource.texture = pool[found].texture;
+  }
+
+  void bindAttachments(const Pass &pass, FrameGraphPassContext &context)
+  {
+    if (pass.colorAttachments.empty() && pass.depthAttachment < 0)
+      return;
+    const Resource &first = resources[pass.colorAttachments.empty() ? (uint32_t)pass.depthAttachment : pass.colorAttachments[0]];
+    context.width = first.desc.width;
+    context.height = first.desc.height;
+    if (first.backbuffer)
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    else
+    {
+      GLuint colors[FRAMEGRAPH_MAX_COLOR_ATTACHMENTS];
+      int count = 0;
+      for (uint32_t r : pass.colorAttachments)
+        if (count < FRAMEGRAPH_MAX_COLOR_ATTACHMENTS)
+          colors[count++] = resources[r].texture;
+      GLuint depth = pass.depthAttachment >= 0 ? resources[pass.depthAttachment].texture : 0;
+      context.framebuffer = framebuffer(colors, count, depth);
+    }
+    glViewport(0, 0, context.width, context.height);
+  }
+
+  // frees textures unused for a few frames, with the framebuffers that attach them
+  void evict()
+  {
+    for (size_t i = 0; i < pool.size();)
+    {
+      if (frameIndex - pool[i].lastFrame <= FRAMEGRAPH_POOL_FRAMES)
+      {
+        i++;
+        continue;
+      }
+      GLuint texture = pool[i].texture;
+      for (auto it = framebuffers.begin(); it != framebuffers.end();)
+      {
+        if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end())
+        {
+          glDeleteFramebuffers(1, &it->second);
+          it = framebuffers.erase(it);
+        }
+        else
+          ++it;
+      }
+      glDeleteTextures(1, &texture);
+      pool.erase(pool.begin() + (std::ptrdiff_t)i);
+    }
+  }
+
+  std::string versionName(uint32_t n) const
+  {
+    const Node &node = nodes[n];
+    std::string name = resources[node.resource].name;
+    if (node.version > 0)
+      name += " v" + std::to_string(node.version);
+    return name;
+  }
+
+  void buildDump()
+  {
+    char line[256];
+    dumpText.clear();
+    snprintf(line, sizeof(line), "%u passes (%u culled), %u transient textures\n", frameStats.passes, frameStats.culledPasses,
+             frameStats.transientTextures);
+    dumpText += line;
+    for (size_t o = 0; o < order.size(); o++)
+    {
+      const Pass &pass = passes[order[o]];
+      snprintf(line, sizeof(line), "%2zu %s\n", o, pass.name.c_str());
+      dumpText += line;
+      for (uint32_t r : pass.reads)
+        dumpText += "     < " + versionName(r) + "\n";
+      for (uint32_t w : pass.writes)
+        dumpText += "     > " + versionName(w) + "\n";
+    }
+    for (const Pass &pass : passes)
+      if (pass.culled)
+        dumpText += " - " + pass.name + " (culled)\n";
+
+    dumpText += "resources (lifetime in pass order):\n";
+    for (const Resource &resource : resources)
+    {
+      if (resource.firstUse < 0)
+        continue;
+      if (resource.imported)
+        snprintf(line, sizeof(line), "  %-24s imported %d-%d\n", resource.name.c_str(), resource.firstUse, resource.lastUse);
+      else
+        snprintf(line, sizeof(line), "  %-24s %-9s %5dx%-5d %6.2f MB  %2d-%-2d  texture %u\n", resource.name.c_str(),
+                 frameGraphFormatName(resource.desc.format), resource.desc.width, resource.desc.height,
+                 textureBytes(resource.desc) / (1024.0 * 1024.0), resource.firstUse, resource.lastUse, resource.texture);
+      dumpText += line;
+    }
+    snprintf(line, sizeof(line), "transient %.2f MB in %u textures of %.2f MB: %.2f MB saved by aliasing\n",
+             frameStats.transientBytes / (1024.0 * 1024.0), frameStats.pooledTextures, frameStats.allocatedBytes / (1024.0 * 1024.0),
+             frameStats.savedBytes() / (1024.0 * 1024.0));
+    dumpText += line;
+    dumpText += problems;
+  }
+};
+
+inline GLuint FrameGraphPassContext::texture(FrameGraphResource resource) const
+{
+  return graph->texture(resource);
+}
+
+inline GLuint FrameGraphPassContext::framebufferFor(std::initializer_list<FrameGraphResource> colors, FrameGraphResource depth) const
+{
+  GLuint textures[FRAMEGRAPH_MAX_COLOR_ATTACHMENTS];
+  int count = 0;
+  for (FrameGraphResource color : colors)
+    if (count < FRAMEGRAPH_MAX_COLOR_ATTACHMENTS)
+      textures[count++] = graph->texture(color);
+  return graph->framebuffer(textures, count, depth.valid() ? graph->texture(depth) : 0);
+}
+
+inline FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource)
+{
+  graph.passes[pass].reads.push_back(resource.node);
+  graph.compiled = false;
+  return resource;
+}
+
+inline FrameGraphResource FrameGraphBuilder::write(FrameGraphResource resource)
+{
+  if (graph.hasContents(resource.node))
+    read(resource);
+  return graph.newVersion(resource.node, pass);
+}
+
+inline FrameGraphResource FrameGraphBuilder::colorAttachment(FrameGraphResource resource)
+{
+  graph.passes[pass].colorAttachments.push_back(graph.nodes[resource.node].resource);
+  return write(resource);
+}
+
+inline FrameGraphResource FrameGraphBuilder::depthAttachment(FrameGraphResource resource, bool depthWrites)
+{
+  graph.passes[pass].depthAttachment = (int)graph.nodes[resource.node].resource;
+  return depthWrites ? write(resource) : read(resource);
+}
+
+inline void FrameGraphBuilder::sideEffect()
+{
+  graph.passes[pass].sideEffect = true;
+}
+
+inline void FrameGraphBuilder::execute(FrameGraphCallback callback)
+{
+  graph.passes[pass].callback = std::move(callback);
+}
+
+#endif // FRAME_GRAPH_H
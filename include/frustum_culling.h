@@ -0,0 +1,236 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#endif
+
+// View-frustum culling of world-space AABBs.
+//
+// Planes are pulled straight out of projection * view (Gribb/Hartmann) and point inwards, so a
+// point p is inside when dot(n, p) + d >= 0 for all six. A box with center c and half-extents e
+// is outside a plane when dot(n, c) + d + dot(|n|, e) < 0, i.e. even its most inward corner is
+// behind it. The test is conservative: boxes near frustum corners may be kept.
+//
+// cullAABBs runs that test on 8 boxes at a time with AVX (build with ENABLE_AVX) or 4 with SSE2,
+// over boxes stored as structure-of-arrays; cullAABBsScalar is the reference it must agree with,
+// index for index (tools/frustum_cull_report.cpp, FrustumCullReport, checks that).
+
+enum FrustumPlane
+{
+  FRUSTUM_LEFT = 0,
+  FRUSTUM_RIGHT,
+  FRUSTUM_BOTTOM,
+  FRUSTUM_TOP,
+  FRUSTUM_NEAR,
+  FRUSTUM_FAR,
+  FRUSTUM_PLANE_COUNT
+};
+
+struct Frustum
+{
+  glm::vec4 planes[FRUSTUM_PLANE_COUNT]; // xyz = normal (unit length), w = distance
+
+  static Frustum fromMatrix(const glm::mat4 &viewProjection)
+  {
+    // glm is column-major: m[col][row]
+    const glm::mat4 &m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[FRUSTUM_LEFT] = row3 + row0;
+    frustum.planes[FRUSTUM_RIGHT] = row3 - row0;
+    frustum.planes[FRUSTUM_BOTTOM] = row3 + row1;
+    frustum.planes[FRUSTUM_TOP] = row3 - row1;
+    frustum.planes[FRUSTUM_NEAR] = row3 + row2; // OpenGL clip space: -w <= z <= w
+    frustum.planes[FRUSTUM_FAR] = row3 - row2;
+    for (glm::vec4 &plane : frustum.planes)
+    {
+      float length = glm::length(glm::vec3(plane));
+      if (length > 0.0f)
+        plane /= length;
+    }
+    return frustum;
+  }
+
+  bool intersects(const AABB &box) const
+  {
+    glm::vec3 center = box.center();
+    glm::vec3 extents = box.extents();
+    for (const glm::vec4 &plane : planes)
+    {
+      float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+      float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+      if (distance + radius < 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  bool intersects(const BoundingSphere &sphere) const
+  {
+    for (const glm::vec4 &plane : planes)
+      if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+        return false;
+    return true;
+  }
+};
+
+// Boxes as center/extent columns, the layout the SIMD kernel loads from.
+struct AABBSoA
+{
+  std::vector<float> cx, cy, cz;
+  std::vector<float> ex, ey, ez;
+
+  size_t size() const { return cx.size(); }
+
+  void clear()
+  {
+    cx.clear(), cy.clear(), cz.clear();
+    ex.clear(), ey.clear(), ez.clear();
+  }
+
+  void reserve(size_t count)
+  {
+    cx.reserve(count), cy.reserve(count), cz.reserve(count);
+    ex.reserve(count), ey.reserve(count), ez.reserve(count);
+  }
+
+  void push(const AABB &box)
+  {
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+    cx.push_back(c.x), cy.push_back(c.y), cz.push_back(c.z);
+    ex.push_back(e.x), ey.push_back(e.y), ez.push_back(e.z);
+  }
+};
+
+struct CullingStats
+{
+  unsigned int tested = 0;
+  unsigned int visible = 0;
+
+  unsigned int culled() const { return tested - visible; }
+};
+
+namespace culling
+{
+  inline bool boxVisible(const Frustum &frustum, const AABBSoA &boxes, size_t i)
+  {
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+      float distance = plane.x * boxes.cx[i] + plane.y * boxes.cy[i] + plane.z * boxes.cz[i] + plane.w;
+      float radius = std::fabs(plane.x) * boxes.ex[i] + std::fabs(plane.y) * boxes.ey[i] + std::fabs(plane.z) * boxes.ez[i];
+      if (distance + radius < 0.0f)
+        return false;
+    }
+    return true;
+  }
+}
+
+// Appends the indices of boxes at least partly inside the frustum to `visible`; returns how many.
+inline size_t cullAABBsScalar(const Frustum &frustum, const AABBSoA &boxes, std::vector<uint32_t> &visible)
+{
+  size_t before = visible.size();
+  for (size_t i = 0; i < boxes.size(); i++)
+    if (culling::boxVisible(frustum, boxes, i))
+      visible.push_back((uint32_t)i);
+  return visible.size() - before;
+}
+
+inline size_t cullAABBs(const Frustum &frustum, const AABBSoA &boxes, std::vector<uint32_t> &visible)
+{
+  size_t before = visible.size();
+  size_t count = boxes.size();
+  size_t i = 0;
+
+#if defined(FRUSTUM_CULLING_AVX)
+  __m256 planeN[FRUSTUM_PLANE_COUNT][3], planeAbs[FRUSTUM_PLANE_COUNT][3], planeD[FRUSTUM_PLANE_COUNT];
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+  {
+    for (int a = 0; a < 3; a++)
+    {
+      planeN[p][a] = _mm256_set1_ps(frustum.planes[p][a]);
+      planeAbs[p][a] = _mm256_set1_ps(std::fabs(frustum.planes[p][a]));
+    }
+    planeD[p] = _mm256_set1_ps(frustum.planes[p].w);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256 cx = _mm256_loadu_ps(&boxes.cx[i]), cy = _mm256_loadu_ps(&boxes.cy[i]), cz = _mm256_loadu_ps(&boxes.cz[i]);
+    __m256 ex = _mm256_loadu_ps(&boxes.ex[i]), ey = _mm256_loadu_ps(&boxes.ey[i]), ez = _mm256_loadu_ps(&boxes.ez[i]);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+    {
+      __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeN[p][0], cx), _mm256_mul_ps(planeN[p][1], cy)),
+                                                    _mm256_mul_ps(planeN[p][2], cz)),
+                                      planeD[p]);
+      __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeAbs[p][0], ex), _mm256_mul_ps(planeAbs[p][1], ey)),
+                                    _mm256_mul_ps(planeAbs[p][2], ez));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+    }
+    int mask = _mm256_movemask_ps(inside);
+    if (mask == 0)
+      continue;
+    for (int lane = 0; lane < 8; lane++)
+      if (mask & (1 << lane))
+        visible.push_back((uint32_t)(i + lane));
+  }
+#elif defined(FRUSTUM_CULLING_SSE)
+  __m128 planeN[FRUSTUM_PLANE_COUNT][3], planeAbs[FRUSTUM_PLANE_COUNT][3], planeD[FRUSTUM_PLANE_COUNT];
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+  {
+    for (int a = 0; a < 3; a++)
+    {
+      planeN[p][a] = _mm_set1_ps(frustum.planes[p][a]);
+      planeAbs[p][a] = _mm_set1_ps(std::fabs(frustum.planes[p][a]));
+    }
+    planeD[p] = _mm_set1_ps(frustum.planes[p].w);
+  }
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 cx = _mm_loadu_ps(&boxes.cx[i]), cy = _mm_loadu_ps(&boxes.cy[i]), cz = _mm_loadu_ps(&boxes.cz[i]);
+    __m128 ex = _mm_loadu_ps(&boxes.ex[i]), ey = _mm_loadu_ps(&boxes.ey[i]), ez = _mm_loadu_ps(&boxes.ez[i]);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+    {
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeN[p][0], cx), _mm_mul_ps(planeN[p][1], cy)),
+                                              _mm_mul_ps(planeN[p][2], cz)),
+                                   planeD[p]);
+      __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeAbs[p][0], ex), _mm_mul_ps(planeAbs[p][1], ey)),
+                                 _mm_mul_ps(planeAbs[p][2], ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+    }
+    int mask = _mm_movemask_ps(inside);
+    if (mask == 0)
+      continue;
+    for (int lane = 0; lane < 4; lane++)
+      if (mask & (1 << lane))
+        visible.push_back((uint32_t)(i + lane));
+  }
+#endif
+
+  for (; i < count; i++)
+    if (culling::boxVisible(frustum, boxes, i))
+      visible.push_back((uint32_t)i);
+  return visible.size() - before;
+}
+
+#endif // FRUSTUM_CULLING_H
@@ -0,0 +1,116 @@
+#ifndef GBUFFER_ENCODING_H
+#define GBUFFER_ENCODING_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+// CPU mirror of data/shaders/gbuffer_encoding.glsl: the same octahedral normal mapping, the
+// rounding a GL_RG16 target applies, and position reconstruction from depth. Tools use it to
+// measure precision; keep it in step with the GLSL.
+
+inline glm::vec2 signNotZero(const glm::vec2 &v)
+{
+  return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+  n /= std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+  glm::vec2 p(n.x, n.y);
+  if (n.z < 0.0f)
+    p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(p);
+  return p;
+}
+
+inline glm::vec3 octDecode(const glm::vec2 &p)
+{
+  glm::vec3 n(p.x, p.y, 1.0f - std::fabs(p.x) - std::fabs(p.y));
+  if (n.z < 0.0f)
+  {
+    glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+    n.x = folded.x;
+    n.y = folded.y;
+  }
+  return glm::normalize(n);
+}
+
+// what the fixed-function output stage writes for a float into a 16-bit unorm channel
+inline uint16_t quantizeUnorm16(float v)
+{
+  return (uint16_t)std::lround(glm::clamp(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+// encodeNormal() as stored in the RG16 target, and decodeNormal() of the fetched texel
+inline glm::u16vec2 packNormalRG16(const glm::vec3 &n)
+{
+  glm::vec2 e = octEncode(n) * 0.5f + 0.5f;
+  return glm::u16vec2(quantizeUnorm16(e.x), quantizeUnorm16(e.y));
+}
+
+inline glm::vec3 unpackNormalRG16(const glm::u16vec2 &texel)
+{
+  return octDecode(glm::vec2(texel) / 65535.0f * 2.0f - 1.0f);
+}
+
+inline glm::vec3 reconstructPosition(const glm::vec2 &uv, float depth, const glm::mat4 &inverseMatrix)
+{
+  glm::vec4 position = inverseMatrix * glm::vec4(glm::vec3(uv, depth) * 2.0f - 1.0f, 1.0f);
+  return glm::vec3(position) / position.w;
+}
+
+// Per-frame G-buffer traffic, as a lower bound: every target written once by the geometry pass
+// (times `overdraw`) and read once by each full-screen pass that samples it (SSAO, lighting, the
+// depth blit). Texture caches absorb the SSAO kernel's extra taps, so they are not counted.
+struct GBufferTargetInfo
+{
+  const char *name;
+  const char *format;
+  unsigned int bytesPerPixel;
+  unsigned int fullscreenReads;
+};
+
+struct GBufferLayoutInfo
+{
+  const char *name;
+  const GBufferTargetInfo *targets;
+  unsigned int targetCount;
+
+  unsigned int bytesPerPixel() const
+  {
+    unsigned int bytes = 0;
+    for (unsigned int t = 0; t < targetCount; t++)
+      bytes += targets[t].bytesPerPixel;
+    return bytes;
+  }
+
+  double frameBytes(int width, int height, float overdraw = 1.0f) const
+  {
+    double perPixel = 0.0;
+    for (unsigned int t = 0; t < targetCount; t++)
+      perPixel += targets[t].bytesPerPixel * (overdraw + (double)targets[t].fullscreenReads);
+    return perPixel * width * height;
+  }
+};
+
+// position + full normal, as before depth reconstruction (RGB16F is usually padded to 8 bytes)
+inline constexpr GBufferTargetInfo GBUFFER_LEGACY_TARGETS[] = {
+    {"position", "RGB16F", 8, 2},
+    {"normal + rough/metal", "RGBA16F", 8, 2},
+    {"albedo + metal", "RGBA8", 4, 1},
+    {"AO/emissive/specular", "RGBA8", 4, 1},
+    {"depth", "DEPTH32F", 4, 1},
+};
+// GBuffer in buffers.h
+inline constexpr GBufferTargetInfo GBUFFER_COMPACT_TARGETS[] = {
+    {"octahedral normal", "RG16", 4, 2},
+    {"albedo + metal", "RGBA8", 4, 1},
+    {"rough/AO/emissive/specular", "RGBA8", 4, 1},
+    {"depth", "DEPTH32F", 4, 3},
+    {"motion vectors (TAA)", "RG16F", 4, 1},
+};
+inline constexpr GBufferLayoutInfo GBUFFER_LAYOUT_LEGACY{"legacy", GBUFFER_LEGACY_TARGETS, 5};
+inline constexpr GBufferLayoutInfo GBUFFER_LAYOUT_COMPACT{"compact", GBUFFER_COMPACT_TARGETS, 5};
+
+#endif // GBUFFER_ENCODING_H
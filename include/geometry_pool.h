@@ -0,0 +1,477 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <glad/glad.h>
+
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// Shared vertex/index storage for every Mesh.
+//
+// Meshes with the same VertexLayout and index type live in one arena: a vertex buffer per stream,
+// an index buffer and a single VAO over them. A mesh owns a range of vertices and a range of
+// indices in its arena and draws with glDraw*BaseVertex, so consecutive meshes of an arena need no
+// VAO switch and a scene has a few buffer objects instead of three per mesh.
+//
+// Ranges come from a best-fit free list per buffer (RangeAllocator) that merges neighbours on
+// release. A full arena doubles its buffers and copies the contents over, keeping offsets.
+// Releasing meshes leaves holes; update() compacts an arena whose free space is large and
+// scattered (or mostly unused) into fresh buffers, which moves ranges. Anything that caches
+// offsets or buffer names (GpuDrivenScene) compares revision() and rebuilds when it changes.
+
+typedef uint32_t GeometryHandle;
+#define GEOMETRY_NO_ALLOCATION 0xFFFFFFFFu
+#define GEOMETRY_NO_ARENA 0xFFFFFFFFu
+
+// first buffer sizes of an arena, in vertices and indices; growth doubles them
+#define GEOMETRY_POOL_INITIAL_VERTICES 16384u
+#define GEOMETRY_POOL_INITIAL_INDICES 65536u
+
+// Free list over [0, capacity) in abstract units (vertices or indices).
+class RangeAllocator
+{
+public:
+  size_t capacity() const { return total; }
+  size_t used() const { return usedUnits; }
+  size_t freeBlockCount() const { return freeBlocks.size(); }
+
+  size_t largestFree() const
+  {
+    size_t largest = 0;
+    for (const auto &block : freeBlocks)
+      largest = std::max(largest, block.second);
+    return largest;
+  }
+
+  // 0 while the free space is one block, approaching 1 as it splinters
+  float fragmentation() const
+  {
+    size_t free = total - usedUnits;
+    return free ? 1.0f - (float)largestFree() / (float)free : 0.0f;
+  }
+
+  // best fit; false if no free block is large enough
+  bool allocate(size_t size, size_t &offset)
+  {
+    if (size == 0)
+    {
+      offset = 0;
+      return true;
+    }
+    auto best = freeBlocks.end();
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+      if (it->second >= size && (best == freeBlocks.end() || it->second < best->second))
+      {
+        best = it;
+        if (it->second == size)
+          break;
+      }
+    if (best == freeBlocks.end())
+      return false;
+    offset = best->first;
+    size_t remaining = best->second - size;
+    freeBlocks.erase(best);
+    if (remaining)
+      freeBlocks.emplace(offset + size, remaining);
+    usedUnits += size;
+    return true;
+  }
+
+  void release(size_t offset, size_t size)
+  {
+    if (size == 0)
+      return;
+    usedUnits -= size;
+    addFree(offset, size);
+  }
+
+  // appends [capacity, newCapacity) as free space
+  void grow(size_t newCapacity)
+  {
+    if (newCapacity <= total)
+      return;
+    size_t oldCapacity = total;
+    total = newCapacity;
+    addFree(oldCapacity, newCapacity - oldCapacity);
+  }
+
+  // after compaction: [0, usedPrefix) allocated, the rest one free block
+  void reset(size_t newCapacity, size_t usedPrefix)
+  {
+    freeBlocks.clear();
+    total = newCapacity;
+    usedUnits = usedPrefix;
+    if (newCapacity > usedPrefix)
+      freeBlocks.emplace(usedPrefix, newCapacity - usedPrefix);
+  }
+
+private:
+  std::map<size_t, size_t> freeBlocks; // offset -> size, never adjacent
+  size_t total = 0;
+  size_t usedUnits = 0;
+
+  void addFree(size_t offset, size_t size)
+  {
+    auto next = freeBlocks.lower_bound(offset);
+    if (next != freeBlocks.begin())
+    {
+      auto previous = std::prev(next);
+      if (previous->first + previous->second == offset)
+      {
+        offset = previous->first;
+        size += previous->second;
+        freeBlocks.erase(previous);
+      }
+    }
+    if (next != freeBlocks.end() && offset + size == next->first)
+    {
+      size += next->second;
+      freeBlocks.erase(next);
+    }
+    freeBlocks.emplace(offset, size);
+  }
+};
+
+struct GeometryArena
+{
+  VertexLayout layout;
+  GLenum indexType = GL_UNSIGNED_INT;
+  size_t indexSize = sizeof(uint32_t);
+  GLuint vao = 0;
+  GLuint vertexBuffers[2] = {0, 0}; // one per stream
+  GLuint indexBuffer = 0;
+  RangeAllocator vertices; // shared by both streams
+  RangeAllocator indices;
+  unsigned int allocations = 0;
+
+  size_t vertexBytes(size_t count) const { return layout.bytesFor(count); }
+  size_t indexBytes(size_t count) const { return count * indexSize; }
+};
+
+// where a mesh lives: draw with baseVertex and indices starting at firstIndex
+struct GeometryRange
+{
+  uint32_t arena = GEOMETRY_NO_ARENA;
+  uint32_t baseVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+};
+
+struct GeometryPoolStats
+{
+  unsigned int arenas = 0;
+  unsigned int allocations = 0;
+  unsigned int freeBlocks = 0;
+  size_t capacityBytes = 0;
+  size_t usedBytes = 0;
+  size_t freeBytes = 0;
+  size_t largestFreeBytes = 0; // summed over every buffer's largest hole
+  unsigned int grows = 0;
+  unsigned int compactions = 0;
+  size_t compactedBytes = 0;
+
+  float utilization() const { return capacityBytes ? (float)usedBytes / (float)capacityBytes : 0.0f; }
+  float fragmentation() const { return freeBytes ? 1.0f - (float)largestFreeBytes / (float)freeBytes : 0.0f; }
+};
+
+class GeometryPool
+{
+public:
+  static GeometryPool &instance()
+  {
+    static GeometryPool pool;
+    return pool;
+  }
+
+  GeometryPool(const GeometryPool &) = delete;
+  GeometryPool &operator=(const GeometryPool &) = delete;
+
+  // GL thread. Places a mesh: `streams` are packed for `layout`, `indexData` is already `indexType`.
+  GeometryHandle allocate(const VertexLayout &layout, GLenum indexType, uint32_t vertexCount, const void *const streams[2],
+                          uint32_t indexCount, const void *indexData)
+  {
+    uint32_t arenaIndex = findArena(layout, indexType);
+    GeometryArena &arena = arenas[arenaIndex];
+
+    size_t baseVertex, firstIndex;
+    while (!arena.vertices.allocate(vertexCount, baseVertex))
+      growVertices(arena, vertexCount);
+    while (!arena.indices.allocate(indexCount, firstIndex))
+      growIndices(arena, indexCount);
+
+    for (unsigned int stream = 0; stream < arena.layout.streamCount() && stream < 2; stream++)
+    {
+      size_t stride = arena.layout.stride(stream);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, arena.vertexBuffers[stream]);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(baseVertex * stride), (GLsizeiptr)(vertexCount * stride), streams[stream]);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)arena.indexBytes(firstIndex), (GLsizeiptr)arena.indexBytes(indexCount), indexData);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GeometryRange range;
+    range.arena = arenaIndex;
+    range.baseVertex = (uint32_t)baseVertex;
+    range.vertexCount = vertexCount;
+    range.firstIndex = (uint32_t)firstIndex;
+    range.indexCount = indexCount;
+    arena.allocations++;
+
+    GeometryHandle handle;
+    if (!freeHandles.empty())
+    {
+      handle = freeHandles.back();
+      freeHandles.pop_back();
+      ranges[handle] = range;
+    }
+    else
+    {
+      handle = (GeometryHandle)ranges.size();
+      ranges.push_back(range);
+    }
+    return handle;
+  }
+
+  // Returns the ranges to the free lists. No GL calls, so it is safe after the context is gone;
+  // the space is reclaimed by the next update().
+  void release(GeometryHandle handle)
+  {
+    if (handle >= ranges.size() || ranges[handle].arena == GEOMETRY_NO_ARENA)
+      return;
+    GeometryRange &range = ranges[handle];
+    GeometryArena &arena = arenas[range.arena];
+    arena.vertices.release(range.baseVertex, range.vertexCount);
+    arena.indices.release(range.firstIndex, range.indexCount);
+    arena.allocations--;
+    range = GeometryRange();
+    freeHandles.push_back(handle);
+  }
+
+  const GeometryRange &range(GeometryHandle handle) const { return ranges[handle]; }
+  const GeometryArena &arena(uint32_t index) const { return arenas[index]; }
+  size_t arenaCount() const { return arenas.size(); }
+
+  // changes whenever a range moves or a buffer object is replaced
+  uint32_t revision() const { return currentRevision; }
+
+  // GL thread, once per frame: compacts arenas that releases left fragmented or mostly empty
+  void update()
+  {
+    for (uint32_t a = 0; a < arenas.size(); a++)
+      if (needsCompaction(arenas[a].vertices, GEOMETRY_POOL_INITIAL_VERTICES) ||
+          needsCompaction(arenas[a].indices, GEOMETRY_POOL_INITIAL_INDICES))
+        compact(a);
+  }
+
+  // Moves every live range of the arena to the front of new, right-sized buffers. GL thread.
+  void compact(uint32_t arenaIndex)
+  {
+    GeometryArena &arena = arenas[arenaIndex];
+    std::vector<GeometryHandle> live;
+    for (GeometryHandle h = 0; h < ranges.size(); h++)
+      if (ranges[h].arena == arenaIndex)
+        live.push_back(h);
+
+    size_t vertexCapacity = compactedCapacity(arena.vertices.used(), GEOMETRY_POOL_INITIAL_VERTICES);
+    size_t indexCapacity = compactedCapacity(arena.indices.used(), GEOMETRY_POOL_INITIAL_INDICES);
+    unsigned int streamCount = std::min(arena.layout.streamCount(), 2u);
+
+    // vertices, in their current order so neighbouring meshes stay neighbours
+    std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b)
+              { return ranges[a].baseVertex < ranges[b].baseVertex; });
+    std::vector<std::pair<size_t, size_t>> moves; // (old offset, count) in order, packed from 0
+    for (GeometryHandle h : live)
+      moves.push_back({ranges[h].baseVertex, ranges[h].vertexCount});
+    for (unsigned int stream = 0; stream < streamCount; stream++)
+      arena.vertexBuffers[stream] = relocate(arena.vertexBuffers[stream], vertexCapacity * arena.layout.stride(stream), moves,
+                                             arena.layout.stride(stream));
+    size_t next = 0;
+    for (GeometryHandle h : live)
+    {
+      ranges[h].baseVertex = (uint32_t)next;
+      next += ranges[h].vertexCount;
+    }
+    arena.vertices.reset(vertexCapacity, next);
+
+    std::sort(live.begin(), live.end(), [&](GeometryHandle a, GeometryHandle b)
+              { return ranges[a].firstIndex < ranges[b].firstIndex; });
+    moves.clear();
+    for (GeometryHandle h : live)
+      moves.push_back({ranges[h].firstIndex, ranges[h].indexCount});
+    arena.indexBuffer = relocate(arena.indexBuffer, arena.indexBytes(indexCapacity), moves, arena.indexSize);
+    next = 0;
+    for (GeometryHandle h : live)
+    {
+      ranges[h].firstIndex = (uint32_t)next;
+      next += ranges[h].indexCount;
+    }
+    arena.indices.reset(indexCapacity, next);
+
+    buildVertexArray(arena);
+    compactions++;
+    compactedBytes += arena.vertexBytes(arena.vertices.used()) + arena.indexBytes(arena.indices.used());
+    currentRevision++;
+  }
+
+  GeometryPoolStats stats() const
+  {
+    GeometryPoolStats s;
+    s.arenas = (unsigned int)arenas.size();
+    for (const GeometryArena &arena : arenas)
+    {
+      s.allocations += arena.allocations;
+      s.freeBlocks += (unsigned int)(arena.vertices.freeBlockCount() + arena.indices.freeBlockCount());
+      s.capacityBytes += arena.vertexBytes(arena.vertices.capacity()) + arena.indexBytes(arena.indices.capacity());
+      s.usedBytes += arena.vertexBytes(arena.vertices.used()) + arena.indexBytes(arena.indices.used());
+      s.largestFreeBytes += arena.vertexBytes(arena.vertices.largestFree()) + arena.indexBytes(arena.indices.largestFree());
+    }
+    s.freeBytes = s.capacityBytes - s.usedBytes;
+    s.grows = grows;
+    s.compactions = compactions;
+    s.compactedBytes = compactedBytes;
+    return s;
+  }
+
+private:
+  GeometryPool() = default;
+
+  std::vector<GeometryArena> arenas; // never removed, so arena indices stay valid
+  std::vector<GeometryRange> ranges; // by handle; arena GEOMETRY_NO_ARENA when free
+  std::vector<GeometryHandle> freeHandles;
+  uint32_t currentRevision = 0;
+  unsigned int grows = 0;
+  unsigned int compactions = 0;
+  size_t compactedBytes = 0;
+
+  uint32_t findArena(const VertexLayout &layout, GLenum indexType)
+  {
+    for (uint32_t a = 0; a < arenas.size(); a++)
+      if (arenas[a].layout == layout && arenas[a].indexType == indexType)
+        return a;
+    arenas.emplace_back();
+    GeometryArena &arena = arenas.back();
+    arena.layout = layout;
+    arena.indexType = indexType;
+    arena.indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    return (uint32_t)(arenas.size() - 1);
+  }
+
+  static bool needsCompaction(const RangeAllocator &allocator, size_t initialCapacity)
+  {
+    size_t free = allocator.capacity() - allocator.used();
+    bool scattered = free * 4 > allocator.capacity() && allocator.fragmentation() > 0.5f;
+    bool oversized = allocator.capacity() > initialCapacity && allocator.used() * 4 < allocator.capacity();
+    return scattered || oversized;
+  }
+
+  // power-of-two multiple of the initial size with at least a quarter of headroom
+  static size_t compactedCapacity(size_t used, size_t initialCapacity)
+  {
+    size_t capacity = initialCapacity;
+    while (capacity < used + used / 4)
+      capacity *= 2;
+    return capacity;
+  }
+
+  void growVertices(GeometryArena &arena, size_t needed)
+  {
+    size_t oldCapacity = arena.vertices.capacity();
+    size_t newCapacity = oldCapacity ? oldCapacity * 2 : GEOMETRY_POOL_INITIAL_VERTICES;
+    while (newCapacity < oldCapacity + needed)
+      newCapacity *= 2;
+    for (unsigned int stream = 0; stream < arena.layout.streamCount() && stream < 2; stream++)
+    {
+      size_t stride = arena.layout.stride(stream);
+      arena.vertexBuffers[stream] = resize(arena.vertexBuffers[stream], oldCapacity * stride, newCapacity * stride);
+    }
+    arena.vertices.grow(newCapacity);
+    buildVertexArray(arena);
+    grows++;
+    currentRevision++;
+  }
+
+  void growIndices(GeometryArena &arena, size_t needed)
+  {
+    size_t oldCapacity = arena.indices.capacity();
+    size_t newCapacity = oldCapacity ? oldCapacity * 2 : GEOMETRY_POOL_INITIAL_INDICES;
+    while (newCapacity < oldCapacity + needed)
+      newCapacity *= 2;
+    arena.indexBuffer = resize(arena.indexBuffer, arena.indexBytes(oldCapacity), arena.indexBytes(newCapacity));
+    arena.indices.grow(newCapacity);
+    buildVertexArray(arena);
+    grows++;
+    currentRevision++;
+  }
+
+  // new buffer of `newBytes` holding the first `oldBytes` of `buffer`, which is deleted
+  static GLuint resize(GLuint buffer, size_t oldBytes, size_t newBytes)
+  {
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newBytes, nullptr, GL_STATIC_DRAW);
+    if (buffer && oldBytes)
+    {
+      glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)oldBytes);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (buffer)
+      glDeleteBuffers(1, &buffer);
+    return grown;
+  }
+
+  // new buffer of `newBytes` with the `moves` (offset, count in elements) packed from the start;
+  // runs that are already adjacent are copied in one go. `buffer` is deleted.
+  static GLuint relocate(GLuint buffer, size_t newBytes, const std::vector<std::pair<size_t, size_t>> &moves, size_t elementSize)
+  {
+    GLuint packed;
+    glGenBuffers(1, &packed);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    size_t destination = 0;
+    for (size_t i = 0; i < moves.size();)
+    {
+      size_t source = moves[i].first, count = moves[i].second;
+      for (i++; i < moves.size() && moves[i].first == source + count; i++)
+        count += moves[i].second;
+      if (count)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)(source * elementSize),
+                            (GLintptr)(destination * elementSize), (GLsizeiptr)(count * elementSize));
+      destination += count;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (buffer)
+      glDeleteBuffers(1, &buffer);
+    return packed;
+  }
+
+  // (re)points the arena's VAO at its current buffers; the VAO name never changes
+  static void buildVertexArray(GeometryArena &arena)
+  {
+    if (!arena.vao)
+      glGenVertexArrays(1, &arena.vao);
+    glBindVertexArray(arena.vao);
+    for (unsigned int stream = 0; stream < arena.layout.streamCount() && stream < 2; stream++)
+    {
+      if (!arena.vertexBuffers[stream])
+        continue;
+      glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffers[stream]);
+      arena.layout.applyAttributes(stream);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+};
+
+#endif // GEOMETRY_POOL_H
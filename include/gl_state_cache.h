@@ -0,0 +1,117 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// Shadows the bits of GL binding state the render queue touches, so binding what is already bound
+// costs nothing. Code outside the queue binds GL objects directly, so call invalidate() before
+// relying on the cache after such code has run (RenderQueue::execute does this itself).
+
+#define GL_STATE_CACHE_TEXTURE_UNITS 16
+
+struct RenderCounters
+{
+  unsigned int draws = 0;
+  unsigned int triangles = 0;
+  unsigned int programBinds = 0;
+  unsigned int vaoBinds = 0;
+  unsigned int textureBinds = 0;
+  unsigned int uniformUploads = 0; // per-draw transforms and per-material sampler setup
+  unsigned int elidedBinds = 0;    // redundant program/VAO/texture binds skipped by the cache
+};
+
+class GLStateCache
+{
+public:
+  RenderCounters counters;
+
+  GLStateCache() { invalidate(); }
+
+  void invalidate()
+  {
+    program = INVALID;
+    vao = INVALID;
+    activeUnit = INVALID;
+    std::memset(textures, 0xFF, sizeof(textures));
+    std::memset(arrayTextures, 0xFF, sizeof(arrayTextures));
+  }
+
+  void resetCounters() { counters = RenderCounters(); }
+
+  // true if the program actually changed
+  bool useProgram(GLuint id)
+  {
+    if (program == id)
+    {
+      counters.elidedBinds++;
+      return false;
+    }
+    glUseProgram(id);
+    program = id;
+    counters.programBinds++;
+    return true;
+  }
+
+  void bindVertexArray(GLuint id)
+  {
+    if (vao == id)
+    {
+      counters.elidedBinds++;
+      return;
+    }
+    glBindVertexArray(id);
+    vao = id;
+    counters.vaoBinds++;
+  }
+
+  void bindTexture2D(unsigned int unit, GLuint id)
+  {
+    if (unit < GL_STATE_CACHE_TEXTURE_UNITS && textures[unit] == id)
+    {
+      counters.elidedBinds++;
+      return;
+    }
+    if (activeUnit != unit)
+    {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, id);
+    if (unit < GL_STATE_CACHE_TEXTURE_UNITS)
+      textures[unit] = id;
+    counters.textureBinds++;
+  }
+
+  // GL_TEXTURE_2D_ARRAY binds are tracked separately; a unit holds one binding per target
+  void bindTexture2DArray(unsigned int unit, GLuint id)
+  {
+    if (unit < GL_STATE_CACHE_TEXTURE_UNITS && arrayTextures[unit] == id)
+    {
+      counters.elidedBinds++;
+      return;
+    }
+    if (activeUnit != unit)
+    {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    if (unit < GL_STATE_CACHE_TEXTURE_UNITS)
+      arrayTextures[unit] = id;
+    counters.textureBinds++;
+  }
+
+  GLuint currentProgram() const { return program; }
+
+private:
+  static constexpr GLuint INVALID = 0xFFFFFFFFu;
+  GLuint program = INVALID;
+  GLuint vao = INVALID;
+  GLuint activeUnit = INVALID;
+  GLuint textures[GL_STATE_CACHE_TEXTURE_UNITS];
+  GLuint arrayTextures[GL_STATE_CACHE_TEXTURE_UNITS];
+};
+
+#endif // GL_STATE_CACHE_H
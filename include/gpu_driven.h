@@ -0,0 +1,636 @@
+#ifndef GPU_DRIVEN_H
+#define GPU_DRIVEN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "buffers.h"
+#include "frustum_culling.h"
+#include "geometry_pool.h"
+#include "gl_state_cache.h"
+#include "hiz.h"
+#include "material.h"
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "shader.h"
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// GPU-driven geometry pass.
+//
+// Meshes already share vertex + index buffers per GeometryPool arena; a "geometry group" is an
+// arena plus a VAO of this pass that adds the instance attribute. Every placed mesh becomes a
+// GpuDrawInstance in an SSBO. Each frame gpu_cull.glsl tests all
+// instances against the frustum and appends a DrawElementsIndirectCommand for each survivor to
+// its bucket's range of the command buffer, counting draws per bucket. The CPU then issues one
+// multi-draw per bucket: glMultiDrawElementsIndirectCount where GL 4.6 is available, otherwise
+// glMultiDrawElementsIndirect over the whole range, with unused commands cleared to zero.
+//
+// A bucket is (geometry group, material array signature): draws in one multi-draw must share a
+// VAO, and deferred.fs indexes uMaterialArrays by material, which must stay dynamically uniform.
+// The instance index reaches the vertex shader through a divisor-1 attribute (location 7) that
+// the command's baseInstance offsets, which works on GL 4.3 without shader draw parameters.
+//
+// Occlusion culling splits the pass in two (GpuCullPhase): last frame's visible set is drawn
+// first, the caller builds a Hi-Z pyramid from that depth, and the second cull tests everything
+// else in the frustum against it. Early and late draws use separate halves of the command buffer
+// and their own per-bucket counts, so the first multi-draw is not overwritten by the second cull.
+//
+// Every LOD of a mesh is in its pool range; the cull pass picks a level per instance from the same
+// screen-space error rule as the render queue (mesh_lod.h) and emits that level's index range.
+// At LOD 0 a clustered mesh is meshlet-culled in the same invocation (frustum and normal cone,
+// meshlet.h) and emits one command per run of adjacent surviving meshlets, so every instance
+// reserves one command slot per meshlet.
+//
+// Only meshes with a MaterialLibrary material and a single-stream (unskinned) layout qualify.
+// Instances bake pool offsets in, so they are rebuilt whenever GeometryPool::revision() changes.
+
+#define GPU_DRIVEN_NO_INSTANCE 0xFFFFFFFFu
+// per-instance index attribute, after the VertexSemantic locations 0-6
+#define GPU_DRIVEN_INSTANCE_LOCATION 7
+
+// must match the buffer bindings in gpu_cull.glsl and deferred_indirect.vs
+enum GpuDrivenStorageBinding
+{
+  SSBO_BINDING_DRAW_INSTANCES = 6,
+  SSBO_BINDING_DRAW_COMMANDS = 7,
+  SSBO_BINDING_DRAW_COUNTS = 8,
+  SSBO_BINDING_DRAW_VISIBILITY = 9,
+  SSBO_BINDING_MESH_LODS = 10,
+  SSBO_BINDING_MESHLETS = 11,
+};
+
+// must match the PHASE_ defines in gpu_cull.glsl
+enum GpuCullPhase
+{
+  GPU_CULL_FRUSTUM,          // single pass, frustum only
+  GPU_CULL_PREVIOUS_VISIBLE, // occlusion phase 1: what passed the last occlusion test
+  GPU_CULL_OCCLUSION,        // occlusion phase 2: the rest, tested against the Hi-Z pyramid
+};
+
+// GL's indirect command layout
+struct DrawElementsIndirectCommand
+{
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// std430, mirrored by DrawInstance in gpu_cull.glsl and deferred_indirect.vs
+struct GpuDrawInstance
+{
+  glm::mat4 model;
+  glm::vec4 normalMatrix[3]; // inverse transpose of model, mat3 columns each padded to a vec4
+  glm::vec4 boundsCenter;  // local space
+  glm::vec4 boundsExtents;
+  glm::uvec4 draw;   // LOD 0 indexCount, firstIndex, baseVertex (bit pattern of an int), materialID
+  glm::uvec4 bucket; // bucket index, first command slot of the bucket, first LOD entry, LOD count
+  glm::uvec4 meshlets; // first GpuMeshlet, meshlet count (0: LOD 0 is drawn whole), unused, unused
+};
+
+// std430, mirrored by MeshletBounds in gpu_cull.glsl
+struct GpuMeshlet
+{
+  glm::vec4 sphere; // mesh-space center, radius
+  glm::vec4 cone;   // axis, cutoff
+  glm::uvec4 range; // indexCount, firstIndex in the geometry group, unused, unused
+};
+
+struct GpuDrivenStats
+{
+  unsigned int instances = 0;
+  unsigned int buckets = 0;
+  unsigned int geometryGroups = 0;
+  // from the cull pass, read back a frame or two late
+  unsigned int visible = 0;    // inside the frustum
+  unsigned int occluded = 0;   // inside the frustum but behind the Hi-Z pyramid
+  unsigned int drawnEarly = 0; // frustum pass, or occlusion phase 1
+  unsigned int drawnLate = 0;  // occlusion phase 2: became visible this frame
+  MeshletCullStats meshlets;   // of the instances drawn at LOD 0
+  size_t geometryBytes = 0;
+  bool drawCountPath = false;
+};
+
+class GpuDrivenScene
+{
+public:
+  void init(const std::string &shaderDir)
+  {
+    cullShader = std::make_unique<ComputeShader>((shaderDir + "/gpu_cull.glsl").c_str(), "gpuCullShader");
+    instanceBuffer.init((GLsizeiptr)sizeof(GpuDrawInstance) * 64, SSBO_BINDING_DRAW_INSTANCES);
+    commandBuffer.init((GLsizeiptr)sizeof(DrawElementsIndirectCommand) * 64, SSBO_BINDING_DRAW_COMMANDS);
+    countBuffer.init((GLsizeiptr)sizeof(GLuint) * 16, SSBO_BINDING_DRAW_COUNTS);
+    visibilityBuffer.init((GLsizeiptr)sizeof(GLuint) * 64, SSBO_BINDING_DRAW_VISIBILITY);
+    lodBuffer.init((GLsizeiptr)sizeof(glm::uvec4) * 64, SSBO_BINDING_MESH_LODS);
+    meshletBuffer.init((GLsizeiptr)sizeof(GpuMeshlet) * 64, SSBO_BINDING_MESHLETS);
+    glGenBuffers(2, readbackBuffers);
+    for (GLuint buffer : readbackBuffers)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+      glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * CULL_STAT_COUNT, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    drawCountPath = GLAD_GL_VERSION_4_6 && glMultiDrawElementsIndirectCount;
+  }
+
+  // Places `mesh` with `transform`. The mesh must stay alive (and keep its pool ranges) while it is
+  // placed. Returns GPU_DRIVEN_NO_INSTANCE for meshes
+  // this path cannot draw; the caller keeps drawing those through the render queue.
+  uint32_t add(const Mesh &mesh, const glm::mat4 &transform)
+  {
+    if (mesh.materialID == MESH_NO_MATERIAL || mesh.layout.streamCount() != 1 || mesh.indexCount == 0)
+      return GPU_DRIVEN_NO_INSTANCE;
+
+    const MeshSlot &slot = meshSlot(mesh);
+    GpuDrawInstance instance;
+    setInstanceTransform(instance, transform);
+    instance.boundsCenter = glm::vec4(mesh.bounds.center(), 0.0f);
+    instance.boundsExtents = glm::vec4(mesh.bounds.extents(), 0.0f);
+    instance.draw = glm::uvec4(mesh.lods[0].indexCount, slot.firstIndex + mesh.lods[0].firstIndex, (GLuint)slot.baseVertex, mesh.materialID);
+    instance.bucket = glm::uvec4(0u, 0u, slot.lodOffset, slot.lodCount);
+    instance.meshlets = glm::uvec4(slot.meshletOffset, slot.meshletCount, 0u, 0u);
+    instances.push_back(instance);
+    instanceGroups.push_back(slot.group);
+    instanceMeshes.push_back(&mesh);
+    bucketsDirty = true;
+    return (uint32_t)(instances.size() - 1);
+  }
+
+  void setTransform(uint32_t instance, const glm::mat4 &transform)
+  {
+    setInstanceTransform(instances[instance], transform);
+    instancesDirty = true;
+  }
+
+  size_t size() const { return instances.size(); }
+
+  // camera terms for the per-instance LOD choice in the cull pass; set every frame
+  void setLodSelection(const LodSelection &selection) { lodSelection = selection; }
+  void setMeshletCulling(const MeshletCullSettings &settings) { meshletCulling = settings; }
+
+  // Frees all GL objects; init() is needed before using the scene again. GL thread.
+  void clear()
+  {
+    for (GeometryGroup &group : groups)
+      if (group.vao)
+        glDeleteVertexArrays(1, &group.vao);
+    groups.clear();
+    meshSlots.clear();
+    lodEntries.clear();
+    lodsDirty = true;
+    meshletEntries.clear();
+    meshletsDirty = true;
+    clearInstances();
+    if (instanceIdBuffer)
+      glDeleteBuffers(1, &instanceIdBuffer);
+    instanceIdBuffer = 0;
+    instanceIdCapacity = 0;
+    for (unsigned int slot = 0; slot < 2; slot++)
+    {
+      if (readbackFences[slot])
+        glDeleteSync(readbackFences[slot]);
+      readbackFences[slot] = nullptr;
+    }
+    glDeleteBuffers(2, readbackBuffers);
+    readbackBuffers[0] = readbackBuffers[1] = 0;
+    for (StorageBuffer *buffer : {&instanceBuffer, &commandBuffer, &countBuffer, &visibilityBuffer, &lodBuffer, &meshletBuffer})
+    {
+      if (buffer->id)
+        glDeleteBuffers(1, &buffer->id);
+      *buffer = StorageBuffer();
+    }
+    cullShader.reset();
+  }
+
+  // drops every instance but keeps the per-mesh LOD and meshlet tables
+  void clearInstances()
+  {
+    instances.clear();
+    instanceGroups.clear();
+    instanceMeshes.clear();
+    buckets.clear();
+    bucketsDirty = true;
+  }
+
+  // Before each draw(): uploads what changed and runs the cull pass. Once a frame with
+  // GPU_CULL_FRUSTUM, or GPU_CULL_PREVIOUS_VISIBLE then, after the pyramid is rebuilt from the
+  // early draws, GPU_CULL_OCCLUSION with `hiZTexture`.
+  void cull(const Frustum &frustum, GpuCullPhase phase = GPU_CULL_FRUSTUM, GLuint hiZTexture = 0)
+  {
+    static constexpr UniformHandle uFrustumPlanes("uFrustumPlanes");
+    static constexpr UniformHandle uInstanceCount("uInstanceCount");
+    static constexpr UniformHandle uCommandCapacity("uCommandCapacity");
+    static constexpr UniformHandle uBucketCount("uBucketCount");
+    static constexpr UniformHandle uPhase("uPhase");
+    static constexpr UniformHandle uLodPixelsPerUnit("uLodPixelsPerUnit");
+    static constexpr UniformHandle uLodMaxPixelError("uLodMaxPixelError");
+    static constexpr UniformHandle uLodForced("uLodForced");
+    static constexpr UniformHandle uMeshletCulling("uMeshletCulling");
+
+    if (phase != GPU_CULL_OCCLUSION)
+    {
+      readBackStats();
+      if (instances.empty())
+        return;
+      if (GeometryPool::instance().revision() != poolRevision)
+        refreshGeometry();
+
+      uint32_t materialRevision = MaterialLibrary::instance().currentRevision();
+      if (bucketsDirty || materialRevision != bucketRevision)
+      {
+        assignBuckets();
+        bucketRevision = materialRevision;
+        instancesDirty = true;
+        visibilityDirty = true;
+      }
+      if (instancesDirty)
+      {
+        instanceBuffer.upload(instances);
+        ensureInstanceIds(instances.size());
+        instancesDirty = false;
+      }
+      if (lodsDirty)
+      {
+        lodBuffer.upload(lodEntries);
+        lodsDirty = false;
+      }
+      if (meshletsDirty)
+      {
+        meshletBuffer.upload(meshletEntries);
+        meshletsDirty = false;
+      }
+
+      GLuint zero = 0;
+      visibilityBuffer.reserve((GLsizeiptr)(instances.size() * sizeof(GLuint)));
+      if (visibilityDirty)
+      {
+        // instance indices changed meaning: start from an empty visible set
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer.id);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        visibilityDirty = false;
+      }
+      commandBuffer.reserve((GLsizeiptr)(2 * commandCapacity * sizeof(DrawElementsIndirectCommand)));
+      countBuffer.reserve((GLsizeiptr)((CULL_STAT_COUNT + 2 * buckets.size()) * sizeof(GLuint)));
+      if (!drawCountPath)
+      {
+        // without a draw count every command in a bucket's range is drawn; unused ones must be empty
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer.id);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+      }
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer.id);
+      glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    else if (instances.empty())
+      return;
+
+    if (phase == GPU_CULL_OCCLUSION)
+    {
+      glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+      glBindTexture(GL_TEXTURE_2D, hiZTexture);
+      glActiveTexture(GL_TEXTURE0);
+    }
+    cullShader->use();
+    glUniform4fv(cullShader->getUniformLocation(uFrustumPlanes), FRUSTUM_PLANE_COUNT, &frustum.planes[0].x);
+    glUniform1ui(cullShader->getUniformLocation(uInstanceCount), (GLuint)instances.size());
+    glUniform1ui(cullShader->getUniformLocation(uCommandCapacity), (GLuint)commandCapacity);
+    glUniform1ui(cullShader->getUniformLocation(uBucketCount), (GLuint)buckets.size());
+    glUniform1i(cullShader->getUniformLocation(uPhase), (GLint)phase);
+    glUniform1f(cullShader->getUniformLocation(uLodPixelsPerUnit), lodSelection.pixelsPerUnit);
+    glUniform1f(cullShader->getUniformLocation(uLodMaxPixelError), lodSelection.maxPixelError);
+    glUniform1i(cullShader->getUniformLocation(uLodForced), lodSelection.enabled ? lodSelection.forcedLod : 0);
+    GLint meshletTests = meshletCulling.enabled ? (meshletCulling.frustum ? 1 : 0) | (meshletCulling.cone ? 2 : 0) : 0;
+    glUniform1i(cullShader->getUniformLocation(uMeshletCulling), meshletTests);
+    cullShader->dispatch((GLuint)((instances.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE));
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (phase != GPU_CULL_PREVIOUS_VISIBLE)
+      queueStatsReadback();
+  }
+
+  // The geometry pass: one multi-draw per bucket over the commands the matching cull() emitted.
+  // `shader` is deferred_indirect.vs + deferred.fs.
+  void draw(const Shader &shader, GLStateCache &state, GpuCullPhase phase = GPU_CULL_FRUSTUM)
+  {
+    if (instances.empty())
+      return;
+    state.invalidate();
+    state.useProgram(shader.ID);
+    MaterialLibrary::instance().bind(shader, state);
+    const GeometryPool &pool = GeometryPool::instance();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id);
+    if (drawCountPath)
+      glBindBuffer(GL_PARAMETER_BUFFER, countBuffer.id);
+    // late draws live in the second half of the command buffer and after the early counts
+    size_t commandSlot = phase == GPU_CULL_OCCLUSION ? 1 : 0;
+    for (size_t b = 0; b < buckets.size(); b++)
+    {
+      const Bucket &bucket = buckets[b];
+      state.bindVertexArray(groups[bucket.group].vao);
+      size_t firstCommand = commandSlot * commandCapacity + bucket.firstCommand;
+      size_t countIndex = CULL_STAT_COUNT + commandSlot * buckets.size() + b;
+      const void *commands = (const void *)(uintptr_t)(firstCommand * sizeof(DrawElementsIndirectCommand));
+      if (drawCountPath)
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, pool.arena(bucket.group).indexType, commands, (GLintptr)(countIndex * sizeof(GLuint)), (GLsizei)bucket.capacity, 0);
+      else
+        glMultiDrawElementsIndirect(GL_TRIANGLES, pool.arena(bucket.group).indexType, commands, (GLsizei)bucket.capacity, 0);
+      state.counters.draws++;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    if (drawCountPath)
+      glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    glBindVertexArray(0);
+    state.invalidate();
+  }
+
+  GpuDrivenStats stats() const
+  {
+    GpuDrivenStats s;
+    s.instances = (unsigned int)instances.size();
+    s.buckets = (unsigned int)buckets.size();
+    s.geometryGroups = (unsigned int)groups.size();
+    s.visible = lastStats[0];
+    s.occluded = lastStats[1];
+    s.drawnEarly = lastStats[2];
+    s.drawnLate = lastStats[3];
+    s.meshlets.meshlets = lastStats[4];
+    s.meshlets.meshletsVisible = lastStats[5];
+    s.meshlets.triangles = lastStats[6];
+    s.meshlets.frustumCulledTriangles = lastStats[7];
+    s.meshlets.coneCulledTriangles = lastStats[8];
+    s.drawCountPath = drawCountPath;
+    const GeometryPool &pool = GeometryPool::instance();
+    for (uint32_t a = 0; a < groups.size(); a++)
+    {
+      const GeometryArena &arena = pool.arena(a);
+      s.geometryBytes += arena.vertexBytes(arena.vertices.used()) + arena.indexBytes(arena.indices.used());
+    }
+    return s;
+  }
+
+private:
+  // must match GROUP_SIZE in gpu_cull.glsl
+  static constexpr size_t CULL_GROUP_SIZE = 64;
+  // statistics ahead of the per-bucket counts, STAT_ defines in gpu_cull.glsl
+  static constexpr size_t CULL_STAT_COUNT = 9;
+
+  // indexed by GeometryPool arena: the arena's buffers plus the instance attribute
+  struct GeometryGroup
+  {
+    GLuint vao = 0;
+    bool vaoDirty = true;
+  };
+
+  struct MeshSlot
+  {
+    uint32_t group;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t lodOffset; // into lodEntries
+    uint32_t lodCount;
+    uint32_t meshletOffset; // into meshletEntries
+    uint32_t meshletCount;
+  };
+
+  struct Bucket
+  {
+    uint32_t group;
+    uint32_t firstCommand;
+    uint32_t capacity; // command slots: one per instance, or per meshlet of clustered ones
+  };
+
+  std::unique_ptr<ComputeShader> cullShader;
+  StorageBuffer instanceBuffer;
+  StorageBuffer commandBuffer;
+  StorageBuffer countBuffer;
+  StorageBuffer visibilityBuffer;
+  StorageBuffer lodBuffer; // lodEntries, mirrored by MeshLods in gpu_cull.glsl
+  StorageBuffer meshletBuffer; // meshletEntries
+  GLuint instanceIdBuffer = 0;
+  size_t instanceIdCapacity = 0;
+  bool drawCountPath = false;
+  uint32_t poolRevision = 0;
+
+  std::vector<GeometryGroup> groups;
+  std::unordered_map<const Mesh *, MeshSlot> meshSlots;
+  // per LOD of every slot: indexCount, firstIndex in the arena, error (float bits), unused
+  std::vector<glm::uvec4> lodEntries;
+  bool lodsDirty = true;
+  std::vector<GpuMeshlet> meshletEntries;
+  bool meshletsDirty = true;
+  LodSelection lodSelection;
+  MeshletCullSettings meshletCulling;
+  std::vector<GpuDrawInstance> instances;
+  std::vector<uint32_t> instanceGroups;
+  std::vector<const Mesh *> instanceMeshes;
+  std::vector<Bucket> buckets;
+  size_t commandCapacity = 0; // per command slot (early / late), sum of the bucket capacities
+  bool bucketsDirty = true;
+  bool instancesDirty = true;
+  bool visibilityDirty = true;
+  uint32_t bucketRevision = 0;
+
+  // double-buffered copy of the cull statistics, read once its fence has passed
+  GLuint readbackBuffers[2] = {0, 0};
+  GLsync readbackFences[2] = {nullptr, nullptr};
+  unsigned int readbackFrame = 0;
+  GLuint lastStats[CULL_STAT_COUNT] = {};
+
+  // the normal matrix is inverted here once rather than per vertex in deferred_indirect.vs
+  static void setInstanceTransform(GpuDrawInstance &instance, const glm::mat4 &transform)
+  {
+    glm::mat3 normal = normalMatrix(transform);
+    instance.model = transform;
+    for (int c = 0; c < 3; c++)
+      instance.normalMatrix[c] = glm::vec4(normal[c], 0.0f);
+  }
+
+  const MeshSlot &meshSlot(const Mesh &mesh)
+  {
+    auto found = meshSlots.find(&mesh);
+    if (found != meshSlots.end())
+      return found->second;
+
+    const GeometryRange &range = mesh.geometryRange();
+    if (groups.size() <= range.arena)
+      groups.resize(range.arena + 1);
+
+    MeshSlot slot;
+    slot.group = range.arena;
+    slot.firstIndex = range.firstIndex;
+    slot.baseVertex = (int32_t)range.baseVertex;
+    slot.lodOffset = (uint32_t)lodEntries.size();
+    slot.lodCount = (uint32_t)mesh.lods.size();
+    for (const MeshLod &lod : mesh.lods)
+    {
+      uint32_t errorBits;
+      std::memcpy(&errorBits, &lod.error, sizeof(errorBits));
+      lodEntries.push_back(glm::uvec4(lod.indexCount, slot.firstIndex + lod.firstIndex, errorBits, 0u));
+    }
+    lodsDirty = true;
+    slot.meshletOffset = (uint32_t)meshletEntries.size();
+    slot.meshletCount = (uint32_t)mesh.meshlets.size();
+    for (const Meshlet &meshlet : mesh.meshlets)
+    {
+      GpuMeshlet entry;
+      entry.sphere = glm::vec4(meshlet.center, meshlet.radius);
+      entry.cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+      entry.range = glm::uvec4(meshlet.indexCount, slot.firstIndex + meshlet.firstIndex, 0u, 0u);
+      meshletEntries.push_back(entry);
+    }
+    meshletsDirty = true;
+    return meshSlots.emplace(&mesh, slot).first->second;
+  }
+
+  // The pool grew or compacted: buffer names and offsets changed. Re-point every VAO and rebuild
+  // the slots and the offsets baked into the instances. Arenas (and so buckets) stay the same.
+  void refreshGeometry()
+  {
+    poolRevision = GeometryPool::instance().revision();
+    meshSlots.clear();
+    lodEntries.clear();
+    meshletEntries.clear();
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+      const Mesh &mesh = *instanceMeshes[i];
+      const MeshSlot &slot = meshSlot(mesh);
+      GpuDrawInstance &instance = instances[i];
+      instance.draw.y = slot.firstIndex + mesh.lods[0].firstIndex;
+      instance.draw.z = (GLuint)slot.baseVertex;
+      instance.bucket.z = slot.lodOffset;
+      instance.meshlets.x = slot.meshletOffset;
+    }
+    lodsDirty = true;
+    meshletsDirty = true;
+    instancesDirty = true;
+    for (GeometryGroup &group : groups)
+      group.vaoDirty = true;
+  }
+
+  // identity instance indices [0, count) for the divisor-1 attribute; every VAO points at it
+  void ensureInstanceIds(size_t count)
+  {
+    if (count > instanceIdCapacity)
+    {
+      size_t capacity = instanceIdCapacity ? instanceIdCapacity : 1024;
+      while (capacity < count)
+        capacity *= 2;
+      std::vector<GLuint> ids(capacity);
+      for (size_t i = 0; i < capacity; i++)
+        ids[i] = (GLuint)i;
+      if (!instanceIdBuffer)
+        glGenBuffers(1, &instanceIdBuffer);
+      glBindBuffer(GL_ARRAY_BUFFER, instanceIdBuffer);
+      glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(capacity * sizeof(GLuint)), ids.data(), GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      instanceIdCapacity = capacity;
+      for (GeometryGroup &group : groups)
+        group.vaoDirty = true;
+    }
+
+    const GeometryPool &pool = GeometryPool::instance();
+    for (uint32_t a = 0; a < groups.size(); a++)
+    {
+      GeometryGroup &group = groups[a];
+      if (!group.vaoDirty)
+        continue;
+      const GeometryArena &arena = pool.arena(a);
+      if (!group.vao)
+        glGenVertexArrays(1, &group.vao);
+      glBindVertexArray(group.vao);
+      glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffers[0]);
+      arena.layout.applyAttributes(0);
+      glBindBuffer(GL_ARRAY_BUFFER, instanceIdBuffer);
+      glEnableVertexAttribArray(GPU_DRIVEN_INSTANCE_LOCATION);
+      glVertexAttribIPointer(GPU_DRIVEN_INSTANCE_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+      glVertexAttribDivisor(GPU_DRIVEN_INSTANCE_LOCATION, 1);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+      glBindVertexArray(0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      group.vaoDirty = false;
+    }
+  }
+
+  // groups instances by (geometry group, material array signature) and lays the buckets out
+  // back to back in the command buffer
+  void assignBuckets()
+  {
+    const MaterialLibrary &library = MaterialLibrary::instance();
+    std::map<std::pair<uint32_t, uint64_t>, uint32_t> bucketOf;
+    buckets.clear();
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+      auto key = std::make_pair(instanceGroups[i], library.arraySignature(instances[i].draw.w));
+      auto found = bucketOf.find(key);
+      uint32_t bucket;
+      if (found == bucketOf.end())
+      {
+        bucket = (uint32_t)buckets.size();
+        bucketOf.emplace(key, bucket);
+        buckets.push_back({instanceGroups[i], 0, 0});
+      }
+      else
+        bucket = found->second;
+      instances[i].bucket.x = bucket;
+      buckets[bucket].capacity += std::max(1u, instances[i].meshlets.y);
+    }
+
+    uint32_t firstCommand = 0;
+    for (Bucket &bucket : buckets)
+    {
+      bucket.firstCommand = firstCommand;
+      firstCommand += bucket.capacity;
+    }
+    commandCapacity = firstCommand;
+    for (GpuDrawInstance &instance : instances)
+      instance.bucket.y = buckets[instance.bucket.x].firstCommand;
+  }
+
+  void queueStatsReadback()
+  {
+    unsigned int slot = readbackFrame % 2;
+    if (readbackFences[slot])
+      return; // previous copy into this slot not consumed yet
+    glBindBuffer(GL_COPY_READ_BUFFER, countBuffer.id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffers[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)(CULL_STAT_COUNT * sizeof(GLuint)));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readbackFrame++;
+  }
+
+  // non-blocking: only reads a copy whose fence has already signalled
+  void readBackStats()
+  {
+    for (unsigned int slot = 0; slot < 2; slot++)
+    {
+      if (!readbackFences[slot])
+        continue;
+      if (glClientWaitSync(readbackFences[slot], 0, 0) == GL_TIMEOUT_EXPIRED)
+        continue;
+      glDeleteSync(readbackFences[slot]);
+      readbackFences[slot] = nullptr;
+
+      glBindBuffer(GL_COPY_READ_BUFFER, readbackBuffers[slot]);
+      glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)sizeof(lastStats), lastStats);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+  }
+};
+
+#endif // GPU_DRIVEN_H
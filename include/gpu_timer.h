@@ -0,0 +1,50 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// GL_TIME_ELAPSED query pair, read back one frame late so the CPU never waits on the GPU.
+// Wrap a pass in begin()/end(); milliseconds() returns the last completed measurement.
+class GpuTimer
+{
+public:
+  void init()
+  {
+    glGenQueries(2, queries);
+  }
+
+  void begin()
+  {
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+  }
+
+  void end()
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    current ^= 1;
+    issued++;
+
+    // the query issued last frame is now in queries[current]
+    if (issued > 1)
+    {
+      GLint available = 0;
+      glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available)
+      {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &ns);
+        lastMs = (float)((double)ns / 1.0e6);
+      }
+    }
+  }
+
+  float milliseconds() const { return lastMs; }
+
+private:
+  GLuint queries[2] = {0, 0};
+  int current = 0;
+  unsigned int issued = 0;
+  float lastMs = 0.0f;
+};
+
+#endif // GPU_TIMER_H
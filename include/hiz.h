@@ -0,0 +1,122 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <glad/glad.h>
+
+#include "shader.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Hierarchical-Z depth pyramid, rebuilt from the G-buffer depth by hiz_build.glsl.
+//
+// Level 0 is a copy of the depth buffer; every further level holds the farthest (max) depth of
+// the texels it covers, so a box whose nearest depth lies behind a level's value over its whole
+// screen footprint is hidden by what has already been drawn. Levels follow GL's floor-halving
+// sizes and the last texel of an odd-sized level also takes the leftover row/column, so no depth
+// is skipped and the test stays conservative.
+
+// after the material array units 0-11; must match the sampler bindings in hiz_build.glsl and gpu_cull.glsl
+#define HIZ_TEXTURE_UNIT 12
+
+class HiZPyramid
+{
+public:
+  GLuint texture = 0; // GL_R32F, full mip chain
+  int width = 0;
+  int height = 0;
+  int levels = 0;
+  std::vector<GLuint> levelViews; // one single-level view per mip (red swizzled to grey), for the debug viewer
+
+  void init(const std::string &shaderDir, int w, int h)
+  {
+    buildShader = std::make_unique<ComputeShader>((shaderDir + "/hiz_build.glsl").c_str(), "hizBuildShader");
+    resize(w, h);
+  }
+
+  // reallocates the pyramid; the depth texture passed to build() must have this size
+  void resize(int w, int h)
+  {
+    releaseTextures();
+    width = std::max(w, 1);
+    height = std::max(h, 1);
+    levels = 1;
+    while ((std::max(width, height) >> levels) > 0)
+      levels++;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    levelViews.resize(levels);
+    glGenTextures(levels, levelViews.data());
+    for (int level = 0; level < levels; level++)
+    {
+      glTextureView(levelViews[level], GL_TEXTURE_2D, texture, GL_R32F, level, 1, 0, 1);
+      glBindTexture(GL_TEXTURE_2D, levelViews[level]);
+      GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  // Copies `depthTexture` into level 0 and reduces it down the chain, one dispatch per level.
+  // Depth written by earlier draws is visible without a barrier; the levels themselves are
+  // written through image stores and need one before the next level (or the culling pass) reads them.
+  void build(GLuint depthTexture)
+  {
+    static constexpr UniformHandle uSourceLevel("uSourceLevel");
+    static constexpr UniformHandle uDownsample("uDownsample");
+
+    buildShader->use();
+    glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+    for (int level = 0; level < levels; level++)
+    {
+      int levelWidth = std::max(width >> level, 1);
+      int levelHeight = std::max(height >> level, 1);
+      glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : texture);
+      glUniform1i(buildShader->getUniformLocation(uSourceLevel), level == 0 ? 0 : level - 1);
+      glUniform1i(buildShader->getUniformLocation(uDownsample), level == 0 ? 0 : 1);
+      glBindImageTexture(0, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+      buildShader->dispatch((GLuint)((levelWidth + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE),
+                            (GLuint)((levelHeight + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE));
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+  }
+
+  // GL thread; init() is needed before using the pyramid again
+  void clear()
+  {
+    releaseTextures();
+    buildShader.reset();
+  }
+
+private:
+  // must match the local size in hiz_build.glsl
+  static constexpr int BUILD_GROUP_SIZE = 8;
+
+  std::unique_ptr<ComputeShader> buildShader;
+
+  void releaseTextures()
+  {
+    if (!levelViews.empty())
+      glDeleteTextures((GLsizei)levelViews.size(), levelViews.data());
+    levelViews.clear();
+    if (texture)
+      glDeleteTextures(1, &texture);
+    texture = 0;
+  }
+};
+
+#endif // HIZ_H
@@ -0,0 +1,366 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "buffers.h"
+#include "gl_state_cache.h"
+#include "shader.h"
+#include "texture.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Materials as data instead of per-mesh sampler bindings.
+//
+// Every texture a material uses is copied (glCopyImageSubData, all mips) into a GL_TEXTURE_2D_ARRAY
+// layer; arrays are grouped by size, internal format and mip count. Each material becomes one
+// GpuMaterial in an SSBO holding packed (array << 16 | layer) indices and scalar factors. A draw then
+// needs only the material ID: the array set and the SSBO are bound once per program.
+//
+// Shader side: see deferred.fs (uMaterialArrays[], Materials block) and uMaterialID in deferred.vs.
+
+#define MAX_MATERIAL_ARRAYS 12       // sampler2DArray uMaterialArrays[MAX_MATERIAL_ARRAYS]
+#define MATERIAL_ARRAY_UNIT_BASE 0   // arrays use texture units [base, base + MAX_MATERIAL_ARRAYS)
+#define MATERIAL_ARRAY_INITIAL_LAYERS 4
+#define MATERIAL_NO_TEXTURE -1
+
+enum MaterialStorageBinding
+{
+  SSBO_BINDING_MATERIALS = 5,
+};
+
+enum MaterialSlot
+{
+  MATERIAL_SLOT_ALBEDO,
+  MATERIAL_SLOT_SPECULAR,
+  MATERIAL_SLOT_METALLIC,
+  MATERIAL_SLOT_ROUGHNESS,
+  MATERIAL_SLOT_AO,
+  MATERIAL_SLOT_EMISSIVE,
+  MATERIAL_SLOT_NORMAL,
+  MATERIAL_SLOT_COUNT
+};
+
+// maps the importer's "texture_*" type names onto slots; -1 for types materials do not use
+inline int materialSlotForType(const std::string &type)
+{
+  if (type == "texture_diffuse")
+    return MATERIAL_SLOT_ALBEDO;
+  if (type == "texture_specular")
+    return MATERIAL_SLOT_SPECULAR;
+  if (type == "texture_metallic")
+    return MATERIAL_SLOT_METALLIC;
+  if (type == "texture_roughness")
+    return MATERIAL_SLOT_ROUGHNESS;
+  if (type == "texture_ao")
+    return MATERIAL_SLOT_AO;
+  if (type == "texture_emissive")
+    return MATERIAL_SLOT_EMISSIVE;
+  if (type == "texture_normal")
+    return MATERIAL_SLOT_NORMAL;
+  return -1;
+}
+
+// CPU description. Each factor multiplies its map; a missing map reads as 1, so the factor alone
+// is the value. fromTextures() picks PBR defaults for the slots a mesh has no map for.
+struct Material
+{
+  glm::vec4 baseColor = glm::vec4(1.0f);
+  float metallic = 1.0f;
+  float roughness = 1.0f;
+  float ao = 1.0f;
+  float emissive = 1.0f;
+  float specular = 1.0f;
+  unsigned int textures[MATERIAL_SLOT_COUNT] = {}; // TextureCache names, 0 = no map
+
+  static Material fromTextures(const std::vector<Texture> &meshTextures, const std::string &skipPath)
+  {
+    Material material;
+    for (const Texture &texture : meshTextures)
+    {
+      int slot = materialSlotForType(texture.type);
+      if (slot >= 0 && texture.path != skipPath && !material.textures[slot])
+        material.textures[slot] = texture.id;
+    }
+    if (!material.textures[MATERIAL_SLOT_METALLIC])
+      material.metallic = 0.0f;
+    if (!material.textures[MATERIAL_SLOT_ROUGHNESS])
+      material.roughness = 0.8f;
+    if (!material.textures[MATERIAL_SLOT_SPECULAR])
+      material.specular = 0.5f;
+    if (!material.textures[MATERIAL_SLOT_EMISSIVE])
+      material.emissive = 0.0f;
+    return material;
+  }
+};
+
+// std430, mirrored by the Materials block in deferred.fs
+struct GpuMaterial
+{
+  glm::ivec4 layers[2]; // per MaterialSlot: array << 16 | layer, or MATERIAL_NO_TEXTURE
+  glm::vec4 baseColor;
+  glm::vec4 factors; // metallic, roughness, ao, emissive
+  glm::vec4 extra;   // specular, has emissive map, unused, unused
+};
+
+struct MaterialStats
+{
+  unsigned int materials = 0;
+  unsigned int arrays = 0;
+  unsigned int layers = 0;
+  unsigned int pendingTextures = 0; // still streaming, slot reads as "no map" until copied
+  size_t arrayBytes = 0;            // allocated, including unused capacity
+};
+
+class MaterialLibrary
+{
+public:
+  static MaterialLibrary &instance()
+  {
+    static MaterialLibrary library;
+    return library;
+  }
+
+  MaterialLibrary(const MaterialLibrary &) = delete;
+  MaterialLibrary &operator=(const MaterialLibrary &) = delete;
+
+  // GL thread. Returns the ID of an identical material if there is one.
+  uint32_t add(const Material &material)
+  {
+    uint64_t hash = hashMaterial(material);
+    auto range = byHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+      if (std::memcmp(&materials[it->second], &material, sizeof(Material)) == 0)
+        return it->second;
+
+    uint32_t id = (uint32_t)materials.size();
+    materials.push_back(material);
+    byHash.emplace(hash, id);
+
+    for (unsigned int textureID : material.textures)
+    {
+      if (!textureID || layerOfTexture.count(textureID))
+        continue;
+      // keep the source alive until its pixels are in an array
+      TextureCache::instance().retain(textureID);
+      layerOfTexture[textureID] = MATERIAL_NO_TEXTURE;
+      pending.push_back(textureID);
+    }
+    dirty = true;
+    return id;
+  }
+
+  // GL thread, once per frame: moves finished textures into arrays and re-uploads the material buffer
+  void update()
+  {
+    if (!storage.id)
+      storage.init((GLsizeiptr)sizeof(GpuMaterial) * 16, SSBO_BINDING_MATERIALS);
+
+    for (size_t i = 0; i < pending.size();)
+    {
+      TextureInfo info;
+      if (!TextureCache::instance().textureInfo(pending[i], info))
+      {
+        i++;
+        continue;
+      }
+      layerOfTexture[pending[i]] = placeInArray(pending[i], info);
+      TextureCache::instance().release(pending[i]);
+      pending[i] = pending.back();
+      pending.pop_back();
+      dirty = true;
+    }
+
+    if (!dirty)
+      return;
+    std::vector<GpuMaterial> gpu(materials.size());
+    for (size_t m = 0; m < materials.size(); m++)
+    {
+      const Material &material = materials[m];
+      GpuMaterial &g = gpu[m];
+      for (int slot = 0; slot < 8; slot++)
+        g.layers[slot / 4][slot % 4] = slot < MATERIAL_SLOT_COUNT && material.textures[slot] ? layerOfTexture[material.textures[slot]] : MATERIAL_NO_TEXTURE;
+      g.baseColor = material.baseColor;
+      g.factors = glm::vec4(material.metallic, material.roughness, material.ao, material.emissive);
+      g.extra = glm::vec4(material.specular, material.textures[MATERIAL_SLOT_EMISSIVE] ? 1.0f : 0.0f, 0.0f, 0.0f);
+    }
+    storage.upload(gpu);
+    dirty = false;
+    revision++;
+  }
+
+  // bumped whenever material data or texture placement changes
+  uint32_t currentRevision() const { return revision; }
+
+  // Which texture array each slot of a material samples from. Draws with equal signatures index
+  // uMaterialArrays identically, so they can share one multi-draw (see gpu_driven.h).
+  uint64_t arraySignature(uint32_t id) const
+  {
+    uint64_t signature = 14695981039346656037ull;
+    const Material &material = materials[id];
+    for (int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++)
+    {
+      int32_t packed = MATERIAL_NO_TEXTURE;
+      if (material.textures[slot])
+      {
+        auto found = layerOfTexture.find(material.textures[slot]);
+        if (found != layerOfTexture.end())
+          packed = found->second;
+      }
+      int32_t array = packed < 0 ? -1 : packed >> 16;
+      signature = (signature ^ (uint64_t)(uint32_t)array) * 1099511628211ull;
+    }
+    return signature;
+  }
+
+  // Binds every array and points the shader's sampler array at them. Once per program per pass.
+  void bind(const Shader &shader, GLStateCache &state) const
+  {
+    static const std::vector<UniformHandle> uArrays = []
+    {
+      std::vector<UniformHandle> handles;
+      for (int i = 0; i < MAX_MATERIAL_ARRAYS; i++)
+        handles.emplace_back("uMaterialArrays[" + std::to_string(i) + "]");
+      return handles;
+    }();
+
+    for (unsigned int i = 0; i < MAX_MATERIAL_ARRAYS; i++)
+    {
+      shader.setInt(uArrays[i], (int)(MATERIAL_ARRAY_UNIT_BASE + i));
+      state.bindTexture2DArray(MATERIAL_ARRAY_UNIT_BASE + i, i < arrays.size() ? arrays[i].id : 0);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_MATERIALS, storage.id);
+    state.counters.uniformUploads++;
+  }
+
+  MaterialStats stats() const
+  {
+    MaterialStats s;
+    s.materials = (unsigned int)materials.size();
+    s.arrays = (unsigned int)arrays.size();
+    s.pendingTextures = (unsigned int)pending.size();
+    for (const TextureArray &array : arrays)
+    {
+      s.layers += array.layers;
+      s.arrayBytes += array.layerBytes * array.capacity;
+    }
+    return s;
+  }
+
+  // GL thread, before the context goes away
+  void clear()
+  {
+    for (TextureArray &array : arrays)
+      glDeleteTextures(1, &array.id);
+    arrays.clear();
+    materials.clear();
+    byHash.clear();
+    layerOfTexture.clear();
+    pending.clear();
+    if (storage.id)
+      glDeleteBuffers(1, &storage.id);
+    storage = StorageBuffer();
+  }
+
+private:
+  struct TextureArray
+  {
+    GLuint id = 0;
+    unsigned int width, height;
+    GLenum internalFormat;
+    unsigned int levels;
+    unsigned int layers = 0;
+    unsigned int capacity = 0;
+    size_t layerBytes = 0;
+  };
+
+  std::vector<Material> materials;
+  std::unordered_multimap<uint64_t, uint32_t> byHash;
+  std::unordered_map<unsigned int, int32_t> layerOfTexture; // cache texture -> packed layer
+  std::vector<unsigned int> pending;
+  std::vector<TextureArray> arrays;
+  StorageBuffer storage;
+  bool dirty = false;
+  uint32_t revision = 0;
+
+  MaterialLibrary() = default;
+
+  static uint64_t hashMaterial(const Material &material)
+  {
+    const unsigned char *bytes = (const unsigned char *)&material;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(Material); i++)
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+  }
+
+  // copies all mips of `textureID` into a free layer of a matching array; returns the packed index
+  int32_t placeInArray(unsigned int textureID, const TextureInfo &info)
+  {
+    size_t index = 0;
+    while (index < arrays.size() && !(arrays[index].width == info.width && arrays[index].height == info.height &&
+                                      arrays[index].internalFormat == info.internalFormat && arrays[index].levels == info.levels))
+      index++;
+    if (index == arrays.size())
+    {
+      if (arrays.size() == MAX_MATERIAL_ARRAYS)
+      {
+        std::cout << "WARNING::MATERIAL:: out of texture arrays, texture " << textureID << " left unbound" << std::endl;
+        return MATERIAL_NO_TEXTURE;
+      }
+      TextureArray array;
+      array.width = info.width;
+      array.height = info.height;
+      array.internalFormat = info.internalFormat;
+      array.levels = info.levels;
+      array.layerBytes = info.gpuBytes;
+      arrays.push_back(array);
+      resize(arrays.back(), MATERIAL_ARRAY_INITIAL_LAYERS);
+    }
+
+    TextureArray &array = arrays[index];
+    if (array.layers == array.capacity)
+      resize(array, array.capacity * 2);
+    unsigned int layer = array.layers++;
+    for (unsigned int level = 0; level < array.levels; level++)
+      glCopyImageSubData(textureID, GL_TEXTURE_2D, (GLint)level, 0, 0, 0,
+                         array.id, GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, (GLint)layer,
+                         std::max(1u, array.width >> level), std::max(1u, array.height >> level), 1);
+    return (int32_t)(index << 16 | layer);
+  }
+
+  // (re)allocates immutable storage with room for `capacity` layers, keeping the layers already there
+  static void resize(TextureArray &array, unsigned int capacity)
+  {
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, (GLsizei)array.levels, array.internalFormat, (GLsizei)array.width, (GLsizei)array.height, (GLsizei)capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (array.id)
+    {
+      for (unsigned int level = 0; level < array.levels && array.layers > 0; level++)
+        glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, 0,
+                           id, GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, 0,
+                           std::max(1u, array.width >> level), std::max(1u, array.height >> level), (GLsizei)array.layers);
+      glDeleteTextures(1, &array.id);
+    }
+    array.id = id;
+    array.capacity = capacity;
+  }
+};
+
+#endif // MATERIAL_H
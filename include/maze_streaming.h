@@ -0,0 +1,517 @@
+#ifndef MAZE_STREAMING_H
+#define MAZE_STREAMING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frustum_culling.h"
+#include "geometry_pool.h"
+#include "gl_state_cache.h"
+#include "material.h"
+#include "primitives.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// An endless backrooms maze, streamed in chunks around the camera.
+//
+// A chunk is a 128x128 grid of unit cells, the range of the packed 2-byte wall format that
+// backrooms_wall.vs decodes (2-bit rotation, 7-bit x, 7-bit z). Chunks are generated from
+// (seed, chunk coordinate) alone on worker threads, so the same chunk always comes back the same
+// when the camera returns. Finished wall lists are copied into a ring of fixed-size slots in one
+// instance buffer, a few per frame, and chunks farther than one chunk beyond `radius` are evicted.
+// Freed slots go to the back of the ring, so a slot is rewritten as late as possible after the GPU
+// last read it. Each resident chunk in the frustum is one instanced draw of the MazeWalls segment;
+// baseInstance selects the chunk's slot, so the VAO never changes between chunks.
+
+#define MAZE_CHUNK_CELLS 128 // wall grid per chunk: the 7-bit x/z of the packed format
+#define MAZE_ROOM_CELLS 4    // maze rooms are 4x4 cells
+#define MAZE_CHUNK_ROOMS (MAZE_CHUNK_CELLS / MAZE_ROOM_CELLS)
+// a room owns its west and south edges, so this is every edge closed
+#define MAZE_CHUNK_MAX_WALLS (2 * MAZE_CHUNK_ROOMS * MAZE_CHUNK_ROOMS * MAZE_ROOM_CELLS)
+#define MAZE_WALL_LOCATION 8 // aWallData in backrooms_wall.vs
+#define MAZE_STREAMER_WORKERS 2
+
+// rotation counts quarter turns about +Y: 0 runs the segment along +x, 1 along +z
+inline uint16_t packMazeWall(unsigned int x, unsigned int z, unsigned int rotation)
+{
+  return (uint16_t)((rotation & 0x03u) << 14 | (x & 0x7Fu) << 7 | (z & 0x7Fu));
+}
+
+struct MazeChunkCoord
+{
+  int x = 0;
+  int z = 0;
+
+  bool operator<(const MazeChunkCoord &other) const { return x != other.x ? x < other.x : z < other.z; }
+  bool operator==(const MazeChunkCoord &other) const { return x == other.x && z == other.z; }
+};
+
+// splitmix64 finalizer
+inline uint64_t mazeMix(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Rooms joined by a randomized depth-first spanning tree, then `openness` of the remaining inner
+// walls knocked out so the maze loops like open office space. A chunk closes only its own west
+// (x = 0) and south (z = 0) borders, each with at least one doorway; the east and north borders
+// belong to the neighbours. Every chunk is connected inside and to the ones around it.
+inline std::vector<uint16_t> generateMazeChunk(uint64_t seed, MazeChunkCoord chunk, float openness)
+{
+  const int n = MAZE_CHUNK_ROOMS;
+  // per room r = z * n + x: is its west / south edge closed
+  std::vector<uint8_t> west(n * n, 1), south(n * n, 1), visited(n * n, 0);
+  uint64_t state = mazeMix(mazeMix(mazeMix(seed) ^ (uint32_t)chunk.x) ^ (uint32_t)chunk.z);
+  auto next = [&state](uint32_t range)
+  {
+    state = mazeMix(state);
+    return (uint32_t)(state % range);
+  };
+
+  std::vector<int> stack;
+  stack.reserve(n * n);
+  stack.push_back((int)next(n * n));
+  visited[stack.back()] = 1;
+  while (!stack.empty())
+  {
+    int r = stack.back();
+    int x = r % n, z = r / n;
+    int options[4];
+    int count = 0;
+    if (x > 0 && !visited[r - 1])
+      options[count++] = r - 1;
+    if (x < n - 1 && !visited[r + 1])
+      options[count++] = r + 1;
+    if (z > 0 && !visited[r - n])
+      options[count++] = r - n;
+    if (z < n - 1 && !visited[r + n])
+      options[count++] = r + n;
+    if (count == 0)
+    {
+      stack.pop_back();
+      continue;
+    }
+    int to = options[next((uint32_t)count)];
+    if (to == r - 1)
+      west[r] = 0;
+    else if (to == r + 1)
+      west[to] = 0;
+    else if (to == r - n)
+      south[r] = 0;
+    else
+      south[to] = 0;
+    visited[to] = 1;
+    stack.push_back(to);
+  }
+
+  uint32_t braid = (uint32_t)(std::clamp(openness, 0.0f, 1.0f) * 1024.0f);
+  for (int r = 0; r < n * n; r++)
+  {
+    if (r % n > 0 && west[r] && next(1024) < braid)
+      west[r] = 0;
+    if (r / n > 0 && south[r] && next(1024) < braid)
+      south[r] = 0;
+  }
+
+  // border doorways: about one in four rooms, and always at least one
+  uint32_t westDoor = next(n), southDoor = next(n);
+  for (int i = 0; i < n; i++)
+  {
+    west[i * n] = (uint32_t)i != westDoor && next(4) != 0;
+    south[i] = (uint32_t)i != southDoor && next(4) != 0;
+  }
+
+  std::vector<uint16_t> walls;
+  for (int r = 0; r < n * n; r++)
+  {
+    unsigned int x0 = (unsigned int)(r % n) * MAZE_ROOM_CELLS, z0 = (unsigned int)(r / n) * MAZE_ROOM_CELLS;
+    for (unsigned int k = 0; west[r] && k < MAZE_ROOM_CELLS; k++)
+      walls.push_back(packMazeWall(x0, z0 + k, 1));
+    for (unsigned int k = 0; south[r] && k < MAZE_ROOM_CELLS; k++)
+      walls.push_back(packMazeWall(x0 + k, z0, 0));
+  }
+  return walls;
+}
+
+struct MazeStreamingStats
+{
+  unsigned int residentChunks = 0;
+  unsigned int pendingChunks = 0;   // queued, generating or waiting for upload
+  unsigned int generatedChunks = 0; // total
+  unsigned int evictedChunks = 0;   // total
+  unsigned int uploadedChunks = 0;  // by the last update()
+  unsigned int visibleChunks = 0;   // drawn by the last draw()
+  unsigned int drawnWalls = 0;
+  double lastGenerateMs = 0.0;      // worker time of the newest chunk
+  double averageGenerateMs = 0.0;
+  size_t residentBytes = 0; // packed walls of the resident chunks
+  size_t ringBytes = 0;     // the whole instance buffer
+};
+
+class MazeStreamer
+{
+public:
+  uint64_t seed = 0x6261636B726F6F6Dull;
+  int radius = 2;         // chunks kept around the camera's chunk (Chebyshev distance)
+  float openness = 0.3f;  // share of extra inner walls removed after the spanning tree
+  unsigned int uploadsPerFrame = 2;
+
+  MazeStreamer() = default;
+  MazeStreamer(const MazeStreamer &) = delete;
+  MazeStreamer &operator=(const MazeStreamer &) = delete;
+  ~MazeStreamer() { stopWorkers(); }
+
+  // GL thread, once. `height` is the wall height in world units.
+  void init(float height)
+  {
+    wallHeight = height;
+    wallMesh = std::make_unique<MazeWalls>(height);
+    Material material;
+    material.baseColor = glm::vec4(0.80f, 0.74f, 0.47f, 1.0f); // stale office yellow
+    material.metallic = 0.0f;
+    material.roughness = 0.9f;
+    material.specular = 0.2f;
+    material.emissive = 0.0f;
+    materialID = MaterialLibrary::instance().add(material);
+    startWorkers();
+  }
+
+  // GL thread, once per frame: evicts far chunks, uploads finished ones and requests missing ones
+  void update(const glm::vec3 &cameraPosition)
+  {
+    frameStats.uploadedChunks = 0;
+    if (!wallMesh)
+      return;
+    MazeChunkCoord center{(int)std::floor(cameraPosition.x / MAZE_CHUNK_CELLS), (int)std::floor(cameraPosition.z / MAZE_CHUNK_CELLS)};
+    ensureRing();
+    int keep = radius + 1; // one chunk of slack so walking along a border does not thrash
+
+    for (auto it = resident.begin(); it != resident.end();)
+    {
+      if (distance(it->first, center) > keep)
+      {
+        freeSlots.push_back(it->second.slot);
+        it = resident.erase(it);
+        frameStats.evictedChunks++;
+      }
+      else
+        ++it;
+    }
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job &job)
+                                {
+                                  if (distance(job.chunk, center) <= keep)
+                                    return false;
+                                  requested.erase(job.chunk);
+                                  return true; }),
+                 jobs.end());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(resultMutex);
+      for (GeneratedChunk &chunk : finished)
+      {
+        if (chunk.epoch != epoch)
+          continue;
+        generateMsTotal += chunk.milliseconds;
+        frameStats.generatedChunks++;
+        frameStats.lastGenerateMs = chunk.milliseconds;
+        ready.push_back(std::move(chunk));
+      }
+      finished.clear();
+    }
+    if (frameStats.generatedChunks)
+      frameStats.averageGenerateMs = generateMsTotal / frameStats.generatedChunks;
+
+    // nearest first, within the per-frame budget
+    std::sort(ready.begin(), ready.end(), [&](const GeneratedChunk &a, const GeneratedChunk &b)
+              { return distance(a.chunk, center) < distance(b.chunk, center); });
+    size_t consumed = 0;
+    for (; consumed < ready.size(); consumed++)
+    {
+      GeneratedChunk &chunk = ready[consumed];
+      // out of range by now, or a second copy of a chunk that was dropped and re-requested mid-generation
+      if (distance(chunk.chunk, center) > keep || resident.count(chunk.chunk))
+      {
+        if (!resident.count(chunk.chunk))
+          requested.erase(chunk.chunk);
+        continue;
+      }
+      if (frameStats.uploadedChunks >= uploadsPerFrame || freeSlots.empty())
+        break;
+      ResidentChunk entry;
+      entry.slot = freeSlots.front();
+      freeSlots.pop_front();
+      entry.wallCount = (GLsizei)chunk.walls.size();
+      glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+      glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)entry.slot * MAZE_CHUNK_MAX_WALLS * sizeof(uint16_t),
+                      (GLsizeiptr)(chunk.walls.size() * sizeof(uint16_t)), chunk.walls.data());
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      resident[chunk.chunk] = entry;
+      requested.erase(chunk.chunk);
+      frameStats.uploadedChunks++;
+    }
+    ready.erase(ready.begin(), ready.begin() + consumed);
+
+    // request the missing chunks, nearest ring first
+    std::vector<Job> wanted;
+    for (int dz = -radius; dz <= radius; dz++)
+      for (int dx = -radius; dx <= radius; dx++)
+      {
+        MazeChunkCoord chunk{center.x + dx, center.z + dz};
+        if (!resident.count(chunk) && !requested.count(chunk))
+          wanted.push_back({chunk, seed, openness, epoch});
+      }
+    std::sort(wanted.begin(), wanted.end(), [&](const Job &a, const Job &b)
+              { return distance(a.chunk, center) < distance(b.chunk, center); });
+    if (!wanted.empty())
+    {
+      {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        for (const Job &job : wanted)
+        {
+          jobs.push_back(job);
+          requested.insert(job.chunk);
+        }
+      }
+      jobReady.notify_all();
+    }
+
+    frameStats.residentChunks = (unsigned int)resident.size();
+    frameStats.pendingChunks = (unsigned int)requested.size();
+    frameStats.residentBytes = 0;
+    for (const auto &entry : resident)
+      frameStats.residentBytes += (size_t)entry.second.wallCount * sizeof(uint16_t);
+    frameStats.ringBytes = (size_t)slotCount * MAZE_CHUNK_MAX_WALLS * sizeof(uint16_t);
+  }
+
+  // GL thread. One instanced draw per resident chunk that intersects `frustum` (all without one).
+  // `shader` is backrooms_wall.vs with deferred.fs; the wall material comes from the library.
+  void draw(const Shader &shader, GLStateCache &state, const Frustum *frustum)
+  {
+    static constexpr UniformHandle uChunkOrigin("uChunkOrigin");
+    static constexpr UniformHandle uMaterialID("uMaterialID");
+
+    frameStats.visibleChunks = 0;
+    frameStats.drawnWalls = 0;
+    if (resident.empty())
+      return;
+    refreshVertexArray();
+
+    state.invalidate();
+    state.useProgram(shader.ID);
+    MaterialLibrary::instance().bind(shader, state);
+    shader.setInt(uMaterialID, (int)materialID);
+    state.bindVertexArray(vao);
+    const MeshLod &range = wallMesh->lods[0];
+    for (const auto &entry : resident)
+    {
+      glm::vec2 origin = glm::vec2(entry.first.x, entry.first.z) * (float)MAZE_CHUNK_CELLS;
+      AABB box{glm::vec3(origin.x, 0.0f, origin.y), glm::vec3(origin.x + MAZE_CHUNK_CELLS, wallHeight, origin.y + MAZE_CHUNK_CELLS)};
+      if (frustum && !frustum->intersects(box))
+        continue;
+      shader.setVec2(uChunkOrigin, origin);
+      glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.indexCount, wallMesh->indexType, wallMesh->indexOffset(range.firstIndex),
+                                                    entry.second.wallCount, wallMesh->baseVertex(),
+                                                    entry.second.slot * MAZE_CHUNK_MAX_WALLS);
+      state.counters.draws++;
+      state.counters.triangles += (unsigned int)entry.second.wallCount * (range.indexCount / 3);
+      frameStats.visibleChunks++;
+      frameStats.drawnWalls += (unsigned int)entry.second.wallCount;
+    }
+    glBindVertexArray(0);
+    state.invalidate();
+  }
+
+  // GL thread. Drops every chunk; the next update() regenerates them from `seed` and `openness`.
+  void regenerate()
+  {
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      jobs.clear();
+    }
+    epoch++;
+    for (const auto &entry : resident)
+      freeSlots.push_back(entry.second.slot);
+    resident.clear();
+    requested.clear();
+    ready.clear();
+  }
+
+  const MazeStreamingStats &stats() const { return frameStats; }
+
+  // GL thread, before the context goes away
+  void shutdown()
+  {
+    stopWorkers();
+    if (vao)
+      glDeleteVertexArrays(1, &vao);
+    if (instanceBuffer)
+      glDeleteBuffers(1, &instanceBuffer);
+    vao = instanceBuffer = 0;
+    if (wallMesh)
+      wallMesh->release();
+    wallMesh.reset();
+    resident.clear();
+  }
+
+private:
+  struct Job
+  {
+    MazeChunkCoord chunk;
+    uint64_t seed;
+    float openness;
+    uint32_t epoch;
+  };
+
+  struct GeneratedChunk
+  {
+    MazeChunkCoord chunk;
+    uint32_t epoch = 0;
+    std::vector<uint16_t> walls;
+    double milliseconds = 0.0;
+  };
+
+  struct ResidentChunk
+  {
+    GLuint slot = 0;
+    GLsizei wallCount = 0;
+  };
+
+  float wallHeight = 3.0f;
+  std::unique_ptr<MazeWalls> wallMesh;
+  uint32_t materialID = MESH_NO_MATERIAL;
+
+  // GL thread only
+  GLuint instanceBuffer = 0;
+  GLuint vao = 0;
+  uint32_t vaoRevision = 0;
+  bool vaoDirty = true;
+  uint32_t slotCount = 0;
+  std::deque<GLuint> freeSlots; // the ring: taken from the front, returned to the back
+  std::map<MazeChunkCoord, ResidentChunk> resident;
+  std::set<MazeChunkCoord> requested; // queued, generating or in `ready`
+  std::vector<GeneratedChunk> ready;
+  double generateMsTotal = 0.0;
+  uint32_t epoch = 0; // bumped by regenerate(); results from older epochs are dropped
+  MazeStreamingStats frameStats;
+
+  std::vector<std::thread> workers;
+  std::mutex jobMutex;
+  std::condition_variable jobReady;
+  std::deque<Job> jobs;
+  bool stopping = false;
+  std::mutex resultMutex;
+  std::vector<GeneratedChunk> finished;
+
+  static int distance(MazeChunkCoord a, MazeChunkCoord b) { return std::max(std::abs(a.x - b.x), std::abs(a.z - b.z)); }
+
+  // one slot per chunk that can be resident at once; a radius change reallocates and starts over
+  void ensureRing()
+  {
+    uint32_t side = (uint32_t)(2 * (radius + 1) + 1);
+    if (side * side == slotCount)
+      return;
+    regenerate();
+    slotCount = side * side;
+    if (!instanceBuffer)
+      glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)slotCount * MAZE_CHUNK_MAX_WALLS * sizeof(uint16_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    freeSlots.clear();
+    for (GLuint slot = 0; slot < slotCount; slot++)
+      freeSlots.push_back(slot);
+    vaoDirty = true;
+  }
+
+  // the wall segment's arena buffers plus the packed walls at MAZE_WALL_LOCATION; rebuilt when the
+  // pool moves geometry around
+  void refreshVertexArray()
+  {
+    const GeometryPool &pool = GeometryPool::instance();
+    if (!vaoDirty && vaoRevision == pool.revision())
+      return;
+    const GeometryArena &arena = pool.arena(wallMesh->geometryRange().arena);
+    if (!vao)
+      glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffers[0]);
+    arena.layout.applyAttributes(0);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(MAZE_WALL_LOCATION);
+    glVertexAttribIPointer(MAZE_WALL_LOCATION, 1, GL_UNSIGNED_SHORT, sizeof(uint16_t), (void *)0);
+    glVertexAttribDivisor(MAZE_WALL_LOCATION, 1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vaoRevision = pool.revision();
+    vaoDirty = false;
+  }
+
+  void startWorkers()
+  {
+    stopping = false;
+    for (unsigned int i = 0; i < MAZE_STREAMER_WORKERS; i++)
+      workers.emplace_back([this]
+                           { workerLoop(); });
+  }
+
+  void stopWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      stopping = true;
+      jobs.clear();
+    }
+    jobReady.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+    workers.clear();
+  }
+
+  void workerLoop()
+  {
+    for (;;)
+    {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobReady.wait(lock, [this]
+                      { return stopping || !jobs.empty(); });
+        if (stopping)
+          return;
+        job = jobs.front();
+        jobs.pop_front();
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      GeneratedChunk chunk;
+      chunk.chunk = job.chunk;
+      chunk.epoch = job.epoch;
+      chunk.walls = generateMazeChunk(job.seed, job.chunk, job.openness);
+      chunk.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      std::lock_guard<std::mutex> lock(resultMutex);
+      finished.push_back(std::move(chunk));
+    }
+  }
+};
+
+#endif // MAZE_STREAMING_H
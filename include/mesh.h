@@ -3,22 +3,18 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <bounds.h>
+#include <mesh_lod.h>
+#include <meshlet.h>
+#include <geometry_pool.h>
+#include <gl_state_cache.h>
 #include <shader.h>
 #include <texture.h>
+#include <vertex_layout.h>
 #include <vector>
 
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex
-{
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec2 texCoords;
-  glm::vec3 tangent;
-  glm::vec3 bitangent;
-  int m_BoneIDs[MAX_BONE_INFLUENCE];
-  float m_Weights[MAX_BONE_INFLUENCE];
-};
+// Mesh::materialID for meshes that still bind their own textures
+#define MESH_NO_MATERIAL 0xFFFFFFFFu
 
 class Mesh
 {
@@ -27,24 +23,101 @@ public:
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
   std::vector<Texture> textures;
+  // GPU vertex format; compact static unless the vertices carry bone weights
+  VertexLayout layout;
+  // counts of what is on the GPU; `vertices`/`indices` are empty for meshes built from packed data
+  unsigned int vertexCount = 0;
+  unsigned int indexCount = 0; // every LOD
+  // GL_UNSIGNED_SHORT when every vertex is addressable with 16 bits, else GL_UNSIGNED_INT;
+  // `indices` stays 32-bit on the CPU, the narrowing happens at upload
+  GLenum indexType = GL_UNSIGNED_INT;
+  // vertex and index ranges in the shared GeometryPool; copies of a Mesh share them
+  GeometryHandle geometry = GEOMETRY_NO_ALLOCATION;
+  // index ranges per level of detail, LOD 0 (full detail) first; never empty once constructed
+  std::vector<MeshLod> lods;
+  // LOD 0 split into contiguous clusters (see meshlet.h); empty when the mesh was not clustered
+  std::vector<Meshlet> meshlets;
+  MeshletSoA meshletBounds;
+  // MaterialLibrary entry; with one, the render queue draws with a material ID instead of `textures`
+  uint32_t materialID = MESH_NO_MATERIAL;
+  // local-space bounds, computed at import (or read back from the mesh cache)
+  AABB bounds;
+  BoundingSphere sphere;
+
+  // `meshLods` are ranges of `indices`; without any, all of `indices` is the only level.
+  // `meshMeshlets` are ranges of LOD 0.
+  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, std::vector<MeshLod> meshLods = {},
+       std::vector<Meshlet> meshMeshlets = {})
+      : Mesh(vertices, indices, textures, VertexLayout::forVertices(vertices), meshLods, meshMeshlets)
+  {
+  }
 
-  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
-      : vertices(vertices), indices(indices), textures(textures)
+  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, VertexLayout vertexLayout,
+       std::vector<MeshLod> meshLods = {}, std::vector<Meshlet> meshMeshlets = {})
+      : vertices(vertices), indices(indices), textures(textures), layout(vertexLayout), lods(meshLods), meshlets(meshMeshlets)
   {
+    meshletBounds.assign(meshlets);
+    MeshBounds meshBounds = computeMeshBounds(this->vertices);
+    bounds = meshBounds.box;
+    sphere = meshBounds.sphere;
     setupMesh();
+    updateTextureBindings();
   }
 
-  void Draw(Shader &shader)
+  // Builds a mesh from vertex streams already packed for `vertexLayout` (e.g. a mapped mesh cache).
+  // The data goes straight into the GeometryPool; no CPU copy of vertices or indices is kept, so
+  // the bounds have to come with it.
+  Mesh(const VertexLayout &vertexLayout, unsigned int numVertices, const void *const streams[2], const unsigned int *indexData,
+       unsigned int numIndices, std::vector<Texture> textures, const MeshBounds &meshBounds, std::vector<MeshLod> meshLods = {}, std::vector<Meshlet> meshMeshlets = {})
+      : textures(textures), layout(vertexLayout), lods(meshLods), meshlets(meshMeshlets), bounds(meshBounds.box), sphere(meshBounds.sphere)
+  {
+    meshletBounds.assign(meshlets);
+    uploadBuffers(numVertices, streams, indexData, numIndices);
+    updateTextureBindings();
+  }
+
+  // bytes of vertex data resident on the GPU for this mesh
+  size_t vertexBufferBytes() const
+  {
+    return layout.bytesFor(vertexCount);
+  }
+
+  // bytes per index in the element buffer
+  size_t indexSize() const
+  {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+  }
+
+  // Gives the pool ranges back. Only the owner (Model) calls this, once; copies share the ranges.
+  void release()
+  {
+    GeometryPool::instance().release(geometry);
+    geometry = GEOMETRY_NO_ALLOCATION;
+  }
+
+  // Where the mesh currently sits in its arena. Ranges move when the pool compacts (see
+  // GeometryPool::revision), so read this at draw time instead of caching it.
+  const GeometryRange &geometryRange() const { return GeometryPool::instance().range(geometry); }
+
+  // glDraw* "indices" argument for index `first` of this mesh
+  const void *indexOffset(uint32_t first) const
+  {
+    return (const void *)(uintptr_t)((geometryRange().firstIndex + first) * indexSize());
+  }
+  GLint baseVertex() const { return (GLint)geometryRange().baseVertex; }
+
+  // resolves the sampler uniform names for the current texture list once, so Draw never builds
+  // strings. Must be called again whenever `textures` is modified.
+  void updateTextureBindings()
   {
     unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
     unsigned int metallicNr = 1, roughnessNr = 1, aoNr = 1, emissiveNr = 1;
 
-    // Track presence flags
-    bool hasEmissive = false;
-
+    hasEmissive = false;
+    samplerBindings.clear();
+    textureSetHash = 14695981039346656037ull;
     for (unsigned int i = 0; i < textures.size(); i++)
     {
-      glActiveTexture(GL_TEXTURE0 + i);
       std::string number;
       std::string name = textures[i].type;
       if (name == "texture_diffuse")
@@ -67,93 +140,145 @@ public:
         hasEmissive = true;
       }
 
-      shader.setInt(("material." + name + number).c_str(), i);
-      shader.setInt((name + number).c_str(), i);
+      samplerBindings.push_back({UniformHandle("material." + name + number), UniformHandle(name + number)});
+      // FNV-1a over (sampler, texture) pairs: meshes with equal hashes bind identical state
+      textureSetHash = (textureSetHash ^ samplerBindings.back().plain.hash) * 1099511628211ull;
+      textureSetHash = (textureSetHash ^ textures[i].id) * 1099511628211ull;
+    }
+  }
+
+  // identifies the texture set for render queue sorting; equal hashes mean bindMaterial can be skipped
+  uint64_t materialHash() const { return textureSetHash; }
+  // the VAO of the mesh's pool arena, shared with every mesh of the same layout and index type
+  unsigned int vertexArray() const { return GeometryPool::instance().arena(geometryRange().arena).vao; }
+
+  // Render queue path: binds the textures through the state cache and points the samplers at them.
+  // The queue calls this only when the program or the material changes between draws.
+  void bindMaterial(const Shader &shader, GLStateCache &state)
+  {
+    static constexpr UniformHandle uHasEmissive("hasEmissive");
+
+    if (samplerBindings.size() != textures.size())
+      updateTextureBindings();
+
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+      shader.setInt(samplerBindings[i].material, i);
+      shader.setInt(samplerBindings[i].plain, i);
+      state.bindTexture2D(i, textures[i].id);
+    }
+    shader.setBool(uHasEmissive, hasEmissive);
+    state.counters.uniformUploads++;
+  }
+
+  // Render queue path: draw one level of detail with whatever program and material are bound
+  void drawElements(GLStateCache &state, uint32_t lod = 0)
+  {
+    const MeshLod &range = lods[lod];
+    state.bindVertexArray(vertexArray());
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, indexType, indexOffset(range.firstIndex), baseVertex());
+    state.counters.draws++;
+    state.counters.triangles += range.indexCount / 3;
+  }
+
+  // Render queue path: draw index ranges of this mesh (e.g. the meshlets that survived culling)
+  // in one call, with whatever program and material are bound; offsets come from indexOffset()
+  // and baseVertices repeat baseVertex()
+  void drawRanges(GLStateCache &state, const GLsizei *counts, const void *const *offsets, const GLint *baseVertices, GLsizei rangeCount)
+  {
+    state.bindVertexArray(vertexArray());
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, indexType, offsets, rangeCount, baseVertices);
+    state.counters.draws++;
+    for (GLsizei i = 0; i < rangeCount; i++)
+      state.counters.triangles += (unsigned int)counts[i] / 3;
+  }
+
+  void Draw(Shader &shader)
+  {
+    static constexpr UniformHandle uHasEmissive("hasEmissive");
+
+    if (samplerBindings.size() != textures.size())
+      updateTextureBindings();
+
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+      glActiveTexture(GL_TEXTURE0 + i);
+      shader.setInt(samplerBindings[i].material, i);
+      shader.setInt(samplerBindings[i].plain, i);
       glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
     // Provide presence flags the shaders can use
-    shader.setBool("hasEmissive", hasEmissive);
+    shader.setBool(uHasEmissive, hasEmissive);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glDrawElements(GL_TRIANGLES, (unsigned int)indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(vertexArray());
+    glDrawElementsBaseVertex(GL_TRIANGLES, lods[0].indexCount, indexType, indexOffset(lods[0].firstIndex), baseVertex());
   }
 
   void DrawInstanced(Shader &shader, unsigned int instanceCount)
   {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
+    if (samplerBindings.size() != textures.size())
+      updateTextureBindings();
+
     for (unsigned int i = 0; i < textures.size(); i++)
     {
       glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-      // retrieve texture number (the N in diffuse_textureN)
-      std::string number;
-      std::string name = textures[i].type;
-      if (name == "texture_diffuse")
-        number = std::to_string(diffuseNr++);
-      else if (name == "texture_specular")
-        number = std::to_string(specularNr++);
-      else if (name == "texture_normal")
-        number = std::to_string(normalNr++);
-      else if (name == "texture_height")
-        number = std::to_string(heightNr++);
-
-      shader.setInt(("material." + name + number).c_str(), i);
+      shader.setInt(samplerBindings[i].material, i);
       glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
 
     // draw mesh
-    glBindVertexArray(VAO);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, instanceCount);
+    glBindVertexArray(vertexArray());
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lods[0].indexCount, indexType, indexOffset(lods[0].firstIndex), instanceCount,
+                                      baseVertex());
     // glBindVertexArray(0);
   }
 
 private:
 protected:
-  //  render data
-  unsigned int VAO, VBO, EBO;
+  // pre-hashed "material.texture_diffuse1" / "texture_diffuse1" names, one per texture
+  struct SamplerBinding
+  {
+    UniformHandle material;
+    UniformHandle plain;
+  };
+  std::vector<SamplerBinding> samplerBindings;
+  bool hasEmissive = false;
+  uint64_t textureSetHash = 0;
+
   void setupMesh()
   {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-                 &indices[0], GL_STATIC_DRAW);
-
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
-    // vertex tangents
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tangent));
-    // vertex bitangents
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, bitangent));
-    // bone IDs
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, m_BoneIDs));
-    // bone weights
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_Weights));
-
-    glBindVertexArray(0);
+    std::vector<unsigned char> packed[2];
+    const void *streams[2] = {nullptr, nullptr};
+    for (unsigned int stream = 0; stream < layout.streamCount() && stream < 2; stream++)
+    {
+      packed[stream] = layout.pack(vertices, stream);
+      streams[stream] = packed[stream].data();
+    }
+    uploadBuffers((unsigned int)vertices.size(), streams, indices.data(), (unsigned int)indices.size());
+  }
+
+  // stream 0: position/normal/uv/tangent; stream 1: bone ids + weights, only for skinned layouts.
+  // Both go into the GeometryPool arena for the layout, sized by layout.stride(stream) * numVertices.
+  void uploadBuffers(unsigned int numVertices, const void *const streams[2], const unsigned int *indexData, unsigned int numIndices)
+  {
+    vertexCount = numVertices;
+    indexCount = numIndices;
+    if (lods.empty())
+      lods.push_back({0, numIndices, 0.0f});
+
+    if (numVertices <= 0xFFFFu + 1u)
+    {
+      // half the index bandwidth whenever 16 bits address every vertex
+      std::vector<uint16_t> narrow(indexData, indexData + numIndices);
+      indexType = GL_UNSIGNED_SHORT;
+      geometry = GeometryPool::instance().allocate(layout, indexType, numVertices, streams, numIndices, narrow.data());
+    }
+    else
+    {
+      indexType = GL_UNSIGNED_INT;
+      geometry = GeometryPool::instance().allocate(layout, indexType, numVertices, streams, numIndices, indexData);
+    }
   }
 };
 
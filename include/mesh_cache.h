@@ -0,0 +1,427 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "bounds.h"
+#include "file_stamp.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "model_import.h"
+#include "vertex_layout.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Cooked mesh cache (".meshcache" next to the source model).
+//
+// Layout, little-endian, every section 16-byte aligned:
+//   CookedFileHeader
+//   CookedMeshEntry[meshCount]
+//   per mesh: VertexAttribute[attributeCount], CookedTextureEntry[textureCount],
+//             stream 0 bytes, stream 1 bytes, uint32 indices (every LOD; narrowed to 16 bits at upload
+//             when the vertex count allows), MeshLod[lodCount],
+//             Meshlet[meshletCount]
+//   string table (null-terminated texture types and paths)
+//
+// Vertex streams are stored already packed for the mesh's VertexLayout, so loading is a mmap plus
+// glBufferData straight from the mapping. Bump COOKED_MESH_VERSION whenever the layout or the
+// import pipeline changes; stale caches are then ignored and rewritten.
+
+#define COOKED_MESH_MAGIC 0x434D474Fu // "OGMC"
+#define COOKED_MESH_VERSION 6u
+#define COOKED_MESH_EXTENSION ".meshcache"
+
+struct CookedFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t meshCount;
+  uint32_t reserved;
+  uint64_t sourceSize;      // size of the model file this was cooked from
+  int64_t sourceWriteTime;  // its last write time, in file_clock ticks
+  uint64_t stringTableOffset;
+  uint64_t fileSize;
+};
+
+struct CookedMeshEntry
+{
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t attributeCount;
+  uint32_t textureCount;
+  uint64_t attributeOffset;
+  uint64_t textureOffset;
+  uint64_t streamOffset[2];
+  uint64_t streamSize[2];
+  uint64_t indexOffset;
+  uint64_t reserved;
+  float boundsMin[3]; // local-space AABB and bounding sphere, so culling needs no vertex data
+  float boundsMax[3];
+  float sphereCenter[3];
+  float sphereRadius;
+  uint32_t lodCount; // index ranges into the indices above, LOD 0 first
+  uint32_t lodReserved;
+  uint64_t lodOffset;
+  uint32_t meshletCount; // ranges of LOD 0
+  uint32_t meshletReserved;
+  uint64_t meshletOffset;
+};
+
+struct CookedTextureEntry
+{
+  uint32_t typeOffset; // into the string table
+  uint32_t pathOffset;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { close(); }
+
+  bool open(const std::string &path)
+  {
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    length = (size_t)fileSize.QuadPart;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+      close();
+      return false;
+    }
+    bytes = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      close();
+      return false;
+    }
+    length = (size_t)st.st_size;
+    void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    bytes = ptr == MAP_FAILED ? nullptr : (const unsigned char *)ptr;
+#endif
+    if (!bytes)
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close()
+  {
+#ifdef _WIN32
+    if (bytes)
+      UnmapViewOfFile(bytes);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (bytes)
+      munmap((void *)bytes, length);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+#endif
+    bytes = nullptr;
+    length = 0;
+  }
+
+  const unsigned char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const unsigned char *bytes = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int fd = -1;
+#endif
+};
+
+// One cooked mesh as seen through the mapping. Pointers stay valid while the CookedMeshFile is open.
+struct CookedMeshView
+{
+  VertexLayout layout;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  const void *streams[2];
+  size_t streamSizes[2];
+  const uint32_t *indices;
+  std::vector<TextureRef> textures;
+  MeshBounds bounds;
+  std::vector<MeshLod> lods;
+  std::vector<Meshlet> meshlets;
+};
+
+class CookedMeshFile
+{
+public:
+  // maps `cachePath` and validates it against the model it claims to come from
+  bool open(const std::string &cachePath, const std::string &sourcePath)
+  {
+    if (!file.open(cachePath))
+      return false;
+    if (file.size() < sizeof(CookedFileHeader))
+      return fail();
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION || header.fileSize != file.size())
+      return fail();
+
+    uint64_t size = 0;
+    int64_t writeTime = 0;
+    if (!readSourceStamp(sourcePath, size, writeTime) || size != header.sourceSize || writeTime != header.sourceWriteTime)
+      return fail();
+    if (sizeof(CookedFileHeader) + (uint64_t)header.meshCount * sizeof(CookedMeshEntry) > file.size())
+      return fail();
+    if (header.stringTableOffset > file.size())
+      return fail();
+    for (uint32_t m = 0; m < header.meshCount; m++)
+    {
+      CookedMeshEntry entry;
+      std::memcpy(&entry, file.data() + sizeof(CookedFileHeader) + m * sizeof(CookedMeshEntry), sizeof(entry));
+      if (!entryInBounds(entry))
+      {
+        std::cout << "WARNING::MESH_CACHE:: " << cachePath << " has a bad entry for mesh " << m << ", reimporting" << std::endl;
+        return fail();
+      }
+    }
+    return true;
+  }
+
+  uint32_t meshCount() const { return header.meshCount; }
+
+  CookedMeshView mesh(uint32_t index) const
+  {
+    const unsigned char *base = file.data();
+    CookedMeshEntry entry;
+    std::memcpy(&entry, base + sizeof(CookedFileHeader) + index * sizeof(CookedMeshEntry), sizeof(entry));
+
+    CookedMeshView view;
+    view.vertexCount = entry.vertexCount;
+    view.indexCount = entry.indexCount;
+    view.layout.attributes.resize(entry.attributeCount);
+    std::memcpy(view.layout.attributes.data(), base + entry.attributeOffset, entry.attributeCount * sizeof(VertexAttribute));
+    for (int s = 0; s < 2; s++)
+    {
+      view.streams[s] = entry.streamSize[s] ? base + entry.streamOffset[s] : nullptr;
+      view.streamSizes[s] = (size_t)entry.streamSize[s];
+    }
+    view.indices = (const uint32_t *)(base + entry.indexOffset);
+    view.bounds.box.min = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+    view.bounds.box.max = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    view.bounds.sphere.center = glm::vec3(entry.sphereCenter[0], entry.sphereCenter[1], entry.sphereCenter[2]);
+    view.bounds.sphere.radius = entry.sphereRadius;
+    view.lods.resize(entry.lodCount);
+    if (entry.lodCount)
+      std::memcpy(view.lods.data(), base + entry.lodOffset, entry.lodCount * sizeof(MeshLod));
+    view.meshlets.resize(entry.meshletCount);
+    if (entry.meshletCount)
+      std::memcpy(view.meshlets.data(), base + entry.meshletOffset, entry.meshletCount * sizeof(Meshlet));
+
+    const char *strings = (const char *)(base + header.stringTableOffset);
+    for (uint32_t t = 0; t < entry.textureCount; t++)
+    {
+      CookedTextureEntry tex;
+      std::memcpy(&tex, base + entry.textureOffset + t * sizeof(CookedTextureEntry), sizeof(tex));
+      view.textures.push_back({strings + tex.typeOffset, strings + tex.pathOffset});
+    }
+    return view;
+  }
+
+  void close() { file.close(); }
+
+private:
+  MappedFile file;
+  CookedFileHeader header{};
+
+  bool fail()
+  {
+    file.close();
+    return false;
+  }
+
+  // [offset, offset + count * elementSize) lies inside the mapping, without overflowing
+  bool rangeInFile(uint64_t offset, uint64_t count, uint64_t elementSize) const
+  {
+    uint64_t size = file.size();
+    return offset <= size && count <= (size - offset) / elementSize;
+  }
+
+  // a string starting `offset` bytes into the string table is NUL-terminated inside the mapping
+  bool stringInFile(uint32_t offset) const
+  {
+    uint64_t start = header.stringTableOffset + (uint64_t)offset;
+    if (start >= file.size())
+      return false;
+    return std::memchr(file.data() + start, '\0', (size_t)(file.size() - start)) != nullptr;
+  }
+
+  // A stamp only says which model the cache came from; a truncated or corrupt body must not be
+  // read past the mapping by mesh(), so every section of the entry is checked here. LOD and
+  // meshlet ranges must also stay inside the mesh's own indices, since they are drawn as is.
+  bool entryInBounds(const CookedMeshEntry &entry) const
+  {
+    if (!rangeInFile(entry.attributeOffset, entry.attributeCount, sizeof(VertexAttribute)) ||
+        !rangeInFile(entry.textureOffset, entry.textureCount, sizeof(CookedTextureEntry)) ||
+        !rangeInFile(entry.indexOffset, entry.indexCount, sizeof(uint32_t)) ||
+        !rangeInFile(entry.lodOffset, entry.lodCount, sizeof(MeshLod)) ||
+        !rangeInFile(entry.meshletOffset, entry.meshletCount, sizeof(Meshlet)))
+      return false;
+    for (int s = 0; s < 2; s++)
+      if (entry.streamSize[s] && !rangeInFile(entry.streamOffset[s], entry.streamSize[s], 1))
+        return false;
+
+    const unsigned char *base = file.data();
+    for (uint32_t t = 0; t < entry.textureCount; t++)
+    {
+      CookedTextureEntry tex;
+      std::memcpy(&tex, base + entry.textureOffset + t * sizeof(CookedTextureEntry), sizeof(tex));
+      if (!stringInFile(tex.typeOffset) || !stringInFile(tex.pathOffset))
+        return false;
+    }
+    for (uint32_t l = 0; l < entry.lodCount; l++)
+    {
+      MeshLod lod;
+      std::memcpy(&lod, base + entry.lodOffset + l * sizeof(MeshLod), sizeof(lod));
+      if ((uint64_t)lod.firstIndex + lod.indexCount > entry.indexCount)
+        return false;
+    }
+    for (uint32_t i = 0; i < entry.meshletCount; i++)
+    {
+      Meshlet meshlet;
+      std::memcpy(&meshlet, base + entry.meshletOffset + i * sizeof(Meshlet), sizeof(meshlet));
+      if ((uint64_t)meshlet.firstIndex + meshlet.indexCount > entry.indexCount)
+        return false;
+    }
+    return true;
+  }
+};
+
+// Packs every mesh with the layout Mesh would pick and writes the cache. Used both by Model after a
+// fresh import and by the offline MeshCooker tool.
+inline bool writeCookedMeshFile(const std::string &cachePath, const std::string &sourcePath, const std::vector<ImportedMesh> &meshes)
+{
+  CookedFileHeader header{};
+  header.magic = COOKED_MESH_MAGIC;
+  header.version = COOKED_MESH_VERSION;
+  header.meshCount = (uint32_t)meshes.size();
+  if (!readSourceStamp(sourcePath, header.sourceSize, header.sourceWriteTime))
+    return false;
+
+  auto align = [](uint64_t offset)
+  {
+    return (offset + 15) & ~(uint64_t)15;
+  };
+
+  std::vector<unsigned char> blob;
+  auto append = [&](const void *data, size_t size)
+  {
+    uint64_t offset = align(blob.size());
+    blob.resize(offset + size);
+    if (size)
+      std::memcpy(blob.data() + offset, data, size);
+    return offset;
+  };
+
+  std::string strings;
+  auto addString = [&](const std::string &s)
+  {
+    uint32_t offset = (uint32_t)strings.size();
+    strings.append(s);
+    strings.push_back('\0');
+    return offset;
+  };
+
+  std::vector<CookedMeshEntry> entries(meshes.size());
+  blob.resize(sizeof(CookedFileHeader) + entries.size() * sizeof(CookedMeshEntry));
+  for (size_t m = 0; m < meshes.size(); m++)
+  {
+    const ImportedMesh &mesh = meshes[m];
+    VertexLayout layout = VertexLayout::forVertices(mesh.vertices);
+    CookedMeshEntry &entry = entries[m];
+    entry = CookedMeshEntry{};
+    entry.vertexCount = (uint32_t)mesh.vertices.size();
+    entry.indexCount = (uint32_t)mesh.indices.size();
+    entry.attributeCount = (uint32_t)layout.attributes.size();
+    entry.textureCount = (uint32_t)mesh.textures.size();
+    entry.attributeOffset = append(layout.attributes.data(), layout.attributes.size() * sizeof(VertexAttribute));
+
+    std::vector<CookedTextureEntry> textures;
+    for (const TextureRef &t : mesh.textures)
+      textures.push_back({addString(t.type), addString(t.path)});
+    entry.textureOffset = append(textures.data(), textures.size() * sizeof(CookedTextureEntry));
+
+    for (unsigned int s = 0; s < 2; s++)
+    {
+      if (s >= layout.streamCount())
+        continue;
+      std::vector<unsigned char> stream = layout.pack(mesh.vertices, s);
+      entry.streamOffset[s] = append(stream.data(), stream.size());
+      entry.streamSize[s] = stream.size();
+    }
+    entry.indexOffset = append(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+
+    MeshBounds bounds = computeMeshBounds(mesh.vertices);
+    for (int i = 0; i < 3; i++)
+    {
+      entry.boundsMin[i] = bounds.box.min[i];
+      entry.boundsMax[i] = bounds.box.max[i];
+      entry.sphereCenter[i] = bounds.sphere.center[i];
+    }
+    entry.sphereRadius = bounds.sphere.radius;
+    entry.lodCount = (uint32_t)mesh.lods.size();
+    entry.lodOffset = append(mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+    entry.meshletCount = (uint32_t)mesh.meshlets.size();
+    entry.meshletOffset = append(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+  }
+  header.stringTableOffset = append(strings.data(), strings.size());
+  header.fileSize = blob.size();
+
+  std::memcpy(blob.data(), &header, sizeof(header));
+  std::memcpy(blob.data() + sizeof(header), entries.data(), entries.size() * sizeof(CookedMeshEntry));
+
+  std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cout << "ERROR::MESH_CACHE:: cannot write " << cachePath << std::endl;
+    return false;
+  }
+  out.write((const char *)blob.data(), (std::streamsize)blob.size());
+  return (bool)out;
+}
+
+#endif // MESH_CACHE_H
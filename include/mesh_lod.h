@@ -0,0 +1,455 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// Level-of-detail chains for imported meshes.
+//
+// Every level is a range of one index buffer over the mesh's single vertex buffer: LOD 0 is the
+// original triangle list and each further level has about half the triangles of the one before.
+// Levels come from quadric error metric simplification (Garland & Heckbert) with half-edge
+// collapses, so simplified triangles only reference original vertices and no vertex data is added.
+// Collapses are attribute-aware: the cost includes the normal/UV change, vertices on UV or normal
+// seams (one position, several vertices) never move, and border vertices only slide along their border.
+//
+// Each level stores its error in object-space units. selectLod() projects that with the camera
+// FOV and picks the coarsest level whose error stays under a pixel budget.
+
+#define MESH_MAX_LODS 5
+
+struct MeshLod
+{
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  float error = 0.0f; // object space, never smaller than the previous level's
+};
+
+struct LodBuildSettings
+{
+  unsigned int maxLods = MESH_MAX_LODS;
+  float reduction = 0.5f;        // triangle ratio between consecutive levels
+  unsigned int minTriangles = 64; // no level below this
+};
+
+namespace mesh_lod_detail
+{
+  // symmetric 4x4 error quadric plus the area weight it was accumulated with
+  struct Quadric
+  {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(const glm::dvec3 &n, double d, double w)
+    {
+      Quadric q;
+      q.a00 = w * n.x * n.x;
+      q.a01 = w * n.x * n.y;
+      q.a02 = w * n.x * n.z;
+      q.a11 = w * n.y * n.y;
+      q.a12 = w * n.y * n.z;
+      q.a22 = w * n.z * n.z;
+      q.b0 = w * n.x * d;
+      q.b1 = w * n.y * d;
+      q.b2 = w * n.z * d;
+      q.c = w * d * d;
+      q.weight = w;
+      return q;
+    }
+
+    void operator+=(const Quadric &o)
+    {
+      a00 += o.a00, a01 += o.a01, a02 += o.a02, a11 += o.a11, a12 += o.a12, a22 += o.a22;
+      b0 += o.b0, b1 += o.b1, b2 += o.b2, c += o.c;
+      weight += o.weight;
+    }
+
+    // mean squared distance of p to the accumulated planes
+    double error(const glm::vec3 &p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+      double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+      return weight > 0.0 ? std::fabs(e) / weight : 0.0;
+    }
+  };
+
+  enum VertexKind : uint8_t
+  {
+    KIND_MANIFOLD, // interior, free to collapse onto a neighbour
+    KIND_BORDER,   // on an open boundary; collapses only along a border edge
+    KIND_LOCKED,   // seam, bow-tie or non-manifold; never moves
+  };
+
+  struct Collapse
+  {
+    uint32_t from;
+    uint32_t to;
+    float cost;
+  };
+
+  inline uint64_t edgeKey(uint32_t a, uint32_t b) { return (uint64_t)a << 32 | b; }
+
+  // FNV-1a over raw bytes; only used to bucket exact duplicates
+  inline size_t hashBytes(const void *data, size_t size)
+  {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+      h = (h ^ bytes[i]) * 1099511628211ull;
+    return (size_t)h;
+  }
+
+  // For every vertex, the first vertex with the same bytes in [offset, offset + size) of Vertex
+  inline std::vector<uint32_t> canonicalVertices(const std::vector<Vertex> &vertices, size_t offset, size_t size)
+  {
+    std::vector<uint32_t> canonical(vertices.size());
+    std::unordered_multimap<size_t, uint32_t> seen;
+    seen.reserve(vertices.size());
+    for (uint32_t v = 0; v < vertices.size(); v++)
+    {
+      const char *bytes = (const char *)&vertices[v] + offset;
+      size_t h = hashBytes(bytes, size);
+      canonical[v] = v;
+      auto range = seen.equal_range(h);
+      for (auto it = range.first; it != range.second; ++it)
+        if (std::memcmp((const char *)&vertices[it->second] + offset, bytes, size) == 0)
+        {
+          canonical[v] = it->second;
+          break;
+        }
+      if (canonical[v] == v)
+        seen.emplace(h, v);
+    }
+    return canonical;
+  }
+}
+
+// Simplifies an indexed triangle list through each of `targetIndexCounts` (descending) in one
+// collapse sequence, snapshotting the index list and the error reached (object-space distance) as
+// each target is met. Stops early, after one last snapshot, once no collapse is possible or the
+// next would cost more than `maxError`. Snapshots reference the original vertices.
+inline void simplifyMeshLevels(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                               const std::vector<size_t> &targetIndexCounts, float maxError,
+                               std::vector<std::vector<unsigned int>> &levels, std::vector<float> &errors)
+{
+  using namespace mesh_lod_detail;
+
+  // vertices that only differ in attributes Mesh ignores (tangents, bones) are one vertex here;
+  // vertices sharing a position but not normal/UV mark a seam
+  const size_t attributeBytes = offsetof(Vertex, tangent);
+  std::vector<uint32_t> wedge = canonicalVertices(vertices, 0, attributeBytes);
+  std::vector<uint32_t> position = canonicalVertices(vertices, 0, sizeof(glm::vec3));
+
+  std::vector<unsigned int> triangles;
+  triangles.reserve(indices.size());
+  for (size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    uint32_t a = wedge[indices[i]], b = wedge[indices[i + 1]], c = wedge[indices[i + 2]];
+    if (position[a] != position[b] && position[b] != position[c] && position[c] != position[a])
+      triangles.insert(triangles.end(), {a, b, c});
+  }
+
+  // classify by position: seams and anything non-manifold are locked
+  const size_t vertexCount = vertices.size();
+  std::vector<uint32_t> wedgesAtPosition(vertexCount, 0);
+  for (uint32_t v = 0; v < vertexCount; v++)
+    if (wedge[v] == v)
+      wedgesAtPosition[position[v]]++;
+
+  // directed edges between positions; an edge without its reverse is on a border
+  std::unordered_map<uint64_t, uint32_t> directedEdges;
+  auto buildEdges = [&]()
+  {
+    directedEdges.clear();
+    directedEdges.reserve(triangles.size());
+    for (size_t t = 0; t < triangles.size(); t += 3)
+      for (int e = 0; e < 3; e++)
+        directedEdges[edgeKey(position[triangles[t + e]], position[triangles[t + (e + 1) % 3]])]++;
+  };
+  buildEdges();
+
+  std::vector<uint8_t> kind(vertexCount, KIND_MANIFOLD);
+  std::vector<uint32_t> borderEdges(vertexCount, 0);
+  auto isBorderEdge = [&](uint32_t a, uint32_t b)
+  {
+    return directedEdges.find(edgeKey(position[b], position[a])) == directedEdges.end();
+  };
+  for (const auto &edge : directedEdges)
+  {
+    uint32_t a = (uint32_t)(edge.first >> 32), b = (uint32_t)edge.first;
+    if (edge.second > 1)
+      kind[a] = kind[b] = KIND_LOCKED;
+    if (directedEdges.find(edgeKey(b, a)) == directedEdges.end())
+    {
+      borderEdges[a]++;
+      borderEdges[b]++;
+    }
+  }
+  for (uint32_t v = 0; v < vertexCount; v++)
+  {
+    uint32_t p = position[v];
+    if (kind[p] == KIND_LOCKED || wedgesAtPosition[p] > 1 || (borderEdges[p] != 0 && borderEdges[p] != 2))
+      kind[v] = KIND_LOCKED;
+    else
+      kind[v] = borderEdges[p] ? KIND_BORDER : KIND_MANIFOLD;
+  }
+
+  // area-weighted plane quadrics, plus a stiff perpendicular plane along every border edge
+  const double borderWeight = 10.0;
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t t = 0; t < triangles.size(); t += 3)
+  {
+    glm::dvec3 p0 = vertices[triangles[t]].position, p1 = vertices[triangles[t + 1]].position, p2 = vertices[triangles[t + 2]].position;
+    glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+    double area = glm::length(normal);
+    if (area <= 0.0)
+      continue;
+    normal /= area;
+    Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0), area * 0.5);
+    for (int c = 0; c < 3; c++)
+      quadrics[triangles[t + c]] += q;
+
+    for (int e = 0; e < 3; e++)
+    {
+      uint32_t a = triangles[t + e], b = triangles[t + (e + 1) % 3];
+      if (!isBorderEdge(a, b))
+        continue;
+      glm::dvec3 pa = vertices[a].position, pb = vertices[b].position;
+      glm::dvec3 edge = pb - pa;
+      double length = glm::length(edge);
+      glm::dvec3 side = glm::cross(edge / length, normal);
+      Quadric border = Quadric::fromPlane(side, -glm::dot(side, pa), length * length * borderWeight);
+      quadrics[a] += border;
+      quadrics[b] += border;
+    }
+  }
+
+  auto collapseCost = [&](uint32_t from, uint32_t to)
+  {
+    Quadric merged = quadrics[from];
+    merged += quadrics[to];
+    const Vertex &a = vertices[from], &b = vertices[to];
+    glm::vec3 delta = a.position - b.position;
+    glm::vec3 normalDelta = a.normal - b.normal;
+    glm::vec2 uvDelta = a.texCoords - b.texCoords;
+    // attribute change scaled by the edge length, so it reads as a distance like the quadric term
+    double attribute = (glm::dot(normalDelta, normalDelta) * 0.25 + glm::dot(uvDelta, uvDelta)) * glm::dot(delta, delta);
+    return (float)(merged.error(b.position) + attribute);
+  };
+
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint8_t> touched(vertexCount);
+  std::vector<Collapse> candidates;
+  float worstCost = 0.0f;
+  const float maxCost = maxError < std::sqrt(std::numeric_limits<float>::max()) ? maxError * maxError : std::numeric_limits<float>::max();
+
+  bool edgesCurrent = true;
+  bool stuck = false;
+  for (size_t targetIndexCount : targetIndexCounts)
+  {
+    while (!stuck && triangles.size() > targetIndexCount)
+    {
+      // collapses create edges, so border tests need the current topology
+      if (!edgesCurrent)
+        buildEdges();
+      edgesCurrent = true;
+
+      // vertex -> triangle adjacency for this pass
+      std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+      for (unsigned int v : triangles)
+        adjacencyOffsets[v + 1]++;
+      for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+      adjacency.resize(triangles.size());
+      std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+      for (size_t i = 0; i < triangles.size(); i++)
+        adjacency[fill[triangles[i]]++] = (uint32_t)(i / 3);
+
+      candidates.clear();
+      for (size_t t = 0; t < triangles.size(); t += 3)
+        for (int e = 0; e < 3; e++)
+        {
+          uint32_t a = triangles[t + e], b = triangles[t + (e + 1) % 3];
+          for (int direction = 0; direction < 2; direction++, std::swap(a, b))
+          {
+            if (kind[a] == KIND_LOCKED || (kind[a] == KIND_BORDER && !isBorderEdge(a, b) && !isBorderEdge(b, a)))
+              continue;
+            candidates.push_back({a, b, collapseCost(a, b)});
+          }
+        }
+      if (candidates.empty())
+      {
+        stuck = true;
+        break;
+      }
+      std::sort(candidates.begin(), candidates.end(), [](const Collapse &x, const Collapse &y)
+                { return x.cost < y.cost; });
+
+      for (size_t v = 0; v < vertexCount; v++)
+        remap[v] = (uint32_t)v;
+      std::fill(touched.begin(), touched.end(), 0);
+      size_t liveTriangles = triangles.size() / 3;
+      size_t targetTriangles = targetIndexCount / 3;
+      size_t collapses = 0;
+
+      for (const Collapse &collapse : candidates)
+      {
+        if (liveTriangles <= targetTriangles || collapse.cost > maxCost)
+          break;
+        uint32_t from = collapse.from, to = collapse.to;
+        if (touched[from] || touched[to])
+          continue;
+
+        // reject collapses that flip a surviving triangle around `from`
+        bool flips = false;
+        size_t removed = 0;
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && !flips; i++)
+        {
+          const unsigned int *tri = &triangles[adjacency[i] * 3];
+          if (tri[0] == to || tri[1] == to || tri[2] == to)
+          {
+            removed++;
+            continue;
+          }
+          glm::vec3 p[3], moved[3];
+          for (int c = 0; c < 3; c++)
+          {
+            p[c] = vertices[tri[c]].position;
+            moved[c] = tri[c] == from ? vertices[to].position : p[c];
+          }
+          glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+          glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+          flips = glm::dot(before, after) <= 0.0f;
+        }
+        if (flips || removed == 0)
+          continue;
+
+        // lock the neighbourhood so every flip test this pass sees current geometry
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
+          for (int c = 0; c < 3; c++)
+            touched[triangles[adjacency[i] * 3 + c]] = 1;
+        remap[from] = to;
+        quadrics[to] += quadrics[from];
+        liveTriangles -= removed;
+        worstCost = std::max(worstCost, collapse.cost);
+        collapses++;
+      }
+      if (collapses == 0)
+      {
+        stuck = true;
+        break;
+      }
+
+      size_t write = 0;
+      for (size_t t = 0; t < triangles.size(); t += 3)
+      {
+        unsigned int a = remap[triangles[t]], b = remap[triangles[t + 1]], c = remap[triangles[t + 2]];
+        if (a == b || b == c || c == a)
+          continue;
+        triangles[write++] = a;
+        triangles[write++] = b;
+        triangles[write++] = c;
+      }
+      triangles.resize(write);
+      edgesCurrent = false;
+    }
+    levels.push_back(triangles);
+    errors.push_back(std::sqrt(worstCost));
+    if (stuck)
+      break;
+  }
+}
+
+// Appends LOD 1.. to `indices` (which holds LOD 0) and returns the ranges of every level. All
+// levels come from one collapse sequence whose quadrics keep accumulating, so each level's error
+// is measured against the original surface. Levels stop once the simplifier cannot get below
+// about 90% of the previous level's triangles.
+inline std::vector<MeshLod> buildMeshLods(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                                          const LodBuildSettings &settings = LodBuildSettings())
+{
+  std::vector<MeshLod> lods;
+  MeshLod base;
+  base.indexCount = (uint32_t)indices.size();
+  lods.push_back(base);
+
+  std::vector<size_t> targets;
+  size_t count = indices.size() / 3;
+  while (targets.size() + 1 < settings.maxLods)
+  {
+    count = (size_t)(count * settings.reduction);
+    if (count < settings.minTriangles)
+      break;
+    targets.push_back(count * 3);
+  }
+  if (targets.empty())
+    return lods;
+
+  std::vector<std::vector<unsigned int>> levels;
+  std::vector<float> errors;
+  simplifyMeshLevels(vertices, indices, targets, std::numeric_limits<float>::max(), levels, errors);
+
+  size_t previousCount = indices.size();
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    if (levels[i].empty() || levels[i].size() > previousCount * 9 / 10)
+      break;
+    MeshLod lod;
+    lod.firstIndex = (uint32_t)indices.size();
+    lod.indexCount = (uint32_t)levels[i].size();
+    lod.error = std::max(errors[i], lods.back().error);
+    indices.insert(indices.end(), levels[i].begin(), levels[i].end());
+    lods.push_back(lod);
+    previousCount = levels[i].size();
+  }
+  return lods;
+}
+
+// Camera terms for turning an object-space error into pixels.
+struct LodSelection
+{
+  glm::vec3 eye = glm::vec3(0.0f);
+  float pixelsPerUnit = 0.0f; // pixels one unit covers at distance 1: screen height / (2 tan(fov / 2))
+  float maxPixelError = 1.0f;
+  int forcedLod = -1; // >= 0 pins every mesh to that level (clamped), for inspection
+  bool enabled = true;
+
+  void setCamera(const glm::vec3 &position, float fovYDegrees, float screenHeight)
+  {
+    eye = position;
+    pixelsPerUnit = screenHeight / (2.0f * std::tan(glm::radians(fovYDegrees) * 0.5f));
+  }
+};
+
+// Coarsest level whose error, projected at the nearest point of the world-space bounding sphere,
+// stays within the pixel budget. `scale` is the largest axis scale of the mesh's transform.
+inline uint32_t selectLod(const std::vector<MeshLod> &lods, const BoundingSphere &worldSphere, float scale, const LodSelection &selection)
+{
+  if (lods.size() <= 1 || !selection.enabled)
+    return 0;
+  if (selection.forcedLod >= 0)
+    return std::min((uint32_t)selection.forcedLod, (uint32_t)lods.size() - 1);
+
+  float distance = std::max(glm::length(worldSphere.center - selection.eye) - worldSphere.radius, 1e-4f);
+  float pixelsPerError = scale * selection.pixelsPerUnit / distance;
+  uint32_t lod = 0;
+  while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerError <= selection.maxPixelError)
+    lod++;
+  return lod;
+}
+
+#endif // MESH_LOD_H
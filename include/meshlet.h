@@ -0,0 +1,475 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+
+#include "frustum_culling.h"
+#include "mesh_lod.h"
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Meshlets: LOD 0 of a mesh split into small clusters of at most 64 vertices / 124 triangles.
+//
+// buildMeshlets() reorders LOD 0's triangles so each meshlet is a contiguous index range; the
+// vertex buffer and the other LODs are untouched. Triangles are grown greedily from a seed over
+// shared vertices, preferring ones that add no new vertex and face the way the cluster already
+// does, which keeps both the bounding sphere and the normal cone tight.
+//
+// Each meshlet carries a bounding sphere and a normal cone (axis + cutoff), both in mesh space.
+// A meshlet is skipped when its sphere is outside the frustum, or when the whole cone faces away
+// from the eye (the test from meshoptimizer):
+//   dot(center - eye, axis) >= cutoff * |center - eye| + radius
+// Clusters whose normals spread over more than a hemisphere get cutoff 1, which never passes.
+//
+// Both tests run in mesh space: the frustum planes and the eye are moved into it once per draw,
+// which is exact for any affine transform (a mirroring one only disables the cone test, since it
+// flips the winding). cullMeshlets does 8 meshlets per step with AVX or 4 with SSE2, like
+// cullAABBs; cullMeshletsScalar is the reference, and tools/meshlet_cull_report.cpp (MeshletCullReport)
+// checks that both keep the same meshlets. Only LOD 0 is clustered: coarser levels are drawn at a
+// distance where they are small on screen anyway.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet
+{
+  uint32_t firstIndex = 0; // range of the mesh's index buffer, inside LOD 0
+  uint32_t indexCount = 0;
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+  glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+  float coneCutoff = 1.0f; // sin of the cone's half angle; 1 disables the backface test
+};
+
+// Meshlet bounds as columns, the layout the SIMD kernel loads from.
+struct MeshletSoA
+{
+  std::vector<float> cx, cy, cz, radius;
+  std::vector<float> ax, ay, az, cutoff;
+  std::vector<uint32_t> triangles;
+
+  size_t size() const { return cx.size(); }
+
+  void assign(const std::vector<Meshlet> &meshlets)
+  {
+    for (std::vector<float> *column : {&cx, &cy, &cz, &radius, &ax, &ay, &az, &cutoff})
+      column->clear();
+    triangles.clear();
+    for (const Meshlet &m : meshlets)
+    {
+      cx.push_back(m.center.x), cy.push_back(m.center.y), cz.push_back(m.center.z);
+      radius.push_back(m.radius);
+      ax.push_back(m.coneAxis.x), ay.push_back(m.coneAxis.y), az.push_back(m.coneAxis.z);
+      cutoff.push_back(m.coneCutoff);
+      triangles.push_back(m.indexCount / 3);
+    }
+  }
+};
+
+// which meshlet tests run; set from the UI
+struct MeshletCullSettings
+{
+  bool enabled = true;
+  bool frustum = true;
+  // off while GL_CULL_FACE is disabled: back faces are then visible, and skipping them changes the image
+  bool cone = false;
+};
+
+// per frame; triangles of meshlet-culled draws only
+struct MeshletCullStats
+{
+  unsigned int meshlets = 0;
+  unsigned int meshletsVisible = 0;
+  unsigned int triangles = 0;
+  unsigned int frustumCulledTriangles = 0;
+  unsigned int coneCulledTriangles = 0;
+
+  float rejectionRate() const
+  {
+    return triangles ? (float)(frustumCulledTriangles + coneCulledTriangles) / (float)triangles : 0.0f;
+  }
+};
+
+// The frustum and eye of one draw, in the mesh's local space.
+struct MeshletCullView
+{
+  glm::vec4 planes[FRUSTUM_PLANE_COUNT]; // normalized in local space, so local radii compare directly
+  glm::vec3 eye = glm::vec3(0.0f);
+  bool frustum = true;
+  bool cone = true;
+
+  static MeshletCullView forTransform(const Frustum &worldFrustum, const glm::vec3 &worldEye, const glm::mat4 &transform,
+                                      const MeshletCullSettings &settings)
+  {
+    MeshletCullView view;
+    // a world plane p evaluated at M x is the local plane (dot(p, M[0]), ..., dot(p, M[3]))
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+    {
+      const glm::vec4 &plane = worldFrustum.planes[p];
+      glm::vec4 local(glm::dot(plane, transform[0]), glm::dot(plane, transform[1]), glm::dot(plane, transform[2]), glm::dot(plane, transform[3]));
+      float length = glm::length(glm::vec3(local));
+      view.planes[p] = length > 0.0f ? local / length : local;
+    }
+    view.eye = glm::vec3(glm::inverse(transform) * glm::vec4(worldEye, 1.0f));
+    view.frustum = settings.frustum;
+    view.cone = settings.cone && glm::determinant(glm::mat3(transform)) > 0.0f;
+    return view;
+  }
+};
+
+namespace meshlet_detail
+{
+  inline glm::vec3 triangleNormal(const std::vector<Vertex> &vertices, const unsigned int *tri)
+  {
+    const glm::vec3 &a = vertices[tri[0]].position;
+    return glm::cross(vertices[tri[1]].position - a, vertices[tri[2]].position - a); // length = 2 * area
+  }
+
+  inline Meshlet finishMeshlet(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &order, uint32_t first, uint32_t count,
+                               const std::vector<uint32_t> &meshletVertices)
+  {
+    Meshlet meshlet;
+    meshlet.firstIndex = first;
+    meshlet.indexCount = count;
+
+    glm::vec3 lo = vertices[meshletVertices[0]].position, hi = lo;
+    for (uint32_t v : meshletVertices)
+    {
+      lo = glm::min(lo, vertices[v].position);
+      hi = glm::max(hi, vertices[v].position);
+    }
+    meshlet.center = (lo + hi) * 0.5f;
+    float radius2 = 0.0f;
+    for (uint32_t v : meshletVertices)
+    {
+      glm::vec3 d = vertices[v].position - meshlet.center;
+      radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radius2);
+
+    // area-weighted mean normal as the axis; the widest triangle normal sets the angle
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = 0; i < count; i += 3)
+      sum += triangleNormal(vertices, &order[first + i]);
+    float sumLength = glm::length(sum);
+    if (sumLength <= 1e-12f)
+      return meshlet;
+    meshlet.coneAxis = sum / sumLength;
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < count; i += 3)
+    {
+      glm::vec3 n = triangleNormal(vertices, &order[first + i]);
+      float length = glm::length(n);
+      if (length > 1e-12f)
+        minDot = std::min(minDot, glm::dot(n / length, meshlet.coneAxis));
+    }
+    if (minDot > 0.0f)
+      meshlet.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+    return meshlet;
+  }
+}
+
+// Splits the triangles of `range` (normally LOD 0) into meshlets and rewrites that part of
+// `indices` so every meshlet is contiguous. Returns the meshlets in index order.
+inline std::vector<Meshlet> buildMeshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, const MeshLod &range)
+{
+  using namespace meshlet_detail;
+  std::vector<Meshlet> meshlets;
+  size_t triangleCount = range.indexCount / 3;
+  if (triangleCount == 0 || vertices.empty())
+    return meshlets;
+  const unsigned int *source = indices.data() + range.firstIndex;
+
+  // vertex -> triangles, compressed rows
+  std::vector<uint32_t> adjacencyStart(vertices.size() + 1, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++)
+    adjacencyStart[source[i] + 1]++;
+  for (size_t v = 0; v < vertices.size(); v++)
+    adjacencyStart[v + 1] += adjacencyStart[v];
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+      adjacency[fill[source[i]]++] = (uint32_t)(i / 3);
+  }
+  std::vector<glm::vec3> normals(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    glm::vec3 n = triangleNormal(vertices, source + t * 3);
+    float length = glm::length(n);
+    normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+  }
+
+  std::vector<unsigned int> order;
+  order.reserve(triangleCount * 3);
+  std::vector<uint8_t> emitted(triangleCount, 0);
+  std::vector<uint32_t> candidateStamp(triangleCount, 0);
+  std::vector<uint32_t> vertexStamp(vertices.size(), 0);
+  std::vector<uint32_t> meshletVertices, candidates;
+  size_t emittedCount = 0, seedCursor = 0;
+  uint32_t stamp = 0;
+
+  while (emittedCount < triangleCount)
+  {
+    stamp++;
+    meshletVertices.clear();
+    candidates.clear();
+    uint32_t first = (uint32_t)order.size();
+    glm::vec3 normalSum(0.0f);
+
+    auto newVertices = [&](uint32_t t)
+    {
+      int count = 0;
+      for (int k = 0; k < 3; k++)
+        count += vertexStamp[source[t * 3 + k]] != stamp;
+      return count;
+    };
+    auto addTriangle = [&](uint32_t t)
+    {
+      for (int k = 0; k < 3; k++)
+      {
+        uint32_t v = source[t * 3 + k];
+        order.push_back(v);
+        if (vertexStamp[v] == stamp)
+          continue;
+        vertexStamp[v] = stamp;
+        meshletVertices.push_back(v);
+        for (uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; a++)
+        {
+          uint32_t neighbour = adjacency[a];
+          if (!emitted[neighbour] && candidateStamp[neighbour] != stamp)
+          {
+            candidateStamp[neighbour] = stamp;
+            candidates.push_back(neighbour);
+          }
+        }
+      }
+      emitted[t] = 1;
+      emittedCount++;
+      normalSum += normals[t];
+    };
+
+    while (emitted[seedCursor])
+      seedCursor++;
+    addTriangle((uint32_t)seedCursor);
+
+    while ((order.size() - first) / 3 < MESHLET_MAX_TRIANGLES)
+    {
+      // fewest new vertices first, then the best fit with the cluster's facing
+      glm::vec3 facing = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+      candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t t)
+                                      { return emitted[t] != 0; }),
+                       candidates.end());
+      float bestCost = 1e30f;
+      size_t best = candidates.size();
+      for (size_t c = 0; c < candidates.size(); c++)
+      {
+        uint32_t t = candidates[c];
+        int added = newVertices(t);
+        if (meshletVertices.size() + added <= MESHLET_MAX_VERTICES)
+        {
+          float cost = (float)added + (1.0f - glm::dot(normals[t], facing));
+          if (cost < bestCost)
+          {
+            bestCost = cost;
+            best = c;
+          }
+        }
+      }
+      if (best == candidates.size())
+      {
+        // nothing connected fits: top up a nearly empty cluster with the next triangle in order,
+        // otherwise close it
+        if ((order.size() - first) / 3 >= MESHLET_MAX_TRIANGLES / 4 || meshletVertices.size() + 3 > MESHLET_MAX_VERTICES ||
+            emittedCount == triangleCount)
+          break;
+        while (emitted[seedCursor])
+          seedCursor++;
+        addTriangle((uint32_t)seedCursor);
+        continue;
+      }
+      uint32_t t = candidates[best];
+      candidates[best] = candidates.back();
+      candidates.pop_back();
+      addTriangle(t);
+    }
+
+    meshlets.push_back(finishMeshlet(vertices, order, first, (uint32_t)(order.size() - first), meshletVertices));
+  }
+
+  std::copy(order.begin(), order.end(), indices.begin() + range.firstIndex);
+  for (Meshlet &meshlet : meshlets)
+    meshlet.firstIndex += range.firstIndex;
+  return meshlets;
+}
+
+namespace culling
+{
+  inline bool meshletVisible(const MeshletCullView &view, const MeshletSoA &m, size_t i, bool &coneCulled)
+  {
+    coneCulled = false;
+    if (view.frustum)
+      for (const glm::vec4 &plane : view.planes)
+        if (plane.x * m.cx[i] + plane.y * m.cy[i] + plane.z * m.cz[i] + plane.w < -m.radius[i])
+          return false;
+    if (view.cone)
+    {
+      float dx = m.cx[i] - view.eye.x, dy = m.cy[i] - view.eye.y, dz = m.cz[i] - view.eye.z;
+      float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+      if (dx * m.ax[i] + dy * m.ay[i] + dz * m.az[i] >= m.cutoff[i] * distance + m.radius[i])
+      {
+        coneCulled = true;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  inline void countMeshlet(const MeshletSoA &m, size_t i, bool visible, bool coneCulled, MeshletCullStats *stats)
+  {
+    if (!stats)
+      return;
+    stats->meshlets++;
+    stats->triangles += m.triangles[i];
+    if (visible)
+      stats->meshletsVisible++;
+    else if (coneCulled)
+      stats->coneCulledTriangles += m.triangles[i];
+    else
+      stats->frustumCulledTriangles += m.triangles[i];
+  }
+}
+
+// Appends the indices of the meshlets that survive `view` to `visible`; returns how many.
+inline size_t cullMeshletsScalar(const MeshletCullView &view, const MeshletSoA &meshlets, std::vector<uint32_t> &visible,
+                                 MeshletCullStats *stats = nullptr)
+{
+  size_t before = visible.size();
+  for (size_t i = 0; i < meshlets.size(); i++)
+  {
+    bool coneCulled;
+    bool keep = culling::meshletVisible(view, meshlets, i, coneCulled);
+    if (keep)
+      visible.push_back((uint32_t)i);
+    culling::countMeshlet(meshlets, i, keep, coneCulled, stats);
+  }
+  return visible.size() - before;
+}
+
+inline size_t cullMeshlets(const MeshletCullView &view, const MeshletSoA &meshlets, std::vector<uint32_t> &visible,
+                           MeshletCullStats *stats = nullptr)
+{
+  size_t before = visible.size();
+  size_t count = meshlets.size();
+  size_t i = 0;
+
+#if defined(FRUSTUM_CULLING_AVX)
+  __m256 planeN[FRUSTUM_PLANE_COUNT][3], planeD[FRUSTUM_PLANE_COUNT];
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+  {
+    for (int a = 0; a < 3; a++)
+      planeN[p][a] = _mm256_set1_ps(view.planes[p][a]);
+    planeD[p] = _mm256_set1_ps(view.planes[p].w);
+  }
+  const __m256 eyeX = _mm256_set1_ps(view.eye.x), eyeY = _mm256_set1_ps(view.eye.y), eyeZ = _mm256_set1_ps(view.eye.z);
+  const __m256 allSet = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256 cx = _mm256_loadu_ps(&meshlets.cx[i]), cy = _mm256_loadu_ps(&meshlets.cy[i]), cz = _mm256_loadu_ps(&meshlets.cz[i]);
+    __m256 radius = _mm256_loadu_ps(&meshlets.radius[i]);
+    __m256 inside = allSet;
+    if (view.frustum)
+    {
+      __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+      for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+      {
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeN[p][0], cx), _mm256_mul_ps(planeN[p][1], cy)),
+                                                      _mm256_mul_ps(planeN[p][2], cz)),
+                                        planeD[p]);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+      }
+    }
+    __m256 facing = allSet;
+    if (view.cone)
+    {
+      __m256 dx = _mm256_sub_ps(cx, eyeX), dy = _mm256_sub_ps(cy, eyeY), dz = _mm256_sub_ps(cz, eyeZ);
+      __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+      __m256 along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(&meshlets.ax[i])), _mm256_mul_ps(dy, _mm256_loadu_ps(&meshlets.ay[i]))),
+                                   _mm256_mul_ps(dz, _mm256_loadu_ps(&meshlets.az[i])));
+      __m256 limit = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&meshlets.cutoff[i]), distance), radius);
+      facing = _mm256_cmp_ps(along, limit, _CMP_LT_OQ);
+    }
+    int insideMask = _mm256_movemask_ps(inside);
+    int visibleMask = insideMask & _mm256_movemask_ps(facing);
+    for (int lane = 0; lane < 8; lane++)
+    {
+      bool keep = (visibleMask >> lane) & 1;
+      if (keep)
+        visible.push_back((uint32_t)(i + lane));
+      culling::countMeshlet(meshlets, i + lane, keep, ((insideMask >> lane) & 1) != 0, stats);
+    }
+  }
+#elif defined(FRUSTUM_CULLING_SSE)
+  __m128 planeN[FRUSTUM_PLANE_COUNT][3], planeD[FRUSTUM_PLANE_COUNT];
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+  {
+    for (int a = 0; a < 3; a++)
+      planeN[p][a] = _mm_set1_ps(view.planes[p][a]);
+    planeD[p] = _mm_set1_ps(view.planes[p].w);
+  }
+  const __m128 eyeX = _mm_set1_ps(view.eye.x), eyeY = _mm_set1_ps(view.eye.y), eyeZ = _mm_set1_ps(view.eye.z);
+  const __m128 allSet = _mm_castsi128_ps(_mm_set1_epi32(-1));
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 cx = _mm_loadu_ps(&meshlets.cx[i]), cy = _mm_loadu_ps(&meshlets.cy[i]), cz = _mm_loadu_ps(&meshlets.cz[i]);
+    __m128 radius = _mm_loadu_ps(&meshlets.radius[i]);
+    __m128 inside = allSet;
+    if (view.frustum)
+    {
+      __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+      for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+      {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeN[p][0], cx), _mm_mul_ps(planeN[p][1], cy)),
+                                                _mm_mul_ps(planeN[p][2], cz)),
+                                     planeD[p]);
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+      }
+    }
+    __m128 facing = allSet;
+    if (view.cone)
+    {
+      __m128 dx = _mm_sub_ps(cx, eyeX), dy = _mm_sub_ps(cy, eyeY), dz = _mm_sub_ps(cz, eyeZ);
+      __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+      __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&meshlets.ax[i])), _mm_mul_ps(dy, _mm_loadu_ps(&meshlets.ay[i]))),
+                                _mm_mul_ps(dz, _mm_loadu_ps(&meshlets.az[i])));
+      __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&meshlets.cutoff[i]), distance), radius);
+      facing = _mm_cmplt_ps(along, limit);
+    }
+    int insideMask = _mm_movemask_ps(inside);
+    int visibleMask = insideMask & _mm_movemask_ps(facing);
+    for (int lane = 0; lane < 4; lane++)
+    {
+      bool keep = (visibleMask >> lane) & 1;
+      if (keep)
+        visible.push_back((uint32_t)(i + lane));
+      culling::countMeshlet(meshlets, i + lane, keep, ((insideMask >> lane) & 1) != 0, stats);
+    }
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    bool coneCulled;
+    bool keep = culling::meshletVisible(view, meshlets, i, coneCulled);
+    if (keep)
+      visible.push_back((uint32_t)i);
+    culling::countMeshlet(meshlets, i, keep, coneCulled, stats);
+  }
+  return visible.size() - before;
+}
+
+#endif // MESHLET_H
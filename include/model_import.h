@@ -0,0 +1,228 @@
+#ifndef MODEL_IMPORT_H
+#define MODEL_IMPORT_H
+
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "mesh_optimize.h"
+#include "vertex_layout.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define FALLBACK_TEXTURE_PATH "data/textures/FALLBACK.png"
+
+// A texture a mesh refers to, before anything is decoded or uploaded.
+// `path` is relative to the model directory, or FALLBACK_TEXTURE_PATH.
+struct TextureRef
+{
+  std::string type;
+  std::string path;
+};
+
+// CPU-only result of importing one mesh. Shared by Model (runtime) and the offline cooker.
+// `indices` holds every LOD back to back; `lods` are the ranges, LOD 0 first. LOD 0 is ordered
+// meshlet by meshlet. Vertices are deduplicated and in first-use order (see mesh_optimize.h).
+struct ImportedMesh
+{
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  std::vector<TextureRef> textures;
+  std::vector<MeshLod> lods;
+  std::vector<Meshlet> meshlets;
+  MeshOptimizeStats optimization;
+};
+
+// Runs Assimp and flattens the node hierarchy into ImportedMeshes. Makes no GL calls.
+class ModelImporter
+{
+public:
+  // returns false (and leaves `meshes` empty) if Assimp could not read the file
+  static bool import(const std::string &path, std::vector<ImportedMesh> &meshes)
+  {
+    // read file via ASSIMP
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+    // check for errors
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+    {
+      std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+      return false;
+    }
+    // process ASSIMP's root node recursively
+    processNode(scene->mRootNode, scene, meshes);
+    return true;
+  }
+
+private:
+  // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+  static void processNode(aiNode *node, const aiScene *scene, std::vector<ImportedMesh> &meshes)
+  {
+    // process each mesh located at the current node
+    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+    {
+      // the node object only contains indices to index the actual objects in the scene.
+      // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+      aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+      meshes.push_back(processMesh(mesh, scene));
+    }
+    // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+      processNode(node->mChildren[i], scene, meshes);
+    }
+  }
+
+  static ImportedMesh processMesh(aiMesh *mesh, const aiScene *scene)
+  {
+    // data to fill
+    ImportedMesh result;
+    std::vector<Vertex> &vertices = result.vertices;
+    std::vector<unsigned int> &indices = result.indices;
+    std::vector<TextureRef> &textures = result.textures;
+
+    // walk through each of the mesh's vertices
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    {
+      Vertex vertex;
+      // Initialize all fields to prevent garbage data
+      vertex.position = glm::vec3(0.0f);
+      vertex.normal = glm::vec3(0.0f);
+      vertex.texCoords = glm::vec2(0.0f);
+      vertex.tangent = glm::vec3(0.0f);
+      vertex.bitangent = glm::vec3(0.0f);
+      // Initialize bone data
+      for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+      {
+        vertex.m_BoneIDs[j] = -1;
+        vertex.m_Weights[j] = 0.0f;
+      }
+
+      glm::vec3 vector;
+      // positions
+      vector.x = mesh->mVertices[i].x;
+      vector.y = mesh->mVertices[i].y;
+      vector.z = mesh->mVertices[i].z;
+      vertex.position = vector;
+
+      // normals
+      if (mesh->HasNormals())
+      {
+        vector.x = mesh->mNormals[i].x;
+        vector.y = mesh->mNormals[i].y;
+        vector.z = mesh->mNormals[i].z;
+        vertex.normal = vector;
+      }
+
+      // texture coordinates
+      if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+      {
+        glm::vec2 vec;
+        vec.x = mesh->mTextureCoords[0][i].x;
+        vec.y = mesh->mTextureCoords[0][i].y;
+        vertex.texCoords = vec;
+
+        // Only set tangents/bitangents if they exist
+        if (mesh->mTangents)
+        {
+          vector.x = mesh->mTangents[i].x;
+          vector.y = mesh->mTangents[i].y;
+          vector.z = mesh->mTangents[i].z;
+          vertex.tangent = vector;
+        }
+        else
+        {
+          vertex.tangent = glm::vec3(0.0f);
+        }
+
+        if (mesh->mBitangents)
+        {
+          vector.x = mesh->mBitangents[i].x;
+          vector.y = mesh->mBitangents[i].y;
+          vector.z = mesh->mBitangents[i].z;
+          vertex.bitangent = vector;
+        }
+        else
+        {
+          vertex.bitangent = glm::vec3(0.0f);
+        }
+      }
+      else
+        vertex.texCoords = glm::vec2(0.0f, 0.0f);
+
+      vertices.push_back(vertex);
+    }
+    // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    {
+      aiFace face = mesh->mFaces[i];
+      // retrieve all indices of the face and store them in the indices vector
+      for (unsigned int j = 0; j < face.mNumIndices; j++)
+        indices.push_back(face.mIndices[j]);
+    }
+    // process materials
+    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+    // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+    // Same applies to other texture as the following list summarizes:
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+
+    // 1. diffuse maps
+    collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
+    // 2. specular maps
+    collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
+    // 3. normal maps
+    collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
+    // 4. height maps
+    collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
+
+    // Add PBR maps (if authoring tool exported them)
+    // albedo maps
+    collectMaterialTextures(material, aiTextureType_METALNESS, "texture_metallic", textures);
+    // roughness maps
+    collectMaterialTextures(material, aiTextureType_DIFFUSE_ROUGHNESS, "texture_roughness", textures);
+    // ambient occlusion maps
+    collectMaterialTextures(material, aiTextureType_AMBIENT_OCCLUSION, "texture_ao", textures);
+    // emissive maps
+    collectMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emissive", textures);
+
+    // Fallback texture for the samplers the forward shader always reads. Material-based shaders
+    // do not need these; the other slots fall back to the material's scalar factors.
+    auto ensureType = [&](const char *typeName)
+    {
+      for (auto &t : textures)
+        if (t.type == typeName)
+          return;
+      textures.push_back({typeName, FALLBACK_TEXTURE_PATH});
+    };
+    ensureType("texture_diffuse");
+    ensureType("texture_specular");
+
+    // vertex cache and overdraw order first, so LOD 0 and the simplifier start from it
+    result.optimization = optimizeMesh(vertices, indices);
+    result.lods = buildMeshLods(vertices, indices);
+    // reorders LOD 0 only, so the LOD ranges stay valid
+    result.meshlets = buildMeshlets(vertices, indices, result.lods[0]);
+    optimizeMeshLevels(vertices, indices, result.lods, result.meshlets, result.optimization);
+    return result;
+  }
+
+  static void collectMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, std::vector<TextureRef> &textures)
+  {
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    {
+      aiString str;
+      mat->GetTexture(type, i, &str);
+      textures.push_back({typeName, str.C_Str()});
+    }
+  }
+};
+
+#endif // MODEL_IMPORT_H
@@ -0,0 +1,291 @@
+#ifndef MODEL_INSTANCES_H
+#define MODEL_INSTANCES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "buffers.h"
+#include "frustum_culling.h"
+#include "gl_state_cache.h"
+#include "material.h"
+#include "mesh_lod.h"
+#include "model.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Many copies of one Model, drawn with instancing.
+//
+// Each instance is a model matrix plus its normal matrix (inverse transpose, computed once on the
+// CPU when the transform is set) in an SSBO. Only the range of instances touched since the last
+// update() is re-uploaded. Every frame update() frustum-culls the instances' world boxes, picks a
+// LOD per mesh and instance with the render queue's screen-space error rule, and uploads the
+// visible instance indices grouped by (mesh, LOD). draw() then issues one
+// glDrawElementsInstancedBaseVertex per mesh and LOD in use; the vertex shader
+// (deferred_instanced.vs, model_instanced.vs) finds its instance through
+// visibleInstances[uInstanceOffset + gl_InstanceID], which works on GL 4.3 without
+// gl_BaseInstance.
+
+// must match the buffer bindings in deferred_instanced.vs and model_instanced.vs
+enum ModelInstanceStorageBinding
+{
+  SSBO_BINDING_MODEL_INSTANCES = 12,
+  SSBO_BINDING_MODEL_INSTANCE_INDICES = 13,
+};
+
+// std430, mirrored by ModelInstance in the instanced vertex shaders
+struct GpuModelInstance
+{
+  glm::mat4 model;
+  glm::vec4 normalMatrix[3]; // mat3 columns, each padded to a vec4
+};
+
+struct ModelInstanceStats
+{
+  unsigned int instances = 0;
+  unsigned int visible = 0;
+  unsigned int draws = 0;             // instanced calls by the last draw()
+  unsigned int triangles = 0;         // summed over visible instances
+  unsigned int uploadedInstances = 0; // transforms re-uploaded by the last update()
+  unsigned int lodInstances[MESH_MAX_LODS] = {}; // visible (mesh, instance) pairs per LOD
+};
+
+class ModelInstanceSet
+{
+public:
+  explicit ModelInstanceSet(Model &instancedModel) : model(instancedModel)
+  {
+    for (size_t m = 0; m < model.meshes.size(); m++)
+      localBounds = m == 0 ? model.meshes[m].bounds : mergeAABB(localBounds, model.meshes[m].bounds);
+  }
+
+  ModelInstanceSet(const ModelInstanceSet &) = delete;
+  ModelInstanceSet &operator=(const ModelInstanceSet &) = delete;
+
+  ~ModelInstanceSet() { release(); }
+
+  // GL thread, before the context goes away; update() recreates the buffers if used again
+  void release()
+  {
+    for (StorageBuffer *buffer : {&instanceBuffer, &indexBuffer})
+      if (buffer->id)
+      {
+        glDeleteBuffers(1, &buffer->id);
+        *buffer = StorageBuffer();
+      }
+  }
+
+  void reserve(size_t count)
+  {
+    instances.reserve(count);
+    transforms.reserve(count);
+    scales.reserve(count);
+    boxes.reserve(count);
+  }
+
+  uint32_t add(const glm::mat4 &transform)
+  {
+    instances.emplace_back();
+    transforms.emplace_back();
+    scales.emplace_back();
+    boxes.push(AABB{glm::vec3(0.0f), glm::vec3(0.0f)});
+    uint32_t index = (uint32_t)(instances.size() - 1);
+    setTransform(index, transform);
+    return index;
+  }
+
+  void setTransform(uint32_t index, const glm::mat4 &transform)
+  {
+    glm::mat3 normal = normalMatrix(transform);
+    GpuModelInstance &instance = instances[index];
+    instance.model = transform;
+    for (int c = 0; c < 3; c++)
+      instance.normalMatrix[c] = glm::vec4(normal[c], 0.0f);
+    transforms[index] = transform;
+    scales[index] = maxAxisScale(transform);
+    AABB world = transformAABB(localBounds, transform);
+    glm::vec3 center = world.center(), extents = world.extents();
+    boxes.cx[index] = center.x, boxes.cy[index] = center.y, boxes.cz[index] = center.z;
+    boxes.ex[index] = extents.x, boxes.ey[index] = extents.y, boxes.ez[index] = extents.z;
+    dirtyBegin = std::min(dirtyBegin, (size_t)index);
+    dirtyEnd = std::max(dirtyEnd, (size_t)index + 1);
+  }
+
+  void clear()
+  {
+    instances.clear();
+    transforms.clear();
+    scales.clear();
+    boxes.clear();
+    dirtyBegin = SIZE_MAX;
+    dirtyEnd = 0;
+  }
+
+  size_t size() const { return instances.size(); }
+  const glm::mat4 &transform(uint32_t index) const { return transforms[index]; }
+
+  // Once a frame before draw(), GL thread: uploads changed transforms, culls (without a frustum
+  // everything is visible) and groups the visible instances by mesh and LOD.
+  void update(const Frustum *frustum, const LodSelection &selection)
+  {
+    if (!instanceBuffer.id)
+    {
+      instanceBuffer.init((GLsizeiptr)sizeof(GpuModelInstance) * 64, SSBO_BINDING_MODEL_INSTANCES);
+      indexBuffer.init((GLsizeiptr)sizeof(GLuint) * 64, SSBO_BINDING_MODEL_INSTANCE_INDICES);
+    }
+    frameStats = ModelInstanceStats();
+    frameStats.instances = (unsigned int)instances.size();
+
+    GLsizeiptr needed = (GLsizeiptr)(instances.size() * sizeof(GpuModelInstance));
+    if (needed > instanceBuffer.capacity)
+    {
+      // growing orphans the store: everything goes up again
+      instanceBuffer.reserve(needed);
+      dirtyBegin = 0;
+      dirtyEnd = instances.size();
+    }
+    if (dirtyBegin < dirtyEnd)
+    {
+      instanceBuffer.uploadRange(&instances[dirtyBegin], (GLintptr)(dirtyBegin * sizeof(GpuModelInstance)),
+                                 (GLsizeiptr)((dirtyEnd - dirtyBegin) * sizeof(GpuModelInstance)));
+      frameStats.uploadedInstances = (unsigned int)(dirtyEnd - dirtyBegin);
+    }
+    dirtyBegin = SIZE_MAX;
+    dirtyEnd = 0;
+
+    visible.clear();
+    if (frustum)
+      cullAABBs(*frustum, boxes, visible);
+    else
+    {
+      visible.resize(instances.size());
+      for (size_t i = 0; i < visible.size(); i++)
+        visible[i] = (uint32_t)i;
+    }
+    frameStats.visible = (unsigned int)visible.size();
+
+    // counting sort of (mesh, LOD) per visible instance into one index list
+    size_t meshCount = model.meshes.size();
+    runs.assign(meshCount * MESH_MAX_LODS, Run());
+    lodOf.resize(visible.size() * meshCount);
+    for (size_t v = 0; v < visible.size(); v++)
+    {
+      uint32_t i = visible[v];
+      for (size_t m = 0; m < meshCount; m++)
+      {
+        const Mesh &mesh = model.meshes[m];
+        uint32_t lod = 0;
+        if (mesh.lods.size() > 1)
+        {
+          BoundingSphere sphere{glm::vec3(transforms[i] * glm::vec4(mesh.sphere.center, 1.0f)), mesh.sphere.radius * scales[i]};
+          lod = selectLod(mesh.lods, sphere, scales[i], selection);
+        }
+        lodOf[v * meshCount + m] = (uint8_t)lod;
+        runs[m * MESH_MAX_LODS + lod].count++;
+      }
+    }
+    uint32_t offset = 0;
+    for (Run &run : runs)
+    {
+      run.first = offset;
+      offset += run.count;
+      run.count = 0;
+    }
+    visibleIndices.resize(offset);
+    for (size_t v = 0; v < visible.size(); v++)
+      for (size_t m = 0; m < meshCount; m++)
+      {
+        Run &run = runs[m * MESH_MAX_LODS + lodOf[v * meshCount + m]];
+        visibleIndices[run.first + run.count++] = visible[v];
+      }
+    indexBuffer.upload(visibleIndices);
+
+    for (size_t m = 0; m < meshCount; m++)
+      for (uint32_t lod = 0; lod < model.meshes[m].lods.size() && lod < MESH_MAX_LODS; lod++)
+      {
+        uint32_t count = runs[m * MESH_MAX_LODS + lod].count;
+        frameStats.lodInstances[lod] += count;
+        frameStats.triangles += count * (model.meshes[m].lods[lod].indexCount / 3);
+      }
+  }
+
+  // One instanced draw per (mesh, LOD) with visible instances. `shader` is deferred_instanced.vs
+  // or model_instanced.vs with the usual fragment shader; materials bind like in the render queue.
+  void draw(const Shader &shader, GLStateCache &state)
+  {
+    static constexpr UniformHandle uInstanceOffset("uInstanceOffset");
+    static constexpr UniformHandle uMaterialID("uMaterialID");
+
+    frameStats.draws = 0;
+    if (visibleIndices.empty())
+      return;
+    state.invalidate();
+    state.useProgram(shader.ID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_MODEL_INSTANCES, instanceBuffer.id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_MODEL_INSTANCE_INDICES, indexBuffer.id);
+    bool useLibrary = shader.hasUniform(uMaterialID);
+    if (useLibrary)
+      MaterialLibrary::instance().bind(shader, state);
+
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+      Mesh &mesh = model.meshes[m];
+      bool materialBound = false;
+      for (uint32_t lod = 0; lod < mesh.lods.size() && lod < MESH_MAX_LODS; lod++)
+      {
+        const Run &run = runs[m * MESH_MAX_LODS + lod];
+        if (run.count == 0)
+          continue;
+        if (!materialBound)
+        {
+          if (useLibrary && mesh.materialID != MESH_NO_MATERIAL)
+            shader.setInt(uMaterialID, (int)mesh.materialID);
+          else
+            mesh.bindMaterial(shader, state);
+          materialBound = true;
+        }
+        const MeshLod &range = mesh.lods[lod];
+        glUniform1ui(shader.getUniformLocation(uInstanceOffset), run.first);
+        state.bindVertexArray(mesh.vertexArray());
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, mesh.indexType, mesh.indexOffset(range.firstIndex),
+                                          (GLsizei)run.count, mesh.baseVertex());
+        state.counters.draws++;
+        state.counters.triangles += run.count * (range.indexCount / 3);
+        frameStats.draws++;
+      }
+    }
+    glBindVertexArray(0);
+    state.invalidate();
+  }
+
+  const ModelInstanceStats &stats() const { return frameStats; }
+
+private:
+  struct Run
+  {
+    uint32_t first = 0; // into visibleIndices
+    uint32_t count = 0;
+  };
+
+  Model &model;
+  AABB localBounds; // union of the meshes' bounds
+  std::vector<GpuModelInstance> instances;
+  std::vector<glm::mat4> transforms;
+  std::vector<float> scales; // maxAxisScale per transform
+  AABBSoA boxes;             // world space, refreshed by setTransform
+  size_t dirtyBegin = SIZE_MAX, dirtyEnd = 0;
+  StorageBuffer instanceBuffer;
+  StorageBuffer indexBuffer;
+
+  // per-frame scratch
+  std::vector<uint32_t> visible;
+  std::vector<uint8_t> lodOf;    // [visible * meshCount + mesh]
+  std::vector<Run> runs;         // [mesh * MESH_MAX_LODS + lod]
+  std::vector<uint32_t> visibleIndices;
+  ModelInstanceStats frameStats;
+};
+
+#endif // MODEL_INSTANCES_H
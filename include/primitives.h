@@ -2,18 +2,48 @@
 #define PRIMITIVES_H
 
 #include "mesh.h"
+#include "mesh_optimize.h"
+
+// Generated geometry goes through the same vertex cache / overdraw / fetch optimization as
+// imported meshes before it is uploaded.
+struct MeshGeometry
+{
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+};
+
+inline MeshGeometry optimizedGeometry(std::vector<Vertex> vertices, std::vector<unsigned int> indices)
+{
+  optimizeMesh(vertices, indices);
+  return {std::move(vertices), std::move(indices)};
+}
+
+// value-initialized, so tangents and bone data are zero rather than left out of an aggregate
+inline Vertex makeVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 texCoords)
+{
+  Vertex vertex{};
+  vertex.position = position;
+  vertex.normal = normal;
+  vertex.texCoords = texCoords;
+  return vertex;
+}
 
 class Plane : public Mesh
 {
 public:
   Plane(float width, float height, std::vector<Texture> textures)
-      : Mesh(generateVertices(width, height), generateIndices(), textures)
+      : Plane(optimizedGeometry(generateVertices(width, height), generateIndices()), textures)
   {
   }
 
 private:
+  Plane(MeshGeometry geometry, std::vector<Texture> textures)
+      : Mesh(std::move(geometry.vertices), std::move(geometry.indices), textures)
+  {
+  }
+
   // clang-format off
-  std::vector<Vertex> generateVertices(float width, float height)
+  static std::vector<Vertex> generateVertices(float width, float height)
   {
     return {
       {{-width / 2, 0.0f, -height / 2}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
@@ -23,7 +53,7 @@ private:
     };
   }
 
-  std::vector<unsigned int> generateIndices()
+  static std::vector<unsigned int> generateIndices()
   {
     return {
       0, 1, 2,
@@ -37,13 +67,18 @@ class RectangularPrism : public Mesh
 {
 public:
   RectangularPrism(float length, float width, float height, std::vector<Texture> textures)
-      : Mesh(generateVertices(length, width, height), generateIndices(), textures)
+      : RectangularPrism(optimizedGeometry(generateVertices(length, width, height), generateIndices()), textures)
   {
   }
 
 private:
+  RectangularPrism(MeshGeometry geometry, std::vector<Texture> textures)
+      : Mesh(std::move(geometry.vertices), std::move(geometry.indices), textures)
+  {
+  }
+
   // clang-format off
-  std::vector<Vertex> generateVertices(float length, float width, float height)
+  static std::vector<Vertex> generateVertices(float length, float width, float height)
   {
     return {
       // Bottom face
@@ -60,7 +95,7 @@ private:
     };
   }
 
-  std::vector<unsigned int> generateIndices()
+  static std::vector<unsigned int> generateIndices()
   {
     return {
       // Bottom face
@@ -95,12 +130,17 @@ class Sphere : public Mesh
 {
 public:
   Sphere(float radius, unsigned int sectorCount, unsigned int stackCount, std::vector<Texture> textures)
-      : Mesh(generateVertices(radius, sectorCount, stackCount), generateIndices(sectorCount, stackCount), textures)
+      : Sphere(optimizedGeometry(generateVertices(radius, sectorCount, stackCount), generateIndices(sectorCount, stackCount)), textures)
   {
   }
 
 private:
-  std::vector<Vertex> generateVertices(float radius, unsigned int sectorCount, unsigned int stackCount)
+  Sphere(MeshGeometry geometry, std::vector<Texture> textures)
+      : Mesh(std::move(geometry.vertices), std::move(geometry.indices), textures)
+  {
+  }
+
+  static std::vector<Vertex> generateVertices(float radius, unsigned int sectorCount, unsigned int stackCount)
   {
     std::vector<Vertex> vertices;
     for (unsigned int i = 0; i <= stackCount; ++i)
@@ -124,7 +164,7 @@ private:
     }
     return vertices;
   }
-  std::vector<unsigned int> generateIndices(unsigned int sectorCount, unsigned int stackCount)
+  static std::vector<unsigned int> generateIndices(unsigned int sectorCount, unsigned int stackCount)
   {
     std::vector<unsigned int> indices;
     for (unsigned int i = 0; i < stackCount; ++i)
@@ -152,190 +192,48 @@ private:
   }
 };
 
-/** MAZE IMPLEMENTATION FOR REFERENCE
-class Wall : public Mesh
-{
-public:
-  Wall(float width, float height, Shader shader)
-      : Mesh(generateVertices(width, height), generateIndices(), std::vector<Texture>(), shader)
-  {
-    // Additional setup for the wall if needed
-  }
-
-private:
-  // clang-format off
-  std::vector<Vertex> generateVertices(float width, float height)
-  {
-    // return {
-    //     -width / 2, 0.0f, -height / 2, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-    //     width / 2, 0.0f, -height / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-    //     width / 2, 0.0f, height / 2, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-    //     -width / 2, 0.0f, height / 2, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-    // };
-    return {
-      {{-width / 2, 0.0f, -height / 2}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-      {{ width / 2, 0.0f, -height / 2}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-      {{ width / 2, 0.0f,  height / 2}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-      {{-width / 2, 0.0f,  height / 2}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
-    };
-  }
-
-  std::vector<unsigned int> generateIndices()
-  {
-    return {
-      0, 1, 2,
-      2, 3, 0,
-    };
-  }
-  // clang-format on
-};
-
+// One unit-wide wall segment of the backrooms maze, instanced once per packed wall (see
+// maze_streaming.h). It spans x in [0, 1] and y in [0, height] at z = 0, with a back face so a
+// wall is stored once however it is seen; backrooms_wall.vs rotates and places each copy.
 class MazeWalls : public Mesh
 {
 public:
-  MazeWalls(float width, float height, std::vector<Texture> wallTextures, Shader shader)
-      : Mesh(generateVertices(width, height), generateIndices(), wallTextures, shader)
-  {
-    generateMazeWalls();
-    generateWallData();
-    setupInstancedMesh();
-  }
-
-  void DrawInstanced(Shader &shader)
-  {
-    if (wallData.empty())
-      return;
-
-    // Update instance buffer if needed
-    updateInstanceBuffer();
-
-    // Use the parent's instanced drawing method
-    Mesh::DrawInstanced(shader, wallData.size());
-  }
-
-  void addWall(uint8_t x, uint8_t z, uint8_t rotation = 0)
-  {
-    WallSegment segment;
-    segment.rotation = rotation & 0x03; // Ensure only 2 bits
-    segment.x = x & 0x7F;               // Ensure only 7 bits
-    segment.z = z & 0x7F;               // Ensure only 7 bits
-
-    uint16_t packedData = (segment.rotation & 0x03) << 14 |
-                          (segment.x & 0x7F) << 7 |
-                          (segment.z & 0x7F);
-    wallData.push_back(packedData);
-    instanceBufferNeedsUpdate = true;
-  }
-
-  void clearWalls()
+  explicit MazeWalls(float height)
+      : MazeWalls(optimizedGeometry(generateVertices(height), generateIndices()))
   {
-    wallData.clear();
-    instanceBufferNeedsUpdate = true;
   }
 
-  size_t getWallCount() const { return wallData.size(); }
-
 private:
-  // The maze buffer should have position and rotation data for each wall segment
-  // 2 bits for rotation (0, 90, 180, 270)
-  // 14 bits for position, 7 bits each for x and z (0-127)
-  // Total 16 bits = 2 bytes per wall segment
-  // This 128x128 area will be per chunk, and multiple chunks can be rendered
-  // together by combining their wall data buffers
-  std::vector<uint16_t> wallData;
-  unsigned int instanceVBO;
-  bool instanceBufferNeedsUpdate;
-
-  struct WallSegment
+  explicit MazeWalls(MeshGeometry geometry)
+      : Mesh(std::move(geometry.vertices), std::move(geometry.indices), std::vector<Texture>())
   {
-    uint8_t rotation; // 0, 1, 2, 3 for 0, 90, 180, 270 degrees
-    uint8_t x;        // 0-127
-    uint8_t z;        // 0-127
-  };
-
-  void generateWallData()
-  {
-    // Generate a simple test pattern - you can replace this with maze generation
-    wallData.clear();
-
-    // Create a simple room outline
-    for (int x = 0; x < 10; x++)
-    {
-      addWall(x, 0, 0); // Bottom wall
-      addWall(x, 9, 2); // Top wall
-    }
-    for (int z = 1; z < 9; z++)
-    {
-      addWall(0, z, 3); // Left wall
-      addWall(9, z, 1); // Right wall
-    }
   }
 
   // clang-format off
-  std::vector<Vertex> generateVertices(float width, float height)
+  static std::vector<Vertex> generateVertices(float height)
   {
-    // return {
-    //     -width / 2, 0.0f, -height / 2, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-    //     width / 2, 0.0f, -height / 2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-    //     width / 2, 0.0f, height / 2, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-    //     -width / 2, 0.0f, height / 2, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-    // };
     return {
-      {{-width / 2, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}}, // Bottom left
-      {{ width / 2, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}}, // Bottom right
-      {{ width / 2, height, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}}, // Top right
-      {{-width / 2, height, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}}, // Top left
+      makeVertex({0.0f, 0.0f,   0.0f}, {0.0f, 0.0f,  1.0f}, {0.0f, 0.0f}),
+      makeVertex({1.0f, 0.0f,   0.0f}, {0.0f, 0.0f,  1.0f}, {1.0f, 0.0f}),
+      makeVertex({1.0f, height, 0.0f}, {0.0f, 0.0f,  1.0f}, {1.0f, height}),
+      makeVertex({0.0f, height, 0.0f}, {0.0f, 0.0f,  1.0f}, {0.0f, height}),
+      makeVertex({1.0f, 0.0f,   0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}),
+      makeVertex({0.0f, 0.0f,   0.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}),
+      makeVertex({0.0f, height, 0.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, height}),
+      makeVertex({1.0f, height, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, height}),
     };
   }
 
-  std::vector<unsigned int> generateIndices()
+  static std::vector<unsigned int> generateIndices()
   {
     return {
       0, 1, 2,
       2, 3, 0,
+      4, 5, 6,
+      6, 7, 4,
     };
   }
-
-  void generateMazeWalls()
-  {
-    // Implementation for generating maze walls
-    // super basic square room for now
-  }
   // clang-format on
-
-  void setupInstancedMesh()
-  {
-    // Call parent setup first
-    setupMesh();
-
-    // Generate instance buffer
-    glGenBuffers(1, &instanceVBO);
-    instanceBufferNeedsUpdate = true;
-
-    // Bind VAO and setup instance attributes
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-
-    // Set up instance attribute (wall data)
-    glEnableVertexAttribArray(3);
-    glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(uint16_t), (void *)0);
-    glVertexAttribDivisor(3, 1); // One per instance
-
-    glBindVertexArray(0);
-  }
-
-  void updateInstanceBuffer()
-  {
-    if (!instanceBufferNeedsUpdate || wallData.empty())
-      return;
-
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, wallData.size() * sizeof(uint16_t),
-                 wallData.data(), GL_DYNAMIC_DRAW);
-
-    instanceBufferNeedsUpdate = false;
-  }
 };
-*/
 
 #endif // PRIMITIVES_H
\ No newline at end of file
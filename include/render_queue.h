@@ -0,0 +1,236 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_state_cache.h"
+#include "material.h"
+#include "mesh.h"
+#include "frustum_culling.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Draw items are collected per frame, sorted by a 64-bit key and then issued with redundant binds
+// dropped by a GLStateCache.
+//
+// Opaque key, most significant first:
+//   pass (4) | program (12) | material (16) | VAO (16) | depth (16, front to back)
+// Transparent items put depth (back to front) right after the pass so blending stays correct.
+// Program and VAO are GL names cut to their field width; a collision only affects grouping, since
+// execute() compares the real objects before rebinding anything. Meshes share the VAO of their
+// GeometryPool arena, so the VAO field groups draws by vertex layout and index type.
+//
+// Meshes with a materialID, drawn with a shader that declares uMaterialID, go through the
+// MaterialLibrary: its texture arrays are bound once per program and each draw only sets
+// uMaterialID. Everything else binds the mesh's own textures (Mesh::bindMaterial).
+//
+// Items drawn at LOD 0 from a clustered mesh are meshlet-culled at submit: only the surviving
+// meshlets are drawn, as runs of adjacent index ranges in one glMultiDrawElements, and an item
+// with none left is dropped. Transparent items skip the backface cone test.
+
+enum RenderPass
+{
+  RENDER_PASS_GEOMETRY = 0, // deferred G-buffer fill
+  RENDER_PASS_FORWARD = 1,  // opaque forward shading
+  RENDER_PASS_TRANSPARENT = 2,
+  RENDER_PASS_COUNT
+};
+
+struct DrawItem
+{
+  uint64_t key;
+  Mesh *mesh;
+  Shader *shader;
+  glm::mat4 transform;
+  glm::mat4 previousTransform; // last frame's, for motion vectors; equal to transform when static
+  uint32_t lod;
+  uint32_t firstRange; // into the queue's meshlet ranges; rangeCount 0 draws the whole LOD
+  uint32_t rangeCount;
+};
+
+class RenderQueue
+{
+public:
+  // view-space depth range mapped onto the 16-bit depth field
+  float depthRange = 100.0f;
+  // camera terms for per-item LOD selection; set every frame before submitting
+  LodSelection lodSelection;
+  // meshlet culling against this frustum and the begin() position; set every frame before submitting
+  MeshletCullSettings meshletCulling;
+  Frustum meshletFrustum;
+
+  // camera position for this frame's depth keys; also clears the queue
+  void begin(const glm::vec3 &viewPosition)
+  {
+    items.clear();
+    rangeCounts.clear();
+    rangeOffsets.clear();
+    rangeBaseVertices.clear();
+    frameMeshletStats = MeshletCullStats();
+    eyePosition = viewPosition;
+  }
+
+  // `previousTransform` is where the object was last frame (nullptr: it has not moved)
+  void submit(Mesh &mesh, Shader &shader, const glm::mat4 &transform, RenderPass pass, const glm::mat4 *previousTransform = nullptr)
+  {
+    float distance = glm::length(glm::vec3(transform[3]) - eyePosition);
+    uint64_t depth = (uint64_t)(std::clamp(distance / depthRange, 0.0f, 1.0f) * 65535.0f);
+
+    uint64_t key = (uint64_t)pass << 60;
+    uint64_t program = shader.ID & 0xFFF;
+    uint64_t material = mesh.materialID != MESH_NO_MATERIAL ? mesh.materialID & 0xFFFF : materialIndex(mesh.materialHash());
+    uint64_t vao = mesh.vertexArray() & 0xFFFF;
+    if (pass == RENDER_PASS_TRANSPARENT)
+      key |= (0xFFFF - depth) << 44 | program << 32 | material << 16 | vao;
+    else
+      key |= program << 48 | material << 32 | vao << 16 | depth;
+
+    uint32_t lod = 0;
+    if (mesh.lods.size() > 1)
+      lod = selectLod(mesh.lods, transformSphere(mesh.sphere, transform), maxAxisScale(transform), lodSelection);
+
+    uint32_t firstRange = (uint32_t)rangeCounts.size(), rangeCount = 0;
+    if (lod == 0 && !mesh.meshlets.empty() && meshletCulling.enabled)
+    {
+      MeshletCullSettings settings = meshletCulling;
+      settings.cone = settings.cone && pass != RENDER_PASS_TRANSPARENT;
+      MeshletCullView view = MeshletCullView::forTransform(meshletFrustum, eyePosition, transform, settings);
+      visibleMeshlets.clear();
+      if (cullMeshlets(view, mesh.meshletBounds, visibleMeshlets, &frameMeshletStats) == 0)
+        return;
+      // meshlets are back to back in the index buffer: consecutive survivors form one range
+      GLint baseVertex = mesh.baseVertex();
+      for (size_t i = 0; i < visibleMeshlets.size(); i++)
+      {
+        const Meshlet &meshlet = mesh.meshlets[visibleMeshlets[i]];
+        if (i > 0 && visibleMeshlets[i] == visibleMeshlets[i - 1] + 1)
+        {
+          rangeCounts.back() += (GLsizei)meshlet.indexCount;
+          continue;
+        }
+        rangeCounts.push_back((GLsizei)meshlet.indexCount);
+        rangeOffsets.push_back(mesh.indexOffset(meshlet.firstIndex));
+        rangeBaseVertices.push_back(baseVertex);
+      }
+      rangeCount = (uint32_t)rangeCounts.size() - firstRange;
+    }
+
+    items.push_back({key, &mesh, &shader, transform, previousTransform ? *previousTransform : transform, lod, firstRange, rangeCount});
+  }
+
+  void sort()
+  {
+    std::sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b)
+              { return a.key < b.key; });
+  }
+
+  // Issues every queued item of `pass` in key order. Per-pass state (framebuffer, blending, other
+  // uniforms) is the caller's job; the queue handles program, material textures, VAO, "model" and
+  // (when the shader declares them) "normalMatrix" and "previousModel".
+  void execute(RenderPass pass, GLStateCache &state)
+  {
+    static constexpr UniformHandle uModel("model");
+    static constexpr UniformHandle uNormalMatrix("normalMatrix");
+    static constexpr UniformHandle uPreviousModel("previousModel");
+    static constexpr UniformHandle uMaterialID("uMaterialID");
+
+    state.invalidate();
+    const Shader *lastShader = nullptr;
+    uint64_t lastMaterial = 0;
+    uint32_t lastMaterialID = MESH_NO_MATERIAL;
+    bool arraysBound = false;
+    bool haveTransform = false;
+    glm::mat4 lastTransform(1.0f);
+    glm::mat4 lastPreviousTransform(1.0f);
+
+    for (DrawItem &item : items)
+    {
+      if ((RenderPass)(item.key >> 60) != pass)
+        continue;
+
+      bool programChanged = state.useProgram(item.shader->ID) || item.shader != lastShader;
+      if (programChanged)
+      {
+        lastShader = item.shader;
+        haveTransform = false;
+        arraysBound = false;
+        lastMaterialID = MESH_NO_MATERIAL;
+      }
+      // shaders without uMaterialID (e.g. model.fs) keep using the mesh's own samplers
+      if (item.mesh->materialID != MESH_NO_MATERIAL && item.shader->hasUniform(uMaterialID))
+      {
+        if (!arraysBound)
+        {
+          MaterialLibrary::instance().bind(*item.shader, state);
+          arraysBound = true;
+        }
+        if (item.mesh->materialID != lastMaterialID)
+        {
+          item.shader->setInt(uMaterialID, (int)item.mesh->materialID);
+          lastMaterialID = item.mesh->materialID;
+          state.counters.uniformUploads++;
+        }
+      }
+      else if (programChanged || item.mesh->materialHash() != lastMaterial)
+      {
+        item.mesh->bindMaterial(*item.shader, state);
+        lastMaterial = item.mesh->materialHash();
+      }
+      if (!haveTransform || item.transform != lastTransform || item.previousTransform != lastPreviousTransform)
+      {
+        item.shader->setMat4(uModel, item.transform);
+        if (item.shader->hasUniform(uNormalMatrix))
+          item.shader->setMat3(uNormalMatrix, normalMatrix(item.transform));
+        if (item.shader->hasUniform(uPreviousModel))
+          item.shader->setMat4(uPreviousModel, item.previousTransform);
+        lastTransform = item.transform;
+        lastPreviousTransform = item.previousTransform;
+        haveTransform = true;
+        state.counters.uniformUploads++;
+      }
+      if (item.rangeCount)
+        item.mesh->drawRanges(state, &rangeCounts[item.firstRange], &rangeOffsets[item.firstRange], &rangeBaseVertices[item.firstRange],
+                              (GLsizei)item.rangeCount);
+      else
+        item.mesh->drawElements(state, item.lod);
+    }
+    glBindVertexArray(0);
+    state.invalidate();
+  }
+
+  size_t size() const { return items.size(); }
+  // meshlet culling of everything submitted since begin()
+  const MeshletCullStats &meshletStats() const { return frameMeshletStats; }
+
+private:
+  std::vector<DrawItem> items;
+  glm::vec3 eyePosition = glm::vec3(0.0f);
+  // surviving meshlet runs of all items: index counts, byte offsets and base vertices, as
+  // glMultiDrawElementsBaseVertex takes them
+  std::vector<GLsizei> rangeCounts;
+  std::vector<const void *> rangeOffsets;
+  std::vector<GLint> rangeBaseVertices;
+  std::vector<uint32_t> visibleMeshlets;
+  MeshletCullStats frameMeshletStats;
+  // 64-bit texture-set hashes interned to dense 16-bit indices for the key
+  std::unordered_map<uint64_t, uint16_t> materialIndices;
+
+  uint16_t materialIndex(uint64_t hash)
+  {
+    auto found = materialIndices.find(hash);
+    if (found != materialIndices.end())
+      return found->second;
+    uint16_t index = (uint16_t)materialIndices.size(); // wraps after 65536 sets; grouping only
+    materialIndices.emplace(hash, index);
+    return index;
+  }
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,216 @@
+#ifndef SCENE_INDEX_H
+#define SCENE_INDEX_H
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "frustum_culling.h"
+#include "mesh.h"
+#include "model.h"
+#include "render_queue.h"
+
+#include <cstdint>
+#include <vector>
+
+// Scene-wide spatial index: every placed mesh is a leaf in one DynamicAABBTree, keyed by a stable
+// object id. The renderer asks it for what the camera frustum touches, picking casts rays through
+// it, and moving an object only touches the tree when it leaves its fat box.
+
+#define SCENE_NO_OBJECT 0xFFFFFFFFu
+
+struct SceneObject
+{
+  Mesh *mesh = nullptr; // nullptr for a removed slot
+  glm::mat4 transform = glm::mat4(1.0f);
+  glm::mat4 previousTransform = glm::mat4(1.0f); // as of the last endFrame(), for motion vectors
+  AABB worldBox;        // exact world-space box; the tree holds a fattened copy
+  int proxy = BVH_NULL_NODE;
+};
+
+struct ScenePick
+{
+  uint32_t object = SCENE_NO_OBJECT;
+  float distance = 0.0f;
+};
+
+class SceneIndex
+{
+public:
+  DynamicAABBTree tree;
+  std::vector<SceneObject> objects;
+
+  uint32_t add(Mesh &mesh, const glm::mat4 &transform)
+  {
+    uint32_t id;
+    if (!freeIds.empty())
+    {
+      id = freeIds.back();
+      freeIds.pop_back();
+    }
+    else
+    {
+      id = (uint32_t)objects.size();
+      objects.emplace_back();
+    }
+    SceneObject &object = objects[id];
+    object.mesh = &mesh;
+    object.transform = transform;
+    object.previousTransform = transform;
+    object.worldBox = transformAABB(mesh.bounds, transform);
+    object.proxy = tree.insert(object.worldBox, id);
+    return id;
+  }
+
+  // one object per mesh; the model must outlive the index entries
+  void addModel(Model &model, const glm::mat4 &transform, std::vector<uint32_t> *ids = nullptr)
+  {
+    for (Mesh &mesh : model.meshes)
+    {
+      uint32_t id = add(mesh, transform);
+      if (ids)
+        ids->push_back(id);
+    }
+  }
+
+  void remove(uint32_t id)
+  {
+    SceneObject &object = objects[id];
+    if (!object.mesh)
+      return;
+    tree.remove(object.proxy);
+    object = SceneObject();
+    freeIds.push_back(id);
+  }
+
+  // previousTransform keeps last frame's value until endFrame()
+  void setTransform(uint32_t id, const glm::mat4 &transform)
+  {
+    SceneObject &object = objects[id];
+    if (object.transform == object.previousTransform)
+      moved.push_back(id);
+    object.transform = transform;
+    object.worldBox = transformAABB(object.mesh->bounds, transform);
+    tree.move(object.proxy, object.worldBox);
+  }
+
+  // after the frame's draws: objects moved this frame become the previous positions of the next
+  void endFrame()
+  {
+    for (uint32_t id : moved)
+      objects[id].previousTransform = objects[id].transform;
+    moved.clear();
+  }
+
+  void clear()
+  {
+    tree.clear();
+    objects.clear();
+    freeIds.clear();
+    moved.clear();
+  }
+
+  size_t size() const { return objects.size() - freeIds.size(); }
+
+  // ids of objects whose exact world box intersects the frustum
+  void collectVisible(const Frustum &frustum, std::vector<uint32_t> &visible) const
+  {
+    tree.queryFrustum(frustum, [&](int proxy)
+                      {
+                        uint32_t id = tree.userData(proxy);
+                        if (frustum.intersects(objects[id].worldBox))
+                          visible.push_back(id); });
+  }
+
+  // Queues every object for `pass`, or with a frustum only the visible ones.
+  void submit(RenderQueue &queue, Shader &shader, RenderPass pass, const Frustum *frustum = nullptr, CullingStats *stats = nullptr)
+  {
+    visibleScratch.clear();
+    if (frustum)
+      collectVisible(*frustum, visibleScratch);
+    else
+      for (uint32_t id = 0; id < objects.size(); id++)
+        if (objects[id].mesh)
+          visibleScratch.push_back(id);
+
+    for (uint32_t id : visibleScratch)
+      queue.submit(*objects[id].mesh, shader, objects[id].transform, pass, &objects[id].previousTransform);
+    if (stats)
+    {
+      stats->tested += (unsigned int)size();
+      stats->visible += (unsigned int)visibleScratch.size();
+    }
+  }
+
+  // Nearest object hit by the ray. Meshes that kept their CPU vertices are tested per triangle;
+  // meshes built from packed cache data only have their box to go on.
+  ScenePick pick(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance = 1000.0f) const
+  {
+    ScenePick result;
+    glm::vec3 inverse = 1.0f / direction;
+    tree.raycast(origin, direction, maxDistance, [&](int proxy, float)
+                 {
+                   uint32_t id = tree.userData(proxy);
+                   const SceneObject &object = objects[id];
+                   float distance;
+                   if (!DynamicAABBTree::rayHitsBox(origin, inverse, object.worldBox, maxDistance, distance))
+                     return maxDistance;
+                   if (!object.mesh->vertices.empty() && !object.mesh->indices.empty() &&
+                       !rayHitsMesh(*object.mesh, object.transform, origin, direction, maxDistance, distance))
+                     return maxDistance;
+                   result.object = id;
+                   result.distance = distance;
+                   maxDistance = distance;
+                   return maxDistance; });
+    return result;
+  }
+
+private:
+  std::vector<uint32_t> freeIds;
+  std::vector<uint32_t> moved; // ids whose transform changed since the last endFrame()
+  std::vector<uint32_t> visibleScratch;
+
+  // nearest triangle hit (Moller-Trumbore) in the mesh's local space; distances stay in world units
+  // because the ray direction is transformed without renormalising
+  static bool rayHitsMesh(const Mesh &mesh, const glm::mat4 &transform, const glm::vec3 &origin, const glm::vec3 &direction,
+                          float maxDistance, float &distance)
+  {
+    glm::mat4 toLocal = glm::inverse(transform);
+    glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+
+    bool hit = false;
+    float nearest = maxDistance;
+    // LOD 0 only; the coarser levels follow it in the same index list
+    const MeshLod &lod = mesh.lods[0];
+    for (size_t i = lod.firstIndex; i + 2 < (size_t)lod.firstIndex + lod.indexCount; i += 3)
+    {
+      const glm::vec3 &a = mesh.vertices[mesh.indices[i]].position;
+      const glm::vec3 &b = mesh.vertices[mesh.indices[i + 1]].position;
+      const glm::vec3 &c = mesh.vertices[mesh.indices[i + 2]].position;
+      glm::vec3 edge1 = b - a, edge2 = c - a;
+      glm::vec3 p = glm::cross(localDirection, edge2);
+      float det = glm::dot(edge1, p);
+      if (std::fabs(det) < 1e-12f)
+        continue;
+      float invDet = 1.0f / det;
+      glm::vec3 s = localOrigin - a;
+      float u = glm::dot(s, p) * invDet;
+      if (u < 0.0f || u > 1.0f)
+        continue;
+      glm::vec3 q = glm::cross(s, edge1);
+      float v = glm::dot(localDirection, q) * invDet;
+      if (v < 0.0f || u + v > 1.0f)
+        continue;
+      float t = glm::dot(edge2, q) * invDet;
+      if (t >= 0.0f && t < nearest)
+      {
+        nearest = t;
+        hit = true;
+      }
+    }
+    distance = nearest;
+    return hit;
+  }
+};
+
+#endif // SCENE_INDEX_H
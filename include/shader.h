@@ -9,8 +9,34 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
 #include <filesystem>
 
+// 64-bit FNV-1a over a uniform name. constexpr so handles for literal names are folded at compile time.
+constexpr uint64_t hashUniformName(std::string_view name)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : name)
+  {
+    hash ^= (uint64_t)(unsigned char)c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// A pre-hashed uniform name. Handles stay valid across Shader::reload() since they are resolved
+// against the shader's reflected table at set time rather than caching a driver location.
+struct UniformHandle
+{
+  uint64_t hash = 0;
+
+  constexpr UniformHandle() = default;
+  constexpr explicit UniformHandle(std::string_view name) : hash(hashUniformName(name)) {}
+};
+
 class Shader
 {
 public:
@@ -30,6 +56,8 @@ public:
     this->vertexPath = vertexPath;
     this->fragmentPath = fragmentPath;
     this->name = tName;
+    vertexDirectory = std::filesystem::path(vertexPath).parent_path();
+    fragmentDirectory = std::filesystem::path(fragmentPath).parent_path();
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -64,8 +92,11 @@ public:
     strncpy(ftext, fragmentCode.c_str(), sizeof(ftext) - 1);
     ftext[sizeof(ftext) - 1] = '\0';
 
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+    // the editor buffers keep the #include lines; only the compiled source is expanded
+    std::string vertexSource = expandIncludes(vertexCode, vertexDirectory);
+    std::string fragmentSource = expandIncludes(fragmentCode, fragmentDirectory);
+    const char *vShaderCode = vertexSource.c_str();
+    const char *fShaderCode = fragmentSource.c_str();
     // 2. compile shaders
     unsigned int vertex, fragment;
     // vertex shader
@@ -87,6 +118,7 @@ public:
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    reflectUniforms();
 
     // Add this shader to the static map
     shaders[std::string(tName)] = this;
@@ -97,8 +129,12 @@ public:
   {
     glUseProgram(ID);
   }
-  void reload(const char *vShaderCode, const char *fShaderCode)
+  void reload(const char *vertexCode, const char *fragmentCode)
   {
+    std::string vertexSource = expandIncludes(vertexCode, vertexDirectory);
+    std::string fragmentSource = expandIncludes(fragmentCode, fragmentDirectory);
+    const char *vShaderCode = vertexSource.c_str();
+    const char *fShaderCode = fragmentSource.c_str();
     // compile shaders
     unsigned int vertex, fragment;
     // vertex shader
@@ -112,6 +148,7 @@ public:
     glCompileShader(fragment);
     checkCompileErrors(fragment, "FRAGMENT");
     // shader Program
+    unsigned int oldID = ID;
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
@@ -120,69 +157,132 @@ public:
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    glDeleteProgram(oldID);
+    // locations can move between links, rebuild the table
+    reflectUniforms();
   }
 
   void reload()
   {
     reload(vtext, ftext);
   }
+  // uniform location lookup from the reflected table (no driver query, no allocation)
+  // ------------------------------------------------------------------------
+  GLint getUniformLocation(UniformHandle handle) const
+  {
+    if (uniformTable.empty())
+      return -1;
+    size_t mask = uniformTable.size() - 1;
+    for (size_t i = (size_t)handle.hash & mask;; i = (i + 1) & mask)
+    {
+      const UniformSlot &slot = uniformTable[i];
+      if (slot.location == EMPTY_SLOT)
+        return -1;
+      if (slot.hash == handle.hash)
+        return slot.location;
+    }
+  }
+  GLint getUniformLocation(std::string_view name) const
+  {
+    return getUniformLocation(UniformHandle(name));
+  }
+  bool hasUniform(UniformHandle handle) const
+  {
+    return getUniformLocation(handle) != -1;
+  }
   // utility uniform functions
   // ------------------------------------------------------------------------
-  void setBool(const std::string &name, bool value) const
+  void setBool(UniformHandle handle, bool value) const
   {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(handle), (int)value);
+  }
+  void setBool(std::string_view name, bool value) const
+  {
+    setBool(UniformHandle(name), value);
   }
   // ------------------------------------------------------------------------
-  void setInt(const std::string &name, int value) const
+  void setInt(UniformHandle handle, int value) const
+  {
+    glUniform1i(getUniformLocation(handle), value);
+  }
+  void setInt(std::string_view name, int value) const
   {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(UniformHandle(name), value);
   }
   // ------------------------------------------------------------------------
-  void setFloat(const std::string &name, float value) const
+  void setFloat(UniformHandle handle, float value) const
+  {
+    glUniform1f(getUniformLocation(handle), value);
+  }
+  void setFloat(std::string_view name, float value) const
   {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(UniformHandle(name), value);
   }
   // ------------------------------------------------------------------------
-  void setVec2(const std::string &name, const glm::vec2 &value) const
+  void setVec2(UniformHandle handle, const glm::vec2 &value) const
   {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(handle), 1, &value[0]);
   }
-  void setVec2(const std::string &name, float x, float y) const
+  void setVec2(std::string_view name, const glm::vec2 &value) const
   {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    setVec2(UniformHandle(name), value);
+  }
+  void setVec2(std::string_view name, float x, float y) const
+  {
+    glUniform2f(getUniformLocation(name), x, y);
   }
   // ------------------------------------------------------------------------
-  void setVec3(const std::string &name, const glm::vec3 &value) const
+  void setVec3(UniformHandle handle, const glm::vec3 &value) const
+  {
+    glUniform3fv(getUniformLocation(handle), 1, &value[0]);
+  }
+  void setVec3(std::string_view name, const glm::vec3 &value) const
   {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec3(UniformHandle(name), value);
   }
-  void setVec3(const std::string &name, float x, float y, float z) const
+  void setVec3(std::string_view name, float x, float y, float z) const
   {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
   }
   // ------------------------------------------------------------------------
-  void setVec4(const std::string &name, const glm::vec4 &value) const
+  void setVec4(UniformHandle handle, const glm::vec4 &value) const
+  {
+    glUniform4fv(getUniformLocation(handle), 1, &value[0]);
+  }
+  void setVec4(std::string_view name, const glm::vec4 &value) const
   {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec4(UniformHandle(name), value);
   }
-  void setVec4(const std::string &name, float x, float y, float z, float w) const
+  void setVec4(std::string_view name, float x, float y, float z, float w) const
   {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(getUniformLocation(name), x, y, z, w);
   }
   // ------------------------------------------------------------------------
-  void setMat2(const std::string &name, const glm::mat2 &mat) const
+  void setMat2(UniformHandle handle, const glm::mat2 &mat) const
   {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getUniformLocation(handle), 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat2(std::string_view name, const glm::mat2 &mat) const
+  {
+    setMat2(UniformHandle(name), mat);
   }
   // ------------------------------------------------------------------------
-  void setMat3(const std::string &name, const glm::mat3 &mat) const
+  void setMat3(UniformHandle handle, const glm::mat3 &mat) const
+  {
+    glUniformMatrix3fv(getUniformLocation(handle), 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat3(std::string_view name, const glm::mat3 &mat) const
   {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat3(UniformHandle(name), mat);
   }
   // ------------------------------------------------------------------------
-  void setMat4(const std::string &name, const glm::mat4 &mat) const
+  void setMat4(UniformHandle handle, const glm::mat4 &mat) const
+  {
+    glUniformMatrix4fv(getUniformLocation(handle), 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat4(std::string_view name, const glm::mat4 &mat) const
   {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat4(UniformHandle(name), mat);
   }
   void saveShaders()
   {
@@ -197,7 +297,132 @@ public:
     myfile.close();
   }
 
-private:
+protected:
+  // used by ComputeShader, which compiles its own single-stage program
+  Shader() : ID(0), vertexPath(nullptr), fragmentPath(nullptr), name("default")
+  {
+    vtext[0] = '\0';
+    ftext[0] = '\0';
+  }
+
+  // directories `#include "file"` lines are resolved against
+  std::filesystem::path vertexDirectory;
+  std::filesystem::path fragmentDirectory;
+
+  static std::string readSource(const char *path)
+  {
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+      file.open(path);
+      std::stringstream stream;
+      stream << file.rdbuf();
+      return stream.str();
+    }
+    catch (std::ifstream::failure &e)
+    {
+      std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+    }
+    return std::string();
+  }
+
+  // Pastes `#include "file"` lines (relative to `directory`) into the source, recursively, so
+  // programs can share GLSL such as gbuffer_encoding.glsl. Included files guard themselves with
+  // #ifndef like C headers.
+  static std::string expandIncludes(const std::string &source, const std::filesystem::path &directory, int depth = 0)
+  {
+    std::istringstream in(source);
+    std::string expanded, line;
+    while (std::getline(in, line))
+    {
+      size_t start = line.find_first_not_of(" \t");
+      if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+      {
+        size_t open = line.find('"', start);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close != std::string::npos && depth < 8)
+        {
+          std::filesystem::path file = directory / line.substr(open + 1, close - open - 1);
+          expanded += expandIncludes(readSource(file.string().c_str()), file.parent_path(), depth + 1);
+          expanded += '\n';
+          continue;
+        }
+      }
+      expanded += line;
+      expanded += '\n';
+    }
+    return expanded;
+  }
+
+  static constexpr GLint EMPTY_SLOT = -2;
+  struct UniformSlot
+  {
+    uint64_t hash;
+    GLint location;
+  };
+  // open-addressed, power-of-two sized, linear probing
+  std::vector<UniformSlot> uniformTable;
+
+  void insertUniform(std::string_view name, GLint location)
+  {
+    uint64_t hash = hashUniformName(name);
+    size_t mask = uniformTable.size() - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask)
+    {
+      UniformSlot &slot = uniformTable[i];
+      if (slot.location == EMPTY_SLOT || slot.hash == hash)
+      {
+        slot.hash = hash;
+        slot.location = location;
+        return;
+      }
+    }
+  }
+
+  // query every active uniform once after link. Array uniforms are registered per element
+  // ("samples[3]", "uPointLights[1].color") plus the bare name GL also accepts for element 0.
+  // ------------------------------------------------------------------------
+  void reflectUniforms()
+  {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<std::pair<std::string, GLint>> found;
+    std::vector<char> nameBuffer((size_t)maxLength + 1);
+    for (GLint u = 0; u < count; u++)
+    {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ID, (GLuint)u, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+      std::string name(nameBuffer.data(), (size_t)length);
+      GLint location = glGetUniformLocation(ID, name.c_str());
+      if (location < 0)
+        continue; // uniform block member
+      found.emplace_back(name, location);
+
+      if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+      {
+        std::string base = name.substr(0, name.size() - 3);
+        found.emplace_back(base, location);
+        for (GLint e = 1; e < size; e++)
+        {
+          std::string element = base + "[" + std::to_string(e) + "]";
+          found.emplace_back(element, glGetUniformLocation(ID, element.c_str()));
+        }
+      }
+    }
+
+    size_t capacity = 16;
+    while (capacity < found.size() * 2)
+      capacity <<= 1;
+    uniformTable.assign(capacity, UniformSlot{0, EMPTY_SLOT});
+    for (const auto &[name, location] : found)
+      insertUniform(name, location);
+  }
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(GLuint shader, std::string type)
@@ -227,4 +452,36 @@ private:
   }
 };
 
+// A single-stage compute program. Shares the uniform table and setters with Shader but is not
+// registered in Shader::shaders, so the ImGui editor (vertex/fragment only) never lists it.
+class ComputeShader : public Shader
+{
+public:
+  ComputeShader(const char *computePath, const char *tName = "compute")
+  {
+    this->vertexPath = computePath;
+    this->name = tName;
+
+    std::string computeCode = expandIncludes(readSource(computePath), std::filesystem::path(computePath).parent_path());
+    const char *cShaderCode = computeCode.c_str();
+
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    checkCompileErrors(compute, "COMPUTE");
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+    glDeleteShader(compute);
+    reflectUniforms();
+  }
+
+  void dispatch(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1) const
+  {
+    glDispatchCompute(groupsX, groupsY, groupsZ);
+  }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,473 @@
+#ifndef SSAO_H
+#define SSAO_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "buffers.h"
+#include "frame_graph.h"
+#include "gpu_timer.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+// Screen-space ambient occlusion at a reduced resolution.
+//
+// Full-screen passes, added to the frame graph by addPasses(), each with its own GPU timer:
+//   prepare   ssao_prepare.fs   G-buffer depth/normal -> low-res linear depth (R32F) and view-space
+//                               normal (RG16 octahedral); each low-res texel keeps the nearest depth
+//                               of the block it covers
+//   ao        ssao.fs           hemisphere samples from the kernel UBO against the low-res depth, or
+//             gtao.fs           horizon-based GTAO with a few directions and a noise pattern that
+//                               rotates every frame
+//   temporal  gtao_temporal.fs  (GTAO only) reprojects last frame's AO with the G-buffer motion
+//                               vectors and keeps a running average; history whose stored distance
+//                               disagrees with the reprojected one is a disocclusion and dropped
+//   blur      ssao_blur.fs      separable Gaussian, horizontal then vertical, with taps weighted down
+//                               by their relative depth difference so AO does not bleed over edges
+//   upsample  ssao_upsample.fs  joint bilateral: the four low-res texels around a full-res pixel,
+//                               bilinear weights times the same depth similarity (skipped at full res)
+// The targets are frame graph transients, so the raw AO and the blurred AO share a texture once
+// the horizontal blur has consumed the raw one. Only the GTAO history outlives a frame.
+// The kernel lives in a UBO written when the sample count changes instead of 64 uniforms a frame.
+
+// must match SSAO_MAX_KERNEL_SIZE in ssao.fs
+#define SSAO_MAX_KERNEL_SIZE 64
+
+enum SSAOMode
+{
+  SSAO_MODE_HEMISPHERE, // ssao.fs, a fixed kernel every frame
+  SSAO_MODE_GTAO,       // gtao.fs + gtao_temporal.fs, few samples per frame accumulated over frames
+};
+
+// must match the block binding in ssao.fs
+enum SSAOUniformBinding
+{
+  UBO_BINDING_SSAO_KERNEL = 1,
+};
+
+// std140, mirrored by SSAOKernelBlock in ssao.fs
+struct SSAOKernelBlock
+{
+  glm::vec4 samples[SSAO_MAX_KERNEL_SIZE]; // xyz = tangent-space offset, w unused
+};
+
+// Hemisphere (+z) offsets with length in [0.1, 1], denser towards the origin. The falloff runs over
+// `count`, so a short kernel covers the same radius as a long one.
+inline void buildSSAOKernel(SSAOKernelBlock &block, int count, unsigned int seed = 0)
+{
+  std::default_random_engine rng(seed);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  count = std::clamp(count, 1, SSAO_MAX_KERNEL_SIZE);
+  for (int i = 0; i < SSAO_MAX_KERNEL_SIZE; i++)
+  {
+    if (i >= count)
+    {
+      block.samples[i] = glm::vec4(0.0f);
+      continue;
+    }
+    glm::vec3 s(dist(rng) * 2.0f - 1.0f, dist(rng) * 2.0f - 1.0f, dist(rng));
+    s = glm::normalize(s);
+    float scale = float(i) / float(count);
+    scale = glm::mix(0.1f, 1.0f, scale * scale);
+    block.samples[i] = glm::vec4(s * scale, 0.0f);
+  }
+}
+
+struct SSAOStats
+{
+  int width = 0; // AO resolution
+  int height = 0;
+  float prepareMs = 0.0f;
+  float aoMs = 0.0f;
+  float temporalMs = 0.0f;
+  float blurMs = 0.0f;
+  float upsampleMs = 0.0f;
+
+  float totalMs() const { return prepareMs + aoMs + temporalMs + blurMs + upsampleMs; }
+};
+
+// what addPasses() produced
+struct SSAOResources
+{
+  FrameGraphResource raw;    // low-res AO of this frame alone (before accumulation and blur), for the debug viewer
+  FrameGraphResource output; // full-resolution AO for the lighting pass
+};
+
+class SSAOPipeline
+{
+public:
+  // read by every addPasses()
+  SSAOMode mode = SSAO_MODE_HEMISPHERE;
+  int resolutionDivisor = 2; // 1, 2 or 4
+  int sampleCount = 16;      // up to SSAO_MAX_KERNEL_SIZE
+  float radius = 0.5f;
+  float bias = 0.025f;
+  int blurRadius = 4;          // taps each side, per axis
+  float depthSharpness = 40.0f; // falloff of the blur/upsample weights per unit of relative depth difference
+  // GTAO
+  int gtaoSlices = 2;             // directions per pixel per frame
+  int gtaoSteps = 4;              // horizon samples each side of a direction
+  float temporalFrames = 8.0f;    // running-average length; more is smoother but slower to react
+  float rejectThreshold = 0.05f;  // relative view-distance change treated as a disocclusion
+
+  void init(const std::string &shaderDir)
+  {
+    paths[0] = shaderDir + "/fullscreen_quad.vs";
+    paths[1] = shaderDir + "/ssao_prepare.fs";
+    paths[2] = shaderDir + "/ssao.fs";
+    paths[3] = shaderDir + "/ssao_blur.fs";
+    paths[4] = shaderDir + "/ssao_upsample.fs";
+    paths[5] = shaderDir + "/gtao.fs";
+    paths[6] = shaderDir + "/gtao_temporal.fs";
+    prepareShader = std::make_unique<Shader>(paths[0].c_str(), paths[1].c_str(), "ssaoPrepareShader");
+    aoShader = std::make_unique<Shader>(paths[0].c_str(), paths[2].c_str(), "ssaoShader");
+    blurShader = std::make_unique<Shader>(paths[0].c_str(), paths[3].c_str(), "ssaoBlurShader");
+    upsampleShader = std::make_unique<Shader>(paths[0].c_str(), paths[4].c_str(), "ssaoUpsampleShader");
+    gtaoShader = std::make_unique<Shader>(paths[0].c_str(), paths[5].c_str(), "gtaoShader");
+    temporalShader = std::make_unique<Shader>(paths[0].c_str(), paths[6].c_str(), "gtaoTemporalShader");
+    kernelUBO.init(sizeof(SSAOKernelBlock), UBO_BINDING_SSAO_KERNEL);
+    createNoise();
+    prepareTimer.init();
+    aoTimer.init();
+    temporalTimer.init();
+    blurTimers[0].init();
+    blurTimers[1].init();
+    upsampleTimer.init();
+  }
+
+  // Adds the passes from the G-buffer `depth`, `normal` and `motion` (read by the GTAO temporal pass
+  // only), whose size is the full resolution, with `quadVAO` as the full-screen quad.
+  SSAOResources addPasses(FrameGraph &graph, FrameGraphResource depth, FrameGraphResource normal,
+                          FrameGraphResource motion, GLuint quadVAO)
+  {
+    static constexpr UniformHandle uGDepth("gDepth");
+    static constexpr UniformHandle uGNormal("gNormal");
+    static constexpr UniformHandle uScale("uScale");
+    static constexpr UniformHandle uLinearDepth("uLinearDepth");
+    static constexpr UniformHandle uViewNormal("uViewNormal");
+    static constexpr UniformHandle uNoise("noiseTex");
+    static constexpr UniformHandle uSampleCount("uSampleCount");
+    static constexpr UniformHandle uRadius("radius");
+    static constexpr UniformHandle uBias("bias");
+    static constexpr UniformHandle uInput("ssaoInput");
+    static constexpr UniformHandle uSharpness("uSharpness");
+    static constexpr UniformHandle uSliceCount("uSliceCount");
+    static constexpr UniformHandle uStepCount("uStepCount");
+    static constexpr UniformHandle uFrameIndex("uFrameIndex");
+    static constexpr UniformHandle uHistory("uHistory");
+    static constexpr UniformHandle uGMotion("gMotion");
+    static constexpr UniformHandle uMaxFrames("uMaxFrames");
+    static constexpr UniformHandle uRejectThreshold("uRejectThreshold");
+
+    resolutionDivisor = resolutionDivisor >= 4 ? 4 : resolutionDivisor >= 2 ? 2 : 1;
+    const int divisor = resolutionDivisor;
+    const FrameGraphTextureDesc &full = graph.desc(depth);
+    const int lowWidth = std::max((full.width + divisor - 1) / divisor, 1);
+    const int lowHeight = std::max((full.height + divisor - 1) / divisor, 1);
+    frameStats.width = lowWidth;
+    frameStats.height = lowHeight;
+    sampleCount = std::clamp(sampleCount, 1, SSAO_MAX_KERNEL_SIZE);
+    if (sampleCount != kernelSize)
+    {
+      SSAOKernelBlock block;
+      buildSSAOKernel(block, sampleCount);
+      kernelUBO.update(block);
+      kernelSize = sampleCount;
+    }
+    auto lowRes = [&](GLenum format)
+    {
+      FrameGraphTextureDesc desc;
+      desc.width = lowWidth;
+      desc.height = lowHeight;
+      desc.format = format;
+      return desc;
+    };
+
+    // prepare: low-res linear depth and view-space normal
+    FrameGraphResource linearDepth, viewNormal;
+    {
+      FrameGraphBuilder pass = graph.addPass("SSAO prepare");
+      pass.read(depth);
+      pass.read(normal);
+      linearDepth = pass.colorAttachment(graph.createTexture("SSAO linear depth", lowRes(GL_R32F)));
+      viewNormal = pass.colorAttachment(graph.createTexture("SSAO view normal", lowRes(GL_RG16)));
+      pass.execute([=](const FrameGraphPassContext &context)
+                   {
+        prepareTimer.begin();
+        prepareShader->use();
+        bindTexture(0, context.texture(depth));
+        prepareShader->setInt(uGDepth, 0);
+        bindTexture(1, context.texture(normal));
+        prepareShader->setInt(uGNormal, 1);
+        prepareShader->setInt(uScale, divisor);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        prepareTimer.end();
+        frameStats.prepareMs = prepareTimer.milliseconds(); });
+    }
+
+    // ao
+    FrameGraphResource raw;
+    {
+      FrameGraphBuilder pass = graph.addPass(mode == SSAO_MODE_GTAO ? "GTAO" : "SSAO");
+      pass.read(linearDepth);
+      pass.read(viewNormal);
+      raw = pass.colorAttachment(graph.createTexture("SSAO raw", lowRes(GL_R8)));
+      SSAOMode passMode = mode;
+      uint32_t noiseFrame = frameIndex++;
+      pass.execute([=](const FrameGraphPassContext &context)
+                   {
+        aoTimer.begin();
+        Shader &shader = passMode == SSAO_MODE_GTAO ? *gtaoShader : *aoShader;
+        shader.use();
+        bindTexture(0, context.texture(linearDepth));
+        shader.setInt(uLinearDepth, 0);
+        bindTexture(1, context.texture(viewNormal));
+        shader.setInt(uViewNormal, 1);
+        shader.setFloat(uRadius, radius);
+        if (passMode == SSAO_MODE_GTAO)
+        {
+          shader.setInt(uSliceCount, std::max(gtaoSlices, 1));
+          shader.setInt(uStepCount, std::max(gtaoSteps, 1));
+          shader.setInt(uFrameIndex, (int)(noiseFrame & 0x7fffffff));
+        }
+        else
+        {
+          bindTexture(2, noiseTexture);
+          shader.setInt(uNoise, 2);
+          shader.setInt(uSampleCount, kernelSize);
+          shader.setFloat(uBias, bias);
+        }
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        aoTimer.end();
+        frameStats.aoMs = aoTimer.milliseconds(); });
+    }
+
+    // temporal accumulation: raw + history[previous] -> history[current], which the blur reads
+    FrameGraphResource blurSource = raw;
+    frameStats.temporalMs = 0.0f;
+    if (mode == SSAO_MODE_GTAO)
+    {
+      ensureHistory(lowWidth, lowHeight);
+      int previous = historyIndex, current = historyIndex ^ 1;
+      FrameGraphTextureDesc historyDesc = lowRes(GL_RGBA16F);
+      FrameGraphBuilder pass = graph.addPass("GTAO temporal");
+      pass.read(raw);
+      pass.read(linearDepth);
+      pass.read(motion);
+      FrameGraphResource previousHistory = pass.read(graph.importTexture("GTAO history (last frame)", history[previous], historyDesc));
+      blurSource = pass.write(graph.importTexture("GTAO history", history[current], historyDesc));
+      // a mode switch or a new size leaves stale history behind: restart the average
+      float maxFrames = historyValid ? std::max(temporalFrames, 0.0f) : 0.0f;
+      GLuint target = historyFBO[current];
+      pass.execute([=](const FrameGraphPassContext &context)
+                   {
+        temporalTimer.begin();
+        temporalShader->use();
+        bindTexture(0, context.texture(raw));
+        temporalShader->setInt(uInput, 0);
+        bindTexture(1, context.texture(linearDepth));
+        temporalShader->setInt(uLinearDepth, 1);
+        bindTexture(2, context.texture(previousHistory));
+        temporalShader->setInt(uHistory, 2);
+        bindTexture(3, context.texture(motion));
+        temporalShader->setInt(uGMotion, 3);
+        temporalShader->setFloat(uMaxFrames, maxFrames);
+        temporalShader->setFloat(uRejectThreshold, rejectThreshold);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(0, 0, lowWidth, lowHeight);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        temporalTimer.end();
+        frameStats.temporalMs = temporalTimer.milliseconds(); });
+      historyIndex = current;
+    }
+    historyValid = mode == SSAO_MODE_GTAO;
+
+    // separable bilateral blur: source -> horizontal -> vertical
+    FrameGraphResource horizontal = addBlurPass(graph, "SSAO blur H", blurSource, linearDepth, lowRes(GL_R8), glm::vec2(1.0f / lowWidth, 0.0f), 0, quadVAO);
+    FrameGraphResource blurred = addBlurPass(graph, "SSAO blur V", horizontal, linearDepth, lowRes(GL_R8), glm::vec2(0.0f, 1.0f / lowHeight), 1, quadVAO);
+    frameStats.upsampleMs = 0.0f;
+    if (divisor == 1)
+      return SSAOResources{raw, blurred};
+
+    // joint bilateral upsample to full res
+    FrameGraphTextureDesc outputDesc = full;
+    outputDesc.format = GL_R8;
+    outputDesc.filter = GL_NEAREST;
+    FrameGraphBuilder pass = graph.addPass("SSAO upsample");
+    pass.read(depth);
+    pass.read(blurred);
+    pass.read(linearDepth);
+    FrameGraphResource output = pass.colorAttachment(graph.createTexture("SSAO", outputDesc));
+    pass.execute([=](const FrameGraphPassContext &context)
+                 {
+      upsampleTimer.begin();
+      upsampleShader->use();
+      bindTexture(0, context.texture(depth));
+      upsampleShader->setInt(uGDepth, 0);
+      bindTexture(1, context.texture(blurred));
+      upsampleShader->setInt(uInput, 1);
+      bindTexture(2, context.texture(linearDepth));
+      upsampleShader->setInt(uLinearDepth, 2);
+      upsampleShader->setFloat(uSharpness, depthSharpness);
+      glBindVertexArray(quadVAO);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      upsampleTimer.end();
+      frameStats.upsampleMs = upsampleTimer.milliseconds(); });
+    return SSAOResources{raw, output};
+  }
+
+  const SSAOStats &stats() const { return frameStats; }
+
+  // GL thread; init() is needed before rendering again
+  void clear()
+  {
+    releaseHistory();
+    if (noiseTexture)
+      glDeleteTextures(1, &noiseTexture);
+    noiseTexture = 0;
+    if (kernelUBO.id)
+      glDeleteBuffers(1, &kernelUBO.id);
+    kernelUBO = UniformBuffer();
+    kernelSize = 0;
+    prepareShader.reset();
+    aoShader.reset();
+    blurShader.reset();
+    upsampleShader.reset();
+    gtaoShader.reset();
+    temporalShader.reset();
+  }
+
+private:
+  std::string paths[7]; // the shader editor shows the programs' paths, so they must outlive init()
+  std::unique_ptr<Shader> prepareShader;
+  std::unique_ptr<Shader> aoShader;
+  std::unique_ptr<Shader> blurShader;
+  std::unique_ptr<Shader> upsampleShader;
+  std::unique_ptr<Shader> gtaoShader;
+  std::unique_ptr<Shader> temporalShader;
+  UniformBuffer kernelUBO;
+  int kernelSize = 0; // sample count the UBO was built for
+  GLuint noiseTexture = 0;
+  GpuTimer prepareTimer, aoTimer, temporalTimer, upsampleTimer;
+  GpuTimer blurTimers[2]; // horizontal, vertical
+  float blurMs[2] = {0.0f, 0.0f};
+
+  int historyWidth = 0, historyHeight = 0;
+  GLuint history[2] = {0, 0}; // RGBA16F: accumulated AO, view distance, frame count
+  GLuint historyFBO[2] = {0, 0};
+  int historyIndex = 0;       // the one written last frame
+  bool historyValid = false;  // last frame ran GTAO at this size
+  uint32_t frameIndex = 0;
+  SSAOStats frameStats;
+
+  static void bindTexture(int unit, GLuint texture)
+  {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+  }
+
+  FrameGraphResource addBlurPass(FrameGraph &graph, const char *name, FrameGraphResource source, FrameGraphResource linearDepth,
+                                 const FrameGraphTextureDesc &desc, glm::vec2 direction, int timer, GLuint quadVAO)
+  {
+    static constexpr UniformHandle uInput("ssaoInput");
+    static constexpr UniformHandle uLinearDepth("uLinearDepth");
+    static constexpr UniformHandle uDirection("uDirection");
+    static constexpr UniformHandle uBlurRadius("uBlurRadius");
+    static constexpr UniformHandle uSharpness("uSharpness");
+
+    FrameGraphBuilder pass = graph.addPass(name);
+    pass.read(source);
+    pass.read(linearDepth);
+    FrameGraphResource result = pass.colorAttachment(graph.createTexture(name, desc));
+    pass.execute([=](const FrameGraphPassContext &context)
+                 {
+      blurTimers[timer].begin();
+      blurShader->use();
+      bindTexture(0, context.texture(source));
+      blurShader->setInt(uInput, 0);
+      bindTexture(1, context.texture(linearDepth));
+      blurShader->setInt(uLinearDepth, 1);
+      blurShader->setInt(uBlurRadius, std::max(blurRadius, 0));
+      blurShader->setFloat(uSharpness, depthSharpness);
+      blurShader->setVec2(uDirection, direction);
+      glBindVertexArray(quadVAO);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      blurTimers[timer].end();
+      blurMs[timer] = blurTimers[timer].milliseconds();
+      frameStats.blurMs = blurMs[0] + blurMs[1]; });
+    return result;
+  }
+
+  // (re)allocates the GTAO history at the AO resolution; zero frame counts make the first frame
+  // after a reallocation start without history
+  void ensureHistory(int w, int h)
+  {
+    if (history[0] && w == historyWidth && h == historyHeight)
+      return;
+    releaseHistory();
+    historyWidth = w;
+    historyHeight = h;
+    for (int i = 0; i < 2; i++)
+    {
+      glGenTextures(1, &history[i]);
+      glBindTexture(GL_TEXTURE_2D, history[i]);
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, w, h);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glGenFramebuffers(1, &historyFBO[i]);
+      glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, history[i], 0);
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::SSAO::FRAMEBUFFER_INCOMPLETE" << std::endl;
+      const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      glClearBufferfv(GL_COLOR, 0, zero);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    historyValid = false;
+  }
+
+  // 4x4 random rotations about the normal, tiled over the AO target
+  void createNoise()
+  {
+    std::default_random_engine rng;
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    glm::vec3 noise[16];
+    for (glm::vec3 &n : noise)
+      n = glm::vec3(dist(rng) * 2.0f - 1.0f, dist(rng) * 2.0f - 1.0f, 0.0f);
+    glGenTextures(1, &noiseTexture);
+    glBindTexture(GL_TEXTURE_2D, noiseTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, 4, 4, 0, GL_RGB, GL_FLOAT, noise);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  void releaseHistory()
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      if (history[i])
+        glDeleteTextures(1, &history[i]);
+      if (historyFBO[i])
+        glDeleteFramebuffers(1, &historyFBO[i]);
+      history[i] = historyFBO[i] = 0;
+    }
+    historyWidth = historyHeight = 0;
+  }
+};
+
+#endif // SSAO_H
@@ -0,0 +1,238 @@
+#ifndef TAA_H
+#define TAA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frame_graph.h"
+#include "gpu_timer.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Temporal anti-aliasing.
+//
+// Every frame the projection is offset by a sub-pixel Halton (2, 3) jitter (Camera::GetProjectionMatrix),
+// so successive frames sample different points inside each pixel. The lit scene is rendered into a
+// frame graph target; the pass addResolvePass() adds then reprojects last frame's result with the
+// G-buffer motion vectors (taken at the nearest depth of the 3x3 neighbourhood, so edges carry their object's
+// motion), clamps it to the colour range of the current neighbourhood to reject stale history, and
+// blends it with the current frame. The result becomes the next frame's history and is blitted to
+// the default framebuffer.
+
+#define TAA_JITTER_SAMPLES 8
+
+// radical inverse of `index` in `base`; index 0 maps to 0, so sequences start at 1
+inline float halton(uint32_t index, uint32_t base)
+{
+  float result = 0.0f;
+  float fraction = 1.0f / (float)base;
+  while (index > 0)
+  {
+    result += (float)(index % base) * fraction;
+    index /= base;
+    fraction /= (float)base;
+  }
+  return result;
+}
+
+// sub-pixel offset of frame `frame`, in pixels within [-0.5, 0.5)
+inline glm::vec2 taaJitterOffset(uint32_t frame)
+{
+  uint32_t index = frame % TAA_JITTER_SAMPLES + 1;
+  return glm::vec2(halton(index, 2), halton(index, 3)) - 0.5f;
+}
+
+class TemporalAA
+{
+public:
+  float feedback = 0.9f; // history weight for still pixels; fast motion leans on the current frame
+
+  void init(const std::string &shaderDir, int w, int h)
+  {
+    paths[0] = shaderDir + "/fullscreen_quad.vs";
+    paths[1] = shaderDir + "/taa_resolve.fs";
+    resolveShader = std::make_unique<Shader>(paths[0].c_str(), paths[1].c_str(), "taaResolveShader");
+    resolveTimer.init();
+    resize(w, h);
+  }
+
+  // reallocates the history; the scene colour given to addResolvePass() must have this size
+  void resize(int w, int h)
+  {
+    releaseTargets();
+    width = std::max(w, 1);
+    height = std::max(h, 1);
+
+    for (int i = 0; i < 2; i++)
+    {
+      glGenFramebuffers(1, &historyFBO[i]);
+      glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[i]);
+      history[i] = createColor();
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, history[i], 0);
+      checkFramebuffer();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    resetHistory();
+  }
+
+  // the target the lighting pass and the forward overlays draw into while TAA is on; linear
+  // filtering like the history
+  FrameGraphTextureDesc sceneColorDesc() const
+  {
+    FrameGraphTextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.format = GL_RGBA16F;
+    desc.filter = GL_LINEAR;
+    return desc;
+  }
+
+  // Once a frame before the projection is built: advances the sequence and returns the jitter in
+  // NDC units for Camera::GetProjectionMatrix. previousJitter() is the one before it.
+  glm::vec2 nextJitter()
+  {
+    lastJitter = currentJitter;
+    glm::vec2 offset = taaJitterOffset(frameIndex++);
+    currentJitter = offset * 2.0f / glm::vec2((float)width, (float)height);
+    return currentJitter;
+  }
+
+  glm::vec2 jitter() const { return currentJitter; }
+  glm::vec2 previousJitter() const { return lastJitter; }
+
+  // the next resolve() uses the current frame only (after a cut, a toggle or a resize)
+  void resetHistory() { historyValid = false; }
+
+  // Adds the pass that blends `sceneColor` with the reprojected history into the other history
+  // buffer and blits the result to `backbuffer`; returns the backbuffer's new version.
+  FrameGraphResource addResolvePass(FrameGraph &graph, FrameGraphResource sceneColor, FrameGraphResource motion,
+                                    FrameGraphResource depth, FrameGraphResource backbuffer, GLuint quadVAO)
+  {
+    static constexpr UniformHandle uCurrent("uCurrent");
+    static constexpr UniformHandle uHistory("uHistory");
+    static constexpr UniformHandle uMotion("gMotion");
+    static constexpr UniformHandle uDepth("gDepth");
+    static constexpr UniformHandle uFeedback("uFeedback");
+    static constexpr UniformHandle uHistoryValid("uHistoryValid");
+
+    int previous = historyIndex, current = historyIndex ^ 1;
+    FrameGraphTextureDesc historyDesc = sceneColorDesc();
+    FrameGraphBuilder pass = graph.addPass("TAA resolve");
+    pass.read(sceneColor);
+    pass.read(motion);
+    pass.read(depth);
+    FrameGraphResource previousHistory = pass.read(graph.importTexture("TAA history (last frame)", history[previous], historyDesc));
+    pass.write(graph.importTexture("TAA history", history[current], historyDesc));
+    FrameGraphResource presented = pass.write(backbuffer);
+    bool useHistory = historyValid;
+    pass.execute([=](const FrameGraphPassContext &context)
+                 {
+      GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+      glDisable(GL_DEPTH_TEST);
+      glViewport(0, 0, width, height);
+
+      resolveTimer.begin();
+      resolveShader->use();
+      bindTexture(0, context.texture(sceneColor));
+      resolveShader->setInt(uCurrent, 0);
+      bindTexture(1, context.texture(previousHistory));
+      resolveShader->setInt(uHistory, 1);
+      bindTexture(2, context.texture(motion));
+      resolveShader->setInt(uMotion, 2);
+      bindTexture(3, context.texture(depth));
+      resolveShader->setInt(uDepth, 3);
+      resolveShader->setFloat(uFeedback, std::clamp(feedback, 0.0f, 0.98f));
+      resolveShader->setBool(uHistoryValid, useHistory);
+      glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[current]);
+      glBindVertexArray(quadVAO);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, historyFBO[current]);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+      glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      resolveTimer.end();
+
+      if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+      glActiveTexture(GL_TEXTURE0);
+      lastResolveMs = resolveTimer.milliseconds(); });
+
+    historyIndex = current;
+    historyValid = true;
+    return presented;
+  }
+
+  // the last resolved frame, for the debug viewer
+  GLuint output() const { return history[historyIndex]; }
+  float resolveMilliseconds() const { return lastResolveMs; }
+
+  // GL thread; init() is needed before using it again
+  void clear()
+  {
+    releaseTargets();
+    resolveShader.reset();
+  }
+
+private:
+  std::string paths[2]; // the shader editor shows the program's paths, so they must outlive init()
+  std::unique_ptr<Shader> resolveShader;
+  GpuTimer resolveTimer;
+  float lastResolveMs = 0.0f;
+
+  int width = 0, height = 0;
+  GLuint history[2] = {0, 0};
+  GLuint historyFBO[2] = {0, 0};
+  int historyIndex = 0; // the one resolved last frame
+  bool historyValid = false;
+
+  uint32_t frameIndex = 0;
+  glm::vec2 currentJitter = glm::vec2(0.0f);
+  glm::vec2 lastJitter = glm::vec2(0.0f);
+
+  static void bindTexture(int unit, GLuint texture)
+  {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+  }
+
+  // linear filtering: the history is resampled at sub-pixel reprojected positions
+  GLuint createColor()
+  {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+  }
+
+  static void checkFramebuffer()
+  {
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      std::cout << "ERROR::TAA::FRAMEBUFFER_INCOMPLETE" << std::endl;
+  }
+
+  void releaseTargets()
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      if (history[i])
+        glDeleteTextures(1, &history[i]);
+      if (historyFBO[i])
+        glDeleteFramebuffers(1, &historyFBO[i]);
+      history[i] = historyFBO[i] = 0;
+    }
+  }
+};
+
+#endif // TAA_H
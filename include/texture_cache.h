@@ -0,0 +1,246 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include "texture_streamer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide texture cache. Every Model goes through it, so a file referenced by several models
+// (or by repeated setDefaultTexture calls) is decoded and uploaded once.
+//
+// Textures are keyed by canonical path; with dedupByContent on, a miss also hashes the file bytes so
+// identical images under different names share one texture. acquire()/release() keep a reference
+// count. Unreferenced textures stay resident for reuse until residentBytes exceeds budgetBytes, then
+// the least recently used ones are deleted. Referenced or still-streaming textures are never evicted.
+
+#define TEXTURE_CACHE_DEFAULT_BUDGET ((size_t)512 * 1024 * 1024)
+
+struct TextureCacheStats
+{
+  unsigned int hits = 0;
+  unsigned int misses = 0;
+  unsigned int evictions = 0;
+  unsigned int textures = 0;   // live texture objects, referenced or not
+  unsigned int referenced = 0; // with refCount > 0
+  unsigned int streaming = 0;  // not uploaded yet, size unknown
+  size_t residentBytes = 0;
+};
+
+class TextureCache
+{
+public:
+  size_t budgetBytes = TEXTURE_CACHE_DEFAULT_BUDGET;
+  bool dedupByContent = false;
+
+  static TextureCache &instance()
+  {
+    static TextureCache cache;
+    return cache;
+  }
+
+  TextureCache(const TextureCache &) = delete;
+  TextureCache &operator=(const TextureCache &) = delete;
+
+  // GL thread. Returns the texture for `path`, streaming it in on first use, and adds a reference.
+  unsigned int acquire(const std::string &path)
+  {
+    std::string key = canonicalKey(path);
+    tick++;
+
+    auto found = byPath.find(key);
+    if (found != byPath.end())
+      return addReference(found->second);
+
+    uint64_t contentHash = 0;
+    if (dedupByContent && hashFileContents(key, contentHash))
+    {
+      auto same = byContent.find(contentHash);
+      if (same != byContent.end())
+      {
+        byPath[key] = same->second;
+        entries[same->second].keys.push_back(key);
+        return addReference(same->second);
+      }
+    }
+
+    totals.misses++;
+    unsigned int textureID = TextureStreamer::instance().request(key);
+    Entry &entry = entries[textureID];
+    entry.keys.push_back(key);
+    entry.contentHash = contentHash;
+    entry.refCount = 1;
+    entry.lastUsed = tick;
+    byPath[key] = textureID;
+    if (contentHash)
+      byContent[contentHash] = textureID;
+    return textureID;
+  }
+
+  // GL thread. Drops one reference; the texture becomes evictable once none are left.
+  void release(unsigned int textureID)
+  {
+    auto found = entries.find(textureID);
+    if (found == entries.end() || found->second.refCount == 0)
+      return;
+    found->second.refCount--;
+    found->second.lastUsed = ++tick;
+    evictOverBudget();
+  }
+
+  // GL thread. Adds a reference to a texture already in the cache.
+  void retain(unsigned int textureID)
+  {
+    auto found = entries.find(textureID);
+    if (found != entries.end())
+      found->second.refCount++;
+  }
+
+  // false while the texture is still streaming (or unknown); otherwise fills in what is on the GPU
+  bool textureInfo(unsigned int textureID, TextureInfo &info) const
+  {
+    auto found = entries.find(textureID);
+    if (found == entries.end() || !found->second.ready)
+      return false;
+    info = found->second.info;
+    return true;
+  }
+
+  // GL thread. Applies a lowered budgetBytes right away instead of at the next release.
+  void trim() { evictOverBudget(); }
+
+  // GL thread, before the context goes away. Deletes every cached texture.
+  void clear()
+  {
+    for (auto &kv : entries)
+      glDeleteTextures(1, &kv.first);
+    entries.clear();
+    byPath.clear();
+    byContent.clear();
+    residentBytes = 0;
+  }
+
+  TextureCacheStats stats() const
+  {
+    TextureCacheStats s = totals;
+    s.residentBytes = residentBytes;
+    s.textures = (unsigned int)entries.size();
+    for (auto &kv : entries)
+    {
+      if (kv.second.refCount > 0)
+        s.referenced++;
+      if (!kv.second.ready)
+        s.streaming++;
+    }
+    return s;
+  }
+
+private:
+  struct Entry
+  {
+    std::vector<std::string> keys; // every canonical path that resolved to this texture
+    uint64_t contentHash = 0;      // 0 when not hashed
+    unsigned int refCount = 0;
+    size_t bytes = 0;
+    bool ready = false; // uploaded (or settled on the placeholder) by the streamer
+    TextureInfo info;
+    uint64_t lastUsed = 0;
+  };
+
+  std::unordered_map<unsigned int, Entry> entries; // by texture name
+  std::unordered_map<std::string, unsigned int> byPath;
+  std::unordered_map<uint64_t, unsigned int> byContent;
+  size_t residentBytes = 0;
+  uint64_t tick = 0;
+  TextureCacheStats totals;
+
+  TextureCache()
+  {
+    TextureStreamer::instance().onTextureReady = [this](unsigned int textureID, const TextureInfo &info)
+    {
+      textureReady(textureID, info);
+    };
+  }
+
+  unsigned int addReference(unsigned int textureID)
+  {
+    Entry &entry = entries[textureID];
+    entry.refCount++;
+    entry.lastUsed = tick;
+    totals.hits++;
+    return textureID;
+  }
+
+  void textureReady(unsigned int textureID, const TextureInfo &info)
+  {
+    auto found = entries.find(textureID);
+    if (found == entries.end())
+      return;
+    found->second.info = info;
+    found->second.bytes = info.gpuBytes;
+    found->second.ready = true;
+    residentBytes += info.gpuBytes;
+    evictOverBudget();
+  }
+
+  void evictOverBudget()
+  {
+    while (residentBytes > budgetBytes)
+    {
+      // eviction is rare, a linear search for the oldest unreferenced texture is fine
+      auto victim = entries.end();
+      for (auto it = entries.begin(); it != entries.end(); ++it)
+        if (it->second.refCount == 0 && it->second.ready && (victim == entries.end() || it->second.lastUsed < victim->second.lastUsed))
+          victim = it;
+      if (victim == entries.end())
+        return; // everything left is in use
+
+      for (const std::string &key : victim->second.keys)
+        byPath.erase(key);
+      if (victim->second.contentHash)
+        byContent.erase(victim->second.contentHash);
+      residentBytes -= victim->second.bytes;
+      glDeleteTextures(1, &victim->first);
+      entries.erase(victim);
+      totals.evictions++;
+    }
+  }
+
+  static std::string canonicalKey(const std::string &path)
+  {
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    if (ec)
+      canonical = std::filesystem::path(path).lexically_normal();
+    return canonical.generic_string();
+  }
+
+  // FNV-1a over the raw file bytes; false if the file cannot be read
+  static bool hashFileContents(const std::string &path, uint64_t &hash)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return false;
+    hash = 14695981039346656037ull;
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+    {
+      for (std::streamsize i = 0; i < file.gcount(); i++)
+      {
+        hash ^= (unsigned char)buffer[i];
+        hash *= 1099511628211ull;
+      }
+    }
+    if (hash == 0)
+      hash = 1; // 0 means "not hashed"
+    return true;
+  }
+};
+
+#endif // TEXTURE_CACHE_H
@@ -0,0 +1,434 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// CPU block-compression encoders and mip chain generation. No GL calls, so the offline
+// TextureCooker can run headless.
+//
+//   BC1  8 B/block  RGB, opaque colour maps
+//   BC3 16 B/block  RGB + BC4-coded alpha
+//   BC4  8 B/block  one channel (roughness, metallic, ao)
+//   BC5 16 B/block  two channels, for XY normal maps (reconstruct Z in the shader)
+//   BC7 16 B/block  RGBA, mode 6 only: one subset, 7-bit endpoints + p-bit, 4-bit indices
+//
+// Endpoints come from the principal axis of each 4x4 block, indices are the nearest palette entry.
+// That is a fast "good enough" encoder, not a search-based one like the reference compressors.
+
+enum TextureBlockFormat
+{
+  BLOCK_BC1 = 1,
+  BLOCK_BC3 = 3,
+  BLOCK_BC4 = 4,
+  BLOCK_BC5 = 5,
+  BLOCK_BC7 = 7,
+};
+
+inline unsigned int blockFormatBytes(TextureBlockFormat format)
+{
+  return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+}
+
+inline size_t compressedLevelSize(TextureBlockFormat format, uint32_t width, uint32_t height)
+{
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockFormatBytes(format);
+}
+
+struct CompressedMip
+{
+  uint32_t width;
+  uint32_t height;
+  size_t offset; // into CompressedTexture::data
+  size_t size;
+};
+
+// a block-compressed image with its full mip chain, levels stored back to back
+struct CompressedTexture
+{
+  TextureBlockFormat format = BLOCK_BC1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<CompressedMip> mips;
+  std::vector<uint8_t> data;
+};
+
+namespace bc
+{
+  // copies a 4x4 RGBA block, clamping at the image edge
+  inline void fetchBlock(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[16][4])
+  {
+    for (uint32_t y = 0; y < 4; y++)
+      for (uint32_t x = 0; x < 4; x++)
+      {
+        uint32_t sx = std::min(bx * 4 + x, width - 1);
+        uint32_t sy = std::min(by * 4 + y, height - 1);
+        std::memcpy(block[y * 4 + x], rgba + ((size_t)sy * width + sx) * 4, 4);
+      }
+  }
+
+  // end points of the block's colour distribution along its principal axis, in the first `channels` components
+  inline void principalAxisEndpoints(const uint8_t block[16][4], int channels, float lo[4], float hi[4])
+  {
+    float mean[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+      for (int c = 0; c < channels; c++)
+        mean[c] += block[i][c] / 16.0f;
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++)
+      for (int a = 0; a < channels; a++)
+        for (int b = 0; b < channels; b++)
+          cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+
+    // power iteration, seeded with the bounding box diagonal
+    float axis[4] = {0, 0, 0, 0};
+    for (int c = 0; c < channels; c++)
+    {
+      float mn = 255.0f, mx = 0.0f;
+      for (int i = 0; i < 16; i++)
+      {
+        mn = std::min(mn, (float)block[i][c]);
+        mx = std::max(mx, (float)block[i][c]);
+      }
+      axis[c] = mx - mn + 1e-3f;
+    }
+    for (int iter = 0; iter < 8; iter++)
+    {
+      float next[4] = {0, 0, 0, 0};
+      float length = 0.0f;
+      for (int a = 0; a < channels; a++)
+      {
+        for (int b = 0; b < channels; b++)
+          next[a] += cov[a][b] * axis[b];
+        length = std::max(length, std::fabs(next[a]));
+      }
+      if (length < 1e-6f)
+        break;
+      for (int c = 0; c < channels; c++)
+        axis[c] = next[c] / length;
+    }
+    float norm = 0.0f;
+    for (int c = 0; c < channels; c++)
+      norm += axis[c] * axis[c];
+    norm = std::sqrt(norm);
+
+    float tMin = 0.0f, tMax = 0.0f;
+    if (norm > 1e-6f)
+    {
+      for (int c = 0; c < channels; c++)
+        axis[c] /= norm;
+      tMin = 1e30f;
+      tMax = -1e30f;
+      for (int i = 0; i < 16; i++)
+      {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+          t += (block[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+      }
+    }
+    for (int c = 0; c < channels; c++)
+    {
+      lo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+      hi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+  }
+
+  inline int squaredDistance(const uint8_t *a, const int *b, int channels)
+  {
+    int sum = 0;
+    for (int c = 0; c < channels; c++)
+      sum += (a[c] - b[c]) * (a[c] - b[c]);
+    return sum;
+  }
+
+  inline uint16_t packRGB565(const float rgb[3])
+  {
+    int r = (int)std::lround(rgb[0] * 31.0f / 255.0f);
+    int g = (int)std::lround(rgb[1] * 63.0f / 255.0f);
+    int b = (int)std::lround(rgb[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+  }
+
+  inline void unpackRGB565(uint16_t c, int rgb[3])
+  {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+  }
+
+  // 4-colour BC1 block; also the colour half of BC3
+  inline void encodeBC1(const uint8_t block[16][4], uint8_t *out)
+  {
+    float lo[4], hi[4];
+    principalAxisEndpoints(block, 3, lo, hi);
+    uint16_t c0 = packRGB565(hi);
+    uint16_t c1 = packRGB565(lo);
+    if (c0 < c1)
+      std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+      int palette[4][3];
+      unpackRGB565(c0, palette[0]);
+      unpackRGB565(c1, palette[1]);
+      for (int c = 0; c < 3; c++)
+      {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      for (int i = 0; i < 16; i++)
+      {
+        int best = 0, bestError = squaredDistance(block[i], palette[0], 3);
+        for (int p = 1; p < 4; p++)
+        {
+          int error = squaredDistance(block[i], palette[p], 3);
+          if (error < bestError)
+          {
+            best = p;
+            bestError = error;
+          }
+        }
+        indices |= (uint32_t)best << (i * 2);
+      }
+    }
+    // c0 == c1: every index 0 already selects the single colour
+
+    std::memcpy(out, &c0, 2);
+    std::memcpy(out + 2, &c1, 2);
+    std::memcpy(out + 4, &indices, 4);
+  }
+
+  // single channel block (8-value mode); the alpha half of BC3 and each half of BC5
+  inline void encodeBC4(const uint8_t block[16][4], int channel, uint8_t *out)
+  {
+    int mn = 255, mx = 0;
+    for (int i = 0; i < 16; i++)
+    {
+      mn = std::min(mn, (int)block[i][channel]);
+      mx = std::max(mx, (int)block[i][channel]);
+    }
+
+    uint64_t bits = 0;
+    if (mx != mn)
+    {
+      int palette[8];
+      palette[0] = mx;
+      palette[1] = mn;
+      for (int k = 2; k < 8; k++)
+        palette[k] = ((8 - k) * mx + (k - 1) * mn + 3) / 7;
+      for (int i = 0; i < 16; i++)
+      {
+        int v = block[i][channel];
+        int best = 0, bestError = std::abs(v - palette[0]);
+        for (int p = 1; p < 8; p++)
+        {
+          int error = std::abs(v - palette[p]);
+          if (error < bestError)
+          {
+            best = p;
+            bestError = error;
+          }
+        }
+        bits |= (uint64_t)best << (i * 3);
+      }
+    }
+
+    out[0] = (uint8_t)mx;
+    out[1] = (uint8_t)mn;
+    for (int b = 0; b < 6; b++)
+      out[2 + b] = (uint8_t)(bits >> (b * 8));
+  }
+
+  // little-endian bit writer for 128-bit BC7 blocks
+  struct BlockBits
+  {
+    uint8_t *out;
+    int position = 0;
+
+    void write(uint32_t value, int count)
+    {
+      for (int i = 0; i < count; i++, position++)
+        if (value & (1u << i))
+          out[position >> 3] |= (uint8_t)(1u << (position & 7));
+    }
+  };
+
+  inline void encodeBC7Mode6(const uint8_t block[16][4], uint8_t *out)
+  {
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    float endpoints[2][4];
+    principalAxisEndpoints(block, 4, endpoints[0], endpoints[1]);
+
+    // 7 bits per channel plus a shared p-bit per endpoint; pick the p-bit with the smaller error
+    int quantized[2][4], pbit[2];
+    for (int e = 0; e < 2; e++)
+    {
+      float bestError = 1e30f;
+      for (int p = 0; p < 2; p++)
+      {
+        int q[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+          q[c] = std::clamp((int)std::lround((endpoints[e][c] - p) / 2.0f), 0, 127);
+          float d = (float)((q[c] << 1) | p) - endpoints[e][c];
+          error += d * d;
+        }
+        if (error < bestError)
+        {
+          bestError = error;
+          pbit[e] = p;
+          std::memcpy(quantized[e], q, sizeof(q));
+        }
+      }
+    }
+
+    int palette[16][4];
+    for (int k = 0; k < 16; k++)
+      for (int c = 0; c < 4; c++)
+      {
+        int a = (quantized[0][c] << 1) | pbit[0];
+        int b = (quantized[1][c] << 1) | pbit[1];
+        palette[k][c] = ((64 - weights[k]) * a + weights[k] * b + 32) >> 6;
+      }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+      int best = 0, bestError = squaredDistance(block[i], palette[0], 4);
+      for (int p = 1; p < 16; p++)
+      {
+        int error = squaredDistance(block[i], palette[p], 4);
+        if (error < bestError)
+        {
+          best = p;
+          bestError = error;
+        }
+      }
+      indices[i] = best;
+    }
+
+    // the anchor index is stored with its top bit implied zero
+    if (indices[0] & 8)
+    {
+      std::swap(quantized[0], quantized[1]);
+      std::swap(pbit[0], pbit[1]);
+      for (int i = 0; i < 16; i++)
+        indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    BlockBits bits{out};
+    bits.write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+      bits.write((uint32_t)quantized[0][c], 7);
+      bits.write((uint32_t)quantized[1][c], 7);
+    }
+    bits.write((uint32_t)pbit[0], 1);
+    bits.write((uint32_t)pbit[1], 1);
+    bits.write((uint32_t)indices[0], 3);
+    for (int i = 1; i < 16; i++)
+      bits.write((uint32_t)indices[i], 4);
+  }
+} // namespace bc
+
+// compresses one RGBA8 level
+inline std::vector<uint8_t> compressImage(TextureBlockFormat format, const uint8_t *rgba, uint32_t width, uint32_t height)
+{
+  uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  unsigned int blockBytes = blockFormatBytes(format);
+  std::vector<uint8_t> out((size_t)blocksX * blocksY * blockBytes);
+
+  uint8_t block[16][4];
+  for (uint32_t by = 0; by < blocksY; by++)
+    for (uint32_t bx = 0; bx < blocksX; bx++)
+    {
+      uint8_t *dst = out.data() + ((size_t)by * blocksX + bx) * blockBytes;
+      bc::fetchBlock(rgba, width, height, bx, by, block);
+      switch (format)
+      {
+      case BLOCK_BC1:
+        bc::encodeBC1(block, dst);
+        break;
+      case BLOCK_BC3:
+        bc::encodeBC4(block, 3, dst);
+        bc::encodeBC1(block, dst + 8);
+        break;
+      case BLOCK_BC4:
+        bc::encodeBC4(block, 0, dst);
+        break;
+      case BLOCK_BC5:
+        bc::encodeBC4(block, 0, dst);
+        bc::encodeBC4(block, 1, dst + 8);
+        break;
+      case BLOCK_BC7:
+        bc::encodeBC7Mode6(block, dst);
+        break;
+      }
+    }
+  return out;
+}
+
+// 2x2 box filter to the next mip level (odd edges reuse the last row/column)
+inline std::vector<uint8_t> downsampleRGBA(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height, uint32_t &outWidth, uint32_t &outHeight)
+{
+  outWidth = std::max(1u, width / 2);
+  outHeight = std::max(1u, height / 2);
+  std::vector<uint8_t> out((size_t)outWidth * outHeight * 4);
+  for (uint32_t y = 0; y < outHeight; y++)
+    for (uint32_t x = 0; x < outWidth; x++)
+    {
+      uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+      uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+      for (int c = 0; c < 4; c++)
+      {
+        int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c] +
+                  rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+        out[((size_t)y * outWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+      }
+    }
+  return out;
+}
+
+// builds the full mip chain down to 1x1 and compresses every level
+inline CompressedTexture compressWithMips(TextureBlockFormat format, const uint8_t *rgba, uint32_t width, uint32_t height)
+{
+  CompressedTexture texture;
+  texture.format = format;
+  texture.width = width;
+  texture.height = height;
+
+  std::vector<uint8_t> level(rgba, rgba + (size_t)width * height * 4);
+  uint32_t w = width, h = height;
+  for (;;)
+  {
+    std::vector<uint8_t> blocks = compressImage(format, level.data(), w, h);
+    texture.mips.push_back({w, h, texture.data.size(), blocks.size()});
+    texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+    if (w == 1 && h == 1)
+      break;
+    level = downsampleRGBA(level, w, h, w, h);
+  }
+  return texture;
+}
+
+// BC1 for opaque images, BC3 when any pixel is not fully opaque
+inline TextureBlockFormat chooseBlockFormat(const uint8_t *rgba, uint32_t width, uint32_t height)
+{
+  for (size_t i = 0; i < (size_t)width * height; i++)
+    if (rgba[i * 4 + 3] != 255)
+      return BLOCK_BC3;
+  return BLOCK_BC1;
+}
+
+#endif // TEXTURE_COMPRESS_H
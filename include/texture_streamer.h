@@ -0,0 +1,434 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "dds_texture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Background texture loading.
+// request() hands out a texture name right away, filled with a 1x1 magenta placeholder, and queues
+// the file for a pool of decode threads. Finished images come back through a lock-free stack and
+// are uploaded by update() on the GL thread, through a small ring of pixel unpack buffers, until the
+// per-frame byte budget is spent. The texture name never changes, so meshes can bind it immediately.
+//
+// If a cooked "<file>.dds" made by TextureCooker sits next to the requested image and matches it, the
+// pre-compressed mip chain is loaded instead and uploaded with glCompressedTexImage2D: no decode, no
+// glGenerateMipmap. Paths ending in ".dds" are always loaded as compressed textures.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#define TEXTURE_STREAMER_PBO_COUNT 3
+#define TEXTURE_STREAMER_DEFAULT_BUDGET (8u * 1024u * 1024u)
+
+// what a finished texture ended up as on the GPU
+struct TextureInfo
+{
+  unsigned int width = 0;
+  unsigned int height = 0;
+  GLenum internalFormat = 0; // always a sized or compressed format
+  unsigned int levels = 0;
+  size_t gpuBytes = 0; // approximate, including mips
+};
+
+struct TextureStreamerStats
+{
+  unsigned int queued = 0;           // waiting for or being decoded
+  unsigned int pendingUploads = 0;   // decoded, waiting for upload budget
+  unsigned int uploaded = 0;         // total textures uploaded
+  unsigned int failed = 0;           // total files that could not be decoded
+  size_t uploadedBytesLastFrame = 0;
+};
+
+class TextureStreamer
+{
+public:
+  size_t uploadBudgetBytes = TEXTURE_STREAMER_DEFAULT_BUDGET;
+  // called on the GL thread once a requested texture is final (decoded image or kept placeholder)
+  std::function<void(unsigned int textureID, const TextureInfo &info)> onTextureReady;
+
+  static TextureStreamer &instance()
+  {
+    static TextureStreamer streamer;
+    return streamer;
+  }
+
+  TextureStreamer(const TextureStreamer &) = delete;
+  TextureStreamer &operator=(const TextureStreamer &) = delete;
+  ~TextureStreamer() { stopWorkers(); }
+
+  // GL thread. Returns a texture holding the placeholder; the decoded image replaces it later.
+  unsigned int request(const std::string &filename)
+  {
+    if (workers.empty())
+      startWorkers();
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    static const unsigned char magentaPixel[] = {255, 0, 255, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, magentaPixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      jobs.push_back({textureID, filename});
+    }
+    queuedCount.fetch_add(1, std::memory_order_relaxed);
+    jobReady.notify_one();
+    return textureID;
+  }
+
+  // GL thread, once per frame. Uploads finished images until uploadBudgetBytes is used up;
+  // at least one image goes through per call so a single huge texture cannot stall forever.
+  void update()
+  {
+    DecodedImage *list = completed.exchange(nullptr, std::memory_order_acquire);
+    // the stack pops newest first; reverse it so uploads follow request order
+    std::vector<DecodedImage *> batch;
+    for (; list; list = list->next)
+      batch.push_back(list);
+    ready.insert(ready.end(), batch.rbegin(), batch.rend());
+
+    size_t spent = 0;
+    while (!ready.empty())
+    {
+      DecodedImage *image = ready.front();
+      size_t size = uploadSize(*image);
+      if (spent > 0 && spent + size > uploadBudgetBytes)
+        break;
+      ready.pop_front();
+      upload(*image);
+      spent += size;
+      delete image;
+    }
+    uploadedBytesLastFrame = spent;
+  }
+
+  // GL thread. Blocks until every queued texture is decoded and uploaded, ignoring the budget.
+  void finish()
+  {
+    while (queuedCount.load(std::memory_order_acquire) > 0)
+      std::this_thread::yield();
+    size_t budget = uploadBudgetBytes;
+    uploadBudgetBytes = SIZE_MAX;
+    update();
+    uploadBudgetBytes = budget;
+  }
+
+  TextureStreamerStats stats() const
+  {
+    TextureStreamerStats s;
+    s.queued = queuedCount.load(std::memory_order_relaxed);
+    s.pendingUploads = (unsigned int)ready.size();
+    s.uploaded = uploadedCount;
+    s.failed = failedCount;
+    s.uploadedBytesLastFrame = uploadedBytesLastFrame;
+    return s;
+  }
+
+  // GL thread, before the context goes away. Drops anything not yet uploaded.
+  void shutdown()
+  {
+    stopWorkers();
+    for (DecodedImage *list = completed.exchange(nullptr, std::memory_order_acquire); list;)
+    {
+      DecodedImage *next = list->next;
+      freeImage(list);
+      list = next;
+    }
+    for (DecodedImage *image : ready)
+      freeImage(image);
+    ready.clear();
+    if (pbos[0])
+      glDeleteBuffers(TEXTURE_STREAMER_PBO_COUNT, pbos);
+    std::fill(pbos, pbos + TEXTURE_STREAMER_PBO_COUNT, 0u);
+  }
+
+private:
+  struct Job
+  {
+    unsigned int textureID;
+    std::string filename;
+  };
+
+  // decode result, linked into the completion stack by the worker that produced it
+  struct DecodedImage
+  {
+    unsigned int textureID;
+    std::string filename;
+    int width = 0, height = 0, components = 0;
+    unsigned char *pixels = nullptr; // stbi allocation, null if decoding failed
+    bool isCompressed = false;       // loaded from a cooked .dds instead; pixels stays null
+    CompressedTexture compressed;
+    std::string error;
+    DecodedImage *next = nullptr;
+  };
+
+  std::vector<std::thread> workers;
+  std::mutex jobMutex;
+  std::condition_variable jobReady;
+  std::deque<Job> jobs;
+  bool stopping = false;
+
+  std::atomic<DecodedImage *> completed{nullptr};
+  std::atomic<unsigned int> queuedCount{0};
+
+  // GL thread only
+  std::deque<DecodedImage *> ready;
+  GLuint pbos[TEXTURE_STREAMER_PBO_COUNT] = {};
+  unsigned int nextPbo = 0;
+  unsigned int uploadedCount = 0;
+  unsigned int failedCount = 0;
+  size_t uploadedBytesLastFrame = 0;
+
+  TextureStreamer() = default;
+
+  void startWorkers()
+  {
+    stopping = false;
+    unsigned int hw = std::thread::hardware_concurrency();
+    unsigned int count = hw > 1 ? hw - 1 : 1; // leave a core for the render thread
+    for (unsigned int i = 0; i < count; i++)
+      workers.emplace_back([this]
+                           { workerLoop(); });
+  }
+
+  void stopWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(jobMutex);
+      stopping = true;
+      jobs.clear();
+    }
+    jobReady.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+    workers.clear();
+    queuedCount.store(0, std::memory_order_relaxed);
+  }
+
+  void workerLoop()
+  {
+    for (;;)
+    {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobReady.wait(lock, [this]
+                      { return stopping || !jobs.empty(); });
+        if (stopping)
+          return;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+
+      DecodedImage *image = new DecodedImage();
+      image->textureID = job.textureID;
+      image->filename = std::move(job.filename);
+      image->isCompressed = loadCooked(image->filename, image->compressed);
+      if (!image->isCompressed)
+      {
+        image->pixels = stbi_load(image->filename.c_str(), &image->width, &image->height, &image->components, 0);
+        if (!image->pixels)
+          image->error = stbi_failure_reason() ? stbi_failure_reason() : "unknown error";
+      }
+
+      // lock-free push; the GL thread takes the whole stack at once, so there is no ABA problem
+      DecodedImage *head = completed.load(std::memory_order_relaxed);
+      do
+        image->next = head;
+      while (!completed.compare_exchange_weak(head, image, std::memory_order_release, std::memory_order_relaxed));
+      queuedCount.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  static bool loadCooked(const std::string &filename, CompressedTexture &texture)
+  {
+    const std::string extension = COOKED_TEXTURE_EXTENSION;
+    bool isDDS = filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+    if (isDDS)
+      return readDDSTexture(filename, texture);
+    return readDDSTexture(filename + extension, texture, filename);
+  }
+
+  static size_t uploadSize(const DecodedImage &image)
+  {
+    if (image.isCompressed)
+      return image.compressed.data.size();
+    return image.pixels ? (size_t)image.width * image.height * image.components : 0;
+  }
+
+  static GLenum compressedInternalFormat(TextureBlockFormat format)
+  {
+    switch (format)
+    {
+    case BLOCK_BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BLOCK_BC4:
+      return GL_COMPRESSED_RED_RGTC1;
+    case BLOCK_BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    case BLOCK_BC7:
+      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+
+  // fills the next unpack buffer in the ring with `size` bytes; returns the pointer to pass to
+  // glTexImage2D and friends: an offset into the buffer, or `data` itself if mapping failed
+  const void *stageUpload(const void *data, size_t size)
+  {
+    if (!pbos[0])
+      glGenBuffers(TEXTURE_STREAMER_PBO_COUNT, pbos);
+
+    // orphan and refill the next buffer in the ring, so the copy never waits on an earlier upload
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+    nextPbo = (nextPbo + 1) % TEXTURE_STREAMER_PBO_COUNT;
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_DRAW);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst)
+    {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return data;
+    }
+    std::memcpy(dst, data, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return nullptr;
+  }
+
+  // uploads a cooked mip chain as is
+  void uploadCompressed(DecodedImage &image)
+  {
+    const CompressedTexture &texture = image.compressed;
+    GLenum internalFormat = compressedInternalFormat(texture.format);
+    const unsigned char *base = (const unsigned char *)stageUpload(texture.data.data(), texture.data.size());
+
+    glBindTexture(GL_TEXTURE_2D, image.textureID);
+    for (size_t level = 0; level < texture.mips.size(); level++)
+    {
+      const CompressedMip &mip = texture.mips[level];
+      glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, (GLsizei)mip.width, (GLsizei)mip.height, 0,
+                             (GLsizei)mip.size, base + mip.offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.mips.size() - 1);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    TextureInfo info;
+    info.width = texture.width;
+    info.height = texture.height;
+    info.internalFormat = internalFormat;
+    info.levels = (unsigned int)texture.mips.size();
+    info.gpuBytes = texture.data.size();
+    image.compressed = CompressedTexture();
+    uploadedCount++;
+    if (onTextureReady)
+      onTextureReady(image.textureID, info);
+  }
+
+  void upload(DecodedImage &image)
+  {
+    if (image.isCompressed)
+    {
+      uploadCompressed(image);
+      return;
+    }
+    if (!image.pixels)
+    {
+      // keep the magenta placeholder so the missing texture is obvious
+      std::cout << "Texture failed to load at path: " << image.filename << std::endl;
+      std::cout << "STB Error: " << image.error << std::endl;
+      failedCount++;
+      if (onTextureReady)
+        onTextureReady(image.textureID, placeholderInfo());
+      return;
+    }
+
+    // sized internal formats, so the texture can be copied into texture arrays of the same format
+    GLenum format = GL_RGBA, internalFormat = GL_RGBA8;
+    if (image.components == 1)
+      format = GL_RED, internalFormat = GL_R8;
+    else if (image.components == 2)
+      format = GL_RG, internalFormat = GL_RG8;
+    else if (image.components == 3)
+      format = GL_RGB, internalFormat = GL_RGB8;
+
+    size_t size = (size_t)image.width * image.height * image.components;
+    const void *src = stageUpload(image.pixels, size);
+
+    // rows of 1- and 3-channel images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, image.textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, src);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    uploadedCount++;
+    if (onTextureReady)
+    {
+      TextureInfo info;
+      info.width = (unsigned int)image.width;
+      info.height = (unsigned int)image.height;
+      info.internalFormat = internalFormat;
+      info.levels = mipLevelCount((unsigned int)image.width, (unsigned int)image.height);
+      info.gpuBytes = size * 4 / 3;
+      onTextureReady(image.textureID, info);
+    }
+  }
+
+  static unsigned int mipLevelCount(unsigned int width, unsigned int height)
+  {
+    unsigned int levels = 1;
+    while ((width | height) >> levels)
+      levels++;
+    return levels;
+  }
+
+  // the 1x1 magenta texture request() created
+  static TextureInfo placeholderInfo()
+  {
+    TextureInfo info;
+    info.width = 1;
+    info.height = 1;
+    info.internalFormat = GL_RGBA8;
+    info.levels = 1;
+    info.gpuBytes = 4;
+    return info;
+  }
+
+  static void freeImage(DecodedImage *image)
+  {
+    if (image->pixels)
+      stbi_image_free(image->pixels);
+    delete image;
+  }
+};
+
+#endif // TEXTURE_STREAMER_H
@@ -0,0 +1,342 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define MAX_BONE_INFLUENCE 4
+
+// CPU-side authoring vertex. This is what importers and primitives produce; what actually reaches
+// the GPU is decided by a VertexLayout, which packs it into one or two interleaved streams.
+struct Vertex
+{
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 texCoords;
+  glm::vec3 tangent;
+  glm::vec3 bitangent;
+  int m_BoneIDs[MAX_BONE_INFLUENCE];
+  float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+// Attribute locations are fixed per semantic so shaders can keep their layout(location = N).
+enum VertexSemantic
+{
+  VERTEX_POSITION = 0,
+  VERTEX_NORMAL = 1,
+  VERTEX_TEXCOORD = 2,
+  VERTEX_TANGENT = 3,   // xyz = tangent, w = bitangent sign when packed as snorm
+  VERTEX_BITANGENT = 4, // only used by the uncompressed layout
+  VERTEX_BONE_IDS = 5,
+  VERTEX_BONE_WEIGHTS = 6,
+};
+
+enum VertexAttribFormat
+{
+  ATTRIB_FLOAT2,
+  ATTRIB_FLOAT3,
+  ATTRIB_FLOAT4,
+  ATTRIB_HALF2,            // 4 bytes
+  ATTRIB_SNORM_2_10_10_10, // 4 bytes, GL_INT_2_10_10_10_REV normalized
+  ATTRIB_INT4,             // 16 bytes, integer attribute
+  ATTRIB_UINT16x4,         // 8 bytes, integer attribute
+  ATTRIB_UNORM16x4,        // 8 bytes, normalized
+};
+
+struct VertexAttribute
+{
+  VertexSemantic semantic;
+  VertexAttribFormat format;
+  unsigned int stream; // 0 = static geometry, 1 = skinning data
+};
+
+inline unsigned int vertexAttribFormatSize(VertexAttribFormat format)
+{
+  switch (format)
+  {
+  case ATTRIB_FLOAT2:
+    return 8;
+  case ATTRIB_FLOAT3:
+    return 12;
+  case ATTRIB_FLOAT4:
+    return 16;
+  case ATTRIB_HALF2:
+    return 4;
+  case ATTRIB_SNORM_2_10_10_10:
+    return 4;
+  case ATTRIB_INT4:
+    return 16;
+  case ATTRIB_UINT16x4:
+    return 8;
+  case ATTRIB_UNORM16x4:
+    return 8;
+  }
+  return 0;
+}
+
+// 10:10:10:2 signed normalized, x in the low bits (GL_INT_2_10_10_10_REV)
+inline uint32_t packSnorm1010102(glm::vec4 v)
+{
+  auto pack = [](float f, int bits)
+  {
+    int maxValue = (1 << (bits - 1)) - 1;
+    int q = (int)std::round(std::clamp(f, -1.0f, 1.0f) * (float)maxValue);
+    return (uint32_t)q & ((1u << bits) - 1u);
+  };
+  return pack(v.x, 10) | (pack(v.y, 10) << 10) | (pack(v.z, 10) << 20) | (pack(v.w, 2) << 30);
+}
+
+inline glm::vec4 unpackSnorm1010102(uint32_t p)
+{
+  auto unpack = [](uint32_t bits, int count)
+  {
+    int value = (int)(bits << (32 - count)) >> (32 - count); // sign extend
+    int maxValue = (1 << (count - 1)) - 1;
+    return std::max((float)value / (float)maxValue, -1.0f);
+  };
+  return glm::vec4(unpack(p & 0x3FF, 10), unpack((p >> 10) & 0x3FF, 10), unpack((p >> 20) & 0x3FF, 10), unpack(p >> 30, 2));
+}
+
+// Which attributes a mesh uploads and in what format. GeometryPool builds each arena's buffers and
+// attribute pointers purely from this description.
+class VertexLayout
+{
+public:
+  std::vector<VertexAttribute> attributes;
+
+  // 24 bytes: float3 position, 10_10_10_2 normal, half2 uv, 10_10_10_2 tangent + bitangent sign
+  static VertexLayout compactStatic()
+  {
+    VertexLayout layout;
+    layout.attributes = {
+        {VERTEX_POSITION, ATTRIB_FLOAT3, 0},
+        {VERTEX_NORMAL, ATTRIB_SNORM_2_10_10_10, 0},
+        {VERTEX_TEXCOORD, ATTRIB_HALF2, 0},
+        {VERTEX_TANGENT, ATTRIB_SNORM_2_10_10_10, 0},
+    };
+    return layout;
+  }
+
+  // compactStatic plus a 16 byte second stream: uint16x4 bone ids, unorm16x4 weights
+  static VertexLayout compactSkinned()
+  {
+    VertexLayout layout = compactStatic();
+    layout.attributes.push_back({VERTEX_BONE_IDS, ATTRIB_UINT16x4, 1});
+    layout.attributes.push_back({VERTEX_BONE_WEIGHTS, ATTRIB_UNORM16x4, 1});
+    return layout;
+  }
+
+  // the original 88 byte all-float layout, kept for debugging precision issues
+  static VertexLayout uncompressed()
+  {
+    VertexLayout layout;
+    layout.attributes = {
+        {VERTEX_POSITION, ATTRIB_FLOAT3, 0},
+        {VERTEX_NORMAL, ATTRIB_FLOAT3, 0},
+        {VERTEX_TEXCOORD, ATTRIB_FLOAT2, 0},
+        {VERTEX_TANGENT, ATTRIB_FLOAT3, 0},
+        {VERTEX_BITANGENT, ATTRIB_FLOAT3, 0},
+        {VERTEX_BONE_IDS, ATTRIB_INT4, 0},
+        {VERTEX_BONE_WEIGHTS, ATTRIB_FLOAT4, 0},
+    };
+    return layout;
+  }
+
+  // skinned layout only if some vertex actually carries bone weights
+  static VertexLayout forVertices(const std::vector<Vertex> &vertices)
+  {
+    for (const Vertex &v : vertices)
+      for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+        if (v.m_Weights[j] > 0.0f)
+          return compactSkinned();
+    return compactStatic();
+  }
+
+  unsigned int streamCount() const
+  {
+    unsigned int count = 0;
+    for (const VertexAttribute &a : attributes)
+      count = std::max(count, a.stream + 1);
+    return count;
+  }
+
+  unsigned int stride(unsigned int stream) const
+  {
+    unsigned int size = 0;
+    for (const VertexAttribute &a : attributes)
+      if (a.stream == stream)
+        size += vertexAttribFormatSize(a.format);
+    return size;
+  }
+
+  unsigned int offset(size_t attributeIndex) const
+  {
+    unsigned int size = 0;
+    for (size_t i = 0; i < attributeIndex; i++)
+      if (attributes[i].stream == attributes[attributeIndex].stream)
+        size += vertexAttribFormatSize(attributes[i].format);
+    return size;
+  }
+
+  // total GPU bytes for n vertices across all streams
+  size_t bytesFor(size_t vertexCount) const
+  {
+    size_t size = 0;
+    for (unsigned int s = 0; s < streamCount(); s++)
+      size += (size_t)stride(s) * vertexCount;
+    return size;
+  }
+
+  // interleaves the vertices of one stream into a byte blob ready for glBufferData
+  std::vector<unsigned char> pack(const std::vector<Vertex> &vertices, unsigned int stream) const
+  {
+    unsigned int vertexStride = stride(stream);
+    std::vector<unsigned char> data((size_t)vertexStride * vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+      unsigned char *dst = data.data() + v * vertexStride;
+      for (size_t i = 0; i < attributes.size(); i++)
+      {
+        if (attributes[i].stream != stream)
+          continue;
+        writeAttribute(dst + offset(i), attributes[i], vertices[v]);
+      }
+    }
+    return data;
+  }
+
+  bool operator==(const VertexLayout &other) const
+  {
+    return attributes.size() == other.attributes.size() &&
+           std::equal(attributes.begin(), attributes.end(), other.attributes.begin(), [](const VertexAttribute &a, const VertexAttribute &b)
+                      { return a.semantic == b.semantic && a.format == b.format && a.stream == b.stream; });
+  }
+
+  // sets up attribute pointers for one stream; the VBO for that stream must be bound
+  void applyAttributes(unsigned int stream) const
+  {
+    GLsizei vertexStride = (GLsizei)stride(stream);
+    for (size_t i = 0; i < attributes.size(); i++)
+    {
+      const VertexAttribute &a = attributes[i];
+      if (a.stream != stream)
+        continue;
+      GLuint location = (GLuint)a.semantic;
+      void *ptr = (void *)(uintptr_t)offset(i);
+      glEnableVertexAttribArray(location);
+      switch (a.format)
+      {
+      case ATTRIB_FLOAT2:
+        glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, vertexStride, ptr);
+        break;
+      case ATTRIB_FLOAT3:
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, vertexStride, ptr);
+        break;
+      case ATTRIB_FLOAT4:
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, vertexStride, ptr);
+        break;
+      case ATTRIB_HALF2:
+        glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, vertexStride, ptr);
+        break;
+      case ATTRIB_SNORM_2_10_10_10:
+        glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertexStride, ptr);
+        break;
+      case ATTRIB_INT4:
+        glVertexAttribIPointer(location, 4, GL_INT, vertexStride, ptr);
+        break;
+      case ATTRIB_UINT16x4:
+        glVertexAttribIPointer(location, 4, GL_UNSIGNED_SHORT, vertexStride, ptr);
+        break;
+      case ATTRIB_UNORM16x4:
+        glVertexAttribPointer(location, 4, GL_UNSIGNED_SHORT, GL_TRUE, vertexStride, ptr);
+        break;
+      }
+    }
+  }
+
+private:
+  static float bitangentSign(const Vertex &v)
+  {
+    return glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? -1.0f : 1.0f;
+  }
+
+  static void writeAttribute(unsigned char *dst, const VertexAttribute &a, const Vertex &v)
+  {
+    switch (a.semantic)
+    {
+    case VERTEX_POSITION:
+      writeVector(dst, a.format, glm::vec4(v.position, 1.0f));
+      break;
+    case VERTEX_NORMAL:
+      writeVector(dst, a.format, glm::vec4(v.normal, 0.0f));
+      break;
+    case VERTEX_TEXCOORD:
+      writeVector(dst, a.format, glm::vec4(v.texCoords, 0.0f, 0.0f));
+      break;
+    case VERTEX_TANGENT:
+      writeVector(dst, a.format, glm::vec4(v.tangent, bitangentSign(v)));
+      break;
+    case VERTEX_BITANGENT:
+      writeVector(dst, a.format, glm::vec4(v.bitangent, 0.0f));
+      break;
+    case VERTEX_BONE_IDS:
+      if (a.format == ATTRIB_INT4)
+        std::memcpy(dst, v.m_BoneIDs, sizeof(v.m_BoneIDs));
+      else
+      {
+        uint16_t ids[MAX_BONE_INFLUENCE];
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+          ids[j] = (uint16_t)std::max(v.m_BoneIDs[j], 0);
+        std::memcpy(dst, ids, sizeof(ids));
+      }
+      break;
+    case VERTEX_BONE_WEIGHTS:
+      writeVector(dst, a.format, glm::vec4(v.m_Weights[0], v.m_Weights[1], v.m_Weights[2], v.m_Weights[3]));
+      break;
+    }
+  }
+
+  static void writeVector(unsigned char *dst, VertexAttribFormat format, glm::vec4 value)
+  {
+    switch (format)
+    {
+    case ATTRIB_FLOAT2:
+    case ATTRIB_FLOAT3:
+    case ATTRIB_FLOAT4:
+      std::memcpy(dst, &value[0], vertexAttribFormatSize(format));
+      break;
+    case ATTRIB_HALF2:
+    {
+      uint32_t packed = glm::packHalf2x16(glm::vec2(value));
+      std::memcpy(dst, &packed, sizeof(packed));
+      break;
+    }
+    case ATTRIB_SNORM_2_10_10_10:
+    {
+      uint32_t packed = packSnorm1010102(value);
+      std::memcpy(dst, &packed, sizeof(packed));
+      break;
+    }
+    case ATTRIB_UNORM16x4:
+    {
+      uint16_t q[4];
+      for (int j = 0; j < 4; j++)
+        q[j] = (uint16_t)std::round(std::clamp(value[j], 0.0f, 1.0f) * 65535.0f);
+      std::memcpy(dst, q, sizeof(q));
+      break;
+    }
+    case ATTRIB_INT4:
+    case ATTRIB_UINT16x4:
+      break; // integer formats only carry bone ids
+    }
+  }
+};
+
+#endif // VERTEX_LAYOUT_H
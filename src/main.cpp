@@ -9,12 +9,30 @@
 #include <primitives.h>
 #include <shader.h>
 #include <buffers.h>
+#include <clustered_lighting.h>
+#include <frame_graph.h>
+#include <frustum_culling.h>
+#include <gbuffer_encoding.h>
+#include <geometry_pool.h>
+#include <gpu_driven.h>
+#include <gpu_timer.h>
+#include <hiz.h>
+#include <material.h>
+#include <maze_streaming.h>
+#include <model_instances.h>
+#include <render_queue.h>
+#include <scene_index.h>
+#include <ssao.h>
+#include <taa.h>
+#include <texture_cache.h>
+#include <texture_streamer.h>
 
 // ImGui includes
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
 #include "imgui/imgui.h"
 
+#include <chrono>
 #include <iostream>
 #include <stb_image.h>
 
@@ -33,6 +51,7 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void key_callback(GLFWwindow *window, int key, int scancode, int action,
                   int mods);
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
 void processInput(GLFWwindow *window);
 // void drawIMGUI(Renderer *myRenderer, iCubeModel *cubeSystem,
 //                SceneGraph *sg, std::map<std::string, unsigned int> texMap,
@@ -42,6 +61,11 @@ void drawIMGUI(GLFWwindow *window, Camera &camera, float &deltaTime,
                float &lastFrame, GBuffer &gbuffer, unsigned int ssaoColor,
                unsigned int ssaoColorBlur);
 unsigned int loadTexture(char const *path);
+struct CullingBenchmark;
+void runCullingBenchmark(CullingBenchmark &bench, const Frustum &frustum);
+struct BVHBenchmark;
+void runBVHBenchmark(BVHBenchmark &bench);
+void rebuildGpuScene();
 ImVec4 clear_color = ImVec4(0.01, 0.01, 0.01, 1.00f);
 
 // settings
@@ -49,6 +73,9 @@ const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 // const unsigned int SCR_WIDTH = 1920;
 // const unsigned int SCR_HEIGHT = 1080;
+// framebuffer size in pixels, kept by framebuffer_size_callback; the deferred targets follow it
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
 
 // camera
 Camera camera(glm::vec3(5.0f, 1.0f, 5.0f));
@@ -61,11 +88,124 @@ bool mouseDisabled = false;
 float deltaTime = 0.0f; // time between current frame and last frame
 float lastFrame = 0.0f;
 
+// clustered lighting debug / light-count benchmark
+struct LightingDebug
+{
+  bool useClusters = true;
+  int extraLightCount = 0; // random lights added on top of the scene lights
+  int totalLights = 0;
+  float cullMs = 0.0f;
+  float lightingMs = 0.0f;
+};
+LightingDebug lightingDebug;
+
+// Reduced-resolution SSAO: settings and per-pass GPU times in the SSAO panel
+SSAOPipeline ssaoPipeline;
+
+// Temporal anti-aliasing of the deferred path: jittered projection, G-buffer motion vectors, resolve
+TemporalAA taa;
+bool taaEnabled = true;
+
+// The deferred frame as a frame graph, declared every frame; the pool behind it outlives frames
+FrameGraph frameGraph;
+
+// G-buffer debug viewer selection. The ImGui pass reads what it shows, so those targets stay
+// alive (and unaliased) to the end of the frame
+struct GBufferViewer
+{
+  int selected = 0;
+  int hiZLevel = 0;
+  bool thumbnails = false;
+};
+GBufferViewer gbufferViewer;
+
+// Draw submission: one queue per frame, executed through a shared GL state cache
+RenderQueue renderQueue;
+GLStateCache glState;
+RenderCounters lastFrameCounters;
+
+// LOD selection: pixel budget and overrides from the Render Queue panel, camera terms per frame
+LodSelection lodSettings;
+
+// Frustum culling: planes extracted once per frame, meshes tested before they reach the queue
+bool frustumCullingEnabled = true;
+Frustum cameraFrustum;
+CullingStats lastFrameCulling;
+
+// Meshlet culling of LOD 0 draws (frustum + normal cones), on both the queue and the GPU-driven path
+MeshletCullSettings meshletSettings;
+MeshletCullStats lastFrameMeshlets;
+
+// scalar vs SIMD culling over random boxes, run from the Render Queue panel
+struct CullingBenchmark
+{
+  int boxCount = 100000;
+  double scalarMs = 0.0;
+  double simdMs = 0.0;
+  size_t scalarVisible = 0;
+  size_t simdVisible = 0;
+  bool listsMatch = true; // same indices in the same order, not just the same count
+  bool ran = false;
+};
+CullingBenchmark cullingBenchmark;
+
+// Scene BVH: every placed mesh, queried for culling and for mouse picking (left click with the
+// cursor released)
+SceneIndex sceneIndex;
+ScenePick lastPick;
+
+// refit cost of the BVH under many moving objects, run from the Scene BVH panel
+struct BVHBenchmark
+{
+  int objectCount = 100000;
+  double insertMs = 0.0;
+  double moveMs = 0.0;  // incremental: reinsert only objects that left their fat box
+  double refitMs = 0.0; // update every leaf, then one bottom-up refit
+  double rebuildMs = 0.0;
+  double queryMs = 0.0;
+  unsigned int reinserted = 0;
+  unsigned int queryHits = 0; // leaves the camera frustum touches after the rebuild
+  float refitSah = 0.0f;
+  float rebuildSah = 0.0f;
+  bool ran = false;
+};
+BVHBenchmark bvhBenchmark;
+
+// GPU-driven geometry pass: compute culling + one multi-draw per bucket. Stress copies tile the
+// scene on a grid to push the instance count into the 100k range.
+GpuDrivenScene gpuScene;
+bool gpuDrivenEnabled = false;
+bool gpuSceneDirty = true;
+int gpuStressCopies = 0;
+std::vector<uint32_t> gpuFallbackObjects; // scene objects the GPU path cannot draw
+
+// Two-phase occlusion culling on the GPU-driven path: draw last frame's visible set, build the
+// Hi-Z pyramid from its depth, then test the rest against it
+HiZPyramid hiZPyramid;
+bool occlusionCullingEnabled = true;
+
+// Instanced herd of the cow model on a grid: one transform buffer, one draw per mesh and LOD.
+// The count slider rebuilds the set; the GPU timer covers the instanced draws only.
+struct InstancingBenchmark
+{
+  int count = 0;
+  bool dirty = false;
+  float spacing = 3.0f;
+  ModelInstanceStats stats;
+  float gpuMs = 0.0f;
+};
+InstancingBenchmark instancingBenchmark;
+
+// Endless backrooms maze streamed in 128x128 chunks around the camera
+MazeStreamer mazeStreamer;
+bool mazeEnabled = false;
+
 int main()
 {
   // Initialize GLFW
   glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  // 4.3 for shader storage buffers and explicit block bindings
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -85,9 +225,11 @@ int main()
   }
   glfwMakeContextCurrent(window);
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
   glfwSetCursorPosCallback(window, mouse_callback);
   glfwSetScrollCallback(window, scroll_callback);
   glfwSetKeyCallback(window, key_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
 
   // Disable V-Sync to unlock framerate
   glfwSwapInterval(0);
@@ -155,6 +297,12 @@ int main()
   Model myModel(std::string(RUNTIME_DATA_DIR) + "/models/cow/source/sample-3d_glb.glb");
   // myModel.setDefaultTexture("data/models/cow/textures/Textured_mesh_1_0.jpeg");
   myModel.setDefaultTexture(std::string(RUNTIME_DATA_DIR) + "/models/cow/textures/Textured_mesh_1_0.jpeg");
+  sceneIndex.addModel(myModel, glm::mat4(1.0f));
+  ModelInstanceSet cowHerd(myModel);
+  Shader modelInstancedShader(
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/model_instanced.vs").c_str(),
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/model.fs").c_str(),
+      "modelInstancedShader");
 
   // std::cout << "Model loaded with " << myModel.meshes.size() << " meshes"
   //           << std::endl;
@@ -165,32 +313,29 @@ int main()
   //             << std::endl;
   // }
 
-  GBuffer gbuffer;
 #ifdef USE_DEFERRED
-  if (!gbuffer.init(SCR_WIDTH, SCR_HEIGHT))
-  {
-    std::cout << "GBuffer init failed\n";
-  }
   // Shader deferredGeometryShader("data/shaders/deferred.vs", "data/shaders/deferred.fs", "deferredGeometryShader");
   Shader deferredGeometryShader(
       (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred.vs").c_str(),
       (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred.fs").c_str(),
       "deferredGeometryShader");
+  Shader deferredIndirectShader(
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred_indirect.vs").c_str(),
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred.fs").c_str(),
+      "deferredIndirectShader");
+  Shader deferredInstancedShader(
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred_instanced.vs").c_str(),
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred.fs").c_str(),
+      "deferredInstancedShader");
+  Shader mazeWallShader(
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/backrooms_wall.vs").c_str(),
+      (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred.fs").c_str(),
+      "mazeWallShader");
   // Shader deferredLightingShader("data/shaders/fullscreen_quad.vs", "data/shaders/deferred_lighting.fs", "deferredLightingShader");
   Shader deferredLightingShader(
       (std::string(RUNTIME_DATA_DIR) + "/shaders/fullscreen_quad.vs").c_str(),
       (std::string(RUNTIME_DATA_DIR) + "/shaders/deferred_lighting.fs").c_str(),
       "deferredLightingShader");
-  // Shader ssaoShader("data/shaders/fullscreen_quad.vs", "data/shaders/ssao.fs", "ssaoShader");
-  Shader ssaoShader(
-      (std::string(RUNTIME_DATA_DIR) + "/shaders/fullscreen_quad.vs").c_str(),
-      (std::string(RUNTIME_DATA_DIR) + "/shaders/ssao.fs").c_str(),
-      "ssaoShader");
-  // Shader ssaoBlurShader("data/shaders/fullscreen_quad.vs", "data/shaders/ssao_blur.fs", "ssaoBlurShader");
-  Shader ssaoBlurShader(
-      (std::string(RUNTIME_DATA_DIR) + "/shaders/fullscreen_quad.vs").c_str(),
-      (std::string(RUNTIME_DATA_DIR) + "/shaders/ssao_blur.fs").c_str(),
-      "ssaoBlurShader");
 #endif
 
   // Fullscreen quad
@@ -216,68 +361,6 @@ int main()
     glBindVertexArray(0);
   }
 
-  // SSAO FBOs
-  unsigned int ssaoFBO = 0, ssaoBlurFBO = 0;
-  unsigned int ssaoColor = 0, ssaoColorBlur = 0;
-#ifdef USE_DEFERRED
-  glGenFramebuffers(1, &ssaoFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-  glGenTextures(1, &ssaoColor);
-  glBindTexture(GL_TEXTURE_2D, ssaoColor);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColor, 0);
-
-  glGenFramebuffers(1, &ssaoBlurFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-  glGenTextures(1, &ssaoColorBlur);
-  glBindTexture(GL_TEXTURE_2D, ssaoColorBlur);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBlur, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-#endif
-
-  // SSAO kernel + noise
-  std::array<glm::vec3, 64> ssaoKernel;
-  std::vector<glm::vec3> ssaoNoise;
-#ifdef USE_DEFERRED
-  {
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    std::default_random_engine rng;
-    for (int i = 0; i < 64; i++)
-    {
-      glm::vec3 s(
-          dist(rng) * 2.0f - 1.0f,
-          dist(rng) * 2.0f - 1.0f,
-          dist(rng));
-      s = glm::normalize(s);
-      float scale = float(i) / 64.0f;
-      scale = glm::mix(0.1f, 1.0f, scale * scale);
-      ssaoKernel[i] = s * scale;
-    }
-    for (int i = 0; i < 16; i++)
-    {
-      ssaoNoise.emplace_back(
-          dist(rng) * 2.0f - 1.0f,
-          dist(rng) * 2.0f - 1.0f,
-          0.0f);
-    }
-  }
-  unsigned int noiseTex = 0;
-  {
-    glGenTextures(1, &noiseTex);
-    glBindTexture(GL_TEXTURE_2D, noiseTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, 4, 4, 0, GL_RGB, GL_FLOAT, ssaoNoise.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  }
-#endif
-
   struct PointLight
   {
     glm::vec3 pos;
@@ -297,6 +380,42 @@ int main()
       (std::string(RUNTIME_DATA_DIR) + "/shaders/lights.fs").c_str(),
       "lightVolumeShader");
 
+  // Per-frame camera block shared by every program, and the packed point light array
+  UniformBuffer cameraUBO;
+  cameraUBO.init(sizeof(CameraBlock), UBO_BINDING_CAMERA);
+  StorageBuffer pointLightSSBO;
+  pointLightSSBO.init((GLsizeiptr)(pointLights.size() * sizeof(GpuPointLight)), SSBO_BINDING_POINT_LIGHTS);
+  std::vector<GpuPointLight> gpuPointLights;
+  gpuPointLights.reserve(pointLights.size());
+
+  // Clustered light culling + per-pass GPU timers for the light-count benchmark
+  ClusteredLighting clusteredLighting;
+  clusteredLighting.init(std::string(RUNTIME_DATA_DIR) + "/shaders");
+  gpuScene.init(std::string(RUNTIME_DATA_DIR) + "/shaders");
+  // textures that outlive a frame are resized in the loop; the frame graph's follow on their own
+  int renderWidth = framebufferWidth, renderHeight = framebufferHeight;
+  hiZPyramid.init(std::string(RUNTIME_DATA_DIR) + "/shaders", renderWidth, renderHeight);
+  ssaoPipeline.init(std::string(RUNTIME_DATA_DIR) + "/shaders");
+  taa.init(std::string(RUNTIME_DATA_DIR) + "/shaders", renderWidth, renderHeight);
+  mazeStreamer.init(3.0f);
+  GpuTimer cullTimer, lightingTimer, instancingTimer;
+  cullTimer.init();
+  lightingTimer.init();
+  instancingTimer.init();
+  std::vector<GpuPointLight> extraLights;
+
+  // Uniform handles are hashed once here; the render loop only probes each shader's reflected table.
+  static constexpr UniformHandle uModel("model");
+  static constexpr UniformHandle uTime("uTime");
+  static constexpr UniformHandle uAlpha("alpha");
+  static constexpr UniformHandle uLightColor("lightColor");
+  static constexpr UniformHandle uPointLightCount("uPointLightCount");
+  static constexpr UniformHandle uUseClusters("uUseClusters");
+
+  // last frame's unjittered view-projection, for motion vectors
+  glm::mat4 previousViewProjection(1.0f);
+  bool havePreviousFrame = false;
+
   // render loop
   // -----------
   while (!glfwWindowShouldClose(window))
@@ -311,6 +430,21 @@ int main()
     // -----
     processInput(window);
 
+    if (framebufferWidth != renderWidth || framebufferHeight != renderHeight)
+    {
+      renderWidth = framebufferWidth;
+      renderHeight = framebufferHeight;
+      hiZPyramid.resize(renderWidth, renderHeight);
+      taa.resize(renderWidth, renderHeight);
+    }
+
+    // finish textures the decode threads have produced, within this frame's upload budget
+    TextureStreamer::instance().update();
+    // copy newly arrived textures into the material arrays
+    MaterialLibrary::instance().update();
+    // compact vertex/index arenas that unloaded meshes left fragmented
+    GeometryPool::instance().update();
+
     // render
     // ------
     //     glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
@@ -346,125 +480,304 @@ int main()
     // wallShader.setFloat("material.shininess", 32.0f);
 
     // // Bind wall texture
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-                                            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    // rasterization uses the jittered projection; culling, clusters and motion vectors the plain one
+    float aspect = (float)renderWidth / (float)renderHeight;
+    glm::vec2 jitter = taaEnabled ? taa.nextJitter() : glm::vec2(0.0f);
+    glm::mat4 unjitteredProjection = camera.GetProjectionMatrix(aspect, 0.1f, 100.0f);
+    glm::mat4 projection = camera.GetProjectionMatrix(aspect, 0.1f, 100.0f, jitter);
     glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 viewProjection = unjitteredProjection * view;
+    if (!havePreviousFrame)
+      previousViewProjection = viewProjection;
+
+    CameraBlock cameraBlock;
+    cameraBlock.projection = projection;
+    cameraBlock.view = view;
+    cameraBlock.viewPos = glm::vec4(camera.Position, 1.0f);
+    cameraBlock.inverseProjection = glm::inverse(projection);
+    cameraBlock.inverseViewProjection = glm::inverse(projection * view);
+    cameraBlock.viewProjection = viewProjection;
+    cameraBlock.previousViewProjection = previousViewProjection;
+    cameraBlock.jitter = glm::vec4(jitter, taaEnabled ? taa.previousJitter() : glm::vec2(0.0f));
+    cameraUBO.update(cameraBlock);
+
+    cameraFrustum = Frustum::fromMatrix(viewProjection);
+    lodSettings.setCamera(camera.Position, camera.Zoom, (float)renderHeight);
+    renderQueue.lodSelection = lodSettings;
+    gpuScene.setLodSelection(lodSettings);
+    renderQueue.meshletCulling = meshletSettings;
+    renderQueue.meshletFrustum = cameraFrustum;
+    gpuScene.setMeshletCulling(meshletSettings);
+    const Frustum *cullFrustum = frustumCullingEnabled ? &cameraFrustum : nullptr;
+    CullingStats frameCulling;
+
+    glState.resetCounters();
+    renderQueue.begin(camera.Position);
+
+    if (instancingBenchmark.dirty)
+    {
+      // square grid behind the origin, deterministic yaw per cow
+      cowHerd.clear();
+      cowHerd.reserve((size_t)instancingBenchmark.count);
+      int side = (int)std::ceil(std::sqrt((float)instancingBenchmark.count));
+      std::mt19937 rng(19);
+      std::uniform_real_distribution<float> yaw(0.0f, glm::two_pi<float>());
+      for (int i = 0; i < instancingBenchmark.count; i++)
+      {
+        glm::vec3 position((i % side - side / 2) * instancingBenchmark.spacing, 0.0f, -(i / side + 1) * instancingBenchmark.spacing);
+        cowHerd.add(glm::rotate(glm::translate(glm::mat4(1.0f), position), yaw(rng), glm::vec3(0.0f, 1.0f, 0.0f)));
+      }
+      instancingBenchmark.dirty = false;
+    }
+    cowHerd.update(cullFrustum, lodSettings);
+    if (mazeEnabled)
+      mazeStreamer.update(camera.Position);
+
+    // frame counters for the UI, taken just before it is drawn
+    auto recordFrameStats = [&]()
+    {
+      instancingBenchmark.stats = cowHerd.stats();
+      instancingBenchmark.gpuMs = instancingTimer.milliseconds();
+      lastFrameCounters = glState.counters;
+      lastFrameCulling = frameCulling;
+      lastFrameMeshlets = renderQueue.meshletStats();
+    };
 
 #ifdef USE_DEFERRED
+    // Light upload + clustered culling; buffers only, so it runs ahead of the frame graph
+    if ((int)extraLights.size() != lightingDebug.extraLightCount)
+    {
+      // deterministic so timings are comparable between runs
+      std::default_random_engine lightRng(1337);
+      std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+      extraLights.clear();
+      for (int i = 0; i < lightingDebug.extraLightCount; i++)
+      {
+        glm::vec3 pos(unit(lightRng) * 40.0f - 20.0f, unit(lightRng) * 3.0f, unit(lightRng) * 40.0f - 20.0f);
+        glm::vec3 color(unit(lightRng), unit(lightRng), unit(lightRng));
+        extraLights.push_back({glm::vec4(pos, 1.0f + unit(lightRng) * 2.0f), glm::vec4(color * 0.5f, 1.0f)});
+      }
+    }
+    gpuPointLights.clear();
+    for (const auto &pl : pointLights)
+      gpuPointLights.push_back({glm::vec4(pl.pos, pl.radius), glm::vec4(pl.color, 1.0f)});
+    gpuPointLights.insert(gpuPointLights.end(), extraLights.begin(), extraLights.end());
+    pointLightSSBO.upload(gpuPointLights);
+    lightingDebug.totalLights = (int)gpuPointLights.size();
+
+    cullTimer.begin();
+    if (lightingDebug.useClusters)
+      clusteredLighting.update(unjitteredProjection, (int)gpuPointLights.size());
+    cullTimer.end();
+
+    // Declare the frame: every pass names what it reads and writes; execute() culls, orders and
+    // hands out pooled targets of the current framebuffer size
+    frameGraph.reset();
+    FrameGraphResource backbuffer = frameGraph.importBackbuffer(renderWidth, renderHeight);
+    auto targetDesc = [&](GLenum format)
+    {
+      FrameGraphTextureDesc desc;
+      desc.width = renderWidth;
+      desc.height = renderHeight;
+      desc.format = format;
+      return desc;
+    };
+
     // Geometry pass
-    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.fbo);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    deferredGeometryShader.use();
-    deferredGeometryShader.setMat4("projection", projection);
-    deferredGeometryShader.setMat4("view", view);
-    glm::mat4 modelMat(1.0f);
-    deferredGeometryShader.setMat4("model", modelMat);
-    deferredGeometryShader.setFloat("uTime", currentFrame);
-    myModel.Draw(deferredGeometryShader);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // SSAO pass
-    ssaoShader.use();
-    ssaoShader.setMat4("projection", projection);
-    ssaoShader.setFloat("radius", 0.5f);
-    ssaoShader.setFloat("bias", 0.025f);
-    for (int i = 0; i < 64; i++)
-      ssaoShader.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texPosition);
-    ssaoShader.setInt("gPosition", 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texNormal);
-    ssaoShader.setInt("gNormal", 1);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, noiseTex);
-    ssaoShader.setInt("noiseTex", 2);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // SSAO blur
-    ssaoBlurShader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ssaoColor);
-    ssaoBlurShader.setInt("ssaoInput", 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    FrameGraphResource gTargets[GBuffer::GBUFFER_NUM_TEXTURES], gDepth;
+    {
+      const char *targetNames[GBuffer::GBUFFER_NUM_TEXTURES] = {"G-buffer normal", "G-buffer albedo+metal", "G-buffer rough+AO+emiss", "G-buffer motion"};
+      FrameGraphBuilder pass = frameGraph.addPass("Geometry");
+      for (int i = 0; i < GBuffer::GBUFFER_NUM_TEXTURES; i++)
+        gTargets[i] = pass.colorAttachment(frameGraph.createTexture(targetNames[i], targetDesc(GBuffer::FORMATS[i])));
+      gDepth = pass.depthAttachment(frameGraph.createTexture("G-buffer depth", targetDesc(GBuffer::DEPTH_FORMAT)));
+      if (gpuDrivenEnabled && occlusionCullingEnabled)
+        pass.write(frameGraph.importTexture("Hi-Z pyramid", hiZPyramid.texture, targetDesc(GL_R32F)));
+      pass.execute([&](const FrameGraphPassContext &context)
+                   {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        const GLfloat noMotion[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        glClearBufferfv(GL_COLOR, GBuffer::GBUFFER_TEXTURE_TYPE_MOTION, noMotion);
+        deferredGeometryShader.use();
+        deferredGeometryShader.setFloat(uTime, currentFrame);
+        if (gpuDrivenEnabled)
+        {
+          if (gpuSceneDirty)
+          {
+            rebuildGpuScene();
+            gpuSceneDirty = false;
+          }
+          GpuCullPhase firstPhase = occlusionCullingEnabled ? GPU_CULL_PREVIOUS_VISIBLE : GPU_CULL_FRUSTUM;
+          gpuScene.cull(cameraFrustum, firstPhase);
+          deferredIndirectShader.use();
+          deferredIndirectShader.setFloat(uTime, currentFrame);
+          gpuScene.draw(deferredIndirectShader, glState, firstPhase);
+          // fallback meshes are drawn before the pyramid is built so they occlude too
+          for (uint32_t id : gpuFallbackObjects)
+            renderQueue.submit(*sceneIndex.objects[id].mesh, deferredGeometryShader, sceneIndex.objects[id].transform, RENDER_PASS_GEOMETRY,
+                               &sceneIndex.objects[id].previousTransform);
+          renderQueue.sort();
+          renderQueue.execute(RENDER_PASS_GEOMETRY, glState);
+          instancingTimer.begin();
+          cowHerd.draw(deferredInstancedShader, glState);
+          instancingTimer.end();
+          if (mazeEnabled)
+            mazeStreamer.draw(mazeWallShader, glState, cullFrustum);
+          if (occlusionCullingEnabled)
+          {
+            hiZPyramid.build(context.texture(gDepth));
+            gpuScene.cull(cameraFrustum, GPU_CULL_OCCLUSION, hiZPyramid.texture);
+            gpuScene.draw(deferredIndirectShader, glState, GPU_CULL_OCCLUSION);
+          }
+        }
+        else
+        {
+          sceneIndex.submit(renderQueue, deferredGeometryShader, RENDER_PASS_GEOMETRY, cullFrustum, &frameCulling);
+          renderQueue.sort();
+          renderQueue.execute(RENDER_PASS_GEOMETRY, glState);
+          instancingTimer.begin();
+          cowHerd.draw(deferredInstancedShader, glState);
+          instancingTimer.end();
+          if (mazeEnabled)
+            mazeStreamer.draw(mazeWallShader, glState, cullFrustum);
+        } });
+    }
+    FrameGraphResource gNormal = gTargets[GBuffer::GBUFFER_TEXTURE_TYPE_NORMAL];
+    FrameGraphResource gAlbedoMetal = gTargets[GBuffer::GBUFFER_TEXTURE_TYPE_ALBEDO_METAL];
+    FrameGraphResource gRoughAoEmiss = gTargets[GBuffer::GBUFFER_TEXTURE_TYPE_ROUGH_AO_EMISS];
+    FrameGraphResource gMotion = gTargets[GBuffer::GBUFFER_TEXTURE_TYPE_MOTION];
 
-    // Lighting pass
-    glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    deferredLightingShader.use();
-    deferredLightingShader.setVec3("viewPos", camera.Position);
-    // Bind GBuffer textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texPosition);
-    deferredLightingShader.setInt("gPosition", 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texNormal);
-    deferredLightingShader.setInt("gNormal", 1);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texAlbedoMetal);
-    deferredLightingShader.setInt("gAlbedoMetal", 2);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, gbuffer.texRoughAoEmiss);
-    deferredLightingShader.setInt("gRoughAoEmiss", 3);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBlur);
-    deferredLightingShader.setInt("ssaoTex", 4);
-
-    deferredLightingShader.setInt("uPointLightCount", (int)pointLights.size());
-    for (int i = 0; i < (int)pointLights.size(); ++i)
+    // SSAO or GTAO: low-res evaluation, bilateral blur, joint bilateral upsample
+    SSAOResources ao = ssaoPipeline.addPasses(frameGraph, gDepth, gNormal, gMotion, quadVAO);
+
+    // Lighting pass, into the TAA scene target when TAA is on
+    FrameGraphResource sceneColor = taaEnabled ? frameGraph.createTexture("Scene color", taa.sceneColorDesc()) : backbuffer;
     {
-      deferredLightingShader.setVec3("uPointLights[" + std::to_string(i) + "].position", pointLights[i].pos);
-      deferredLightingShader.setVec3("uPointLights[" + std::to_string(i) + "].color", pointLights[i].color);
-      deferredLightingShader.setFloat("uPointLights[" + std::to_string(i) + "].radius", pointLights[i].radius);
+      FrameGraphBuilder pass = frameGraph.addPass("Lighting");
+      pass.read(gDepth);
+      pass.read(gNormal);
+      pass.read(gAlbedoMetal);
+      pass.read(gRoughAoEmiss);
+      pass.read(ao.output);
+      sceneColor = pass.colorAttachment(sceneColor);
+      pass.execute([&](const FrameGraphPassContext &context)
+                   {
+        lightingTimer.begin();
+        glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        deferredLightingShader.use();
+        // Bind GBuffer textures
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, context.texture(gDepth));
+        deferredLightingShader.setInt("gDepth", 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, context.texture(gNormal));
+        deferredLightingShader.setInt("gNormal", 1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, context.texture(gAlbedoMetal));
+        deferredLightingShader.setInt("gAlbedoMetal", 2);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, context.texture(gRoughAoEmiss));
+        deferredLightingShader.setInt("gRoughAoEmiss", 3);
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, context.texture(ao.output));
+        deferredLightingShader.setInt("ssaoTex", 4);
+
+        deferredLightingShader.setInt(uPointLightCount, (int)gpuPointLights.size());
+        deferredLightingShader.setBool(uUseClusters, lightingDebug.useClusters);
+        clusteredLighting.setLightingUniforms(deferredLightingShader, glm::vec2(context.width, context.height));
+
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        lightingTimer.end();
+        lightingDebug.cullMs = cullTimer.milliseconds();
+        lightingDebug.lightingMs = lightingTimer.milliseconds(); });
     }
 
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // The light volumes depth-test against the scene: the TAA target uses the G-buffer depth as is,
+    // the default framebuffer has its own depth buffer and gets a copy
+    if (!taaEnabled)
+    {
+      FrameGraphBuilder pass = frameGraph.addPass("Depth copy");
+      pass.read(gDepth);
+      sceneColor = pass.colorAttachment(sceneColor);
+      pass.execute([&](const FrameGraphPassContext &context)
+                   {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, context.framebufferFor({}, gDepth));
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, context.framebuffer);
+        glBlitFramebuffer(0, 0, context.width, context.height, 0, 0, context.width, context.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, context.framebuffer); });
+    }
 
-    // Copy depth from GBuffer to default framebuffer
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.fbo);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Draw light volumes (for visualization) - AFTER lighting pass, over the lit scene
+    {
+      FrameGraphBuilder pass = frameGraph.addPass("Light volumes");
+      sceneColor = pass.colorAttachment(sceneColor);
+      if (taaEnabled)
+        pass.depthAttachment(gDepth, false);
+      pass.execute([&](const FrameGraphPassContext &)
+                   {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE); // Don't write to depth buffer
+
+        lightVolumeShader.use();
+        lightVolumeShader.setFloat(uAlpha, 1.0f); // Add alpha uniform
+
+        for (auto &pl : pointLights)
+        {
+          glm::mat4 model = glm::mat4(1.0f);
+          model = glm::translate(model, pl.pos);
+          model = glm::scale(model, glm::vec3(pl.radius));
+          lightVolumeShader.setMat4(uModel, model);
+          lightVolumeShader.setVec3(uLightColor, pl.color);
+          pl.lightVolume.Draw(lightVolumeShader);
+        }
 
-    // Draw light volumes (for visualization) - AFTER lighting pass, on main framebuffer
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE); // Don't write to depth buffer
+        glDepthMask(GL_TRUE); // Re-enable depth writing
+        glDisable(GL_BLEND); });
+    }
 
-    lightVolumeShader.use();
-    lightVolumeShader.setMat4("projection", projection);
-    lightVolumeShader.setMat4("view", view);
-    lightVolumeShader.setFloat("alpha", 1.0f); // Add alpha uniform
+    // TAA resolve: history + this frame -> default framebuffer
+    backbuffer = taaEnabled ? taa.addResolvePass(frameGraph, sceneColor, gMotion, gDepth, backbuffer, quadVAO) : sceneColor;
 
-    for (auto &pl : pointLights)
+    // UI last, on top of the frame
     {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, pl.pos);
-      model = glm::scale(model, glm::vec3(pl.radius));
-      lightVolumeShader.setMat4("model", model);
-      lightVolumeShader.setVec3("lightColor", pl.color);
-      pl.lightVolume.Draw(lightVolumeShader);
+      FrameGraphResource viewable[] = {gDepth, gNormal, gAlbedoMetal, gRoughAoEmiss, ao.raw, ao.output, FrameGraphResource(), gMotion};
+      const int thumbnailCount = 6; // depth .. SSAO blurred
+      bool shown[IM_ARRAYSIZE(viewable)] = {};
+      FrameGraphBuilder pass = frameGraph.addPass("ImGui");
+      for (int i = 0; i < IM_ARRAYSIZE(viewable); i++)
+        if (viewable[i].valid() && (i == gbufferViewer.selected || (gbufferViewer.thumbnails && i < thumbnailCount)))
+        {
+          pass.read(viewable[i]);
+          shown[i] = true;
+        }
+      pass.colorAttachment(backbuffer);
+      pass.execute([&, viewable, shown](const FrameGraphPassContext &context)
+                   {
+        auto shownTexture = [&](int i)
+        { return shown[i] ? context.texture(viewable[i]) : 0u; };
+        GBuffer targets;
+        targets.texDepth = shownTexture(0);
+        targets.texNormal = shownTexture(1);
+        targets.texAlbedoMetal = shownTexture(2);
+        targets.texRoughAoEmiss = shownTexture(3);
+        targets.texMotion = shownTexture(7);
+        targets.width = context.width;
+        targets.height = context.height;
+        recordFrameStats();
+        drawIMGUI(window, camera, deltaTime, lastFrame, targets, shownTexture(4), shownTexture(5)); });
     }
 
-    glDepthMask(GL_TRUE); // Re-enable depth writing
-    glDisable(GL_BLEND);
+    frameGraph.compile();
+    frameGraph.execute();
 #else
     // Forward fallback (unchanged)
     glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    modelShader.use();
-    modelShader.setMat4("projection", projection);
-    modelShader.setMat4("view", view);
-    modelShader.setMat4("model", glm::mat4(1.0f));
+    sceneIndex.submit(renderQueue, modelShader, RENDER_PASS_FORWARD, cullFrustum, &frameCulling);
+    renderQueue.sort();
 
     //     // Add lighting uniforms for the model (same as wallShader)
     //     modelShader.setVec3("viewPos", camera.Position);
@@ -495,14 +808,22 @@ int main()
     //     // set matrices, bind PBR textures for each mesh (fallbacks if missing)
     //     myModel.Draw(deferredGeometryShader);
     //     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    //     // SSAO pass then blur (bind gbuffer texPosition/texNormal)
+    //     // SSAO pass then blur (bind gbuffer texDepth/texNormal)
     //     // light pass: bind gbuffer textures + ssao result, draw fullscreen quad
     // #else
 
-    myModel.Draw(modelShader);
-#endif
+    renderQueue.execute(RENDER_PASS_FORWARD, glState);
+    instancingTimer.begin();
+    cowHerd.draw(modelInstancedShader, glState);
+    instancingTimer.end();
 
-    drawIMGUI(window, camera, deltaTime, lastFrame, gbuffer, ssaoColor, ssaoColorBlur);
+    recordFrameStats();
+    GBuffer noTargets;
+    drawIMGUI(window, camera, deltaTime, lastFrame, noTargets, 0, 0);
+#endif
+    sceneIndex.endFrame();
+    previousViewProjection = viewProjection;
+    havePreviousFrame = true;
 
     // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved
     // etc.)
@@ -773,6 +1094,18 @@ int main()
   // glDeleteVertexArrays(1, &lightCubeVAO);
   // glDeleteBuffers(1, &VBO);
 
+  TextureStreamer::instance().shutdown();
+  cowHerd.release();
+  mazeStreamer.shutdown();
+  sceneIndex.clear();
+  gpuScene.clear();
+  hiZPyramid.clear();
+  ssaoPipeline.clear();
+  taa.clear();
+  frameGraph.clear();
+  MaterialLibrary::instance().clear();
+  TextureCache::instance().clear();
+
   // Cleanup ImGui
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -815,6 +1148,12 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
   // make sure the viewport matches the new window dimensions; note that width
   // and height will be significantly larger than specified on retina displays.
   glViewport(0, 0, width, height);
+  // a minimized window reports 0x0; keep the last size until it comes back
+  if (width > 0 && height > 0)
+  {
+    framebufferWidth = width;
+    framebufferHeight = height;
+  }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -881,45 +1220,170 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action,
   }
 }
 
+// left click with the cursor released picks the nearest scene object under it
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+  (void)mods;
+  if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS || mouseDisabled || ImGui::GetIO().WantCaptureMouse)
+    return;
+
+  double x, y;
+  int width, height;
+  glfwGetCursorPos(window, &x, &y);
+  glfwGetWindowSize(window, &width, &height);
+  if (width <= 0 || height <= 0)
+    return;
+  float ndcX = 2.0f * (float)x / (float)width - 1.0f;
+  float ndcY = 1.0f - 2.0f * (float)y / (float)height;
+  glm::vec3 direction = camera.GetRayDirection(ndcX, ndcY, (float)width / (float)height);
+  lastPick = sceneIndex.pick(camera.Position, direction);
+}
+
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
 unsigned int loadTexture(char const *path)
 {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
+  // decoded off-thread; shows a placeholder until TextureStreamer::update() uploads it
+  return TextureStreamer::instance().request(path);
+}
+
+// Times both culling kernels against the current camera frustum over random boxes scattered
+// around the camera, a few runs each, keeping the best time.
+void runCullingBenchmark(CullingBenchmark &bench, const Frustum &frustum)
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.1f, 2.0f);
 
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-  if (data)
+  AABBSoA boxes;
+  boxes.reserve((size_t)bench.boxCount);
+  for (int i = 0; i < bench.boxCount; i++)
   {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+    glm::vec3 center = camera.Position + glm::vec3(position(rng), position(rng) * 0.1f, position(rng));
+    glm::vec3 extents(size(rng), size(rng), size(rng));
+    boxes.push(AABB{center - extents, center + extents});
   }
-  else
+
+  std::vector<uint32_t> visible;
+  visible.reserve(boxes.size());
+  auto best = [&](size_t (*kernel)(const Frustum &, const AABBSoA &, std::vector<uint32_t> &), size_t &visibleCount)
   {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
+    double bestMs = 1e30;
+    for (int run = 0; run < 5; run++)
+    {
+      visible.clear();
+      auto start = std::chrono::high_resolution_clock::now();
+      visibleCount = kernel(frustum, boxes, visible);
+      auto end = std::chrono::high_resolution_clock::now();
+      bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return bestMs;
+  };
+  bench.scalarMs = best(cullAABBsScalar, bench.scalarVisible);
+  std::vector<uint32_t> scalarList = visible;
+  bench.simdMs = best(cullAABBs, bench.simdVisible);
+  bench.listsMatch = visible == scalarList;
+  bench.ran = true;
+}
+
+// Fills the GPU-driven scene from the scene index, plus gpuStressCopies translated copies of it
+void rebuildGpuScene()
+{
+  gpuScene.clearInstances();
+  gpuFallbackObjects.clear();
+
+  AABB sceneBox;
+  bool haveBox = false;
+  for (const SceneObject &object : sceneIndex.objects)
+  {
+    if (!object.mesh)
+      continue;
+    sceneBox = haveBox ? mergeAABB(sceneBox, object.worldBox) : object.worldBox;
+    haveBox = true;
   }
+  glm::vec3 spacing = (sceneBox.max - sceneBox.min) * 1.25f + glm::vec3(0.5f);
+  int side = (int)std::ceil(std::sqrt((float)(gpuStressCopies + 1)));
 
-  return textureID;
+  for (int copy = 0; copy <= gpuStressCopies; copy++)
+  {
+    glm::vec3 offset = spacing * glm::vec3((float)(copy % side), 0.0f, (float)(copy / side));
+    glm::mat4 placement = glm::translate(glm::mat4(1.0f), offset);
+    for (uint32_t id = 0; id < sceneIndex.objects.size(); id++)
+    {
+      const SceneObject &object = sceneIndex.objects[id];
+      if (!object.mesh)
+        continue;
+      if (gpuScene.add(*object.mesh, placement * object.transform) == GPU_DRIVEN_NO_INSTANCE && copy == 0)
+        gpuFallbackObjects.push_back(id);
+    }
+  }
+}
+
+// Random boxes drifting a little each step, like a crowd of moving objects: times the incremental
+// update, the refit-only update and a full SAH rebuild of the same tree.
+void runBVHBenchmark(BVHBenchmark &bench)
+{
+  std::mt19937 rng(4321);
+  std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+  std::uniform_real_distribution<float> size(0.2f, 1.5f);
+  std::uniform_real_distribution<float> velocity(-0.3f, 0.3f);
+  using Clock = std::chrono::high_resolution_clock;
+  auto since = [](Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  std::vector<AABB> boxes((size_t)bench.objectCount);
+  for (AABB &box : boxes)
+  {
+    glm::vec3 center(position(rng), position(rng) * 0.1f, position(rng));
+    glm::vec3 extents(size(rng), size(rng), size(rng));
+    box = AABB{center - extents, center + extents};
+  }
+  auto step = [&]()
+  {
+    for (AABB &box : boxes)
+    {
+      glm::vec3 delta(velocity(rng), velocity(rng), velocity(rng));
+      box.min += delta;
+      box.max += delta;
+    }
+  };
+
+  DynamicAABBTree tree;
+  std::vector<int> proxies(boxes.size());
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < boxes.size(); i++)
+    proxies[i] = tree.insert(boxes[i], (uint32_t)i);
+  bench.insertMs = since(start);
+
+  step();
+  bench.reinserted = 0;
+  start = Clock::now();
+  for (size_t i = 0; i < boxes.size(); i++)
+    bench.reinserted += tree.move(proxies[i], boxes[i]) ? 1 : 0;
+  bench.moveMs = since(start);
+
+  step();
+  start = Clock::now();
+  for (size_t i = 0; i < boxes.size(); i++)
+    tree.setLeafBox(proxies[i], boxes[i]);
+  tree.refit();
+  bench.refitMs = since(start);
+  bench.refitSah = tree.sahCost();
+
+  start = Clock::now();
+  tree.rebuild();
+  bench.rebuildMs = since(start);
+  bench.rebuildSah = tree.sahCost();
+
+  unsigned int hits = 0;
+  start = Clock::now();
+  tree.queryFrustum(cameraFrustum, [&](int)
+                    { hits++; });
+  bench.queryHits = hits;
+  bench.queryMs = since(start);
+  bench.ran = true;
 }
 
 void drawIMGUI(GLFWwindow *window, Camera &camera, float &deltaTime,
@@ -944,17 +1408,26 @@ void drawIMGUI(GLFWwindow *window, Camera &camera, float &deltaTime,
   {
     ImGui::Begin("GBuffer Debug Viewer");
 
-    static int selectedBuffer = 0;
-    const char *bufferNames[] = {"Position", "Normal", "Albedo+Metal", "Rough+AO+Emiss", "SSAO", "SSAO Blurred"};
+    int &selectedBuffer = gbufferViewer.selected;
+    int &hiZLevel = gbufferViewer.hiZLevel;
+    const char *bufferNames[] = {"Depth", "Normal (octahedral)", "Albedo+Metal", "Rough+AO+Emiss", "SSAO (low-res, raw)", "SSAO Blurred", "Hi-Z Pyramid", "Motion vectors"};
 
     ImGui::Combo("Buffer", &selectedBuffer, bufferNames, IM_ARRAYSIZE(bufferNames));
+    if (selectedBuffer == 6)
+    {
+      ImGui::SliderInt("Hi-Z level", &hiZLevel, 0, hiZPyramid.levels - 1);
+      hiZLevel = std::min(hiZLevel, hiZPyramid.levels - 1);
+      ImGui::Text("Level %d: %dx%d", hiZLevel, std::max(hiZPyramid.width >> hiZLevel, 1), std::max(hiZPyramid.height >> hiZLevel, 1));
+      if (!gpuDrivenEnabled || !occlusionCullingEnabled)
+        ImGui::TextDisabled("Built only by the GPU-driven pass with occlusion culling on");
+    }
 
     // Display the selected buffer
     GLuint texID = 0;
     switch (selectedBuffer)
     {
     case 0:
-      texID = gbuffer.texPosition;
+      texID = gbuffer.texDepth;
       break;
     case 1:
       texID = gbuffer.texNormal;
@@ -971,10 +1444,16 @@ void drawIMGUI(GLFWwindow *window, Camera &camera, float &deltaTime,
     case 5:
       texID = ssaoColorBlur;
       break;
+    case 6:
+      texID = hiZLevel < (int)hiZPyramid.levelViews.size() ? hiZPyramid.levelViews[hiZLevel] : 0;
+      break;
+    case 7:
+      texID = gbuffer.texMotion;
+      break;
     }
 
     // Calculate display size (maintain aspect ratio)
-    float aspectRatio = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    float aspectRatio = (float)framebufferWidth / (float)framebufferHeight;
     float displayWidth = 512.0f;
     float displayHeight = displayWidth / aspectRatio;
 
@@ -984,53 +1463,349 @@ void drawIMGUI(GLFWwindow *window, Camera &camera, float &deltaTime,
                    ImVec2(0, 1), ImVec2(1, 0)); // Flip V coordinate
     }
 
+    // per-frame G-buffer traffic of this layout against the old position + RGBA16F normal one
+    ImGui::Text("G-buffer: %u B/pixel (was %u)", GBUFFER_LAYOUT_COMPACT.bytesPerPixel(), GBUFFER_LAYOUT_LEGACY.bytesPerPixel());
+    ImGui::Text("Traffic estimate: %.1f MB/frame (was %.1f MB)", GBUFFER_LAYOUT_COMPACT.frameBytes(framebufferWidth, framebufferHeight) / (1024.0 * 1024.0),
+                GBUFFER_LAYOUT_LEGACY.frameBytes(framebufferWidth, framebufferHeight) / (1024.0 * 1024.0));
+
+    GpuDrivenStats occlusionStats = gpuScene.stats();
+    ImGui::Checkbox("Occlusion culling (GPU-driven pass)", &occlusionCullingEnabled);
+    ImGui::Text("In frustum: %u  occluded: %u", occlusionStats.visible, occlusionStats.occluded);
+    ImGui::Text("Drawn: %u from last frame + %u newly visible", occlusionStats.drawnEarly, occlusionStats.drawnLate);
+
     // Show all buffers as thumbnails
     ImGui::Separator();
-    ImGui::Text("All Buffers:");
+    ImGui::Checkbox("All buffers (keeps them alive to the end of the frame)", &gbufferViewer.thumbnails);
+    if (gbufferViewer.thumbnails)
+    {
+      float thumbSize = 128.0f;
+      float thumbHeight = thumbSize / aspectRatio;
+
+      ImGui::BeginGroup();
+      ImGui::Text("Depth");
+      ImGui::Image((void *)(intptr_t)gbuffer.texDepth, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+
+      ImGui::SameLine();
+      ImGui::BeginGroup();
+      ImGui::Text("Normal");
+      ImGui::Image((void *)(intptr_t)gbuffer.texNormal, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+
+      ImGui::SameLine();
+      ImGui::BeginGroup();
+      ImGui::Text("Albedo+Metal");
+      ImGui::Image((void *)(intptr_t)gbuffer.texAlbedoMetal, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+
+      ImGui::BeginGroup();
+      ImGui::Text("Rough+AO+Emiss");
+      ImGui::Image((void *)(intptr_t)gbuffer.texRoughAoEmiss, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+
+      ImGui::SameLine();
+      ImGui::BeginGroup();
+      ImGui::Text("SSAO");
+      ImGui::Image((void *)(intptr_t)ssaoColor, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+
+      ImGui::SameLine();
+      ImGui::BeginGroup();
+      ImGui::Text("SSAO Blurred");
+      ImGui::Image((void *)(intptr_t)ssaoColorBlur, ImVec2(thumbSize, thumbHeight),
+                   ImVec2(0, 1), ImVec2(1, 0));
+      ImGui::EndGroup();
+    }
+
+    ImGui::End();
+  }
 
-    float thumbSize = 128.0f;
-    float thumbHeight = thumbSize / aspectRatio;
+  // SSAO: resolution, sample count and blur against the per-pass GPU cost
+  {
+    const SSAOStats &stats = ssaoPipeline.stats();
+    ImGui::Begin("SSAO");
+    const char *modes[] = {"Hemisphere (SSAO)", "GTAO + temporal"};
+    int mode = (int)ssaoPipeline.mode;
+    if (ImGui::Combo("Mode", &mode, modes, IM_ARRAYSIZE(modes)))
+      ssaoPipeline.mode = (SSAOMode)mode;
+    const char *resolutions[] = {"Full", "Half", "Quarter"};
+    int resolution = ssaoPipeline.resolutionDivisor >= 4 ? 2 : ssaoPipeline.resolutionDivisor - 1;
+    if (ImGui::Combo("Resolution", &resolution, resolutions, IM_ARRAYSIZE(resolutions)))
+      ssaoPipeline.resolutionDivisor = 1 << resolution;
+    const int sampleCounts[] = {8, 16, 32, 64};
+    const char *sampleNames[] = {"8", "16", "32", "64"};
+    int sampleIndex = 0;
+    while (sampleIndex < 3 && sampleCounts[sampleIndex] < ssaoPipeline.sampleCount)
+      sampleIndex++;
+    if (ssaoPipeline.mode == SSAO_MODE_GTAO)
+    {
+      ImGui::SliderInt("Directions", &ssaoPipeline.gtaoSlices, 1, 4);
+      ImGui::SliderInt("Steps", &ssaoPipeline.gtaoSteps, 1, 8);
+      ImGui::SliderFloat("History frames", &ssaoPipeline.temporalFrames, 0.0f, 32.0f);
+      ImGui::SliderFloat("Reject threshold", &ssaoPipeline.rejectThreshold, 0.005f, 0.5f);
+    }
+    else if (ImGui::Combo("Samples", &sampleIndex, sampleNames, IM_ARRAYSIZE(sampleNames)))
+      ssaoPipeline.sampleCount = sampleCounts[sampleIndex];
+    ImGui::SliderFloat("Radius", &ssaoPipeline.radius, 0.05f, 2.0f);
+    if (ssaoPipeline.mode != SSAO_MODE_GTAO)
+      ImGui::SliderFloat("Bias", &ssaoPipeline.bias, 0.0f, 0.1f);
+    ImGui::SliderInt("Blur radius", &ssaoPipeline.blurRadius, 0, 8);
+    ImGui::SliderFloat("Depth sharpness", &ssaoPipeline.depthSharpness, 0.0f, 200.0f);
+    ImGui::Text("AO target:     %dx%d", stats.width, stats.height);
+    ImGui::Text("Prepare:       %.3f ms", stats.prepareMs);
+    ImGui::Text("AO:            %.3f ms", stats.aoMs);
+    ImGui::Text("Temporal:      %.3f ms", stats.temporalMs);
+    ImGui::Text("Blur:          %.3f ms", stats.blurMs);
+    ImGui::Text("Upsample:      %.3f ms", stats.upsampleMs);
+    ImGui::Text("Total:         %.3f ms", stats.totalMs());
+    ImGui::End();
+  }
 
-    ImGui::BeginGroup();
-    ImGui::Text("Position");
-    ImGui::Image((void *)(intptr_t)gbuffer.texPosition, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
+  // Temporal anti-aliasing
+  {
+    ImGui::Begin("Anti-aliasing");
+    if (ImGui::Checkbox("TAA", &taaEnabled))
+      taa.resetHistory();
+    ImGui::SliderFloat("History weight", &taa.feedback, 0.5f, 0.98f);
+    glm::vec2 jitterPixels = taa.jitter() * glm::vec2((float)framebufferWidth, (float)framebufferHeight) * 0.5f;
+    ImGui::Text("Jitter:        %+.3f %+.3f px (Halton 2,3 over %d frames)", jitterPixels.x, jitterPixels.y, TAA_JITTER_SAMPLES);
+    ImGui::Text("Resolve:       %.3f ms", taaEnabled ? taa.resolveMilliseconds() : 0.0f);
+    ImGui::End();
+  }
 
-    ImGui::SameLine();
-    ImGui::BeginGroup();
-    ImGui::Text("Normal");
-    ImGui::Image((void *)(intptr_t)gbuffer.texNormal, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
+  // Frame graph of the last completed frame (this one is still executing): pass order, target
+  // lifetimes and what sharing textures between targets saved
+  {
+    const FrameGraphStats &stats = frameGraph.stats();
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    ImGui::Begin("Frame Graph");
+    ImGui::Text("Resolution:    %dx%d", framebufferWidth, framebufferHeight);
+    ImGui::Text("Passes:        %u (%u culled)", stats.passes, stats.culledPasses);
+    ImGui::Text("Targets:       %u in %u textures", stats.transientTextures, stats.pooledTextures);
+    ImGui::Text("Declared:      %.2f MB", stats.transientBytes * mb);
+    ImGui::Text("Allocated:     %.2f MB", stats.allocatedBytes * mb);
+    ImGui::Text("Aliasing saved %.2f MB", stats.savedBytes() * mb);
+    ImGui::Text("Pool:          %.2f MB, %u created", stats.poolBytes * mb, stats.createdTextures);
+    if (ImGui::Button("Print to console"))
+      std::cout << frameGraph.dump() << std::endl;
+    ImGui::Separator();
+    ImGui::TextUnformatted(frameGraph.dump().c_str());
+    ImGui::End();
+  }
 
-    ImGui::SameLine();
-    ImGui::BeginGroup();
-    ImGui::Text("Albedo+Metal");
-    ImGui::Image((void *)(intptr_t)gbuffer.texAlbedoMetal, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
-
-    ImGui::BeginGroup();
-    ImGui::Text("Rough+AO+Emiss");
-    ImGui::Image((void *)(intptr_t)gbuffer.texRoughAoEmiss, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
+  // Clustered lighting: frame cost vs. light count
+  {
+    ImGui::Begin("Lighting");
+    ImGui::Checkbox("Clustered culling", &lightingDebug.useClusters);
+    ImGui::SliderInt("Extra lights", &lightingDebug.extraLightCount, 0, 4096);
+    ImGui::Text("Lights: %d", lightingDebug.totalLights);
+    ImGui::Text("Cull pass:     %.3f ms", lightingDebug.cullMs);
+    ImGui::Text("Lighting pass: %.3f ms", lightingDebug.lightingMs);
+    ImGui::Text("Cull + light:  %.3f ms", lightingDebug.cullMs + lightingDebug.lightingMs);
+    ImGui::End();
+  }
 
-    ImGui::SameLine();
-    ImGui::BeginGroup();
-    ImGui::Text("SSAO");
-    ImGui::Image((void *)(intptr_t)ssaoColor, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
+  // Render queue: state changes per frame after sorting and elision
+  {
+    ImGui::Begin("Render Queue");
+    ImGui::Text("Queued items:    %zu", renderQueue.size());
+    ImGui::Text("Draw calls:      %u", lastFrameCounters.draws);
+    ImGui::Text("Triangles:       %u", lastFrameCounters.triangles);
+    ImGui::Text("Program binds:   %u", lastFrameCounters.programBinds);
+    ImGui::Text("VAO binds:       %u", lastFrameCounters.vaoBinds);
+    ImGui::Text("Texture binds:   %u", lastFrameCounters.textureBinds);
+    ImGui::Text("Uniform uploads: %u", lastFrameCounters.uniformUploads);
+    ImGui::Text("Elided binds:    %u", lastFrameCounters.elidedBinds);
 
+    ImGui::Separator();
+    ImGui::Checkbox("Frustum culling", &frustumCullingEnabled);
+    ImGui::Text("Meshes drawn:    %u", lastFrameCulling.visible);
+    ImGui::Text("Meshes culled:   %u", lastFrameCulling.culled());
+#if defined(FRUSTUM_CULLING_AVX)
+    ImGui::Text("Culling kernel:  AVX, 8 boxes per step");
+#elif defined(FRUSTUM_CULLING_SSE)
+    ImGui::Text("Culling kernel:  SSE, 4 boxes per step");
+#else
+    ImGui::Text("Culling kernel:  scalar");
+#endif
+
+    ImGui::Separator();
+    ImGui::Checkbox("LOD selection", &lodSettings.enabled);
+    ImGui::SliderFloat("Max pixel error", &lodSettings.maxPixelError, 0.25f, 16.0f, "%.2f px");
+    ImGui::SliderInt("Force LOD", &lodSettings.forcedLod, -1, MESH_MAX_LODS - 1, lodSettings.forcedLod < 0 ? "auto" : "%d");
+
+    ImGui::Separator();
+    ImGui::Checkbox("Meshlet culling", &meshletSettings.enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Frustum##meshlets", &meshletSettings.frustum);
     ImGui::SameLine();
-    ImGui::BeginGroup();
-    ImGui::Text("SSAO Blurred");
-    ImGui::Image((void *)(intptr_t)ssaoColorBlur, ImVec2(thumbSize, thumbHeight),
-                 ImVec2(0, 1), ImVec2(1, 0));
-    ImGui::EndGroup();
+    ImGui::Checkbox("Backface cones", &meshletSettings.cone);
+    auto meshletLines = [](const char *path, const MeshletCullStats &stats)
+    {
+      ImGui::Text("%s meshlets:   %u of %u drawn", path, stats.meshletsVisible, stats.meshlets);
+      ImGui::Text("%s triangles:  %.1f%% of %u rejected (%u frustum, %u backface)", path, stats.rejectionRate() * 100.0f,
+                  stats.triangles, stats.frustumCulledTriangles, stats.coneCulledTriangles);
+    };
+    meshletLines("CPU", lastFrameMeshlets);
+
+    ImGui::Separator();
+    ImGui::Checkbox("GPU-driven geometry pass", &gpuDrivenEnabled);
+    if (ImGui::SliderInt("Stress copies", &gpuStressCopies, 0, 100000))
+      gpuSceneDirty = true;
+    GpuDrivenStats gpuStats = gpuScene.stats();
+    ImGui::Text("GPU instances:   %u (%u visible, %u occluded)", gpuStats.instances, gpuStats.visible, gpuStats.occluded);
+    ImGui::Text("Buckets:         %u in %u geometry groups (%.2f MB)", gpuStats.buckets, gpuStats.geometryGroups, gpuStats.geometryBytes / (1024.0 * 1024.0));
+    ImGui::Text("Multi-draw:      %s", gpuStats.drawCountPath ? "indirect count (GL 4.6)" : "indirect, zeroed tail");
+    meshletLines("GPU", gpuStats.meshlets);
+
+    ImGui::Separator();
+    ImGui::SliderInt("Benchmark boxes", &cullingBenchmark.boxCount, 10000, 1000000);
+    if (ImGui::Button("Run culling benchmark"))
+      runCullingBenchmark(cullingBenchmark, cameraFrustum);
+    if (cullingBenchmark.ran)
+    {
+      ImGui::Text("Scalar: %.3f ms (%zu visible)", cullingBenchmark.scalarMs, cullingBenchmark.scalarVisible);
+      ImGui::Text("SIMD:   %.3f ms (%zu visible)", cullingBenchmark.simdMs, cullingBenchmark.simdVisible);
+      ImGui::Text("Index lists: %s", cullingBenchmark.listsMatch ? "identical" : "DIFFER");
+      if (cullingBenchmark.simdMs > 0.0)
+        ImGui::Text("Speedup: %.2fx", cullingBenchmark.scalarMs / cullingBenchmark.simdMs);
+    }
 
+    MaterialStats materialStats = MaterialLibrary::instance().stats();
+    ImGui::Separator();
+    ImGui::Text("Materials:       %u", materialStats.materials);
+    ImGui::Text("Texture arrays:  %u (%u layers, %.2f MB)", materialStats.arrays, materialStats.layers, materialStats.arrayBytes / (1024.0 * 1024.0));
+    ImGui::Text("Pending layers:  %u", materialStats.pendingTextures);
+    ImGui::End();
+  }
+
+  // Scene BVH: tree shape, picking result and the moving-object benchmark
+  {
+    ImGui::Begin("Scene BVH");
+    ImGui::Text("Objects:  %zu", sceneIndex.size());
+    ImGui::Text("Height:   %d", sceneIndex.tree.height());
+    ImGui::Text("SAH cost: %.2f", sceneIndex.tree.sahCost());
+    if (ImGui::Button("Rebuild (SAH)"))
+      sceneIndex.tree.rebuild();
+    if (lastPick.object != SCENE_NO_OBJECT)
+      ImGui::Text("Picked object %u at %.2f", lastPick.object, lastPick.distance);
+    else
+      ImGui::Text("Picked: none (left click with the cursor released)");
+
+    ImGui::Separator();
+    ImGui::SliderInt("Moving objects", &bvhBenchmark.objectCount, 1000, 100000);
+    if (ImGui::Button("Run BVH benchmark"))
+      runBVHBenchmark(bvhBenchmark);
+    if (bvhBenchmark.ran)
+    {
+      ImGui::Text("Insert all:        %.2f ms", bvhBenchmark.insertMs);
+      ImGui::Text("Incremental move:  %.2f ms (%u reinserted)", bvhBenchmark.moveMs, bvhBenchmark.reinserted);
+      ImGui::Text("Leaf update+refit: %.2f ms (SAH %.1f)", bvhBenchmark.refitMs, bvhBenchmark.refitSah);
+      ImGui::Text("SAH rebuild:       %.2f ms (SAH %.1f)", bvhBenchmark.rebuildMs, bvhBenchmark.rebuildSah);
+      ImGui::Text("Frustum query:     %.3f ms (%u hits)", bvhBenchmark.queryMs, bvhBenchmark.queryHits);
+    }
+    ImGui::End();
+  }
+
+  // Texture streaming: decode backlog and upload budget
+  {
+    TextureStreamer &streamer = TextureStreamer::instance();
+    TextureStreamerStats stats = streamer.stats();
+    int budgetMB = (int)(streamer.uploadBudgetBytes / (1024 * 1024));
+    ImGui::Begin("Texture Streaming");
+    if (ImGui::SliderInt("Upload budget (MB/frame)", &budgetMB, 1, 64))
+      streamer.uploadBudgetBytes = (size_t)budgetMB * 1024 * 1024;
+    ImGui::Text("Decoding:        %u", stats.queued);
+    ImGui::Text("Waiting upload:  %u", stats.pendingUploads);
+    ImGui::Text("Uploaded:        %u (%u failed)", stats.uploaded, stats.failed);
+    ImGui::Text("Last frame:      %.2f MB", stats.uploadedBytesLastFrame / (1024.0 * 1024.0));
+
+    TextureCache &cache = TextureCache::instance();
+    TextureCacheStats cacheStats = cache.stats();
+    int cacheBudgetMB = (int)(cache.budgetBytes / (1024 * 1024));
+    ImGui::Separator();
+    if (ImGui::SliderInt("Cache budget (MB)", &cacheBudgetMB, 16, 4096))
+    {
+      cache.budgetBytes = (size_t)cacheBudgetMB * 1024 * 1024;
+      cache.trim();
+    }
+    ImGui::Checkbox("Dedup by content hash", &cache.dedupByContent);
+    ImGui::Text("Hits / misses:   %u / %u", cacheStats.hits, cacheStats.misses);
+    ImGui::Text("Textures:        %u (%u referenced, %u streaming)", cacheStats.textures, cacheStats.referenced, cacheStats.streaming);
+    ImGui::Text("Resident:        %.2f MB", cacheStats.residentBytes / (1024.0 * 1024.0));
+    ImGui::Text("Evictions:       %u", cacheStats.evictions);
+    ImGui::End();
+  }
+
+  // Instancing: the cow herd drawn through ModelInstanceSet
+  {
+    const ModelInstanceStats &stats = instancingBenchmark.stats;
+    ImGui::Begin("Instancing");
+    if (ImGui::SliderInt("Cows", &instancingBenchmark.count, 0, 10000))
+      instancingBenchmark.dirty = true;
+    if (ImGui::SliderFloat("Spacing", &instancingBenchmark.spacing, 1.0f, 10.0f))
+      instancingBenchmark.dirty = true;
+    ImGui::Text("Visible:         %u / %u", stats.visible, stats.instances);
+    ImGui::Text("Draw calls:      %u", stats.draws);
+    ImGui::Text("Triangles:       %u", stats.triangles);
+    ImGui::Text("Uploaded:        %u transforms", stats.uploadedInstances);
+    for (int lod = 0; lod < MESH_MAX_LODS; lod++)
+      if (stats.lodInstances[lod])
+        ImGui::Text("  LOD %d: %u", lod, stats.lodInstances[lod]);
+    ImGui::Text("GPU time:        %.3f ms", instancingBenchmark.gpuMs);
+    ImGui::End();
+  }
+
+  // Backrooms maze: chunk streaming around the camera
+  {
+    const MazeStreamingStats &stats = mazeStreamer.stats();
+    ImGui::Begin("Backrooms Maze");
+    ImGui::Checkbox("Stream maze", &mazeEnabled);
+    ImGui::SliderInt("Radius (chunks)", &mazeStreamer.radius, 0, 6);
+    if (ImGui::SliderFloat("Openness", &mazeStreamer.openness, 0.0f, 1.0f))
+      mazeStreamer.regenerate();
+    int uploads = (int)mazeStreamer.uploadsPerFrame;
+    if (ImGui::SliderInt("Uploads / frame", &uploads, 1, 16))
+      mazeStreamer.uploadsPerFrame = (unsigned int)uploads;
+    int seed = (int)(uint32_t)mazeStreamer.seed;
+    if (ImGui::InputInt("Seed", &seed))
+    {
+      mazeStreamer.seed = (uint32_t)seed;
+      mazeStreamer.regenerate();
+    }
+    ImGui::Text("Resident chunks: %u (%u pending, %u visible)", stats.residentChunks, stats.pendingChunks, stats.visibleChunks);
+    ImGui::Text("Generated:       %u (%.3f ms/chunk avg, %.3f ms last)", stats.generatedChunks, stats.averageGenerateMs, stats.lastGenerateMs);
+    ImGui::Text("Evicted:         %u", stats.evictedChunks);
+    ImGui::Text("Walls drawn:     %u", stats.drawnWalls);
+    ImGui::Text("Resident memory: %.1f KB of %.1f KB ring", stats.residentBytes / 1024.0, stats.ringBytes / 1024.0);
+    ImGui::End();
+  }
+
+  // Geometry pool: shared vertex/index arenas
+  {
+    GeometryPool &pool = GeometryPool::instance();
+    GeometryPoolStats stats = pool.stats();
+    ImGui::Begin("Geometry Pool");
+    ImGui::Text("Arenas:          %u (%u meshes)", stats.arenas, stats.allocations);
+    ImGui::Text("Used / capacity: %.2f / %.2f MB (%.1f%%)", stats.usedBytes / (1024.0 * 1024.0),
+                stats.capacityBytes / (1024.0 * 1024.0), 100.0f * stats.utilization());
+    ImGui::Text("Free blocks:     %u (fragmentation %.1f%%)", stats.freeBlocks, 100.0f * stats.fragmentation());
+    ImGui::Text("Grows:           %u", stats.grows);
+    ImGui::Text("Compactions:     %u (%.2f MB moved)", stats.compactions, stats.compactedBytes / (1024.0 * 1024.0));
+    for (uint32_t a = 0; a < pool.arenaCount(); a++)
+    {
+      const GeometryArena &arena = pool.arena(a);
+      ImGui::Text("  arena %u: %u B/vertex, %u-bit indices, %zu/%zu vertices, %zu/%zu indices", a, arena.layout.stride(0) + arena.layout.stride(1),
+                  (unsigned int)arena.indexSize * 8, arena.vertices.used(), arena.vertices.capacity(), arena.indices.used(), arena.indices.capacity());
+    }
+    if (ImGui::Button("Compact now"))
+      for (uint32_t a = 0; a < pool.arenaCount(); a++)
+        pool.compact(a);
     ImGui::End();
   }
 
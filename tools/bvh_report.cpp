@@ -0,0 +1,260 @@
+// Scene BVH check: drives a DynamicAABBTree (bvh.h) through seeded insert / remove / move sequences,
+// a leaf update + refit and a SAH rebuild, and after every phase
+//  - validates the tree (links, enclosing parent boxes, heights, balance where it is promised);
+//  - checks each live proxy's fat box still holds its object's box;
+//  - compares the box, sphere, frustum and ray queries with a brute-force scan over the same fat
+//    boxes: the same proxies must come back, and the nearest ray hit must agree.
+// Exits with 1 on a broken invariant or a query mismatch. No GL context is created.
+//
+// usage: BVHReport [--objects N] [--queries N]
+
+#include <bvh.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Scene
+{
+  std::vector<AABB> boxes;
+  std::vector<int> proxies; // BVH_NULL_NODE once removed
+  size_t alive = 0;
+};
+
+struct PhaseStats
+{
+  size_t queries = 0;
+  size_t results = 0;    // proxies returned over all queries
+  size_t mismatches = 0; // queries whose result set differs from brute force
+  const char *problem = nullptr;
+};
+
+static AABB randomBox(std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f), size(0.1f, 3.0f);
+  glm::vec3 center(position(rng), position(rng) * 0.2f, position(rng));
+  glm::vec3 extents(size(rng), size(rng), size(rng));
+  return AABB{center - extents, center + extents};
+}
+
+static void insertObject(DynamicAABBTree &tree, Scene &scene, const AABB &box)
+{
+  scene.proxies.push_back(tree.insert(box, (uint32_t)scene.boxes.size()));
+  scene.boxes.push_back(box);
+  scene.alive++;
+}
+
+// one random edit: remove, insert, a small move (mostly stays in the fat box) or a teleport
+static void randomEdit(DynamicAABBTree &tree, Scene &scene, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f), nudge(-0.15f, 0.15f);
+  std::uniform_int_distribution<size_t> pick(0, scene.boxes.size() - 1);
+  float op = unit(rng);
+  size_t i = pick(rng);
+  if (op < 0.2f || scene.alive == 0)
+  {
+    insertObject(tree, scene, randomBox(rng));
+    return;
+  }
+  if (scene.proxies[i] == BVH_NULL_NODE)
+    return;
+  if (op < 0.3f)
+  {
+    tree.remove(scene.proxies[i]);
+    scene.proxies[i] = BVH_NULL_NODE;
+    scene.alive--;
+    return;
+  }
+  if (op < 0.8f)
+  {
+    glm::vec3 delta(nudge(rng), nudge(rng), nudge(rng));
+    scene.boxes[i].min += delta;
+    scene.boxes[i].max += delta;
+  }
+  else
+    scene.boxes[i] = randomBox(rng);
+  tree.move(scene.proxies[i], scene.boxes[i]);
+}
+
+template <typename Hit>
+static std::vector<int> bruteForce(const DynamicAABBTree &tree, const Scene &scene, Hit &&hit)
+{
+  std::vector<int> result;
+  for (int proxy : scene.proxies)
+    if (proxy != BVH_NULL_NODE && hit(tree.fatBox(proxy)))
+      result.push_back(proxy);
+  return result;
+}
+
+// proxies are reused node slots, so both lists are sorted before comparing
+static void compare(std::vector<int> found, std::vector<int> expected, PhaseStats &stats)
+{
+  std::sort(found.begin(), found.end());
+  std::sort(expected.begin(), expected.end());
+  stats.queries++;
+  stats.results += found.size();
+  if (found != expected)
+    stats.mismatches++;
+}
+
+static PhaseStats checkTree(const DynamicAABBTree &tree, const Scene &scene, int maxBalance, size_t queries, std::mt19937 &rng)
+{
+  PhaseStats stats;
+  stats.problem = tree.validate(maxBalance);
+  if (!stats.problem && tree.leafCount() != scene.alive)
+    stats.problem = "leaf count differs from the live objects";
+  for (size_t i = 0; i < scene.boxes.size() && !stats.problem; i++)
+  {
+    int proxy = scene.proxies[i];
+    if (proxy == BVH_NULL_NODE)
+      continue;
+    if (tree.userData(proxy) != (uint32_t)i)
+      stats.problem = "proxy lost its user data";
+    else if (!tree.fatBox(proxy).contains(scene.boxes[i]))
+      stats.problem = "fat box does not hold the object's box";
+  }
+
+  std::uniform_real_distribution<float> position(-110.0f, 110.0f), unit(-1.0f, 1.0f), radiusDist(0.5f, 25.0f);
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 80.0f);
+  for (size_t q = 0; q < queries; q++)
+  {
+    std::vector<int> found;
+    auto collect = [&](int proxy)
+    { found.push_back(proxy); };
+
+    // box
+    AABB box = randomBox(rng);
+    box.min -= glm::vec3(radiusDist(rng));
+    tree.query(box, collect);
+    compare(found, bruteForce(tree, scene, [&](const AABB &b)
+                              { return b.overlaps(box); }),
+            stats);
+
+    // sphere
+    found.clear();
+    glm::vec3 center(position(rng), position(rng) * 0.2f, position(rng));
+    float radius = radiusDist(rng);
+    tree.querySphere(center, radius, collect);
+    compare(found, bruteForce(tree, scene, [&](const AABB &b)
+                              {
+                                glm::vec3 d = glm::clamp(center, b.min, b.max) - center;
+                                return glm::dot(d, d) <= radius * radius; }),
+            stats);
+
+    // frustum, from a random eye looking somewhere across the scene
+    found.clear();
+    glm::vec3 eye(position(rng), position(rng) * 0.1f, position(rng));
+    glm::vec3 target(position(rng), 0.0f, position(rng));
+    Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    tree.queryFrustum(frustum, collect);
+    compare(found, bruteForce(tree, scene, [&](const AABB &b)
+                              { return frustum.intersects(b); }),
+            stats);
+
+    // ray: every hit when the callback never clips, then the nearest hit when it does
+    found.clear();
+    glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.2f, unit(rng)) + glm::vec3(1.0e-3f));
+    glm::vec3 inverse = 1.0f / direction;
+    float maxDistance = 150.0f, entry;
+    tree.raycast(eye, direction, maxDistance, [&](int proxy, float)
+                 { found.push_back(proxy); return maxDistance; });
+    std::vector<int> rayHits = bruteForce(tree, scene, [&](const AABB &b)
+                                          { return DynamicAABBTree::rayHitsBox(eye, inverse, b, maxDistance, entry); });
+    compare(found, rayHits, stats);
+
+    float nearest = maxDistance, expectedNearest = maxDistance;
+    tree.raycast(eye, direction, maxDistance, [&](int, float distance)
+                 { nearest = std::min(nearest, distance); return nearest; });
+    for (int proxy : rayHits)
+      if (DynamicAABBTree::rayHitsBox(eye, inverse, tree.fatBox(proxy), maxDistance, entry))
+        expectedNearest = std::min(expectedNearest, entry);
+    stats.queries++;
+    if (nearest != expectedNearest)
+      stats.mismatches++;
+  }
+  return stats;
+}
+
+int main(int argc, char **argv)
+{
+  size_t objectCount = 4000, queries = 200;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--objects") && i + 1 < argc)
+      objectCount = (size_t)std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--queries") && i + 1 < argc)
+      queries = (size_t)std::max(1, std::atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "usage: BVHReport [--objects N] [--queries N]\n");
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(2024);
+  DynamicAABBTree tree;
+  Scene scene;
+  bool ok = true;
+  printf("Dynamic AABB tree, %zu objects, %zu queries of each kind per phase\n", objectCount, queries);
+  printf("  %-22s %7s %6s %8s %9s %10s %8s\n", "phase", "leaves", "height", "SAH", "queries", "results", "mismatch");
+  auto report = [&](const char *phase, int maxBalance)
+  {
+    PhaseStats stats = checkTree(tree, scene, maxBalance, queries, rng);
+    printf("  %-22s %7zu %6d %8.1f %9zu %10zu %8zu\n", phase, tree.leafCount(), tree.height(), tree.sahCost(), stats.queries,
+           stats.results, stats.mismatches);
+    if (stats.problem || stats.mismatches)
+    {
+      printf("\nFAIL: %s: %s, %zu queries differ from brute force\n", phase, stats.problem ? stats.problem : "tree sound",
+             stats.mismatches);
+      ok = false;
+    }
+  };
+
+  for (size_t i = 0; i < objectCount; i++)
+    insertObject(tree, scene, randomBox(rng));
+  report("insert", 2);
+
+  for (size_t i = 0; i < objectCount * 2; i++)
+    randomEdit(tree, scene, rng);
+  report("insert/remove/move", 2);
+
+  // every object drifts, the tree only refits
+  std::uniform_real_distribution<float> drift(-2.0f, 2.0f);
+  for (size_t i = 0; i < scene.boxes.size(); i++)
+  {
+    if (scene.proxies[i] == BVH_NULL_NODE)
+      continue;
+    glm::vec3 delta(drift(rng), drift(rng), drift(rng));
+    scene.boxes[i].min += delta;
+    scene.boxes[i].max += delta;
+    tree.setLeafBox(scene.proxies[i], scene.boxes[i]);
+  }
+  tree.refit();
+  report("leaf update + refit", 2);
+
+  tree.rebuild();
+  report("SAH rebuild", -1);
+
+  for (size_t i = 0; i < objectCount; i++)
+    randomEdit(tree, scene, rng);
+  report("edits after rebuild", -1);
+
+  // down to a handful of leaves and back, through the root special cases
+  for (size_t i = 0; i < scene.boxes.size(); i++)
+    if (scene.proxies[i] != BVH_NULL_NODE && scene.alive > 1)
+    {
+      tree.remove(scene.proxies[i]);
+      scene.proxies[i] = BVH_NULL_NODE;
+      scene.alive--;
+    }
+  report("removed to one leaf", 2);
+
+  if (ok)
+    printf("\nOK\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// Clustered light culling check: builds the cluster bounds (buildClusterBoundsCPU) for a few projections,
+// culls seeded point light sets (cullLightsCPU) and verifies the result two ways:
+//  - every light sphere is tested against every cluster AABB by brute force, and each hit must appear in
+//    that cluster's (offset, count) range of the flat index list;
+//  - points sampled inside each light sphere are mapped to their cluster with clusterIndexForFragment, the
+//    lookup deferred_lighting.fs does, and that cluster must list the light.
+// Clusters that hit MAX_LIGHTS_PER_CLUSTER drop lights on the GPU too; they are counted, not failed.
+// Exits with 1 if a light is missing from a cluster it should be in. No GL context is created.
+//
+// usage: ClusterCullReport [--samples N]
+
+#include <clustered_lighting.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct ProjectionCase
+{
+  const char *name;
+  float fovDegrees;
+  float aspect;
+};
+
+struct CullStats
+{
+  size_t listed = 0;          // entries in the flat index list
+  size_t bruteForceHits = 0;  // light/cluster pairs the brute-force test finds
+  size_t missing = 0;         // hits absent from a cluster that has room left
+  size_t capped = 0;          // hits dropped by a full cluster
+  size_t pointsChecked = 0;
+  size_t pointsMissing = 0;
+  unsigned int fullClusters = 0;
+  unsigned int maxPerCluster = 0;
+};
+
+// lights spread uniformly through the frustum volume in view space, then moved to world space with the
+// inverse view; a log depth distribution would pile them into the thin near slices and overflow those
+static std::vector<GpuPointLight> seedLights(size_t count, const glm::mat4 &projection, const glm::mat4 &view,
+                                             const ClusterGrid &grid, unsigned int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> unit(-1.1f, 1.1f), radiusDist(0.2f, 1.5f), volume(0.0f, 1.0f);
+  glm::mat4 invProjection = glm::inverse(projection);
+  glm::mat4 invView = glm::inverse(view);
+  std::vector<GpuPointLight> lights(count);
+  for (GpuPointLight &light : lights)
+  {
+    glm::vec4 ray = invProjection * glm::vec4(unit(rng), unit(rng), -1.0f, 1.0f);
+    glm::vec3 direction = glm::vec3(ray) / ray.w;
+    float depth = std::max(grid.zNear, grid.zFar * 0.8f * std::cbrt(volume(rng)));
+    glm::vec3 position = direction * (depth / -direction.z);
+    light.positionRadius = glm::vec4(glm::vec3(invView * glm::vec4(position, 1.0f)), radiusDist(rng));
+    light.color = glm::vec4(1.0f);
+  }
+  return lights;
+}
+
+static bool clusterLists(const std::vector<LightGridEntry> &lightGrid, const std::vector<uint32_t> &lightIndices,
+                         size_t cluster, uint32_t light)
+{
+  const LightGridEntry &entry = lightGrid[cluster];
+  auto begin = lightIndices.begin() + entry.offset;
+  return std::find(begin, begin + entry.count, light) != begin + entry.count;
+}
+
+static CullStats checkCase(const ClusterGrid &grid, const glm::mat4 &projection, const glm::mat4 &view,
+                           size_t lightCount, size_t samplesPerLight, unsigned int seed)
+{
+  std::vector<ClusterAABB> clusters = buildClusterBoundsCPU(grid, projection);
+  std::vector<GpuPointLight> lights = seedLights(lightCount, projection, view, grid, seed);
+  std::vector<LightGridEntry> lightGrid;
+  std::vector<uint32_t> lightIndices;
+  cullLightsCPU(clusters, view, lights, lightGrid, lightIndices);
+
+  CullStats stats;
+  stats.listed = lightIndices.size();
+  for (const LightGridEntry &entry : lightGrid)
+  {
+    stats.maxPerCluster = std::max(stats.maxPerCluster, entry.count);
+    if (entry.count >= MAX_LIGHTS_PER_CLUSTER)
+      stats.fullClusters++;
+  }
+
+  // every light sphere against every cluster AABB
+  for (size_t l = 0; l < lights.size(); l++)
+  {
+    glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[l].positionRadius), 1.0f));
+    float radius = lights[l].positionRadius.w;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+      if (!sphereIntersectsAABB(center, radius, clusters[c]))
+        continue;
+      stats.bruteForceHits++;
+      if (clusterLists(lightGrid, lightIndices, c, (uint32_t)l))
+        continue;
+      if (lightGrid[c].count >= MAX_LIGHTS_PER_CLUSTER)
+        stats.capped++;
+      else
+        stats.missing++;
+    }
+  }
+
+  // points inside each sphere, looked up the way the lighting pass does
+  const glm::vec2 screenSize(1920.0f, 1080.0f);
+  std::mt19937 rng(seed ^ 0x9e3779b9u);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  for (size_t l = 0; l < lights.size(); l++)
+  {
+    glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[l].positionRadius), 1.0f));
+    float radius = lights[l].positionRadius.w;
+    for (size_t s = 0; s < samplesPerLight; s++)
+    {
+      glm::vec3 offset(unit(rng), unit(rng), unit(rng));
+      if (glm::dot(offset, offset) > 1.0f)
+        continue;
+      glm::vec3 point = center + offset * radius;
+      if (-point.z <= grid.zNear || -point.z >= grid.zFar)
+        continue;
+      glm::vec4 clip = projection * glm::vec4(point, 1.0f);
+      glm::vec2 ndc = glm::vec2(clip) / clip.w;
+      if (std::fabs(ndc.x) >= 1.0f || std::fabs(ndc.y) >= 1.0f)
+        continue;
+
+      unsigned int cluster = clusterIndexForFragment(grid, (ndc * 0.5f + 0.5f) * screenSize, screenSize, point.z);
+      stats.pointsChecked++;
+      if (!clusterLists(lightGrid, lightIndices, cluster, (uint32_t)l) && lightGrid[cluster].count < MAX_LIGHTS_PER_CLUSTER)
+        stats.pointsMissing++;
+    }
+  }
+  return stats;
+}
+
+int main(int argc, char **argv)
+{
+  size_t samples = 32;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--samples") && i + 1 < argc)
+      samples = (size_t)std::max(1, std::atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "usage: ClusterCullReport [--samples N]\n");
+      return 2;
+    }
+  }
+
+  ClusterGrid grid;
+  const ProjectionCase projections[] = {
+      {"45 deg 16:9", 45.0f, 16.0f / 9.0f},
+      {"60 deg 4:3", 60.0f, 4.0f / 3.0f},
+      {"90 deg 21:9", 90.0f, 21.0f / 9.0f},
+      {"30 deg 1:1", 30.0f, 1.0f},
+  };
+  const size_t lightCounts[] = {32, 256, 1024, 4096};
+  glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+  printf("Cluster grid %ux%ux%u, near %.2f, far %.1f, %d lights per cluster max, %zu samples per light\n",
+         grid.dims.x, grid.dims.y, grid.dims.z, grid.zNear, grid.zFar, MAX_LIGHTS_PER_CLUSTER, samples);
+  printf("  %-12s %6s %9s %9s %8s %7s %5s %6s %10s %8s\n", "projection", "lights", "listed", "brute", "missing",
+         "capped", "max", "full", "points", "missed");
+
+  bool ok = true;
+  unsigned int seed = 1;
+  for (const ProjectionCase &p : projections)
+  {
+    glm::mat4 projection = glm::perspective(glm::radians(p.fovDegrees), p.aspect, grid.zNear, grid.zFar);
+    for (size_t count : lightCounts)
+    {
+      CullStats stats = checkCase(grid, projection, view, count, samples, seed++);
+      printf("  %-12s %6zu %9zu %9zu %8zu %7zu %5u %6u %10zu %8zu\n", p.name, count, stats.listed,
+             stats.bruteForceHits, stats.missing, stats.capped, stats.maxPerCluster, stats.fullClusters,
+             stats.pointsChecked, stats.pointsMissing);
+      if (stats.missing || stats.pointsMissing)
+      {
+        printf("\nFAIL: %s, %zu lights: %zu cluster hits and %zu sampled points are missing a light\n", p.name, count,
+               stats.missing, stats.pointsMissing);
+        ok = false;
+      }
+    }
+  }
+
+  if (ok)
+    printf("\nOK\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// Frustum culling check: feeds the same seeded boxes and frustums to the SIMD kernel (cullAABBs) and
+// the scalar reference (cullAABBsScalar) and requires identical index lists, not just equal counts.
+// Besides boxes scattered around the eye, every case includes boxes straddling a frustum plane,
+// boxes whose most inward corner lies exactly on one, flat and point boxes, and boxes that contain
+// the whole frustum. Exits with 1 on any difference. No GL context is created.
+//
+// usage: FrustumCullReport [--boxes N]
+
+#include <frustum_culling.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct FrustumCase
+{
+  const char *name;
+  glm::mat4 projection;
+  glm::vec3 eye;
+  glm::vec3 target;
+};
+
+static AABB boxAround(glm::vec3 center, glm::vec3 extents)
+{
+  return AABB{center - extents, center + extents};
+}
+
+// a box with the given extents moved along a plane's normal until dot(n, c) + d + dot(|n|, e) equals
+// `offset`: 0 puts its most inward corner on the plane, the sign of `offset` picks the side
+static AABB boxAgainstPlane(const glm::vec4 &plane, glm::vec3 center, glm::vec3 extents, float offset)
+{
+  glm::vec3 n(plane);
+  float reach = glm::dot(glm::abs(n), extents);
+  center -= n * (glm::dot(n, center) + plane.w + reach - offset);
+  return boxAround(center, extents);
+}
+
+static AABBSoA seedBoxes(size_t count, const Frustum &frustum, glm::vec3 eye, unsigned int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f), size(0.1f, 4.0f), offset(-1.0e-3f, 1.0e-3f);
+  std::uniform_int_distribution<int> planeDist(0, FRUSTUM_PLANE_COUNT - 1), kindDist(0, 7);
+  AABBSoA boxes;
+  boxes.reserve(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    glm::vec3 center = eye + glm::vec3(position(rng), position(rng) * 0.3f, position(rng));
+    glm::vec3 extents(size(rng), size(rng), size(rng));
+    const glm::vec4 &plane = frustum.planes[planeDist(rng)];
+    switch (kindDist(rng))
+    {
+    case 0: // straddling: center on the plane
+      boxes.push(boxAgainstPlane(plane, center, extents, glm::dot(glm::abs(glm::vec3(plane)), extents)));
+      break;
+    case 1: // most inward corner on the plane
+      boxes.push(boxAgainstPlane(plane, center, extents, 0.0f));
+      break;
+    case 2: // just either side of touching
+      boxes.push(boxAgainstPlane(plane, center, extents, offset(rng)));
+      break;
+    case 3: // flat in one axis, or a point
+      extents[planeDist(rng) % 3] = 0.0f;
+      if (i % 5 == 0)
+        extents = glm::vec3(0.0f);
+      boxes.push(boxAround(center, extents));
+      break;
+    case 4: // encloses the eye and the whole frustum
+      boxes.push(boxAround(eye, glm::vec3(500.0f)));
+      break;
+    default:
+      boxes.push(boxAround(center, extents));
+      break;
+    }
+  }
+  return boxes;
+}
+
+int main(int argc, char **argv)
+{
+  size_t boxCount = 100003; // not a multiple of 8, so the scalar tail runs too
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--boxes") && i + 1 < argc)
+      boxCount = (size_t)std::max(1, std::atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "usage: FrustumCullReport [--boxes N]\n");
+      return 2;
+    }
+  }
+
+#if defined(FRUSTUM_CULLING_AVX)
+  const char *kernel = "AVX, 8 per step";
+#elif defined(FRUSTUM_CULLING_SSE)
+  const char *kernel = "SSE2, 4 per step";
+#else
+  const char *kernel = "none, scalar fallback";
+#endif
+
+  const glm::vec3 up(0.0f, 1.0f, 0.0f);
+  const FrustumCase cases[] = {
+      {"45 deg, origin", glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)},
+      {"90 deg, tilted", glm::perspective(glm::radians(90.0f), 4.0f / 3.0f, 0.1f, 300.0f), glm::vec3(10.0f, 5.0f, -3.0f), glm::vec3(-20.0f, -4.0f, 30.0f)},
+      {"20 deg, far eye", glm::perspective(glm::radians(20.0f), 21.0f / 9.0f, 1.0f, 1000.0f), glm::vec3(500.0f, 80.0f, 500.0f), glm::vec3(0.0f)},
+      {"ortho, down", glm::ortho(-50.0f, 50.0f, -30.0f, 30.0f, 0.5f, 200.0f), glm::vec3(0.0f, 100.0f, 0.1f), glm::vec3(0.0f)},
+  };
+
+  printf("AABB frustum culling, %zu boxes per case, SIMD kernel: %s\n", boxCount, kernel);
+  printf("  %-16s %9s %9s %10s\n", "frustum", "scalar", "SIMD", "mismatch");
+
+  bool ok = true;
+  unsigned int seed = 1;
+  for (const FrustumCase &c : cases)
+  {
+    Frustum frustum = Frustum::fromMatrix(c.projection * glm::lookAt(c.eye, c.target, up));
+    AABBSoA boxes = seedBoxes(boxCount, frustum, c.eye, seed++);
+
+    std::vector<uint32_t> scalarVisible, simdVisible;
+    cullAABBsScalar(frustum, boxes, scalarVisible);
+    cullAABBs(frustum, boxes, simdVisible);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < std::max(scalarVisible.size(), simdVisible.size()); i++)
+      if (i >= scalarVisible.size() || i >= simdVisible.size() || scalarVisible[i] != simdVisible[i])
+        mismatches++;
+    printf("  %-16s %9zu %9zu %10zu\n", c.name, scalarVisible.size(), simdVisible.size(), mismatches);
+    if (mismatches)
+    {
+      printf("\nFAIL: %s: %zu list positions differ between the SIMD and scalar kernels\n", c.name, mismatches);
+      ok = false;
+    }
+  }
+
+  if (ok)
+    printf("\nOK\n");
+  return ok ? 0 : 1;
+}
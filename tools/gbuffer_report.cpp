@@ -0,0 +1,205 @@
+// G-buffer encoding check: measures the angular error of the octahedral RG16 normal encoding
+// (gbuffer_encoding.h, the CPU mirror of gbuffer_encoding.glsl) against the alternatives, the error of
+// positions rebuilt from a 32-bit float depth buffer, and prints the per-frame traffic estimate of the
+// old and new G-buffer layouts. Exits with 1 if the RG16 normals or the reconstruction exceed
+// their error bounds, so it can run as a check. No GL context is created.
+//
+// usage: GBufferReport [--samples N]
+
+#include <gbuffer_encoding.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static const float MAX_NORMAL_ERROR_DEGREES = 0.01f;
+static const float MAX_POSITION_RELATIVE_ERROR = 1.0e-3f;
+
+struct ErrorStats
+{
+  double maxDegrees = 0.0;
+  double sumDegrees = 0.0;
+  size_t count = 0;
+  glm::vec3 worst = glm::vec3(0.0f);
+
+  // chord-based angle in double: acos of a float dot product bottoms out around 0.02 degrees
+  void add(const glm::vec3 &n, const glm::vec3 &decoded)
+  {
+    glm::dvec3 a = glm::normalize(glm::dvec3(n)), b = glm::normalize(glm::dvec3(decoded));
+    double degrees = 2.0 * std::asin(std::min(1.0, 0.5 * glm::length(a - b))) * 180.0 / 3.14159265358979323846;
+    if (degrees > maxDegrees)
+    {
+      maxDegrees = degrees;
+      worst = n;
+    }
+    sumDegrees += degrees;
+    count++;
+  }
+};
+
+// the encoder deferred.fs used before: sign() is 0 on the axes, so -Z folds onto +Z
+static glm::vec2 octEncodeSign(glm::vec3 n)
+{
+  n /= std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+  glm::vec2 p(n.x, n.y);
+  if (n.z < 0.0f)
+    p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::sign(p);
+  return p;
+}
+
+static float quantizeUnorm8(float v)
+{
+  return std::round(glm::clamp(v, 0.0f, 1.0f) * 255.0f) / 255.0f;
+}
+
+// Fibonacci sphere plus the axes, octant diagonals and near-axis directions the fold is sensitive to
+static std::vector<glm::vec3> testNormals(size_t samples)
+{
+  std::vector<glm::vec3> normals;
+  normals.reserve(samples + 64);
+  const double golden = 3.14159265358979323846 * (3.0 - std::sqrt(5.0));
+  for (size_t i = 0; i < samples; i++)
+  {
+    double y = 1.0 - 2.0 * (i + 0.5) / samples;
+    double r = std::sqrt(1.0 - y * y);
+    double phi = golden * i;
+    normals.push_back(glm::vec3((float)(std::cos(phi) * r), (float)y, (float)(std::sin(phi) * r)));
+  }
+  for (int axis = 0; axis < 3; axis++)
+    for (float s : {-1.0f, 1.0f})
+    {
+      glm::vec3 n(0.0f);
+      n[axis] = s;
+      normals.push_back(n);
+      for (float e : {1.0e-6f, -1.0e-6f})
+      {
+        glm::vec3 tilted = n;
+        tilted[(axis + 1) % 3] = e;
+        normals.push_back(glm::normalize(tilted));
+      }
+    }
+  for (int octant = 0; octant < 8; octant++)
+    normals.push_back(glm::normalize(glm::vec3(octant & 1 ? -1.0f : 1.0f, octant & 2 ? -1.0f : 1.0f, octant & 4 ? -1.0f : 1.0f)));
+  return normals;
+}
+
+static void printNormalRow(const char *name, const char *bytes, const ErrorStats &stats)
+{
+  printf("  %-28s %-8s max %10.5f deg  mean %10.6f deg  (worst at %+.3f %+.3f %+.3f)\n", name, bytes, stats.maxDegrees,
+         stats.sumDegrees / std::max<size_t>(stats.count, 1), stats.worst.x, stats.worst.y, stats.worst.z);
+}
+
+int main(int argc, char **argv)
+{
+  size_t samples = 1000000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--samples") && i + 1 < argc)
+      samples = (size_t)std::max(1, std::atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "usage: GBufferReport [--samples N]\n");
+      return 2;
+    }
+  }
+
+  // normals
+  std::vector<glm::vec3> normals = testNormals(samples);
+  ErrorStats rg16, rg8, half, signVariant;
+  for (const glm::vec3 &n : normals)
+  {
+    rg16.add(n, unpackNormalRG16(packNormalRG16(n)));
+
+    glm::vec2 e = octEncode(n) * 0.5f + 0.5f;
+    rg8.add(n, octDecode(glm::vec2(quantizeUnorm8(e.x), quantizeUnorm8(e.y)) * 2.0f - 1.0f));
+
+    glm::vec3 h(glm::unpackHalf1x16(glm::packHalf1x16(n.x)), glm::unpackHalf1x16(glm::packHalf1x16(n.y)),
+                glm::unpackHalf1x16(glm::packHalf1x16(n.z)));
+    half.add(n, h);
+
+    glm::vec2 s = octEncodeSign(n) * 0.5f + 0.5f;
+    signVariant.add(n, octDecode(glm::vec2(quantizeUnorm16(s.x), quantizeUnorm16(s.y)) / 65535.0f * 2.0f - 1.0f));
+  }
+  printf("Normal encoding, %zu directions\n", normals.size());
+  printNormalRow("octahedral RG16 (current)", "4 B", rg16);
+  printNormalRow("octahedral RG8", "2 B", rg8);
+  printNormalRow("xyz RGBA16F", "8 B", half);
+  printNormalRow("octahedral RG16, sign()", "4 B", signVariant);
+
+  // positions rebuilt from a DEPTH32F value with the inverse matrices CameraBlock carries
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 viewProjection = projection * view;
+  glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+  const float bucketEdges[] = {1.0f, 5.0f, 20.0f, 50.0f, 100.0f};
+  double bucketMax[5] = {}, bucketAbsolute[5] = {};
+  std::mt19937 rng(21);
+  std::uniform_real_distribution<float> unit(-0.95f, 0.95f), distanceDist(0.2f, 99.0f);
+  glm::mat4 inverseView = glm::inverse(view);
+  for (size_t i = 0; i < samples; i++)
+  {
+    // a point at a given view distance somewhere inside the frustum
+    float distance = distanceDist(rng);
+    glm::vec4 ndcFar = glm::inverse(projection) * glm::vec4(unit(rng), unit(rng), 1.0f, 1.0f);
+    glm::vec3 direction = glm::normalize(glm::vec3(ndcFar) / ndcFar.w);
+    glm::vec3 world = glm::vec3(inverseView * glm::vec4(direction * (distance / -direction.z), 1.0f));
+
+    glm::vec4 clip = viewProjection * glm::vec4(world, 1.0f);
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    float depth = ndc.z * 0.5f + 0.5f; // what lands in the float depth buffer
+    glm::vec3 rebuilt = reconstructPosition(glm::vec2(ndc) * 0.5f + 0.5f, depth, inverseViewProjection);
+
+    double error = glm::length(rebuilt - world);
+    int bucket = 0;
+    while (bucket < 4 && distance > bucketEdges[bucket])
+      bucket++;
+    bucketAbsolute[bucket] = std::max(bucketAbsolute[bucket], error);
+    bucketMax[bucket] = std::max(bucketMax[bucket], error / distance);
+  }
+  printf("\nPosition from DEPTH32F (near 0.1, far 100), %zu points\n", samples);
+  double worstRelative = 0.0;
+  for (int b = 0; b < 5; b++)
+  {
+    printf("  view depth <= %5.1f: max error %.6f (%.2e relative)\n", bucketEdges[b], bucketAbsolute[b], bucketMax[b]);
+    worstRelative = std::max(worstRelative, bucketMax[b]);
+  }
+
+  // traffic
+  printf("\nG-buffer traffic per frame (one write, one read per full-screen pass that samples a target)\n");
+  for (const GBufferLayoutInfo *layout : {&GBUFFER_LAYOUT_LEGACY, &GBUFFER_LAYOUT_COMPACT})
+  {
+    printf("  %s layout, %u B/pixel:\n", layout->name, layout->bytesPerPixel());
+    for (unsigned int t = 0; t < layout->targetCount; t++)
+      printf("    %-28s %-9s %u B, read by %u pass(es)\n", layout->targets[t].name, layout->targets[t].format,
+             layout->targets[t].bytesPerPixel, layout->targets[t].fullscreenReads);
+  }
+  const int resolutions[][2] = {{1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+  printf("  %-11s %14s %14s %8s\n", "resolution", "legacy MB", "compact MB", "saved");
+  for (const auto &r : resolutions)
+  {
+    double legacy = GBUFFER_LAYOUT_LEGACY.frameBytes(r[0], r[1]) / (1024.0 * 1024.0);
+    double compact = GBUFFER_LAYOUT_COMPACT.frameBytes(r[0], r[1]) / (1024.0 * 1024.0);
+    printf("  %4dx%-6d %14.1f %14.1f %7.1f%%\n", r[0], r[1], legacy, compact, 100.0 * (1.0 - compact / legacy));
+  }
+
+  bool ok = true;
+  if (rg16.maxDegrees > MAX_NORMAL_ERROR_DEGREES)
+  {
+    printf("\nFAIL: RG16 normal error %.5f deg exceeds %.5f deg\n", rg16.maxDegrees, MAX_NORMAL_ERROR_DEGREES);
+    ok = false;
+  }
+  if (worstRelative > MAX_POSITION_RELATIVE_ERROR)
+  {
+    printf("\nFAIL: reconstructed position error %.2e exceeds %.2e relative\n", worstRelative, MAX_POSITION_RELATIVE_ERROR);
+    ok = false;
+  }
+  if (ok)
+    printf("\nOK\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// Offline LOD report: imports models, builds each mesh's LOD chain with the given settings and
+// prints per level the triangle reduction, the stored error and the measured error (the largest
+// distance from sampled LOD 0 vertices to the level's surface). With --cook the chains are also
+// written into the ".meshcache" files Model loads. No GL context is created.
+//
+// Exits with 1 when a model fails to import or cook, when a level's measured error exceeds its
+// stored error by more than the tolerance (a relative margin, since the stored error comes from
+// plane quadrics and the measurement from sampled vertices), or when a chain is not monotonic:
+// every level must have fewer triangles and no smaller stored error than the one before, which is
+// what selectLod() assumes.
+//
+// usage: LodBuilder [--lods N] [--ratio R] [--min-triangles N] [--samples N] [--tolerance T] [--cook] <model> [<model> ...]
+
+#include <mesh_cache.h>
+#include <mesh_lod.h>
+#include <model_import.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// distance from p to triangle abc (closest point by Voronoi region, Ericson 5.1.5)
+static float pointTriangleDistance(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+  glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+  float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f)
+    return glm::length(p - a);
+  glm::vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3)
+    return glm::length(p - b);
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+  glm::vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6)
+    return glm::length(p - c);
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+  float denom = 1.0f / (va + vb + vc);
+  return glm::length(p - (a + ab * (vb * denom) + ac * (vc * denom)));
+}
+
+// largest distance from (at most `samples`) LOD 0 vertices to the triangles of `lod`
+static float measureError(const ImportedMesh &mesh, const MeshLod &lod, size_t samples)
+{
+  const MeshLod &base = mesh.lods[0];
+  size_t step = std::max<size_t>(1, base.indexCount / std::max<size_t>(samples, 1));
+  float worst = 0.0f;
+  for (size_t i = base.firstIndex; i < (size_t)base.firstIndex + base.indexCount; i += step)
+  {
+    const glm::vec3 &p = mesh.vertices[mesh.indices[i]].position;
+    float nearest = std::numeric_limits<float>::max();
+    for (size_t t = lod.firstIndex; t + 2 < (size_t)lod.firstIndex + lod.indexCount && nearest > worst; t += 3)
+      nearest = std::min(nearest, pointTriangleDistance(p, mesh.vertices[mesh.indices[t]].position,
+                                                        mesh.vertices[mesh.indices[t + 1]].position,
+                                                        mesh.vertices[mesh.indices[t + 2]].position));
+    worst = std::max(worst, nearest);
+  }
+  return worst;
+}
+
+int main(int argc, char **argv)
+{
+  LodBuildSettings settings;
+  size_t samples = 1000;
+  float tolerance = 0.1f;
+  bool cook = false;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--lods" && i + 1 < argc)
+      settings.maxLods = (unsigned int)std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--ratio" && i + 1 < argc)
+      settings.reduction = (float)std::atof(argv[++i]);
+    else if (arg == "--min-triangles" && i + 1 < argc)
+      settings.minTriangles = (unsigned int)std::atoi(argv[++i]);
+    else if (arg == "--samples" && i + 1 < argc)
+      samples = (size_t)std::atol(argv[++i]);
+    else if (arg == "--tolerance" && i + 1 < argc)
+      tolerance = (float)std::atof(argv[++i]);
+    else if (arg == "--cook")
+      cook = true;
+    else
+      paths.push_back(arg);
+  }
+  if (paths.empty() || settings.reduction <= 0.0f || settings.reduction >= 1.0f || tolerance < 0.0f)
+  {
+    std::cout << "usage: " << argv[0] << " [--lods N] [--ratio R (0-1)] [--min-triangles N] [--samples N] [--tolerance T] [--cook] <model> [<model> ...]" << std::endl;
+    return 1;
+  }
+
+  int failures = 0;
+  for (const std::string &path : paths)
+  {
+    std::vector<ImportedMesh> meshes;
+    if (!ModelImporter::import(path, meshes))
+    {
+      failures++;
+      continue;
+    }
+
+    std::cout << path << ": " << meshes.size() << " meshes" << std::endl;
+    size_t totalBase = 0, totalCoarsest = 0;
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+      ImportedMesh &mesh = meshes[m];
+      // the importer built the default chain; rebuild from LOD 0 with these settings
+      mesh.indices.resize(mesh.lods[0].indexCount);
+      auto start = std::chrono::steady_clock::now();
+      mesh.lods = buildMeshLods(mesh.vertices, mesh.indices, settings);
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      float radius = computeMeshBounds(mesh.vertices).sphere.radius;
+      std::printf("  mesh %zu: %zu vertices, %zu levels in %.1f ms, bounding radius %.4f\n",
+                  m, mesh.vertices.size(), mesh.lods.size(), ms, radius);
+      std::printf("    lod  triangles  of lod0   stored error  measured error  (%% of radius)\n");
+      for (size_t l = 0; l < mesh.lods.size(); l++)
+      {
+        const MeshLod &lod = mesh.lods[l];
+        float measured = l == 0 ? 0.0f : measureError(mesh, lod, samples);
+        std::printf("    %3zu  %9u  %6.1f%%   %12.6f  %14.6f  (%.3f%%)\n", l, lod.indexCount / 3,
+                    100.0 * lod.indexCount / std::max(1u, mesh.lods[0].indexCount), lod.error, measured,
+                    radius > 0.0f ? 100.0f * measured / radius : 0.0f);
+
+        // a float floor relative to the mesh size, so flat levels with error ~0 do not trip on rounding
+        float allowed = lod.error * (1.0f + tolerance) + 1.0e-5f * radius;
+        if (measured > allowed)
+        {
+          std::printf("    FAIL: lod %zu measured error %.6f exceeds its stored error %.6f\n", l, measured, lod.error);
+          failures++;
+        }
+        if (l > 0 && lod.indexCount >= mesh.lods[l - 1].indexCount)
+        {
+          std::printf("    FAIL: lod %zu has no fewer triangles than lod %zu\n", l, l - 1);
+          failures++;
+        }
+        if (l > 0 && lod.error < mesh.lods[l - 1].error)
+        {
+          std::printf("    FAIL: lod %zu stores a smaller error than lod %zu\n", l, l - 1);
+          failures++;
+        }
+      }
+      totalBase += mesh.lods[0].indexCount / 3;
+      totalCoarsest += mesh.lods.back().indexCount / 3;
+    }
+    std::printf("  total: %zu -> %zu triangles at the coarsest level (%.1f%%)\n", totalBase, totalCoarsest,
+                totalBase ? 100.0 * totalCoarsest / totalBase : 0.0);
+
+    if (cook)
+    {
+      std::string cachePath = path + COOKED_MESH_EXTENSION;
+      if (!writeCookedMeshFile(cachePath, path, meshes))
+        failures++;
+      else
+        std::cout << "  wrote " << cachePath << std::endl;
+    }
+  }
+  if (failures == 0)
+    std::cout << "\nOK" << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+// Meshlet culling check: culls seeded meshlet bounds from several eye positions and model transforms
+// with the SIMD kernel (cullMeshlets) and the scalar reference (cullMeshletsScalar) and requires the
+// same survivor list and the same frustum / cone counts from both. A share of the meshlets is placed
+// exactly on a frustum plane or on the cone test's limit, where a kernel that rounds differently would
+// disagree. Exits with 1 on any difference. No GL context is created.
+//
+// usage: MeshletCullReport [--meshlets N]
+
+#include <meshlet.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct EyeCase
+{
+  const char *name;
+  glm::vec3 eye;
+  glm::vec3 target;
+};
+
+struct TransformCase
+{
+  const char *name;
+  glm::mat4 model;
+};
+
+static void pushMeshlet(MeshletSoA &m, glm::vec3 center, float radius, glm::vec3 axis, float cutoff)
+{
+  m.cx.push_back(center.x), m.cy.push_back(center.y), m.cz.push_back(center.z);
+  m.radius.push_back(radius);
+  m.ax.push_back(axis.x), m.ay.push_back(axis.y), m.az.push_back(axis.z);
+  m.cutoff.push_back(cutoff);
+  m.triangles.push_back(MESHLET_MAX_TRIANGLES);
+}
+
+// random bounds in the mesh's local space; every fourth meshlet sits on a plane of `view` (its sphere
+// just touching it from outside) and every fourth on the cone limit dot(d, axis) = cutoff * |d| + radius
+static MeshletSoA seedMeshlets(size_t count, const MeshletCullView &view, unsigned int seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> position(-30.0f, 30.0f), unit(-1.0f, 1.0f), radiusDist(0.05f, 2.0f), cutoffDist(0.0f, 1.0f);
+  std::uniform_int_distribution<int> planeDist(0, FRUSTUM_PLANE_COUNT - 1);
+  MeshletSoA m;
+  for (size_t i = 0; i < count; i++)
+  {
+    glm::vec3 center(position(rng), position(rng), position(rng));
+    float radius = radiusDist(rng);
+    glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1.0e-3f));
+    float cutoff = i % 8 == 7 ? 1.0f : cutoffDist(rng); // cutoff 1 disables the cone test for that meshlet
+    if (i % 4 == 1)
+    {
+      const glm::vec4 &plane = view.planes[planeDist(rng)];
+      center -= glm::vec3(plane) * (glm::dot(glm::vec3(plane), center) + plane.w + radius);
+    }
+    else if (i % 4 == 2)
+    {
+      glm::vec3 d = center - view.eye;
+      float limit = glm::dot(d, axis) - cutoff * glm::length(d);
+      if (limit > 0.0f)
+        radius = limit;
+    }
+    pushMeshlet(m, center, radius, axis, cutoff);
+  }
+  return m;
+}
+
+static bool sameStats(const MeshletCullStats &a, const MeshletCullStats &b)
+{
+  return a.meshlets == b.meshlets && a.meshletsVisible == b.meshletsVisible && a.triangles == b.triangles &&
+         a.frustumCulledTriangles == b.frustumCulledTriangles && a.coneCulledTriangles == b.coneCulledTriangles;
+}
+
+int main(int argc, char **argv)
+{
+  size_t meshletCount = 4099; // not a multiple of 8, so the scalar tail runs too
+  for (int i = 1; i < argc; i++)
+  {
+    if (!std::strcmp(argv[i], "--meshlets") && i + 1 < argc)
+      meshletCount = (size_t)std::max(1, std::atoi(argv[++i]));
+    else
+    {
+      fprintf(stderr, "usage: MeshletCullReport [--meshlets N]\n");
+      return 2;
+    }
+  }
+
+#if defined(FRUSTUM_CULLING_AVX)
+  const char *kernel = "AVX, 8 per step";
+#elif defined(FRUSTUM_CULLING_SSE)
+  const char *kernel = "SSE2, 4 per step";
+#else
+  const char *kernel = "none, scalar fallback";
+#endif
+
+  const EyeCase eyes[] = {
+      {"origin", glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)},
+      {"outside", glm::vec3(40.0f, 10.0f, 40.0f), glm::vec3(0.0f)},
+      {"above", glm::vec3(0.0f, 35.0f, 0.1f), glm::vec3(0.0f)},
+      {"inside", glm::vec3(3.0f, -2.0f, 5.0f), glm::vec3(-10.0f, 4.0f, -20.0f)},
+  };
+  const TransformCase transforms[] = {
+      {"identity", glm::mat4(1.0f)},
+      {"rotate+scale", glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -5.0f)), 0.7f,
+                                              glm::normalize(glm::vec3(1.0f, 2.0f, 0.5f))),
+                                  glm::vec3(1.5f, 0.5f, 2.0f))},
+      {"mirrored", glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f, 1.0f, 1.0f))}, // cone test is skipped
+  };
+  const bool toggles[][2] = {{true, true}, {true, false}, {false, true}};
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+  printf("Meshlet culling, %zu meshlets per case, SIMD kernel: %s\n", meshletCount, kernel);
+  printf("  %-8s %-13s %-7s %-5s %8s %9s %7s %10s\n", "eye", "transform", "frustum", "cone", "visible", "off-frust",
+         "backface", "mismatch");
+
+  bool ok = true;
+  unsigned int seed = 1;
+  for (const EyeCase &e : eyes)
+    for (const TransformCase &t : transforms)
+      for (const auto &toggle : toggles)
+      {
+        MeshletCullSettings settings;
+        settings.frustum = toggle[0];
+        settings.cone = toggle[1];
+        Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(e.eye, e.target, glm::vec3(0.0f, 1.0f, 0.0f)));
+        MeshletCullView view = MeshletCullView::forTransform(frustum, e.eye, t.model, settings);
+        MeshletSoA meshlets = seedMeshlets(meshletCount, view, seed++);
+
+        std::vector<uint32_t> scalarVisible, simdVisible;
+        MeshletCullStats scalarStats, simdStats;
+        cullMeshletsScalar(view, meshlets, scalarVisible, &scalarStats);
+        cullMeshlets(view, meshlets, simdVisible, &simdStats);
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < std::max(scalarVisible.size(), simdVisible.size()); i++)
+          if (i >= scalarVisible.size() || i >= simdVisible.size() || scalarVisible[i] != simdVisible[i])
+            mismatches++;
+        printf("  %-8s %-13s %-7s %-5s %8u %9u %7u %10zu\n", e.name, t.name, toggle[0] ? "on" : "off", toggle[1] ? "on" : "off",
+               scalarStats.meshletsVisible, scalarStats.frustumCulledTriangles / MESHLET_MAX_TRIANGLES,
+               scalarStats.coneCulledTriangles / MESHLET_MAX_TRIANGLES, mismatches);
+        if (mismatches || !sameStats(scalarStats, simdStats))
+        {
+          printf("\nFAIL: %s / %s: SIMD kept %zu meshlets, scalar %zu, %zu list positions differ\n", e.name, t.name,
+                 simdVisible.size(), scalarVisible.size(), mismatches);
+          ok = false;
+        }
+      }
+
+  if (ok)
+    printf("\nOK\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Offline texture cooker: block-compresses images with a full mip chain and writes "<image>.dds"
+// next to each source. The texture streamer picks these up instead of decoding the PNG/JPEG and
+// generating mips at load time. No GL context is created.
+//
+// usage: TextureCooker [--format auto|bc1|bc3|bc4|bc5|bc7] <image> [<image> ...]
+//   auto (default): BC1 for opaque images, BC3 if any pixel has alpha
+//   bc4: single channel (red), bc5: two channels (red/green, e.g. XY normal maps)
+
+#include <dds_texture.h>
+#include <stb_image.h>
+#include <texture_compress.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static bool parseFormat(const std::string &name, bool &automatic, TextureBlockFormat &format)
+{
+  automatic = false;
+  if (name == "auto")
+    automatic = true;
+  else if (name == "bc1")
+    format = BLOCK_BC1;
+  else if (name == "bc3")
+    format = BLOCK_BC3;
+  else if (name == "bc4")
+    format = BLOCK_BC4;
+  else if (name == "bc5")
+    format = BLOCK_BC5;
+  else if (name == "bc7")
+    format = BLOCK_BC7;
+  else
+    return false;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  bool automatic = true;
+  TextureBlockFormat format = BLOCK_BC1;
+  int failures = 0, cooked = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--format" && i + 1 < argc)
+    {
+      if (!parseFormat(argv[++i], automatic, format))
+      {
+        std::cout << "unknown format " << argv[i] << std::endl;
+        return 1;
+      }
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int width, height, components;
+    unsigned char *pixels = stbi_load(arg.c_str(), &width, &height, &components, 4);
+    if (!pixels)
+    {
+      std::cout << "Texture failed to load at path: " << arg << " (" << stbi_failure_reason() << ")" << std::endl;
+      failures++;
+      continue;
+    }
+
+    TextureBlockFormat chosen = automatic ? chooseBlockFormat(pixels, width, height) : format;
+    CompressedTexture texture = compressWithMips(chosen, pixels, (uint32_t)width, (uint32_t)height);
+    stbi_image_free(pixels);
+
+    std::string outPath = arg + COOKED_TEXTURE_EXTENSION;
+    if (!writeDDSTexture(outPath, texture, arg))
+    {
+      failures++;
+      continue;
+    }
+    cooked++;
+
+    // what the runtime path would have uploaded: source channels plus a third for generated mips
+    double uncompressed = (double)width * height * components * 4.0 / 3.0;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Cooked " << arg << " -> " << outPath << ": " << width << "x" << height << " BC" << (int)chosen << ", "
+              << texture.mips.size() << " mips, " << texture.data.size() / 1024 << " KB (" << uncompressed / texture.data.size()
+              << "x smaller, " << ms << " ms)" << std::endl;
+  }
+
+  if (cooked == 0 && failures == 0)
+  {
+    std::cout << "usage: " << argv[0] << " [--format auto|bc1|bc3|bc4|bc5|bc7] <image> [<image> ...]" << std::endl;
+    return 1;
+  }
+  return failures == 0 ? 0 : 1;
+}